@@ -0,0 +1,50 @@
+# -----------------------------------------------------------------------------
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# xfe-control-sim
+# Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY and FITNESS for a particular purpose. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+# -----------------------------------------------------------------------------
+
+# `bench` target: builds and runs the micro-benchmarks, writing machine-readable JSON results.
+#   cmake --build <build-dir> --target bench
+if(NOT TARGET xfe_control_sim_bench)
+	return()
+endif()
+
+set(XFE_BENCH_RESULTS_DIR "${CMAKE_BINARY_DIR}/bench" CACHE PATH "Directory the bench target writes its JSON results to")
+
+set(XFE_BENCH_COMMANDS
+	COMMAND ${CMAKE_COMMAND} -E make_directory ${XFE_BENCH_RESULTS_DIR}
+	COMMAND $<TARGET_FILE:xfe_control_sim_bench> --output ${XFE_BENCH_RESULTS_DIR}/bench_results.json
+)
+set(XFE_BENCH_DEPENDS xfe_control_sim_bench)
+
+# the DISCON call-latency benchmark needs the shared controller library and its test host
+if(TARGET qblade_interface_test)
+	list(APPEND XFE_BENCH_COMMANDS
+		COMMAND $<TARGET_FILE:qblade_interface_test> --bench ${XFE_BENCH_RESULTS_DIR}/bench_discon.json
+	)
+	list(APPEND XFE_BENCH_DEPENDS qblade_interface_test)
+endif()
+
+add_custom_target(bench
+	${XFE_BENCH_COMMANDS}
+	DEPENDS ${XFE_BENCH_DEPENDS}
+	WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+	COMMENT "Running benchmarks, results in ${XFE_BENCH_RESULTS_DIR}"
+	USES_TERMINAL
+	VERBATIM
+)
@@ -21,4 +21,5 @@
 find_package(jansson REQUIRED)
 find_package(libmodbus REQUIRED)
 find_package(GSL REQUIRED)
-find_package(xflowutils REQUIRED)
\ No newline at end of file
+find_package(xflowutils REQUIRED)
+find_package(Threads REQUIRED)
\ No newline at end of file
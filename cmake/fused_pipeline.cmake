@@ -0,0 +1,72 @@
+# -----------------------------------------------------------------------------
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# xfe-control-sim
+# Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY and FITNESS for a particular purpose. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+# -----------------------------------------------------------------------------
+
+# Fused pipeline build: reads the hot-path *_function_call choices from the system config at
+# configure time and binds them statically (MAKE_STAGE_DEFINE_BOUND in make_stage.h), so with
+# LTO the integrator, eom, flow_sim_model, drivetrain and turbine_control inline into one step.
+# Runtime dispatch stays the default; a config that selects other functions still runs.
+option(XFE_FUSED_PIPELINE "Bind the configured integrator, eom and model stages at build time" OFF)
+
+if(NOT XFE_FUSED_PIPELINE OR NOT TARGET xfe-control-sim-lib)
+	return()
+endif()
+
+set(XFE_FUSED_CONFIG_CSV "${XFE_CONTROL_SIM_CONFIG_DIR}/${SYSTEM_CONFIG_FILENAME}")
+if(NOT EXISTS "${XFE_FUSED_CONFIG_CSV}")
+	message(FATAL_ERROR "XFE_FUSED_PIPELINE: system config ${XFE_FUSED_CONFIG_CSV} not found")
+endif()
+
+# re-run the configure step (and rebind) whenever the config is edited
+set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${XFE_FUSED_CONFIG_CSV}")
+
+set(XFE_FUSED_STAGES
+	numerical_integrator
+	eom
+	flow_sim_model
+	drivetrain
+	turbine_control
+)
+
+set(XFE_FUSED_COMPILE_DEFINITIONS XFE_FUSED_PIPELINE=1)
+foreach(stage IN LISTS XFE_FUSED_STAGES)
+	# config rows are variable_name,data_type,dynamic_or_fixed,value[,...]
+	file(STRINGS "${XFE_FUSED_CONFIG_CSV}" stage_row REGEX "^${stage}_function_call,")
+	if(NOT stage_row MATCHES "^${stage}_function_call,[^,]*,[^,]*,([A-Za-z_][A-Za-z0-9_]*)")
+		message(FATAL_ERROR "XFE_FUSED_PIPELINE: no valid ${stage}_function_call in ${XFE_FUSED_CONFIG_CSV}")
+	endif()
+	string(TOUPPER "${stage}" stage_macro)
+	list(APPEND XFE_FUSED_COMPILE_DEFINITIONS XFE_FUSED_${stage_macro}=${CMAKE_MATCH_1})
+	message(STATUS "XFE_FUSED_PIPELINE: ${stage} bound to ${CMAKE_MATCH_1}")
+endforeach()
+
+target_compile_definitions(xfe-control-sim-lib PRIVATE ${XFE_FUSED_COMPILE_DEFINITIONS})
+
+# the stages live in separate translation units, so inlining across them needs LTO
+include(CheckIPOSupported)
+check_ipo_supported(RESULT fused_ipo_supported OUTPUT fused_ipo_output)
+if(fused_ipo_supported)
+	foreach(fused_target xfe-control-sim-lib xfe_control_sim xfe_control_sim_bench)
+		if(TARGET ${fused_target})
+			set_target_properties(${fused_target} PROPERTIES INTERPROCEDURAL_OPTIMIZATION TRUE)
+		endif()
+	endforeach()
+else()
+	message(WARNING "XFE_FUSED_PIPELINE: LTO not supported (${fused_ipo_output}), stages are bound but not inlined across files")
+endif()
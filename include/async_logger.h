@@ -0,0 +1,57 @@
+/**
+ * @file    async_logger.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Background writer thread for continuous dynamic data logging
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stdio.h>          // for FILE
+#include <time.h>           // for timespec
+
+#define ASYNC_LOGGER_DEFAULT_RING_ROWS 4096
+#define ASYNC_LOGGER_STRING_WIDTH 128 // bytes copied per string parameter in a snapshot
+
+/**
+ * @brief What `async_logger_push` does when the ring is full.
+ */
+typedef enum
+{
+	ASYNC_LOGGER_OVERFLOW_BLOCK, // wait for the writer to free a slot (no data loss)
+	ASYNC_LOGGER_OVERFLOW_DROP   // discard the snapshot and count it (never stalls the caller)
+} async_logger_overflow_t;
+
+/**
+ * @brief Row writer run on the background thread, e.g. `write_dynamic_data_csv_row`.
+ */
+typedef int (*async_logger_row_writer_fn)(FILE *file, const struct timespec ts, const param_array_t *data);
+
+int async_logger_start(FILE *file, async_logger_row_writer_fn row_writer, const param_array_t *data, int ring_rows, async_logger_overflow_t overflow);
+void async_logger_push(const param_array_t *data);
+void async_logger_stop(void);
+bool async_logger_running(void);
+
+#endif // ASYNC_LOGGER_H
@@ -0,0 +1,79 @@
+/**
+ * @file    binary_logger.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Fixed-width binary backend for continuous dynamic data logging
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_LOGGER_H
+#define BINARY_LOGGER_H
+
+#include "xfe_control_sim_common.h" // for csv_logger_action_t
+#include "xflow_aero_sim.h"         // for param_array_t
+#include <stddef.h>                 // for size_t
+#include <stdint.h>                 // for uint32_t
+#include <stdio.h>                  // for FILE
+#include <time.h>                   // for timespec
+
+/*
+ * .xfelog layout (all integers little/native endian, see byte_order_mark):
+ *
+ *   xfe_binary_log_header_t
+ *   n_columns x { uint16 type, uint16 name_len, char name[name_len] }
+ *   zero padding up to header_size (multiple of 8)
+ *   rows of row_size bytes, columns packed in header order
+ *
+ * Column 0 is always `epoch_time` (float64). Strings are stored in a
+ * fixed XFE_BINARY_LOG_STRING_WIDTH byte, NUL padded field.
+ */
+#define XFE_BINARY_LOG_MAGIC "XFELOG\0\0"
+#define XFE_BINARY_LOG_MAGIC_SIZE 8
+#define XFE_BINARY_LOG_VERSION 1U
+#define XFE_BINARY_LOG_BYTE_ORDER_MARK 0x01020304U
+#define XFE_BINARY_LOG_STRING_WIDTH 32
+#define XFE_BINARY_LOG_EXTENSION ".xfelog"
+
+typedef enum
+{
+	XFE_BINARY_LOG_INT32 = 1,
+	XFE_BINARY_LOG_FLOAT64 = 2,
+	XFE_BINARY_LOG_STRING = 3
+} xfe_binary_log_type_t;
+
+typedef struct
+{
+	char magic[XFE_BINARY_LOG_MAGIC_SIZE]; // XFE_BINARY_LOG_MAGIC
+	uint32_t version;                      // XFE_BINARY_LOG_VERSION
+	uint32_t byte_order_mark;              // XFE_BINARY_LOG_BYTE_ORDER_MARK as written by the producer
+	uint32_t header_size;                  // offset of the first row in bytes
+	uint32_t n_columns;                    // number of column descriptors, including epoch_time
+	uint32_t row_size;                     // bytes per row
+	uint32_t string_width;                 // bytes per string column
+	double dt;                             // simulation time step in seconds (0 if unknown)
+} xfe_binary_log_header_t;
+
+int write_dynamic_data_binary_row(FILE *file, const struct timespec ts, const param_array_t *data);
+void dynamic_data_binary_logger(FILE **file, const csv_logger_action_t action, const char *filename, const param_array_t *data);
+void binary_log_path_from_csv(char *out, size_t out_size, const char *csv_path);
+void set_binary_logger_dt(double dt);
+
+#endif // BINARY_LOGGER_H
@@ -130,6 +130,8 @@ typedef int sig_atomic_t;
 #define REC_YAW_BEARING_POSITION 161           /* Yaw bearing angular position (rad) */
 #define REC_YAW_BEARING_VELOCITY 162           /* Yaw bearing angular velocity (rad/s) */
 #define REC_YAW_BEARING_ACCELERATION 163       /* Yaw bearing angular acceleration (rad/s^2) */
+#define REC_INFILE_CHAR_COUNT 49               /* Number of characters in the ACC_INFILE argument */
+#define REC_OUTNAME_CHAR_COUNT 50              /* Number of characters in the AVC_OUTNAME argument */
 
 /* Data Flow: out (Variables passed from the controller to the simulation) */
 
@@ -0,0 +1,58 @@
+/**
+ * @file    bts_format.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   TurbSim full-field .bts header reader shared by the .bts flow readers
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BTS_FORMAT_H
+#define BTS_FORMAT_H
+
+#include <stdint.h> // for int16_t
+#include <stdio.h>  // for FILE
+
+#define BTS_FIXED_HEADER_BYTES 70 // int16 id, 4 x int32 dims, 6 x float32 grid, 6 x float32 scaling, int32 description length
+#define BTS_COMPONENTS 3
+
+/**
+ * @brief Fixed header of a TurbSim full-field file. Samples are int16, velocity = (raw - offset) / slope.
+ */
+typedef struct
+{
+	int16_t id; // 7 periodic, 8 non-periodic
+	int nz;
+	int ny;
+	int ntwr;
+	int nt;
+	float dz;
+	float dy;
+	float dt;
+	float zhub;
+	float zbottom;
+	float slope[BTS_COMPONENTS];
+	float offset[BTS_COMPONENTS];
+} bts_header_t;
+
+int bts_read_header(FILE *file, const char *path, bts_header_t *header);
+int16_t bts_le_i16(const unsigned char *p);
+
+#endif // BTS_FORMAT_H
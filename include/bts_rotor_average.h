@@ -0,0 +1,37 @@
+/**
+ * @file    bts_rotor_average.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Rotor-effective wind speed series from the full y-z grid of a TurbSim .bts file
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BTS_ROTOR_AVERAGE_H
+#define BTS_ROTOR_AVERAGE_H
+
+#include <stdbool.h> // IWYU pragma: keep
+
+#define BTS_ROTOR_AVERAGE_CHUNK_STEPS 256   // time steps read per fread
+#define BTS_ROTOR_AVERAGE_CELL_SUBSAMPLES 16 // per axis, estimates the part of a grid cell inside the disk
+
+int bts_rotor_average_series(const char *path, double radius_m, bool area_weighted, double **out_series, int *out_n_steps, double *out_dt);
+
+#endif // BTS_ROTOR_AVERAGE_H
@@ -0,0 +1,77 @@
+/**
+ * @file    checkpoint.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Binary checkpoint of a running simulation and restart from it (.xfeckpt)
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "numerical_integrator.h" // for numerical_integrator_workspace_t
+#include "stage_schedule.h"       // for stage_schedule_t
+#include "xflow_aero_sim.h"       // for param_array_t
+#include <stddef.h>               // for size_t
+#include <stdint.h>               // for uint32_t, uint64_t, int64_t
+
+#define CHECKPOINT_MAGIC "XFECKPT\0"
+#define CHECKPOINT_MAGIC_SIZE 8
+#define CHECKPOINT_VERSION 1U
+#define CHECKPOINT_DEFAULT_FILE "xfe_checkpoint.xfeckpt"
+
+/**
+ * @brief On-disk header, followed by `body_bytes` of records.
+ *
+ * The body holds, in order: `n_params` numeric dynamic parameters (name length, name, type,
+ * 8-byte value), the integrator's multistep history (state count, seeded flag, adaptive step,
+ * `prev_dx`) and `n_rings` history rings (name, period, next due tick, head, count, capacity,
+ * samples). All values are in host byte order.
+ */
+typedef struct
+{
+	char magic[CHECKPOINT_MAGIC_SIZE]; // CHECKPOINT_MAGIC
+	uint32_t version;                  // CHECKPOINT_VERSION
+	uint32_t header_size;              // sizeof(checkpoint_header_t), offset of the body
+	double dt_sec;                     // base step of the run; a restart must use the same one
+	double time_sec;                   // simulation time the checkpoint was taken at
+	double start_time_sec;             // simulation time at tick 0
+	int64_t tick;                      // base steps completed
+	uint32_t n_params;
+	uint32_t n_rings;
+	uint64_t body_bytes;
+	uint64_t checksum; // FNV-1a 64 over the body
+} checkpoint_header_t;
+
+/**
+ * @brief Where a restored run continues from, for `resume_stage_schedule()`.
+ */
+typedef struct
+{
+	double start_time_sec;
+	int64_t tick;
+} checkpoint_position_t;
+
+int checkpoint_file_path(const param_array_t *fixed_data, char *out, size_t out_size);
+int save_checkpoint(const char *path, const param_array_t *dynamic_data, const numerical_integrator_workspace_t *workspace, const stage_schedule_t *schedule);
+int load_checkpoint(const char *path, const param_array_t *dynamic_data, numerical_integrator_workspace_t *workspace, double dt_sec, checkpoint_position_t *position);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,74 @@
+/**
+ * @file    config_snapshot.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Parsed configuration published once in shared memory, with run-time overrides layered on top
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONFIG_SNAPSHOT_H
+#define CONFIG_SNAPSHOT_H
+
+#include "xflow_aero_sim.h" // for param_array_t, input_param_type_t
+#include <stdint.h>         // for uint32_t, uint64_t, int32_t
+
+#define CONFIG_SNAPSHOT_MAGIC "XFECFG\0\0"
+#define CONFIG_SNAPSHOT_MAGIC_SIZE 8
+#define CONFIG_SNAPSHOT_VERSION 1U
+#define CONFIG_SNAPSHOT_NAME_MAX 64
+#define CONFIG_SNAPSHOT_DEFAULT_PREFIX "xfe_config"
+#define CONFIG_SNAPSHOT_ENV_NAME "XFE_CONFIG_SNAPSHOT_NAME" // exported by the publisher, inherited by children
+
+/**
+ * @brief Segment header, followed by `n_entries` entries and then the string pool.
+ */
+typedef struct
+{
+	char magic[CONFIG_SNAPSHOT_MAGIC_SIZE]; // CONFIG_SNAPSHOT_MAGIC
+	uint32_t version;                       // CONFIG_SNAPSHOT_VERSION
+	uint32_t header_size;                   // sizeof(config_snapshot_header_t)
+	uint32_t n_entries;
+	uint32_t entry_size;  // sizeof(config_snapshot_entry_t)
+	uint64_t total_bytes; // whole segment, header included, a multiple of 8
+	uint64_t checksum;    // FNV-1a 64 over the entries and the string pool
+} config_snapshot_header_t;
+
+/**
+ * @brief One parameter. Offsets are in bytes from the start of the segment and point at
+ * NUL-terminated strings in the pool.
+ */
+typedef struct
+{
+	uint64_t name_offset;
+	uint64_t string_offset; // INPUT_PARAM_STRING only
+	double d;
+	int32_t i;
+	int32_t type;          // input_param_type_t
+	uint32_t dynamic;      // 1 for the dynamic array, 0 for the fixed one
+	uint32_t is_state_var; // `state` rows of the CSV
+} config_snapshot_entry_t;
+
+int load_config(const char *config_path, param_array_t *dynamic_data, param_array_t *fixed_data);
+void set_config_override(const char *name, input_param_type_t type, const void *value);
+const char *config_snapshot_name(void);
+void unpublish_config_snapshot(void);
+
+#endif // CONFIG_SNAPSHOT_H
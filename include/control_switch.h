@@ -32,5 +32,6 @@
 #define CONTROL_SWITCH_PARAM_LIST MAYBE_UNUSED const param_array_t *dynamic_data, MAYBE_UNUSED const param_array_t *fixed_data
 
 void control_switch(CONTROL_SWITCH_PARAM_LIST);
+void ensemble_control_switch(const param_array_t *fixed_data);
 
 #endif
@@ -0,0 +1,72 @@
+/**
+ * @file    ensemble.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   API for the structure-of-arrays ensemble engine
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdint.h>         // for uint64_t
+
+/**
+ * @brief N parameter/state sets of one model stored as contiguous per-channel arrays.
+ *
+ * Every numeric dynamic parameter becomes a channel. Member m of channel c lives at
+ * `values[c * stride + m]`, so a batched stage walks each channel as one flat
+ * `double[n_members]` loop instead of chasing a `get_param` pointer per turbine.
+ * Integer parameters (e.g. `enable_brake_signal`) are stored as doubles.
+ */
+typedef struct
+{
+	uint64_t id;    // unique per create_ensemble(), never 0; batched stages key their resolved channels on it
+	int n_members;  // N, number of parameter/state sets
+	int stride;     // distance between channels in `values` (n_members rounded up to 8)
+	int n_channels; // number of channels
+
+	const char **channel_names; // channel names, borrowed from the dynamic parameter array
+	double *values;             // n_channels * stride channel-major values
+
+	int n_state_var;    // number of state variables (same order as init_state_bindings)
+	int *state_channel; // channel index of each state variable
+
+	double *k1; // rk4 stage derivatives, n_state_var * stride each
+	double *k2;
+	double *k3;
+	double *k4;
+	double *temp; // saved x_n, n_state_var * stride
+
+	double *buffer; // single allocation backing k1–k4 and temp
+} ensemble_t;
+
+ensemble_t *create_ensemble(const param_array_t *dynamic_data, int n_members);
+void free_ensemble(ensemble_t *ensemble);
+int ensemble_channel_index(const ensemble_t *ensemble, const char *name);
+double *ensemble_channel(const ensemble_t *ensemble, const char *name);
+double *ensemble_state(const ensemble_t *ensemble, const char *name, int *out_state_index);
+void ensemble_broadcast_param(ensemble_t *ensemble, const param_array_t *dynamic_data, const char *name);
+void ensemble_rk4_step(ensemble_t *ensemble, double dt, const param_array_t *fixed_data);
+void run_ensemble_simulation(const param_array_t *dynamic_data, const param_array_t *fixed_data, int n_members);
+
+#endif // ENSEMBLE_H
@@ -0,0 +1,78 @@
+/**
+ * @file    flow_cache.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Persistent memory-mapped cache of preprocessed flow series (.xfeflow)
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOW_CACHE_H
+#define FLOW_CACHE_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stddef.h>         // for size_t
+#include <stdint.h>         // for uint64_t, int64_t
+
+#define FLOW_CACHE_MAGIC "XFEFLOW\0"
+#define FLOW_CACHE_MAGIC_SIZE 8
+#define FLOW_CACHE_VERSION 1U
+#define FLOW_CACHE_EXTENSION ".xfeflow"
+
+/**
+ * @brief On-disk header. Followed by `n_sim_steps` interpolated doubles, then `n_raw` raw doubles.
+ */
+typedef struct
+{
+	char magic[FLOW_CACHE_MAGIC_SIZE]; // FLOW_CACHE_MAGIC
+	uint32_t version;                  // FLOW_CACHE_VERSION
+	uint32_t header_size;              // sizeof(flow_cache_header_t), offset of the interpolated series
+	uint64_t source_hash;              // FNV-1a 64 of the source file contents
+	uint64_t source_size;              // source file size in bytes
+	double dt_sec;                     // simulation step the series was interpolated at
+	double flow_time_step_dt;          // configured flow series step
+	double raw_dt;                     // step of the raw series (bts header dt for .bts sources)
+	double total_time;                 // length of the flow series in seconds
+	int64_t n_sim_steps;               // interpolated samples (total_time / dt_sec + 1)
+	int64_t n_raw;                     // raw samples kept for off-grid interpolation
+} flow_cache_header_t;
+
+/**
+ * @brief Read-only view of a mapped cache file.
+ */
+typedef struct
+{
+	const flow_cache_header_t *header;
+	const double *interp; // n_sim_steps values at multiples of dt_sec
+	const double *raw;    // n_raw values at multiples of raw_dt
+	void *map_base;
+	size_t map_size;
+#ifdef _WIN32
+	void *file_handle;
+	void *mapping_handle;
+#endif
+} flow_cache_view_t;
+
+int flow_cache_is_enabled(const param_array_t *fixed_data);
+int flow_cache_open(const param_array_t *fixed_data, const char *source_path, double dt_sec, double flow_time_step_dt, flow_cache_view_t *view);
+int flow_cache_store(const param_array_t *fixed_data, const char *source_path, double dt_sec, double flow_time_step_dt, double raw_dt, double total_time, const double *interp, int n_sim_steps, const double *raw, int n_raw);
+void flow_cache_close(flow_cache_view_t *view);
+
+#endif // FLOW_CACHE_H
@@ -37,11 +37,15 @@
 MAKE_STAGE(flow_gen, void, (FLOW_GEN_PARAM_LIST))
 
 void bts_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST);
+void bts_rotor_avg_interp_flow_gen(FLOW_GEN_PARAM_LIST);
 void csv_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST);
+void stream_interp_flow_gen(FLOW_GEN_PARAM_LIST);
 
 static const flow_gen_Map flowMap[] = {
 	{"csv_fixed_interp_flow_gen", csv_fixed_interp_flow_gen},
 	{"bts_fixed_interp_flow_gen", bts_fixed_interp_flow_gen},
+	{"bts_rotor_avg_interp_flow_gen", bts_rotor_avg_interp_flow_gen},
+	{"stream_interp_flow_gen", stream_interp_flow_gen},
 };
 
 #endif // FLOW_GEN_H
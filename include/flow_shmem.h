@@ -0,0 +1,98 @@
+/**
+ * @file    flow_shmem.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Named shared-memory segments holding one or more validated flow series
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOW_SHMEM_H
+#define FLOW_SHMEM_H
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint32_t, uint64_t, int64_t
+
+#define FLOW_SHMEM_MAGIC "XFESHM\0\0"
+#define FLOW_SHMEM_MAGIC_SIZE 8
+#define FLOW_SHMEM_VERSION 1U
+#define FLOW_SHMEM_SERIES_NAME_MAX 64
+#define FLOW_SHMEM_SEGMENT_NAME_MAX 64
+#define FLOW_SHMEM_DEFAULT_PREFIX "xfe_flow"
+#define FLOW_SHMEM_ENV_NAME "XFE_FLOW_SHMEM_NAME" // exported by the publisher, inherited by children
+
+/**
+ * @brief Segment header, followed by `n_series` table entries and then the series data.
+ */
+typedef struct
+{
+	char magic[FLOW_SHMEM_MAGIC_SIZE]; // FLOW_SHMEM_MAGIC
+	uint32_t version;                  // FLOW_SHMEM_VERSION
+	uint32_t header_size;              // sizeof(flow_shmem_header_t)
+	uint32_t n_series;
+	uint32_t series_entry_size; // sizeof(flow_shmem_series_t)
+	uint64_t total_bytes;       // whole segment, header included
+	uint64_t checksum;          // FNV-1a 64 over the series table and data
+} flow_shmem_header_t;
+
+/**
+ * @brief Series table entry. `offset` is in bytes from the start of the segment, 8-byte aligned.
+ */
+typedef struct
+{
+	char name[FLOW_SHMEM_SERIES_NAME_MAX]; // lookup key, e.g. the flow file name
+	double dt;                             // sample spacing in seconds
+	double total_time;                     // length of the source series in seconds
+	uint64_t offset;
+	int64_t count;
+} flow_shmem_series_t;
+
+/**
+ * @brief One series handed to `flow_shmem_publish`.
+ */
+typedef struct
+{
+	const char *name;
+	const double *values;
+	int64_t count;
+	double dt;
+	double total_time;
+} flow_shmem_series_desc_t;
+
+/**
+ * @brief Read-only mapping of a published segment.
+ */
+typedef struct
+{
+	const flow_shmem_header_t *header;
+	const flow_shmem_series_t *series; // header->n_series entries
+	void *map_base;
+	size_t map_size;
+} flow_shmem_view_t;
+
+int flow_shmem_make_name(char *out, size_t out_size, const char *prefix);
+int flow_shmem_publish(const char *segment_name, const flow_shmem_series_desc_t *series, int n_series);
+void flow_shmem_unpublish(void);
+int flow_shmem_attach(const char *segment_name, flow_shmem_view_t *view);
+const flow_shmem_series_t *flow_shmem_find_series(const flow_shmem_view_t *view, const char *name);
+const double *flow_shmem_series_values(const flow_shmem_view_t *view, const flow_shmem_series_t *entry);
+void flow_shmem_detach(flow_shmem_view_t *view);
+
+#endif // FLOW_SHMEM_H
@@ -0,0 +1,41 @@
+/**
+ * @file    flow_stream.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Bounded-memory streaming reader for long .bts and .csv flow series
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOW_STREAM_H
+#define FLOW_STREAM_H
+
+#include <stdbool.h> // IWYU pragma: keep
+
+#define FLOW_STREAM_DEFAULT_WINDOW_SAMPLES 8192 // raw samples held ahead of time_sec
+#define FLOW_STREAM_DEFAULT_CHUNK_STEPS 256     // bts time steps read per fread
+
+int flow_stream_open(const char *path, double flow_time_step_dt, double y_position, double z_position, int window_samples, int chunk_steps);
+int flow_stream_sample(double time_sec, double *value, bool *past_end);
+double flow_stream_total_time(void);
+bool flow_stream_total_time_known(void);
+void flow_stream_close(void);
+
+#endif // FLOW_STREAM_H
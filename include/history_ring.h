@@ -0,0 +1,71 @@
+/**
+ * @file    history_ring.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Zero-copy ring buffers of recent parameter values, sampled on their own tick schedule
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HISTORY_RING_H
+#define HISTORY_RING_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdint.h>         // for int64_t
+
+/**
+ * @brief Read-only window onto a history ring's live storage; nothing is copied.
+ *
+ * The newest sample is `data[head]`, the one `age` samples older is
+ * `data[(head - age + capacity) % capacity]` for `age < count` (see `history_view_at()`).
+ * A view is a snapshot of the indices: take a new one after the rings are updated.
+ */
+typedef struct
+{
+	const double *data; // ring storage, `capacity` samples
+	int head;           // index of the newest sample
+	int count;          // valid samples, at most `capacity`
+	int capacity;
+} history_view_t;
+
+typedef struct history_ring history_ring_t;
+
+/**
+ * @brief Everything needed to put a ring back after a restart (see `checkpoint.h`).
+ */
+typedef struct
+{
+	const char *name; // source dynamic parameter
+	int64_t every_n_ticks;
+	int64_t next_due_tick;
+	int head;
+	int count;
+	int capacity;
+	const double *data; // `capacity` samples
+} history_ring_state_t;
+
+history_ring_t *get_history_ring(const param_array_t *dynamic_data, const param_array_t *fixed_data, const char *name, int capacity, double period_sec);
+history_view_t history_ring_view(const history_ring_t *ring);
+double history_view_at(const history_view_t *view, int age);
+void update_history_rings(int64_t tick);
+int get_history_ring_states(history_ring_state_t **states);
+int restore_history_ring_states(const history_ring_state_t *states, int n_states, int64_t tick);
+
+#endif // HISTORY_RING_H
@@ -0,0 +1,112 @@
+/**
+ * @file    log_pyramid.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Multi-resolution min/max companion file of the dynamic data log, written alongside it
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOG_PYRAMID_H
+#define LOG_PYRAMID_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdbool.h>        // for bool
+#include <stddef.h>         // for size_t
+#include <stdint.h>         // for uint32_t, uint64_t
+#include <stdio.h>          // for FILE
+
+/*
+ * .xfepyr layout (native endian, see byte_order_mark):
+ *
+ *   log_pyramid_header_t
+ *   n_channels x char name[LOG_PYRAMID_NAME_WIDTH], NUL padded
+ *   records of record_size bytes: log_pyramid_record_t, then n_channels x { double min, double max }
+ *
+ * Level l summarises factors[l] consecutive rows of the full log. Records of all levels are
+ * interleaved in the order they complete; the last record of each level may cover fewer rows.
+ * String channels carry NAN.
+ */
+#define LOG_PYRAMID_MAGIC "XFEPYR\0\0"
+#define LOG_PYRAMID_MAGIC_SIZE 8
+#define LOG_PYRAMID_VERSION 1U
+#define LOG_PYRAMID_BYTE_ORDER_MARK 0x01020304U
+#define LOG_PYRAMID_EXTENSION ".xfepyr"
+#define LOG_PYRAMID_NAME_WIDTH 64
+#define LOG_PYRAMID_MAX_LEVELS 6
+#define LOG_PYRAMID_DEFAULT_FACTOR 10
+#define LOG_PYRAMID_DEFAULT_LEVELS 3
+
+typedef struct
+{
+	char magic[LOG_PYRAMID_MAGIC_SIZE]; // LOG_PYRAMID_MAGIC
+	uint32_t version;                   // LOG_PYRAMID_VERSION
+	uint32_t byte_order_mark;           // LOG_PYRAMID_BYTE_ORDER_MARK
+	uint32_t header_size;               // offset of the first record
+	uint32_t n_channels;
+	uint32_t n_levels;
+	uint32_t record_size;
+	uint64_t factors[LOG_PYRAMID_MAX_LEVELS]; // rows per record of each level, 0 past n_levels
+	uint64_t n_rows;                          // rows in the full log, written at close (0 while running)
+	uint64_t n_records;                       // written at close
+	uint64_t log_data_offset;                 // byte offset of the first row in the full log
+} log_pyramid_header_t;
+
+typedef struct
+{
+	uint32_t level;
+	uint32_t n_rows;      // rows covered, factors[level] except for the last record of the level
+	uint64_t first_row;   // index of the first covered row in the full log
+	uint64_t byte_offset; // byte offset of that row in the full log
+} log_pyramid_record_t;
+
+/**
+ * @brief Group of rows being accumulated at one level.
+ */
+typedef struct
+{
+	uint64_t first_row;
+	uint64_t byte_offset;
+	uint64_t n_rows;
+	double *min_max; // n_channels pairs
+} log_pyramid_level_t;
+
+/**
+ * @brief Writer state; zero-initialise, `file` is NULL while no pyramid is being written.
+ */
+typedef struct
+{
+	FILE *file;
+	int n_channels;
+	int n_levels;
+	uint64_t factors[LOG_PYRAMID_MAX_LEVELS];
+	log_pyramid_level_t levels[LOG_PYRAMID_MAX_LEVELS];
+	unsigned char *record; // record_size scratch buffer
+	size_t record_size;
+	uint64_t n_rows;
+	uint64_t n_records;
+} log_pyramid_t;
+
+void log_pyramid_path_from_log(char *out, size_t out_size, const char *log_path);
+int log_pyramid_open(log_pyramid_t *pyramid, const char *log_path, const param_array_t *data, FILE *log_file, int factor, int n_levels);
+void log_pyramid_add_row(log_pyramid_t *pyramid, FILE *log_file, const param_array_t *data);
+void log_pyramid_close(log_pyramid_t *pyramid);
+
+#endif // LOG_PYRAMID_H
@@ -26,8 +26,11 @@
 #ifndef MAKE_STAGE_H
 #define MAKE_STAGE_H
 
-#include "logger.h"     // for ERROR_MESSAGE (if you need it elsewhere)
-#include "xflow_core.h" // for shutdownFlag (if you need it elsewhere)
+#include "logger.h"        // for ERROR_MESSAGE (if you need it elsewhere)
+#include "stage_context.h" // for STAGE_STATE, so every stage implementation can keep per-run state
+#include "stage_timing.h"  // for stage_timing_t, record_stage_timing used by MAKE_STAGE_DEFINE
+#include "xflow_core.h"    // for shutdownFlag (if you need it elsewhere)
+#include <stdint.h>        // for int64_t
 
 /*
  *   MAKE_STAGE(name, RTYPE, PARAMS, ...)
@@ -49,9 +52,11 @@
  * definition macro (for exactly one .c file).
  *   - PARAMS: full "(type name, type name, ...)"
  *   - ARGS:   bare "(name, name, ...)" for the call
+ *   - name() records the call in name##_timing while stage timing is enabled (stage_timing.h)
  */
 #define MAKE_STAGE_DEFINE(name, RTYPE, PARAMS, ARGS)                                     \
 	static name##_fn name##_cb = NULL;                                                   \
+	static stage_timing_t name##_timing;                                                 \
 	void register_##name(name##_fn fn)                                                   \
 	{                                                                                    \
 		name##_cb = fn;                                                                  \
@@ -67,11 +72,18 @@
 	__attribute__((constructor(101))) static void init_default_##name(void)              \
 	{                                                                                    \
 		register_##name(default_##name);                                                 \
+		register_stage_timing(&name##_timing, #name);                                    \
 	}                                                                                    \
                                                                                          \
 	RTYPE name PARAMS                                                                    \
 	{                                                                                    \
-		if (name##_cb)                                                                   \
+		if (name##_cb && stageTimingEnabled)                                             \
+		{                                                                                \
+			const int64_t _start_ns = stage_timing_now_ns();                             \
+			name##_cb ARGS;                                                              \
+			record_stage_timing(&name##_timing, stage_timing_now_ns() - _start_ns);      \
+		}                                                                                \
+		else if (name##_cb)                                                              \
 			name##_cb ARGS;                                                              \
 		else                                                                             \
 		{                                                                                \
@@ -80,6 +92,57 @@
 			shutdownFlag = 1;                                                            \
 		}                                                                                \
 	}
+/*
+ * fused-pipeline definition (XFE_FUSED_PIPELINE, see cmake/fused_pipeline.cmake).
+ *   - same as MAKE_STAGE_DEFINE, but name() calls BOUND directly whenever the registered
+ *     callback is BOUND, so with LTO the integrator, eom and models inline into one step
+ *   - a config selecting a different implementation still runs, through the callback
+ */
+#define MAKE_STAGE_DEFINE_BOUND(name, RTYPE, PARAMS, ARGS, BOUND)                         \
+	static name##_fn name##_cb = NULL;                                                    \
+	static stage_timing_t name##_timing;                                                  \
+	void register_##name(name##_fn fn)                                                    \
+	{                                                                                     \
+		name##_cb = fn;                                                                   \
+	}                                                                                     \
+                                                                                          \
+	static RTYPE default_##name PARAMS                                                    \
+	{                                                                                     \
+		(void)sizeof((ARGS)); /* NOLINT(bugprone-sizeof-expression,cert-arr39-c) */       \
+		log_message("We should not be in here..., default_" #name ", ending program\n");  \
+		shutdownFlag = 1;                                                                 \
+	}                                                                                     \
+                                                                                          \
+	__attribute__((constructor(101))) static void init_default_##name(void)               \
+	{                                                                                     \
+		register_##name(default_##name);                                                  \
+		register_stage_timing(&name##_timing, #name);                                     \
+	}                                                                                     \
+                                                                                          \
+	RTYPE name PARAMS                                                                     \
+	{                                                                                     \
+		const int64_t _start_ns = stageTimingEnabled ? stage_timing_now_ns() : 0;         \
+		if (name##_cb == (BOUND))                                                         \
+		{                                                                                 \
+			BOUND ARGS;                                                                   \
+		}                                                                                 \
+		else if (name##_cb)                                                               \
+		{                                                                                 \
+			name##_cb ARGS;                                                               \
+		}                                                                                 \
+		else                                                                              \
+		{                                                                                 \
+			(void)sizeof((ARGS)); /* NOLINT(bugprone-sizeof-expression,cert-arr39-c) */   \
+			ERROR_MESSAGE(#name "_cb function pointer not declared.\n");                  \
+			shutdownFlag = 1;                                                             \
+			return;                                                                       \
+		}                                                                                 \
+		if (stageTimingEnabled)                                                           \
+		{                                                                                 \
+			record_stage_timing(&name##_timing, stage_timing_now_ns() - _start_ns);       \
+		}                                                                                 \
+	}
+
 // 1) Defines a static dispatcher function for <name>, looking it up
 //    in the map <map_array>.  The map must be an array of:
 //
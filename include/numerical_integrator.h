@@ -30,22 +30,105 @@
 #include "make_stage.h"     // for MAKE_STAGE
 #include "maybe_unused.h"   // for MAYBE_UNUSED
 #include "xflow_aero_sim.h" // for param_array_t
+#include <stdbool.h>         // IWYU pragma: keep
+
+// optional analytic Jacobian of an eom, for the implicit integrators: fills the row-major
+// n_state_var x n_state_var matrix jac with jac[i * n_state_var + j] = d(dx_i)/d(x_j)
+#define EOM_JACOBIAN_PARAM_LIST MAYBE_UNUSED double **state_vars, MAYBE_UNUSED const char **state_names, MAYBE_UNUSED const int n_state_var, MAYBE_UNUSED double *jac, MAYBE_UNUSED const param_array_t *dynamic_data, MAYBE_UNUSED const param_array_t *fixed_data
+
+typedef void (*eom_jacobian_fn)(EOM_JACOBIAN_PARAM_LIST);
+
+typedef struct
+{
+	const char *id; // eom id in eomMap the Jacobian belongs to
+	eom_jacobian_fn fn;
+} eom_jacobian_Map;
+
+/**
+ * @brief Scratch and history storage shared by the numerical integrators.
+ *
+ * Sized once from the number of state variables returned by `init_state_bindings()`
+ * and handed to every `numerical_integrator()` dispatch, so no integrator has to
+ * allocate on the hot path. Each simulation instance owns its own workspace, which
+ * also carries the multistep history (AB2) that used to live in function-local statics.
+ */
+typedef struct
+{
+	int n_state_var; // number of state variables the buffers are sized for
+
+	double *k1; // stage derivative buffers
+	double *k2;
+	double *k3;
+	double *k4;
+	double *k5;
+	double *k6;
+	double *k7;
+
+	double *temp;     // saved x_n while the stages overwrite the live state
+	double *x_values; // scratch state vector used when the live state must stay untouched
+	double **x_ptrs;  // pointers into x_values, laid out like state_vars for eom()
+	double *x_new;    // candidate solution of an adaptive step
+
+	double *prev_dx; // f(x_{n-1}) for multistep methods
+	bool first_call; // true until the multistep history has been seeded
+
+	// adaptive step-size control (dopri45_numerical_integrator)
+	bool adaptive_configured; // tolerances and step limits have been read from the config
+	double abs_tol;           // absolute error tolerance per state variable
+	double rel_tol;           // relative error tolerance per state variable
+	double min_dt;            // smallest internal substep
+	double max_dt;            // largest internal substep
+	double adaptive_dt;       // step size proposed for the next substep
+
+	// implicit integration with a cached Jacobian (sdirk2_numerical_integrator)
+	bool implicit_configured;          // Newton settings and Jacobian source have been read
+	int max_newton_iterations;         // iterations per stage before the step counts as not converged
+	double jacobian_refresh_rate;      // Newton contraction rate above which the Jacobian is rebuilt
+	eom_jacobian_fn analytic_jacobian; // from eomJacobianMap, NULL to use finite differences
+	double *jacobian;                  // n_state_var x n_state_var, row-major
+	double *iteration_matrix;          // LU factors of I - h*gamma*J
+	int *pivots;                       // row permutation of the LU factors
+	bool jacobian_stale;               // rebuild the Jacobian at the start of the next substep
+	bool jacobian_fresh;               // the Jacobian was evaluated at the current x_n
+	double factored_h;                 // substep the iteration matrix is factored for, 0 when none
+
+	// statistics, reported by log_numerical_integrator_statistics()
+	long steps_accepted;  // internal steps kept (one per call for the fixed-step methods)
+	long steps_rejected;  // adaptive steps discarded because the error estimate was too large
+	long steps_forced;    // adaptive steps accepted at min_dt despite exceeding the tolerance
+	long eom_evaluations; // total calls to eom()
+	long jacobian_evaluations;
+	long factorizations;
+	long newton_iterations;
+
+	double *buffer;        // single allocation backing every double buffer above
+	double *matrix_buffer; // backs jacobian and iteration_matrix
+} numerical_integrator_workspace_t;
 
 // your one and only definition of the parameter list:
-#define NUMERICAL_INTEGRATOR_PARAM_LIST MAYBE_UNUSED double **state_vars, MAYBE_UNUSED const char **state_names, MAYBE_UNUSED const int n_state_var, MAYBE_UNUSED const double dt, MAYBE_UNUSED const param_array_t *dynamic_data, MAYBE_UNUSED const param_array_t *fixed_data
-#define NUMERICAL_INTEGRATOR_CALL_ARGS state_vars, state_names, n_state_var, dt, dynamic_data, fixed_data
+#define NUMERICAL_INTEGRATOR_PARAM_LIST MAYBE_UNUSED double **state_vars, MAYBE_UNUSED const char **state_names, MAYBE_UNUSED const int n_state_var, MAYBE_UNUSED const double dt, MAYBE_UNUSED const param_array_t *dynamic_data, MAYBE_UNUSED const param_array_t *fixed_data, MAYBE_UNUSED numerical_integrator_workspace_t *workspace
+#define NUMERICAL_INTEGRATOR_CALL_ARGS state_vars, state_names, n_state_var, dt, dynamic_data, fixed_data, workspace
 
 // now invoke MAKE_STAGE with the *macro* name inside parens
 MAKE_STAGE(numerical_integrator, void, (NUMERICAL_INTEGRATOR_PARAM_LIST))
 
+numerical_integrator_workspace_t *create_numerical_integrator_workspace(int n_state_var);
+void reset_numerical_integrator_workspace(numerical_integrator_workspace_t *workspace);
+void free_numerical_integrator_workspace(numerical_integrator_workspace_t *workspace);
+void log_numerical_integrator_statistics(const numerical_integrator_workspace_t *workspace);
+
 void ab2_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST);
+void dopri45_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST);
 void euler_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST);
 void rk4_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST);
+void sdirk2_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST);
 
 static const numerical_integrator_Map numericalIntegratorMap[] = {
-	{"ab2_numerical_integrator",   ab2_numerical_integrator  },
-	{"euler_numerical_integrator", euler_numerical_integrator},
-	{"rk4_numerical_integrator",   rk4_numerical_integrator  },
+	{"ab2_numerical_integrator",     ab2_numerical_integrator    },
+	{"dopri45_numerical_integrator", dopri45_numerical_integrator},
+	{"euler_numerical_integrator",   euler_numerical_integrator  },
+	{"rk4_numerical_integrator",     rk4_numerical_integrator    },
+	{"sdirk2_numerical_integrator",  sdirk2_numerical_integrator },
 };
 
 #endif // NUMERICAL_INTEGRATOR_H
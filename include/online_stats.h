@@ -0,0 +1,91 @@
+/**
+ * @file    online_stats.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Constant-memory running statistics of one channel: Welford moments, P-square quantiles and rainflow damage
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ONLINE_STATS_H
+#define ONLINE_STATS_H
+
+#include <stdbool.h> // IWYU pragma: keep
+
+#define ONLINE_STATS_MAX_QUANTILES 8
+#define ONLINE_STATS_P2_MARKERS 5
+#define ONLINE_STATS_RAINFLOW_INITIAL_RESIDUE 64 // reversals; the residue rarely grows past a few dozen
+
+/**
+ * @brief P-square estimate of one quantile (Jain & Chlamtac, 1985): five markers, no samples kept.
+ */
+typedef struct
+{
+	double p;                                 // quantile in [0, 1]
+	double height[ONLINE_STATS_P2_MARKERS];   // marker heights; the first samples until five were seen
+	double position[ONLINE_STATS_P2_MARKERS]; // actual marker positions (0-based)
+	double desired[ONLINE_STATS_P2_MARKERS];  // desired marker positions
+	double increment[ONLINE_STATS_P2_MARKERS];
+	long count;
+} p2_quantile_t;
+
+/**
+ * @brief Incremental four-point rainflow count.
+ *
+ * Reversals go onto a residue stack; each time the inner range of the top four is not larger
+ * than its neighbours it is closed as a full cycle and removed. Closed cycles only add to
+ * `damage_sum`, so memory is bounded by the residue rather than the series length.
+ */
+typedef struct
+{
+	double *residue; // reversals not yet closed into a cycle
+	int n_residue;
+	int capacity;
+	double extreme; // running extreme since the last reversal, pushed once the signal turns
+	int direction;  // +1 rising, -1 falling, 0 before the first change
+	bool started;
+	double wohler_m;   // S-N slope of the damage sum
+	double damage_sum; // sum of range^m over the closed cycles
+	long n_cycles;
+} rainflow_counter_t;
+
+/**
+ * @brief Running statistics of one channel; each update is O(1) apart from the rainflow residue.
+ */
+typedef struct
+{
+	long count;
+	double mean;
+	double m2; // sum of squared deviations from the mean (Welford)
+	double min;
+	double max;
+	p2_quantile_t quantiles[ONLINE_STATS_MAX_QUANTILES];
+	int n_quantiles;
+	rainflow_counter_t rainflow;
+} online_stats_t;
+
+int init_online_stats(online_stats_t *stats, const double *quantiles, int n_quantiles, double wohler_m);
+void online_stats_update(online_stats_t *stats, double x);
+double online_stats_variance(const online_stats_t *stats);
+double online_stats_quantile(const online_stats_t *stats, int k);
+double online_stats_damage_equivalent_load(const online_stats_t *stats, double n_equivalent);
+void free_online_stats(online_stats_t *stats);
+
+#endif // ONLINE_STATS_H
@@ -0,0 +1,50 @@
+/**
+ * @file    param_index.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Hashed name lookup and stable handles for parameter arrays
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARAM_INDEX_H
+#define PARAM_INDEX_H
+
+#include "xflow_aero_sim.h" // for param_array_t, input_param_t
+
+/**
+ * @brief Position of a parameter inside its `param_array_t`.
+ *
+ * A handle stays valid for as long as the array is not resized or reordered, which holds
+ * for the whole simulation once `initialize_control_system` has populated the arrays.
+ */
+typedef int param_handle_t;
+
+#define PARAM_HANDLE_INVALID (-1)
+
+int build_param_index(const param_array_t *data);
+void invalidate_param_index(const param_array_t *data);
+void free_param_indices(void);
+param_handle_t get_param_handle(const param_array_t *data, const char *name);
+input_param_t *param_from_handle(const param_array_t *data, param_handle_t handle);
+double *param_double_from_handle(const param_array_t *data, param_handle_t handle);
+int *param_int_from_handle(const param_array_t *data, param_handle_t handle);
+
+#endif // PARAM_INDEX_H
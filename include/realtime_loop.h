@@ -0,0 +1,66 @@
+/**
+ * @file    realtime_loop.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Fixed-period loop timing on absolute deadlines, with jitter and overrun statistics
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef REALTIME_LOOP_H
+#define REALTIME_LOOP_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdint.h>         // for int64_t
+
+// Wake-up latency bins: bin 0 is < 1 us, bin k covers [2^(k-1), 2^k) us, the last bin is open ended.
+#define REALTIME_LOOP_HISTOGRAM_BINS 20
+
+/**
+ * @brief Deadline state and timing statistics of one periodic loop.
+ *
+ * Deadlines are `start + k * period` on the monotonic clock, so time spent in the loop body
+ * or in a late wake-up never shifts later periods.
+ */
+typedef struct
+{
+	int64_t period_ns;
+	int64_t start_ns;         // monotonic time of the first deadline's period start
+	int64_t next_deadline_ns; // absolute deadline the next wait sleeps until
+	int64_t n_periods;        // waits that slept until their deadline
+	int64_t n_overruns;       // waits entered after their deadline had passed
+	int64_t n_missed_periods; // whole periods skipped to get back onto the deadline grid
+	int64_t worst_overrun_ns;
+	int64_t jitter_min_ns; // wake-up time minus deadline
+	int64_t jitter_max_ns;
+	double jitter_sum_ns;
+	int64_t histogram[REALTIME_LOOP_HISTOGRAM_BINS];
+#ifdef _WIN32
+	void *timer; // high-resolution waitable timer
+#endif
+} realtime_loop_t;
+
+int realtime_loop_start(realtime_loop_t *loop, double period_sec, const param_array_t *fixed_data);
+double realtime_loop_elapsed_sec(const realtime_loop_t *loop);
+void realtime_loop_wait(realtime_loop_t *loop);
+void realtime_loop_log_statistics(const realtime_loop_t *loop);
+void realtime_loop_stop(realtime_loop_t *loop);
+
+#endif // REALTIME_LOOP_H
@@ -0,0 +1,92 @@
+/**
+ * @file    result_shmem.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Lock-free shared-memory area collecting data-processing result rows from worker processes
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESULT_SHMEM_H
+#define RESULT_SHMEM_H
+
+#include <stdatomic.h> // for atomic_uint_least32_t, atomic_uint_least64_t
+#include <stdbool.h>   // IWYU pragma: keep
+#include <stdint.h>    // for uint32_t, uint64_t, int64_t
+
+#define RESULT_SHMEM_MAGIC "XFERES\0\0"
+#define RESULT_SHMEM_MAGIC_SIZE 8
+#define RESULT_SHMEM_VERSION 1U
+#define RESULT_SHMEM_PATH_MAX 1024
+#define RESULT_SHMEM_SLOT_ALIGN 64 // one cache line, so workers never share a line
+#define RESULT_SHMEM_DEFAULT_PREFIX "xfe_results"
+#define RESULT_SHMEM_DEFAULT_MAX_COLUMNS 32
+#define RESULT_SHMEM_ENV_NAME "XFE_RESULT_SHMEM_NAME" // exported by the creator, inherited by workers
+
+/**
+ * @brief Life cycle of one result slot.
+ */
+typedef enum
+{
+	RESULT_SLOT_EMPTY = 0,
+	RESULT_SLOT_WRITING = 1, // claimed by a worker
+	RESULT_SLOT_READY = 2,   // values complete, published with release ordering
+	RESULT_SLOT_SAVED = 3    // written to the results file by the creator
+} result_slot_state_t;
+
+/**
+ * @brief Segment header, followed by `n_slots` slots of `slot_size` bytes.
+ */
+typedef struct
+{
+	char magic[RESULT_SHMEM_MAGIC_SIZE]; // RESULT_SHMEM_MAGIC
+	uint32_t version;                    // RESULT_SHMEM_VERSION
+	uint32_t header_size;                // sizeof(result_shmem_header_t)
+	uint32_t max_columns;                // doubles per slot
+	uint32_t slot_size;                  // bytes per slot, multiple of RESULT_SHMEM_SLOT_ALIGN
+	uint64_t n_slots;
+	uint64_t total_bytes;
+	atomic_uint_least64_t next_slot;   // claim counter, may run past n_slots
+	atomic_uint_least64_t n_overflow;  // rows that did not fit and went to the file directly
+	char results_path[RESULT_SHMEM_PATH_MAX]; // CSV named by save_csv_header()
+} result_shmem_header_t;
+
+/**
+ * @brief Slot header; `n_values` doubles follow it.
+ */
+typedef struct
+{
+	atomic_uint_least32_t state; // result_slot_state_t
+	uint32_t n_values;
+	int64_t tv_sec; // monotonic time the row was recorded
+	int64_t tv_nsec;
+} result_shmem_slot_t;
+
+int result_shmem_create(const char *segment_name, int64_t n_slots, int max_columns);
+int result_shmem_attach(const char *segment_name);
+bool result_shmem_is_active(void);
+bool result_shmem_is_creator(void);
+const char *result_shmem_name(void);
+void result_shmem_set_results_path(const char *filename);
+int result_shmem_write(const double *data, int n_data);
+int64_t result_shmem_save(const char *filename, bool binary);
+void result_shmem_close(void);
+
+#endif // RESULT_SHMEM_H
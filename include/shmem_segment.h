@@ -0,0 +1,47 @@
+/**
+ * @file    shmem_segment.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Creation of named shared memory segments and the word checksum their headers carry
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHMEM_SEGMENT_H
+#define SHMEM_SEGMENT_H
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint64_t
+
+/**
+ * @brief Writable mapping of a segment created by `shmem_segment_create()`.
+ */
+typedef struct
+{
+	void *base;
+	size_t size;
+	void *mapping; // Windows: the HANDLE that keeps the segment alive; NULL elsewhere
+} shmem_segment_t;
+
+uint64_t shmem_word_checksum(const unsigned char *data, size_t n);
+int shmem_segment_create(const char *name, size_t size, shmem_segment_t *segment);
+void shmem_segment_close(shmem_segment_t *segment);
+
+#endif // SHMEM_SEGMENT_H
@@ -0,0 +1,80 @@
+/**
+ * @file    stage_context.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Per-run state objects for stage implementations, replacing function-local statics
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STAGE_CONTEXT_H
+#define STAGE_CONTEXT_H
+
+#include <stdbool.h> // IWYU pragma: keep
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+/**
+ * @brief One simulation run's worth of stage state.
+ *
+ * Every stage implementation that calls `STAGE_STATE()` owns one zero-initialised object in
+ * the context. Resetting the context releases all of them, so the next call of each stage
+ * runs its first-run initialisation again against the current parameter arrays.
+ */
+typedef struct stage_context stage_context_t;
+
+/**
+ * @brief Frees whatever a state object owns (buffers, mappings); the object itself is freed by the context.
+ */
+typedef void (*stage_state_release_fn)(void *state);
+
+/**
+ * @brief A call site's cached state object, valid while `generation` matches the current context's.
+ */
+typedef struct
+{
+	uint64_t generation; // generation of the context (and run) `state` belongs to; 0 = empty
+	void *state;
+} stage_state_slot_t;
+
+stage_context_t *create_stage_context(void);
+void reset_stage_context(stage_context_t *context);
+void free_stage_context(stage_context_t *context);
+stage_context_t *set_current_stage_context(stage_context_t *context);
+stage_context_t *current_stage_context(void);
+void *get_stage_state(const void *key, size_t size, stage_state_release_fn release, bool *first_run);
+void *get_stage_state_cached(stage_state_slot_t *slot, const void *key, size_t size, stage_state_release_fn release, bool *first_run);
+
+/*
+ *   STAGE_STATE(type, state, first_run)
+ *   STAGE_STATE_WITH_RELEASE(type, state, release, first_run)
+ *
+ *   - declares `type *state`, the calling function's object in the thread's current stage
+ *     context (NULL on allocation failure), keyed by `__func__`
+ *   - sets the bool `first_run` to true when the object was just created for this run
+ *   - the call site keeps the object in a thread-local slot, so only the first call of a
+ *     run (or after switching contexts) searches the context
+ */
+#define STAGE_STATE(type, state, first_run) STAGE_STATE_WITH_RELEASE(type, state, NULL, first_run)
+#define STAGE_STATE_WITH_RELEASE(type, state, release, first_run) \
+	static _Thread_local stage_state_slot_t state##StageSlot;     \
+	type *state = (type *)get_stage_state_cached(&state##StageSlot, __func__, sizeof(type), (release), &(first_run))
+
+#endif // STAGE_CONTEXT_H
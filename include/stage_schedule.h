@@ -0,0 +1,70 @@
+/**
+ * @file    stage_schedule.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Integer-tick multi-rate schedule deciding which loop stages run on each base step
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STAGE_SCHEDULE_H
+#define STAGE_SCHEDULE_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stdint.h>         // for int64_t
+
+/**
+ * @brief Loop stages whose rate can be set independently of the integrator step.
+ */
+typedef enum
+{
+	SCHEDULED_FLOW_GEN,           // flow_gen_every_n_ticks
+	SCHEDULED_HISTORY_UPDATES,    // history_every_n_ticks
+	SCHEDULED_TURBINE_CONTROL,    // turbine_control_every_n_ticks, 0 = control_dt_sec / dt_sec
+	SCHEDULED_CONTINUOUS_LOGGING, // continuous_logging_every_n_ticks
+	SCHEDULED_DATA_PROCESSING,    // data_processing_every_n_ticks
+	SCHEDULED_STAGE_COUNT
+} scheduled_stage_t;
+
+/**
+ * @brief Base tick counter and per-stage periods, all in whole ticks.
+ *
+ * A stage with period `n` is due whenever the number of completed base steps is a multiple
+ * of `n`. Stages checked before `advance_stage_schedule()` therefore run on the first step,
+ * stages checked after it run once `n` steps have completed, like the former `control_dt_sec`
+ * accumulator. Counting in integers keeps the rates exact over arbitrarily long runs.
+ */
+typedef struct
+{
+	double base_dt_sec;
+	double start_time_sec;
+	int64_t tick; // completed base steps
+	int64_t every_n_ticks[SCHEDULED_STAGE_COUNT];
+	int64_t n_runs[SCHEDULED_STAGE_COUNT];
+} stage_schedule_t;
+
+int init_stage_schedule(stage_schedule_t *schedule, const param_array_t *fixed_data, double base_dt_sec, double start_time_sec);
+void resume_stage_schedule(stage_schedule_t *schedule, double start_time_sec, int64_t tick);
+double advance_stage_schedule(stage_schedule_t *schedule);
+bool stage_is_due(stage_schedule_t *schedule, scheduled_stage_t stage);
+void log_stage_schedule_statistics(const stage_schedule_t *schedule);
+
+#endif // STAGE_SCHEDULE_H
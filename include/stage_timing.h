@@ -0,0 +1,63 @@
+/**
+ * @file    stage_timing.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Opt-in per-stage call timing recorded by the MAKE_STAGE_DEFINE dispatchers
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STAGE_TIMING_H
+#define STAGE_TIMING_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdatomic.h>      // for atomic_int_least64_t
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stdint.h>         // for int64_t
+
+// Latency bins: bin 0 is < 1 us, bin k covers [2^(k-1), 2^k) us, the last bin is open ended.
+#define STAGE_TIMING_HISTOGRAM_BINS 16
+
+/**
+ * @brief Call statistics of one stage dispatcher; one static instance per `MAKE_STAGE_DEFINE`.
+ *
+ * The counters are relaxed atomics because one dispatcher may run on several threads at once
+ * (e.g. DISCON calls for different turbines).
+ */
+typedef struct stage_timing
+{
+	const char *name;
+	atomic_int_least64_t n_calls;
+	atomic_int_least64_t total_ns;
+	atomic_int_least64_t min_ns;
+	atomic_int_least64_t max_ns;
+	atomic_int_least64_t histogram[STAGE_TIMING_HISTOGRAM_BINS];
+	struct stage_timing *next; // registration list, built by load-time constructors
+} stage_timing_t;
+
+extern bool stageTimingEnabled; // set from `stage_timing_enable` by configure_stage_timing()
+
+void register_stage_timing(stage_timing_t *timing, const char *name);
+int64_t stage_timing_now_ns(void);
+void record_stage_timing(stage_timing_t *timing, int64_t elapsed_ns);
+void configure_stage_timing(const param_array_t *fixed_data);
+void log_stage_timing_table(void);
+
+#endif // STAGE_TIMING_H
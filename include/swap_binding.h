@@ -0,0 +1,61 @@
+/**
+ * @file    swap_binding.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Table of avr_swap records bound to dynamic parameters, copied in and out on each DISCON call
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SWAP_BINDING_H
+#define SWAP_BINDING_H
+
+#include "xflow_aero_sim.h" // for param_array_t, input_param_type_t
+
+#define SWAP_BINDING_MAX_INDEX 1023 // highest avr_swap record a binding may name
+
+/**
+ * @brief One avr_swap record and the dynamic parameter value it is copied from or to.
+ */
+typedef struct
+{
+	int swap_index;
+	input_param_type_t type; // INPUT_PARAM_DOUBLE or INPUT_PARAM_INT
+	void *value;             // the parameter's value.d or value.i
+} swap_binding_t;
+
+/**
+ * @brief Bindings of one controller, split by direction so each call runs two flat loops.
+ */
+typedef struct
+{
+	swap_binding_t *in; // avr_swap -> parameter, before the controller runs
+	int n_in;
+	swap_binding_t *out; // parameter -> avr_swap, after the controller ran
+	int n_out;
+} swap_binding_table_t;
+
+int swap_record_index(const char *name);
+int compile_swap_bindings(swap_binding_table_t *table, const param_array_t *dynamic_data, const char *spec);
+void swap_bindings_copy_in(const swap_binding_table_t *table, const float *avr_swap);
+void swap_bindings_copy_out(const swap_binding_table_t *table, float *avr_swap);
+void free_swap_bindings(swap_binding_table_t *table);
+
+#endif // SWAP_BINDING_H
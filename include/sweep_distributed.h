@@ -0,0 +1,43 @@
+/**
+ * @file    sweep_distributed.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Coordinator and worker nodes splitting one sweep into shards pulled over TCP
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SWEEP_DISTRIBUTED_H
+#define SWEEP_DISTRIBUTED_H
+
+#include "sweep_scheduler.h" // for sweep_run_t, sweep_case_fn
+#include "xflow_aero_sim.h"  // for param_array_t
+#include <stdint.h>          // for uint64_t
+
+#define SWEEP_PROTOCOL_VERSION 1
+#define SWEEP_DEFAULT_COORDINATOR_ADDRESS "127.0.0.1:47600"
+#define SWEEP_DEFAULT_SHARD_COUNT 64 // shards per sweep when sweep_shard_cases is 0
+
+int sweep_shard_cases(const param_array_t *fixed_data, int n_cases);
+uint64_t sweep_fingerprint(const sweep_run_t *run);
+int run_sweep_coordinator(sweep_run_t *run, const param_array_t *fixed_data);
+int run_sweep_worker(sweep_run_t *run, const param_array_t *dynamic_data, const param_array_t *fixed_data, sweep_case_fn run_case, void *user_data);
+
+#endif // SWEEP_DISTRIBUTED_H
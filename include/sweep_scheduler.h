@@ -0,0 +1,94 @@
+/**
+ * @file    sweep_scheduler.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Built-in parameter sweep scheduler running cases on a pool of worker processes
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SWEEP_SCHEDULER_H
+#define SWEEP_SCHEDULER_H
+
+#include "param_index.h"    // for param_handle_t
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stddef.h>         // for size_t
+
+/**
+ * @brief Runs one complete simulation case in the calling (worker) process.
+ *
+ * Called after the case's parameter overrides have been applied to `dynamic_data` /
+ * `fixed_data`; it should run from `time_sec` 0 to `dur_sec` or until `shutdownFlag`.
+ */
+typedef void (*sweep_case_fn)(const param_array_t *dynamic_data, const param_array_t *fixed_data, void *user_data);
+
+/**
+ * @brief List of parameter cases: `n_cases` rows of `n_axes` values, row-major.
+ */
+typedef struct
+{
+	int n_axes;
+	int n_cases;
+	char **axis_names; // parameter name of each column
+	double *values;    // n_cases * n_axes
+} sweep_cases_t;
+
+/**
+ * @brief Per-case result, written by the worker into memory shared with the scheduler.
+ */
+typedef struct
+{
+	double wall_time;   // seconds spent in the case, measured by the worker
+	double end_time;    // time_sec when the case stopped
+	int finished;       // set by the worker once the values below are valid
+	int stopped_early;  // case ended before dur_sec (shutdownFlag)
+	int exit_code;      // filled in by the scheduler from the worker exit status
+	int reserved;
+} sweep_case_result_t;
+
+/**
+ * @brief State of one sweep: the cases, the reported channels and the result storage shared with workers.
+ */
+typedef struct
+{
+	sweep_cases_t cases;
+	char **channels; // reported dynamic channel names
+	int n_channels;
+	param_handle_t *channel_handles;
+	param_handle_t time_handle;
+	double dur_sec;
+	int workers;                  // concurrent local cases
+	sweep_case_result_t *results; // n_cases, in the shared mapping
+	double *values;               // n_cases * n_channels, in the shared mapping
+	size_t shared_bytes;
+} sweep_run_t;
+
+bool sweep_is_configured(const param_array_t *fixed_data);
+int build_sweep_cases(const param_array_t *fixed_data, sweep_cases_t *cases);
+void free_sweep_cases(sweep_cases_t *cases);
+int apply_sweep_case(const param_array_t *dynamic_data, const param_array_t *fixed_data, const sweep_cases_t *cases, int case_index);
+int prepare_sweep_run(const param_array_t *dynamic_data, const param_array_t *fixed_data, const char **default_channels, int n_default_channels, sweep_run_t *run);
+int run_sweep_range(sweep_run_t *run, const param_array_t *dynamic_data, const param_array_t *fixed_data, sweep_case_fn run_case, void *user_data, int first_case, int n_cases);
+int report_sweep_run(const sweep_run_t *run, const param_array_t *fixed_data, int n_done, int workers, double total_wall);
+void release_sweep_run(sweep_run_t *run);
+int run_sweep(const param_array_t *dynamic_data, const param_array_t *fixed_data, sweep_case_fn run_case, void *user_data, const char **default_channels, int n_default_channels);
+
+#endif // SWEEP_SCHEDULER_H
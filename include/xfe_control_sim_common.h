@@ -30,6 +30,8 @@
 #include "xflow_aero_sim.h"  // for param_array_t, bts_data_t, input_param_...
 #include "xflow_shmem_sem.h" // for semaphore_info_t
 #include <stdbool.h>         // IWYU pragma: keep
+#include <stdio.h>           // for FILE
+#include <time.h>            // for timespec
 
 #ifdef _WIN32
 #ifdef XFE_CONTROL_SIM_LIB_EXPORTS
@@ -44,13 +46,6 @@
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
 
-// Define the shared memory name based on the platform.
-#ifdef _WIN32
-MAYBE_UNUSED static const char *shmemName = "Local\\precomputed_wind_interp";
-#else
-MAYBE_UNUSED static const char *shmemName = "/precomputed_wind_interp";
-#endif
-
 enum child_status
 {
 	CHILD_STILL_RUNNING = -1,
@@ -76,17 +71,28 @@ void print_velocity_for_y_z_position(bts_data_t *data, const double horizontal_y
 void save_umag_velocity_data_to_csv(const double *vel_data, int num_time_steps, const char *file_path, const char *base_filename, double dt);
 double get_closest_umag(const double *vel_data, int num_time_steps, double current_time, double dt);
 void save_param_array_data_to_csv(const char *filename, const param_array_t *data, int write_header);
+int write_dynamic_data_csv_row(FILE *file, const struct timespec ts, const param_array_t *data);
 void dynamic_data_csv_logger(FILE **file, const csv_logger_action_t action, const char *filename, const param_array_t *data);
 
 int get_param_value(const param_array_t *data, const char *name, input_param_type_t *type, void *value);
+double get_param_double_or_default(const param_array_t *data, const char *name, double default_value);
+int get_param_int_or_default(const param_array_t *data, const char *name, int default_value);
+const char *get_param_string_or_default(const param_array_t *data, const char *name, const char *default_value);
+int parse_delimited_list(const char *text, char ***out_items);
+void free_delimited_list(char **items, int n_items);
 void initialize_data(param_array_t *dynamic_data, param_array_t *fixed_data);
 void save_dynamic_fixed_data_at_shutdown(const param_array_t *dynamic_data, const param_array_t *fixed_data, const bool logging_status);
 void initialize_control_system(param_array_t **dynamic_data, param_array_t **fixed_data, history_task_list_t **out_task_list, const bool logging_status);
 void continuous_logging_function(const param_array_t *dynamic_data, const param_array_t *fixed_data);
+void defer_dynamic_data_logging(const param_array_t *dynamic_data, const param_array_t *fixed_data);
 void load_double_struct_param(const param_array_t *data, const char *param_name, double *param);
-void create_shared_interp(const double *precomputed_wind_interp, int num_sim_steps);
+void create_shared_interp(const param_array_t *fixed_data, const char *series_name, const double *precomputed_wind_interp, int num_sim_steps, double dt_sec, double total_time);
+const char *shared_interp_name(void);
 void destroy_shared_interp(void);
-double *get_shared_interp(const char *name, int num_sim_steps);
+const double *get_shared_interp(const char *segment_name, const char *series_name, double dt_sec, int *num_sim_steps, double *total_time);
+void start_result_collection(const param_array_t *dynamic_data, const param_array_t *fixed_data);
+void flush_result_collection(const param_array_t *fixed_data);
+void stop_result_collection(const param_array_t *fixed_data);
 
 void add_data_to_array(double *array, const long sim_points_count, const int index, const int final_dp_index, const double *value_ptr);
 int get_num_cores(void);
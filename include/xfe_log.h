@@ -0,0 +1,117 @@
+/**
+ * @file    xfe_log.h
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Leveled, rate-limited diagnostic messages formatted into a ring and written by a background thread
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef XFE_LOG_H
+#define XFE_LOG_H
+
+#include "xflow_aero_sim.h" // for param_array_t
+#include <stdatomic.h>      // for atomic_int_least64_t, atomic_long
+#include <stdbool.h>        // IWYU pragma: keep
+
+#define XFE_LOG_LEVEL_DEBUG 0
+#define XFE_LOG_LEVEL_INFO 1
+#define XFE_LOG_LEVEL_WARN 2
+#define XFE_LOG_LEVEL_ERROR 3
+#define XFE_LOG_LEVEL_OFF 4
+
+// lowest level compiled in; calls below it expand to nothing (set through cmake, XFE_LOG_MIN_LEVEL)
+#ifndef XFE_LOG_MIN_LEVEL
+#define XFE_LOG_MIN_LEVEL XFE_LOG_LEVEL_DEBUG
+#endif
+
+#define XFE_LOG_DEFAULT_RING_RECORDS 1024
+#define XFE_LOG_RECORD_TEXT 256 // bytes of formatted text per record, longer messages are truncated
+
+/**
+ * @brief Rate limit of one call site, zero-initialised as a function-local static by the `_EVERY` macros.
+ */
+typedef struct
+{
+	atomic_int_least64_t next_ns; // monotonic time the site may log again
+	atomic_long suppressed;       // calls dropped since the site last logged
+} xfe_log_site_t;
+
+int xfe_log_start(const param_array_t *fixed_data);
+void xfe_log_stop(void);
+bool xfe_log_level_enabled(int level);
+long xfe_log_site_pass(xfe_log_site_t *site, double period_sec);
+void xfe_log_write(int level, long suppressed, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+/*
+ *   XFE_LOG_<LEVEL>(format, ...)
+ *   XFE_LOG_<LEVEL>_EVERY(period_sec, format, ...)
+ *
+ *   - queue one message for the background writer (or write it directly if none is running)
+ *   - `_EVERY` logs at most once per `period_sec` per call site and reports how many calls it dropped
+ *   - levels below XFE_LOG_MIN_LEVEL expand to ((void)0): no call, no argument evaluation
+ */
+#define XFE_LOG_RATE_LIMITED(level, period_sec, ...)                                      \
+	do                                                                                    \
+	{                                                                                     \
+		static xfe_log_site_t XfeLogSite;                                                 \
+		if (xfe_log_level_enabled(level))                                                 \
+		{                                                                                 \
+			const long xfe_log_suppressed = xfe_log_site_pass(&XfeLogSite, (period_sec)); \
+			if (xfe_log_suppressed >= 0)                                                  \
+			{                                                                             \
+				xfe_log_write((level), xfe_log_suppressed, __VA_ARGS__);                  \
+			}                                                                             \
+		}                                                                                 \
+	} while (0)
+
+#if XFE_LOG_MIN_LEVEL <= XFE_LOG_LEVEL_DEBUG
+#define XFE_LOG_DEBUG(...) xfe_log_write(XFE_LOG_LEVEL_DEBUG, 0, __VA_ARGS__)
+#define XFE_LOG_DEBUG_EVERY(period_sec, ...) XFE_LOG_RATE_LIMITED(XFE_LOG_LEVEL_DEBUG, period_sec, __VA_ARGS__)
+#else
+#define XFE_LOG_DEBUG(...) ((void)0)
+#define XFE_LOG_DEBUG_EVERY(period_sec, ...) ((void)0)
+#endif
+
+#if XFE_LOG_MIN_LEVEL <= XFE_LOG_LEVEL_INFO
+#define XFE_LOG_INFO(...) xfe_log_write(XFE_LOG_LEVEL_INFO, 0, __VA_ARGS__)
+#define XFE_LOG_INFO_EVERY(period_sec, ...) XFE_LOG_RATE_LIMITED(XFE_LOG_LEVEL_INFO, period_sec, __VA_ARGS__)
+#else
+#define XFE_LOG_INFO(...) ((void)0)
+#define XFE_LOG_INFO_EVERY(period_sec, ...) ((void)0)
+#endif
+
+#if XFE_LOG_MIN_LEVEL <= XFE_LOG_LEVEL_WARN
+#define XFE_LOG_WARN(...) xfe_log_write(XFE_LOG_LEVEL_WARN, 0, __VA_ARGS__)
+#define XFE_LOG_WARN_EVERY(period_sec, ...) XFE_LOG_RATE_LIMITED(XFE_LOG_LEVEL_WARN, period_sec, __VA_ARGS__)
+#else
+#define XFE_LOG_WARN(...) ((void)0)
+#define XFE_LOG_WARN_EVERY(period_sec, ...) ((void)0)
+#endif
+
+#if XFE_LOG_MIN_LEVEL <= XFE_LOG_LEVEL_ERROR
+#define XFE_LOG_ERROR(...) xfe_log_write(XFE_LOG_LEVEL_ERROR, 0, __VA_ARGS__)
+#define XFE_LOG_ERROR_EVERY(period_sec, ...) XFE_LOG_RATE_LIMITED(XFE_LOG_LEVEL_ERROR, period_sec, __VA_ARGS__)
+#else
+#define XFE_LOG_ERROR(...) ((void)0)
+#define XFE_LOG_ERROR_EVERY(period_sec, ...) ((void)0)
+#endif
+
+#endif // XFE_LOG_H
@@ -13,6 +13,10 @@ from PyQt5.QtCore import Qt, QTimer, QSettings, QVariant, QMimeData
 from PyQt5.QtGui import QKeySequence, QColor, QDragEnterEvent, QDropEvent
 import pyqtgraph.exporters
 
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from xfe_binary_log import is_xfelog, read_xfelog
+from xfe_log_pyramid import is_complete, overview, pyramid_path, read_log_window, read_pyramid
+
 # Optional scipy imports with fallbacks
 try:
 	from scipy.signal import savgol_filter, find_peaks
@@ -33,6 +37,31 @@ except ImportError:
 	print(
 	    "Warning: markdown library not available. Help will display as plain text. Install with: pip install markdown")
 
+DATA_FILE_FILTER = "Data Files (*.csv *.xfelog);;CSV Files (*.csv);;Binary Logs (*.xfelog);;All Files (*)"
+PYRAMID_OVERVIEW_MIN_ROWS = 200000  # logs with more rows than this open as their .xfepyr envelope
+PYRAMID_DETAIL_MAX_ROWS = 200000  # zooming in to at most this many rows loads them at full resolution
+
+def read_data_file(filename):
+	"""
+	Load a CSV or .xfelog binary dynamic data log into a DataFrame.
+
+	Long logs with a complete .xfepyr companion load as its min/max envelope instead; the
+	returned frame then carries the pyramid in df.attrs["pyramid"].
+	"""
+	pyr_path = pyramid_path(filename)
+	if pyr_path.exists():
+		try:
+			pyramid = read_pyramid(pyr_path)
+		except (OSError, ValueError):
+			pyramid = None
+		if pyramid and is_complete(pyramid) and pyramid["n_rows"] > PYRAMID_OVERVIEW_MIN_ROWS:
+			df = overview(pyramid)
+			df.attrs["pyramid"] = pyramid
+			return df
+	if is_xfelog(filename):
+		return read_xfelog(filename)
+	return pd.read_csv(filename, on_bad_lines='warn')
+
 class CSVPlotter(QMainWindow):
 
 	def __init__(self):
@@ -44,6 +73,8 @@ class CSVPlotter(QMainWindow):
 		self.settings = QSettings("XFlow", "CSVPlotter")
 		self.theme_dark = self.settings.value("theme_dark", True, type=bool)
 		self.df = None
+		self.overview_df = None  # pyramid envelope of a long log, None when the whole log is loaded
+		self.detail_rows = None  # (first_row, n_rows) of the full-resolution window shown over it
 		self.csv_path = None
 		self.csv_mtime = None
 		self.zoom_mode = False
@@ -62,6 +93,11 @@ class CSVPlotter(QMainWindow):
 		self.highlighted_regions = []  # Store highlighted regions
 		self.data_tooltip = None  # Tooltip for showing data values
 
+		self.detail_timer = QTimer(self)  # debounces pan/zoom before reading a full-resolution window
+		self.detail_timer.setSingleShot(True)
+		self.detail_timer.setInterval(250)
+		self.detail_timer.timeout.connect(self.update_detail_window)
+
 		self.setup_ui()
 		self.create_menu_bar()
 		self.create_toolbar()
@@ -384,11 +420,11 @@ class CSVPlotter(QMainWindow):
 		"""Add another CSV file for comparison"""
 		start_dir = self.settings.value("last_csv_dir", os.path.expanduser("~"))
 		filename, _ = QFileDialog.getOpenFileName(
-		    self, "Add Comparison CSV", start_dir, "CSV Files (*.csv);;All Files (*)")
+		    self, "Add Comparison CSV", start_dir, DATA_FILE_FILTER)
 
 		if filename:
 			try:
-				df = pd.read_csv(filename, on_bad_lines='warn')
+				df = read_data_file(filename)
 				file_name = os.path.basename(filename)
 
 				# Avoid duplicate names
@@ -2084,6 +2120,7 @@ class CSVPlotter(QMainWindow):
 				self.main_plot.addItem(self.data_tooltip)
 
 		self.proxy = pg.SignalProxy(self.main_plot.scene().sigMouseMoved, rateLimit=60, slot=self.mouse_moved)
+		self.main_plot.sigXRangeChanged.connect(lambda *_: self.detail_timer.start())
 
 		self.splitter.insertWidget(0, self.plot_area)
 
@@ -2170,24 +2207,31 @@ class CSVPlotter(QMainWindow):
 	def dropEvent(self, event: QDropEvent):
 		files = [u.toLocalFile() for u in event.mimeData().urls()]
 		for f in files:
-			if f.lower().endswith('.csv'):
+			if f.lower().endswith(('.csv', '.xfelog')):
 				self.load_csv(f)
 				break
 
 	def open_file_dialog(self):
 		start_dir = self.settings.value("last_csv_dir", os.path.expanduser("~"))
-		filename, _ = QFileDialog.getOpenFileName(self, "Open CSV File", start_dir, "CSV Files (*.csv);;All Files (*)")
+		filename, _ = QFileDialog.getOpenFileName(self, "Open CSV File", start_dir, DATA_FILE_FILTER)
 		if filename:
 			self.load_csv(filename)
 
 	def load_csv(self, filename):
 		try:
-			self.df = pd.read_csv(filename, on_bad_lines='warn')
+			self.df = read_data_file(filename)
 		except Exception as e:
 			QMessageBox.critical(self, "Error", f"Failed to read CSV: {e}")
 			return
 
-		self.statusBar().showMessage(f"Loaded: {os.path.basename(filename)} ({len(self.df)} rows)")
+		self.overview_df = self.df if "pyramid" in self.df.attrs else None
+		self.detail_rows = None
+		if self.overview_df is not None:
+			self.statusBar().showMessage(
+			    f"Loaded overview of {os.path.basename(filename)} ({self.df.attrs['pyramid']['n_rows']} rows, "
+			    f"zoom in for full resolution)")
+		else:
+			self.statusBar().showMessage(f"Loaded: {os.path.basename(filename)} ({len(self.df)} rows)")
 		self.csv_path = filename
 		self.csv_mtime = os.path.getmtime(filename)
 		self.settings.setValue("last_csv_file", filename)
@@ -2199,6 +2243,48 @@ class CSVPlotter(QMainWindow):
 		self.update_csv_preview()
 		self.update_statistics()
 
+	def update_detail_window(self):
+		"""Swap in the full-resolution rows of the zoomed window of a pyramid overview, or back to the overview."""
+		if self.overview_df is None or not self.csv_path:
+			return
+		x_col = self.x_selector.currentText()
+		if x_col not in self.overview_df.columns:
+			return
+
+		x_min, x_max = self.main_plot.getViewBox().viewRange()[0]
+		x = self.overview_df[x_col].to_numpy()
+		visible = np.flatnonzero((x >= x_min) & (x <= x_max))
+		if visible.size == 0:
+			return
+		starts = self.overview_df.attrs["first_row"][visible]
+		ends = starts + self.overview_df.attrs["n_rows"][visible]
+		first_row, n_rows = int(starts.min()), int(ends.max() - starts.min())
+
+		if n_rows > PYRAMID_DETAIL_MAX_ROWS:
+			if self.detail_rows is None:
+				return
+			self.detail_rows = None
+			new_df = self.overview_df
+		else:
+			if self.detail_rows and self.detail_rows[0] <= first_row and first_row + n_rows <= sum(self.detail_rows):
+				return
+			try:
+				new_df = read_log_window(self.csv_path, self.overview_df.attrs["pyramid"], first_row, n_rows)
+			except Exception as e:
+				self.statusBar().showMessage(f"Failed to read window: {e}")
+				return
+			self.detail_rows = (first_row, n_rows)
+
+		x_range, y_range = self.main_plot.getViewBox().viewRange()
+		self.df = new_df
+		self.plot_selected()
+		self.main_plot.setXRange(*x_range, padding=0)
+		self.main_plot.setYRange(*y_range, padding=0)
+		if self.detail_rows:
+			self.statusBar().showMessage(f"Full resolution: rows {first_row} to {first_row + n_rows}")
+		else:
+			self.statusBar().showMessage("Overview (min/max envelope)")
+
 	def load_column_selectors(self):
 		self.x_selector.clear()
 		self.y1_list.clear()
@@ -2549,12 +2635,14 @@ class CSVPlotter(QMainWindow):
 		if new_mtime != self.csv_mtime:
 			self.csv_mtime = new_mtime
 			try:
-				new_df = pd.read_csv(self.csv_path, on_bad_lines='warn')
+				new_df = read_data_file(self.csv_path)
 			except Exception as e:
 				self.statusBar().showMessage(f"Failed to reload: {e}")
 				return
 
 			self.df = new_df
+			self.overview_df = new_df if "pyramid" in new_df.attrs else None
+			self.detail_rows = None
 			x_range, y_range = self.main_plot.getViewBox().viewRange()
 			self.plot_selected()
 			self.main_plot.setXRange(*x_range, padding=0)
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+Reader and CSV converter for xfe-control-sim binary dynamic data logs (.xfelog).
+
+The file is written by `dynamic_data_binary_logger` (src/binary_logger.c) when the
+configuration sets `dynamic_data_logger_format` to `binary`:
+
+- fixed header (magic, version, byte order mark, header_size, n_columns, row_size,
+  string_width, dt)
+- one descriptor per column: uint16 type, uint16 name length, name bytes
+- zero padding up to header_size
+- fixed-width rows, columns packed in header order
+
+Usage:
+	python xfe_binary_log.py dynamic_data.xfelog               # writes dynamic_data.csv
+	python xfe_binary_log.py dynamic_data.xfelog out.csv
+"""
+
+import struct
+import sys
+from pathlib import Path
+
+import numpy as np
+import pandas as pd
+
+MAGIC = b"XFELOG\0\0"
+BYTE_ORDER_MARK = 0x01020304
+HEADER_STRUCT = "8s6Id"  # magic, version, bom, header_size, n_columns, row_size, string_width, dt
+TYPE_INT32 = 1
+TYPE_FLOAT64 = 2
+TYPE_STRING = 3
+
+
+def is_xfelog(path):
+	"""Return True if the file starts with the .xfelog magic."""
+	try:
+		with open(path, "rb") as f:
+			return f.read(len(MAGIC)) == MAGIC
+	except OSError:
+		return False
+
+
+def read_header(path):
+	"""Parse the header and return (dtype, header_size, dt)."""
+	with open(path, "rb") as f:
+		raw = f.read(struct.calcsize("<" + HEADER_STRUCT))
+		if len(raw) < struct.calcsize("<" + HEADER_STRUCT) or raw[:len(MAGIC)] != MAGIC:
+			raise ValueError(f"{path} is not an .xfelog file")
+
+		order = "<"
+		fields = struct.unpack(order + HEADER_STRUCT, raw)
+		if fields[2] != BYTE_ORDER_MARK:
+			order = ">"
+			fields = struct.unpack(order + HEADER_STRUCT, raw)
+		_, version, _, header_size, n_columns, row_size, string_width, dt = fields
+		if version != 1:
+			raise ValueError(f"Unsupported .xfelog version {version}")
+
+		names = []
+		formats = []
+		for _ in range(n_columns):
+			col_type, name_len = struct.unpack(order + "HH", f.read(4))
+			names.append(f.read(name_len).decode("utf-8", errors="replace"))
+			if col_type == TYPE_INT32:
+				formats.append(order + "i4")
+			elif col_type == TYPE_FLOAT64:
+				formats.append(order + "f8")
+			elif col_type == TYPE_STRING:
+				formats.append(f"S{string_width}")
+			else:
+				raise ValueError(f"Unknown column type {col_type} for {names[-1]}")
+
+	dtype = np.dtype({"names": names, "formats": formats})
+	if dtype.itemsize != row_size:
+		raise ValueError(f"Row size mismatch: header says {row_size}, columns give {dtype.itemsize}")
+	return dtype, header_size, dt
+
+
+def read_xfelog(path, first_row=0, n_rows=None):
+	"""Load an .xfelog file, or n_rows of it from first_row, into a pandas DataFrame (a trailing partial row is ignored)."""
+	dtype, header_size, dt = read_header(path)
+	available = max(0, (Path(path).stat().st_size - header_size) // dtype.itemsize - first_row)
+	n_rows = available if n_rows is None else max(0, min(n_rows, available))
+	offset = header_size + first_row * dtype.itemsize
+	rows = np.memmap(path, dtype=dtype, mode="r", offset=offset, shape=(n_rows,)) if n_rows else np.empty(0, dtype)
+
+	df = pd.DataFrame({name: rows[name] for name in dtype.names})
+	for name in dtype.names:
+		if dtype[name].kind == "S":
+			df[name] = df[name].str.decode("utf-8", errors="replace")
+	df.attrs["dt"] = dt
+	return df
+
+
+def convert_to_csv(path, out_path=None):
+	"""Write the CSV the text logger would have produced; returns the output path."""
+	out_path = Path(out_path) if out_path else Path(path).with_suffix(".csv")
+	read_xfelog(path).to_csv(out_path, index=False, float_format="%.10f")
+	return out_path
+
+
+def main(argv):
+	if len(argv) < 2 or len(argv) > 3:
+		print(__doc__)
+		return 1
+	out_path = convert_to_csv(argv[1], argv[2] if len(argv) == 3 else None)
+	print(f"Wrote {out_path}")
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
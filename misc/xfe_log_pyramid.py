@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Reader for the min/max pyramid written next to xfe-control-sim dynamic data logs (.xfepyr).
+
+The file is written by `log_pyramid_add_row` (src/log_pyramid.c) while the run logs, unless
+the configuration sets `dynamic_data_log_pyramid` to 0:
+
+- fixed header (magic, version, byte order mark, header_size, n_channels, n_levels,
+  record_size, rows per record of each level, n_rows, n_records, log_data_offset)
+- one 64-byte NUL padded name per channel
+- records: uint32 level, uint32 n_rows, uint64 first_row, uint64 byte_offset into the full
+  log, then a (min, max) float64 pair per channel
+
+n_rows is only filled in when the run closes its log, so a pyramid of a run still in
+progress reads as incomplete.
+
+Usage:
+	python xfe_log_pyramid.py log/dynamic_data.xfepyr          # prints the levels
+"""
+
+import struct
+import sys
+from pathlib import Path
+
+import numpy as np
+import pandas as pd
+
+from xfe_binary_log import is_xfelog, read_xfelog
+
+MAGIC = b"XFEPYR\0\0"
+BYTE_ORDER_MARK = 0x01020304
+EXTENSION = ".xfepyr"
+NAME_WIDTH = 64
+MAX_LEVELS = 6
+HEADER_STRUCT = "8s6I6Q3Q"  # magic, version, bom, header_size, n_channels, n_levels, record_size, factors, n_rows, n_records, log_data_offset
+
+
+def pyramid_path(log_path):
+	"""Return the .xfepyr path that belongs to a .csv or .xfelog log."""
+	return Path(log_path).with_suffix(EXTENSION)
+
+
+def read_pyramid(path):
+	"""Parse a pyramid; returns a dict with channels, factors, n_rows, log_data_offset and per-level records."""
+	raw = Path(path).read_bytes()
+	header_len = struct.calcsize("<" + HEADER_STRUCT)
+	if len(raw) < header_len or raw[:len(MAGIC)] != MAGIC:
+		raise ValueError(f"{path} is not an .xfepyr file")
+
+	order = "<"
+	fields = struct.unpack_from(order + HEADER_STRUCT, raw)
+	if fields[2] != BYTE_ORDER_MARK:
+		order = ">"
+		fields = struct.unpack_from(order + HEADER_STRUCT, raw)
+	version, header_size, n_channels, n_levels, record_size = fields[1], fields[3], fields[4], fields[5], fields[6]
+	factors = list(fields[7:7 + n_levels])
+	n_rows, n_records, log_data_offset = fields[7 + MAX_LEVELS:]
+	if version != 1:
+		raise ValueError(f"Unsupported .xfepyr version {version}")
+
+	names = [
+	    raw[header_len + i * NAME_WIDTH:header_len + (i + 1) * NAME_WIDTH].split(b"\0", 1)[0].decode(
+	        "utf-8", errors="replace") for i in range(n_channels)
+	]
+	dtype = np.dtype([("level", order + "u4"), ("n_rows", order + "u4"), ("first_row", order + "u8"),
+	                  ("byte_offset", order + "u8"), ("min_max", order + "f8", (n_channels, 2))])
+	if dtype.itemsize != record_size:
+		raise ValueError(f"Record size mismatch: header says {record_size}, channels give {dtype.itemsize}")
+	count = (len(raw) - header_size) // record_size
+	records = np.frombuffer(raw, dtype=dtype, count=count, offset=header_size)
+
+	levels = []
+	for level in range(n_levels):
+		rec = records[records["level"] == level]
+		levels.append(rec[np.argsort(rec["first_row"], kind="stable")])
+	return {
+	    "channels": names,
+	    "factors": factors,
+	    "n_rows": n_rows,
+	    "n_records": n_records,
+	    "log_data_offset": log_data_offset,
+	    "levels": levels,
+	}
+
+
+def is_complete(pyramid):
+	"""True once the writing run closed its log (n_rows is patched in at close)."""
+	return pyramid["n_rows"] > 0
+
+
+def overview(pyramid, max_points=20000):
+	"""
+	Envelope of the whole run as a DataFrame, two rows (min then max) per record of the finest
+	level that fits in max_points. Plotting one channel against another traces the min/max band.
+	df.attrs["first_row"] and df.attrs["n_rows"] give the log rows each DataFrame row covers.
+	"""
+	levels = pyramid["levels"]
+	chosen = levels[-1]
+	for rec in levels:
+		if 2 * len(rec) <= max_points:
+			chosen = rec
+			break
+	df = pd.DataFrame({name: chosen["min_max"][:, c, :].reshape(-1) for c, name in enumerate(pyramid["channels"])})
+	df.attrs["first_row"] = np.repeat(chosen["first_row"], 2)
+	df.attrs["n_rows"] = np.repeat(chosen["n_rows"], 2)
+	return df
+
+
+def read_log_window(log_path, pyramid, first_row, n_rows):
+	"""Read n_rows of the full log from first_row, seeking through the level-0 byte offsets for CSV logs."""
+	if is_xfelog(log_path):
+		return read_xfelog(log_path, first_row, n_rows)
+
+	with open(log_path, "r", newline="") as f:
+		columns = f.readline().rstrip("\r\n").split(",")
+		skip = first_row
+		level0 = pyramid["levels"][0]
+		k = int(np.searchsorted(level0["first_row"], first_row, side="right")) - 1
+		if k >= 0 and level0["byte_offset"][k] != np.iinfo(np.uint64).max:
+			f.seek(int(level0["byte_offset"][k]))
+			skip = first_row - int(level0["first_row"][k])
+		return pd.read_csv(f, header=None, names=columns, skiprows=skip, nrows=n_rows, on_bad_lines='warn')
+
+
+def main(argv):
+	if len(argv) != 2:
+		print(__doc__)
+		return 1
+	pyramid = read_pyramid(argv[1])
+	state = "" if is_complete(pyramid) else " (incomplete, run still logging)"
+	print(f"{len(pyramid['channels'])} channels, {pyramid['n_rows']} rows{state}")
+	for factor, rec in zip(pyramid["factors"], pyramid["levels"]):
+		print(f"  {factor:>8} rows/record: {len(rec)} records")
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
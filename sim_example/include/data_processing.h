@@ -62,9 +62,11 @@ typedef enum
 MAKE_STAGE(data_processing, void, (DATA_PROCESSING_PARAM_LIST))
 
 void example_data_processing(DATA_PROCESSING_PARAM_LIST);
+void online_stats_data_processing(DATA_PROCESSING_PARAM_LIST);
 
 static const data_processing_Map dataProcessingMap[] = {
 	{"example_data_processing", example_data_processing},
+	{"online_stats_data_processing", online_stats_data_processing},
 };
 
 #endif
@@ -43,6 +43,8 @@
 typedef void (*DISCON_fn)(DISCON_PARAM_LIST);
 
 void register_DISCON(DISCON_fn fn);
+bool discon_instance_is_primary(void);
+void discon_instance_fail(void);
 
 XFE_CONTROL_SIM_LIB_EXPORT void __cdecl DISCON(DISCON_PARAM_LIST);
 
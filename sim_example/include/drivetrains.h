@@ -27,6 +27,7 @@
 #include "xfe_control_sim_common.h"
 #include "xflow_aero_sim.h"
 #include "make_stage.h"
+#include "ensemble.h" // for ensemble_t
 // NOLINTEND(llvm-include-order)
 
 // your one and only definition of the parameter list:
@@ -42,4 +43,17 @@ static const drivetrain_Map drivetrainMap[] = {
 	{"example_drivetrain", example_drivetrain},
 };
 
+// batched form for the ensemble engine
+#define DRIVETRAIN_BATCH_PARAM_LIST MAYBE_UNUSED ensemble_t *ensemble, MAYBE_UNUSED const param_array_t *fixed_data
+#define DRIVETRAIN_BATCH_CALL_ARGS ensemble, fixed_data
+
+MAKE_STAGE(drivetrain_batch, void, (DRIVETRAIN_BATCH_PARAM_LIST))
+
+void example_drivetrain_batch(DRIVETRAIN_BATCH_PARAM_LIST);
+
+// keyed by the same ids as drivetrainMap
+static const drivetrain_batch_Map drivetrainBatchMap[] = {
+	{"example_drivetrain", example_drivetrain_batch},
+};
+
 #endif
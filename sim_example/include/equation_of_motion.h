@@ -26,6 +26,8 @@
 #include "xflow_core.h"
 #include "xflow_aero_sim.h"
 #include "make_stage.h"
+#include "ensemble.h"             // for ensemble_t
+#include "numerical_integrator.h" // for eom_jacobian_Map
 
 // your one and only definition of the parameter list:
 #define EOM_PARAM_LIST MAYBE_UNUSED double **state_vars, MAYBE_UNUSED const char **state_names, MAYBE_UNUSED const int n_state_var, MAYBE_UNUSED double *dx, MAYBE_UNUSED const param_array_t *dynamic_data, MAYBE_UNUSED const param_array_t *fixed_data
@@ -42,4 +44,27 @@ static const eom_Map eomMap[] = {
 	{"example_turbine_eom",           example_turbine_eom          },
 };
 
+// batched form for the ensemble engine: dx holds n_state_var blocks of ensemble->stride values
+#define EOM_BATCH_PARAM_LIST MAYBE_UNUSED ensemble_t *ensemble, MAYBE_UNUSED double *dx, MAYBE_UNUSED const param_array_t *fixed_data
+#define EOM_BATCH_CALL_ARGS ensemble, dx, fixed_data
+
+MAKE_STAGE(eom_batch, void, (EOM_BATCH_PARAM_LIST))
+
+void eom_simple_ball_thrown_in_air_batch(EOM_BATCH_PARAM_LIST);
+void example_turbine_eom_batch(EOM_BATCH_PARAM_LIST);
+
+// keyed by the same ids as eomMap, so eom_function_call selects both forms
+static const eom_batch_Map eomBatchMap[] = {
+	{"eom_simple_ball_thrown_in_air", eom_simple_ball_thrown_in_air_batch},
+	{"example_turbine_eom",           example_turbine_eom_batch          },
+};
+
+// analytic Jacobians for the implicit integrators, keyed by the same ids as eomMap; an eom
+// without an entry gets a finite-difference Jacobian built from repeated eom() calls
+void eom_simple_ball_thrown_in_air_jacobian(EOM_JACOBIAN_PARAM_LIST);
+
+static const eom_jacobian_Map eomJacobianMap[] = {
+	{"eom_simple_ball_thrown_in_air", eom_simple_ball_thrown_in_air_jacobian},
+};
+
 #endif
@@ -26,6 +26,7 @@
 #include "xfe_control_sim_common.h"
 #include "xflow_aero_sim.h"
 #include "make_stage.h"
+#include "ensemble.h" // for ensemble_t
 // NOLINTEND(llvm-include-order)
 
 // your one and only definition of the parameter list:
@@ -36,9 +37,26 @@
 MAKE_STAGE(flow_sim_model, void, (FLOW_SIM_MODEL_PARAM_LIST))
 
 void example_flow_sim_model(FLOW_SIM_MODEL_PARAM_LIST);
+void table_flow_sim_model(FLOW_SIM_MODEL_PARAM_LIST);
 
 static const flow_sim_model_Map flowSimModelMap[] = {
 	{"example_flow_sim_model", example_flow_sim_model},
+	{"table_flow_sim_model", table_flow_sim_model},
+};
+
+// batched form for the ensemble engine
+#define FLOW_SIM_MODEL_BATCH_PARAM_LIST MAYBE_UNUSED ensemble_t *ensemble, MAYBE_UNUSED const param_array_t *fixed_data
+#define FLOW_SIM_MODEL_BATCH_CALL_ARGS ensemble, fixed_data
+
+MAKE_STAGE(flow_sim_model_batch, void, (FLOW_SIM_MODEL_BATCH_PARAM_LIST))
+
+void example_flow_sim_model_batch(FLOW_SIM_MODEL_BATCH_PARAM_LIST);
+void table_flow_sim_model_batch(FLOW_SIM_MODEL_BATCH_PARAM_LIST);
+
+// keyed by the same ids as flowSimModelMap
+static const flow_sim_model_batch_Map flowSimModelBatchMap[] = {
+	{"example_flow_sim_model", example_flow_sim_model_batch},
+	{"table_flow_sim_model", table_flow_sim_model_batch},
 };
 
 #endif
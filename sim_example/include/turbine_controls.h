@@ -27,6 +27,7 @@
 #include "xfe_control_sim_common.h"
 #include "xflow_aero_sim.h"
 #include "make_stage.h"
+#include "ensemble.h" // for ensemble_t
 // NOLINTEND(llvm-include-order)
 
 // your one and only definition of the parameter list:
@@ -44,4 +45,17 @@ static const turbine_control_Map turbineControlMap[] = {
 	{"kw2_turbine_control",     kw2_turbine_control    },
 };
 
+// batched form for the ensemble engine
+#define TURBINE_CONTROL_BATCH_PARAM_LIST MAYBE_UNUSED ensemble_t *ensemble, MAYBE_UNUSED const param_array_t *fixed_data
+#define TURBINE_CONTROL_BATCH_CALL_ARGS ensemble, fixed_data
+
+MAKE_STAGE(turbine_control_batch, void, (TURBINE_CONTROL_BATCH_PARAM_LIST))
+
+void kw2_turbine_control_batch(TURBINE_CONTROL_BATCH_PARAM_LIST);
+
+// keyed by the same ids as turbineControlMap
+static const turbine_control_batch_Map turbineControlBatchMap[] = {
+	{"kw2_turbine_control", kw2_turbine_control_batch},
+};
+
 #endif
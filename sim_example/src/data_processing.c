@@ -34,6 +34,9 @@
 #include "logger.h"          // for log_message
 #include "make_stage.h"
 #include "maybe_unused.h"
+#include "online_stats.h"           // for online_stats_t, online_stats_update
+#include "param_index.h"            // for get_param_handle, param_double_from_handle
+#include "stage_context.h"          // for STAGE_STATE_WITH_RELEASE
 #include "xfe_control_sim_common.h" // for get_param, param_array_t
 #include "xflow_aero_sim.h"
 #include "xflow_core.h" // for usleep_now, shutdownFlag, get_real_time...
@@ -46,6 +49,14 @@
 #include <stdlib.h> // for free, exit, EXIT_FAILURE, malloc
 #include <string.h>
 
+#ifdef _WIN32
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif
+#else
+#include <limits.h> // for PATH_MAX
+#endif
+
 // expand definitions once, using both the decl‐list and the call‐list
 MAKE_STAGE_DEFINE(data_processing, void, (DATA_PROCESSING_PARAM_LIST), (DATA_PROCESSING_CALL_ARGS))
 
@@ -65,3 +76,239 @@ void example_data_processing(DATA_PROCESSING_PARAM_LIST)
 		first_Run = true;
 	}
 }
+
+/**
+ * @brief One tracked channel of `online_stats_data_processing`.
+ */
+typedef struct
+{
+	const char *name; // points into the state's channel_names
+	const double *value;
+	online_stats_t stats;
+} online_stats_channel_t;
+
+/**
+ * @brief Per-run state of `online_stats_data_processing`.
+ */
+typedef struct
+{
+	int *data_processing_status;
+	double *time_sec;
+	double start_time_sec;
+
+	char **channel_names;
+	int n_channel_names;
+	online_stats_channel_t *channels;
+	int n_channels; // channels with initialised statistics
+
+	double quantiles[ONLINE_STATS_MAX_QUANTILES];
+	int n_quantiles;
+	double del_frequency_hz; // equivalent cycles per second of the damage-equivalent load
+} online_stats_data_processing_state_t;
+
+/**
+ * @brief Releases the channel table of an `online_stats_data_processing` run. Safe to call more than once.
+ */
+static void release_online_stats_data_processing_state(void *state_ptr)
+{
+	online_stats_data_processing_state_t *state = state_ptr;
+	for (int c = 0; c < state->n_channels; c++)
+	{
+		free_online_stats(&state->channels[c].stats);
+	}
+	free(state->channels);
+	state->channels = NULL;
+	state->n_channels = 0;
+	free_delimited_list(state->channel_names, state->n_channel_names);
+	state->channel_names = NULL;
+	state->n_channel_names = 0;
+}
+
+/**
+ * @brief Parses `online_stats_quantiles` into the state.
+ *
+ * @return 0 on success, -1 (reported) on a malformed list.
+ */
+static int parse_online_stats_quantiles(online_stats_data_processing_state_t *state, const char *spec)
+{
+	char **items = NULL;
+	const int n_items = parse_delimited_list(spec, &items);
+	if (n_items < 0 || n_items > ONLINE_STATS_MAX_QUANTILES)
+	{
+		ERROR_MESSAGE("online_stats_quantiles '%s' must list at most %d values\n", spec, ONLINE_STATS_MAX_QUANTILES);
+		free_delimited_list(items, n_items);
+		return -1;
+	}
+
+	int status = 0;
+	for (int k = 0; k < n_items; k++)
+	{
+		char *end = NULL;
+		state->quantiles[k] = strtod(items[k], &end);
+		if (end == items[k] || *end != '\0')
+		{
+			ERROR_MESSAGE("online_stats_quantiles entry '%s' is not a number\n", items[k]);
+			status = -1;
+			break;
+		}
+	}
+	state->n_quantiles = status == 0 ? n_items : 0;
+	free_delimited_list(items, n_items);
+	return status;
+}
+
+/**
+ * @brief Binds the channels and sets up one `online_stats_t` per channel.
+ *
+ * @return 0 on success, -1 (reported) on an unknown channel, a bad option or allocation failure.
+ */
+static int init_online_stats_data_processing_state(online_stats_data_processing_state_t *state, const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	get_param(dynamic_data, "data_processing_status", &state->data_processing_status);
+	get_param(dynamic_data, "time_sec", &state->time_sec);
+	state->start_time_sec = *state->time_sec;
+	state->del_frequency_hz = get_param_double_or_default(fixed_data, "online_stats_del_frequency_hz", 1.0);
+
+	if (parse_online_stats_quantiles(state, get_param_string_or_default(fixed_data, "online_stats_quantiles", "0.05;0.5;0.95")) != 0)
+	{
+		return -1;
+	}
+	const double wohler_m = get_param_double_or_default(fixed_data, "online_stats_wohler_exponent", 4.0);
+
+	const int n_names = parse_delimited_list(get_param_string_or_default(fixed_data, "online_stats_channels", ""), &state->channel_names);
+	if (n_names <= 0)
+	{
+		ERROR_MESSAGE("online_stats_channels must name at least one dynamic double parameter\n");
+		return -1;
+	}
+	state->n_channel_names = n_names;
+	state->channels = calloc((size_t)n_names, sizeof(online_stats_channel_t));
+	if (state->channels == NULL)
+	{
+		ERROR_MESSAGE("Failed to allocate %d online stats channels\n", n_names);
+		return -1;
+	}
+
+	for (int c = 0; c < n_names; c++)
+	{
+		online_stats_channel_t *channel = &state->channels[c];
+		channel->name = state->channel_names[c];
+		channel->value = param_double_from_handle(dynamic_data, get_param_handle(dynamic_data, channel->name));
+		if (channel->value == NULL)
+		{
+			ERROR_MESSAGE("online_stats_channels entry '%s' is not a double dynamic parameter\n", channel->name);
+			break;
+		}
+		if (init_online_stats(&channel->stats, state->quantiles, state->n_quantiles, wohler_m) != 0)
+		{
+			break;
+		}
+		state->n_channels++;
+	}
+	return state->n_channels == n_names ? 0 : -1;
+}
+
+/**
+ * @brief Logs the statistics of every channel and writes them to `online_stats_file`.
+ */
+static void save_online_stats(const online_stats_data_processing_state_t *state, const param_array_t *fixed_data)
+{
+	const double n_equivalent = state->del_frequency_hz * (*state->time_sec - state->start_time_sec);
+
+	for (int c = 0; c < state->n_channels; c++)
+	{
+		const online_stats_channel_t *channel = &state->channels[c];
+		log_message("Online stats %s: n %ld, mean %g, std %g, min %g, max %g, DEL %g (%ld cycles)\n", channel->name, channel->stats.count, channel->stats.mean, sqrt(online_stats_variance(&channel->stats)), channel->stats.min, channel->stats.max,
+		            online_stats_damage_equivalent_load(&channel->stats, n_equivalent), channel->stats.rainflow.n_cycles);
+	}
+
+	const char *results_name = get_param_string_or_default(fixed_data, "online_stats_file", "online_stats.csv");
+	if (results_name[0] == '\0' || strcmp(results_name, "none") == 0)
+	{
+		return;
+	}
+#ifndef OUTPUT_LOG_FILE_PATH
+	ERROR_MESSAGE("OUTPUT_LOG_FILE_PATH needs to be defined through cmake to save the online stats\n");
+#else
+	char results_filename[PATH_MAX];
+	create_dynamic_file_path(results_filename, PATH_MAX, "%s/%s", OUTPUT_LOG_FILE_PATH, results_name);
+	FILE *file = xflow_fopen_safe(results_filename, XFLOW_FILE_WRITE_ONLY);
+	if (file == NULL)
+	{
+		ERROR_MESSAGE("Online stats: could not open results file '%s'.\n", results_filename);
+		return;
+	}
+
+	safe_fprintf(file, "channel,count,mean,std,min,max");
+	for (int k = 0; k < state->n_quantiles; k++)
+	{
+		safe_fprintf(file, ",q%g", state->quantiles[k]);
+	}
+	safe_fprintf(file, ",del,rainflow_cycles\n");
+
+	for (int c = 0; c < state->n_channels; c++)
+	{
+		const online_stats_t *stats = &state->channels[c].stats;
+		safe_fprintf(file, "%s,%ld,%.10g,%.10g,%.10g,%.10g", state->channels[c].name, stats->count, stats->mean, sqrt(online_stats_variance(stats)), stats->min, stats->max);
+		for (int k = 0; k < state->n_quantiles; k++)
+		{
+			safe_fprintf(file, ",%.10g", online_stats_quantile(stats, k));
+		}
+		safe_fprintf(file, ",%.10g,%ld\n", online_stats_damage_equivalent_load(stats, n_equivalent), stats->rainflow.n_cycles);
+	}
+
+	fclose(file);
+	log_message("Online stats for %d channels saved to %s\n", state->n_channels, results_filename);
+#endif
+}
+
+/**
+ * @brief Streaming statistics of selected channels in constant memory; no time series is stored.
+ *
+ * Each `LOOPING` call folds the current value of every channel into its statistics in O(1):
+ *   - Welford mean and variance, min and max.
+ *   - P-square estimates of the `online_stats_quantiles` (default `0.05;0.5;0.95`).
+ *   - An incremental four-point rainflow count, summed as damage with S-N slope
+ *     `online_stats_wohler_exponent` (default 4).
+ * At `ENDING` the results are logged and written to `online_stats_file` in `OUTPUT_LOG_FILE_PATH`
+ * (default `online_stats.csv`, `none` to skip), including the damage-equivalent load for
+ * `online_stats_del_frequency_hz` (default 1) equivalent cycles per simulated second.
+ *
+ * `online_stats_channels` lists the dynamic double parameters to track, separated by `;`, `,`
+ * or whitespace. Sampling follows `data_processing_every_n_ticks`.
+ *
+ * @param dynamic_data        Dynamic parameters; the channels are read from here.
+ * @param fixed_data          Fixed parameters with the `online_stats_*` options.
+ * @param dp_program_options  Unused.
+ */
+void online_stats_data_processing(DATA_PROCESSING_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(online_stats_data_processing_state_t, state, release_online_stats_data_processing_state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run && init_online_stats_data_processing_state(state, dynamic_data, fixed_data) != 0)
+	{
+		release_online_stats_data_processing_state(state);
+		shutdownFlag = 1;
+		return;
+	}
+
+	switch (*state->data_processing_status)
+	{
+	case LOOPING:
+		for (int c = 0; c < state->n_channels; c++)
+		{
+			online_stats_update(&state->channels[c].stats, *state->channels[c].value);
+		}
+		break;
+	case ENDING:
+		save_online_stats(state, fixed_data);
+		release_online_stats_data_processing_state(state);
+		break;
+	default:
+		break;
+	}
+}
@@ -28,43 +28,98 @@
 
 #include <stdbool.h> // IWYU pragma: keep
 #include <stddef.h>  // for NULL
+#include <stdint.h>  // for uint64_t
 
 // expand definitions once, using both the decl‐list and the call‐list
+#ifdef XFE_FUSED_DRIVETRAIN
+MAKE_STAGE_DEFINE_BOUND(drivetrain, void, (DRIVETRAIN_PARAM_LIST), (DRIVETRAIN_CALL_ARGS), XFE_FUSED_DRIVETRAIN)
+#else
 MAKE_STAGE_DEFINE(drivetrain, void, (DRIVETRAIN_PARAM_LIST), (DRIVETRAIN_CALL_ARGS))
+#endif
+MAKE_STAGE_DEFINE(drivetrain_batch, void, (DRIVETRAIN_BATCH_PARAM_LIST), (DRIVETRAIN_BATCH_CALL_ARGS))
 
-void example_drivetrain(DRIVETRAIN_PARAM_LIST)
+typedef struct
 {
-	static double *vfd_Torque_Command = NULL;
-	static double *tau_Flow_Extract = NULL;
-	static double *omega = NULL;
-	static double *drivetrain_Drag = NULL;
-	static int *enable_Brake_Signal = NULL;
+	double *vfd_torque_command;
+	double *tau_flow_extract;
+	double *omega;
+	double *drivetrain_drag;
+	int *enable_brake_signal;
+} example_drivetrain_state_t;
 
-	static bool first_Run = false;
-	if (!first_Run)
+void example_drivetrain(DRIVETRAIN_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(example_drivetrain_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
 	{
 		// initialize variables since this is the first time the function is running.
-		get_param(dynamic_data, "vfd_torque_command", &vfd_Torque_Command);
-		get_param(dynamic_data, "tau_flow_extract", &tau_Flow_Extract);
-		get_param(dynamic_data, "omega", &omega);
-		get_param(dynamic_data, "drivetrain_drag", &drivetrain_Drag);
-		get_param(dynamic_data, "enable_brake_signal", &enable_Brake_Signal);
-
-		// log_message("vfd_torque_command before: %f\n", *vfd_Torque_Command);
-		// log_message("tau_Flow_Extract before: %f\n", *tau_Flow_Extract);
+		get_param(dynamic_data, "vfd_torque_command", &state->vfd_torque_command);
+		get_param(dynamic_data, "tau_flow_extract", &state->tau_flow_extract);
+		get_param(dynamic_data, "omega", &state->omega);
+		get_param(dynamic_data, "drivetrain_drag", &state->drivetrain_drag);
+		get_param(dynamic_data, "enable_brake_signal", &state->enable_brake_signal);
 
-		first_Run = true;
+		// log_message("vfd_torque_command before: %f\n", *state->vfd_torque_command);
+		// log_message("tau_Flow_Extract before: %f\n", *state->tau_flow_extract);
 	}
 
-	// log_message("vfd_torque_command before: %f\n", *vfd_Torque_Command);
+	// log_message("vfd_torque_command before: %f\n", *state->vfd_torque_command);
 
-	if (*enable_Brake_Signal != 0)
+	if (*state->enable_brake_signal != 0)
 	{
-		// *drivetrain_Drag = 450;
-		// log_message("BRAKING! %f\n", *drivetrain_Drag);
+		// *state->drivetrain_drag = 450;
+		// log_message("BRAKING! %f\n", *state->drivetrain_drag);
 	}
 	else
 	{
-		*drivetrain_Drag = 0;
+		*state->drivetrain_drag = 0;
+	}
+}
+
+typedef struct
+{
+	uint64_t ensemble_id; // ensemble the channels below were resolved in
+	double *drivetrain_drag;
+	const double *enable_brake_signal;
+} example_drivetrain_batch_state_t;
+
+/**
+ * @brief Batched `example_drivetrain` for the ensemble engine.
+ *
+ * Clears `drivetrain_drag` for every member whose brake is not engaged; braking
+ * members keep their current drag, as in the scalar version.
+ */
+void example_drivetrain_batch(DRIVETRAIN_BATCH_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(example_drivetrain_batch_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (state->ensemble_id != ensemble->id)
+	{
+		state->drivetrain_drag = ensemble_channel(ensemble, "drivetrain_drag");
+		state->enable_brake_signal = ensemble_channel(ensemble, "enable_brake_signal");
+		if (!state->drivetrain_drag || !state->enable_brake_signal)
+		{
+			ERROR_MESSAGE("drivetrain_batch(): drivetrain_drag or enable_brake_signal not found\n");
+			shutdownFlag = 1;
+			return;
+		}
+		state->ensemble_id = ensemble->id;
+	}
+
+	double *restrict drivetrain_drag = state->drivetrain_drag;
+	const double *restrict enable_brake_signal = state->enable_brake_signal;
+	const int n = ensemble->n_members;
+	for (int m = 0; m < n; ++m)
+	{
+		drivetrain_drag[m] = enable_brake_signal[m] != 0.0 ? drivetrain_drag[m] : 0.0;
 	}
 }
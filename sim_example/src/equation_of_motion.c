@@ -20,98 +20,169 @@
  */
 
 #include "xflow_aero_sim.h"
-#include "drivetrains.h"        // for drivetrain
+#include "drivetrains.h"        // for drivetrain, drivetrain_batch
 #include "equation_of_motion.h" // for eom
 #include "flow_sim_model.h"
 #include "logger.h" // for log_message
 #include "make_stage.h"
 #include <stdbool.h> // IWYU pragma: keep
-#include <stddef.h>  // for NULL
+#include <stddef.h>  // for NULL, size_t
+#include <stdint.h>  // for uint64_t
 #include <string.h>  // for strcmp
 
 // expand definitions once, using both the decl‐list and the call‐list
+#ifdef XFE_FUSED_EOM
+MAKE_STAGE_DEFINE_BOUND(eom, void, (EOM_PARAM_LIST), (EOM_CALL_ARGS), XFE_FUSED_EOM) // NOLINT(readability-non-const-parameter)
+#else
 MAKE_STAGE_DEFINE(eom, void, (EOM_PARAM_LIST), (EOM_CALL_ARGS)) // NOLINT(readability-non-const-parameter)
+#endif
+MAKE_STAGE_DEFINE(eom_batch, void, (EOM_BATCH_PARAM_LIST), (EOM_BATCH_CALL_ARGS))
+
+typedef struct
+{
+	double *dt_sec;
+	double *gravity_acc_g;
+	double *time_sec;
+	int idx_theta;
+	int idx_omega;
+} eom_simple_ball_state_t;
 
 void eom_simple_ball_thrown_in_air(EOM_PARAM_LIST)
 {
-	static double *dt_Sec = NULL;
-	static double *gravity_Acc_G = NULL;
-	static double *time_Sec = NULL;
-	static int idx_Theta = -1;
-	static int idx_Omega = -1;
-
-	static bool first_Run = false;
-	if (!first_Run)
+	bool first_run = false;
+	STAGE_STATE(eom_simple_ball_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
 	{
 		// initialize variables since this is the first time the function is running.
-		get_param(fixed_data, "dt_sec", &dt_Sec);
-		get_param(fixed_data, "gravity_acc_g", &gravity_Acc_G);
-		get_param(dynamic_data, "time_sec", &time_Sec);
+		get_param(fixed_data, "dt_sec", &state->dt_sec);
+		get_param(fixed_data, "gravity_acc_g", &state->gravity_acc_g);
+		get_param(dynamic_data, "time_sec", &state->time_sec);
 
+		state->idx_theta = -1;
+		state->idx_omega = -1;
 		for (int i = 0; i < n_state_var; ++i)
 		{
 			if (strcmp(state_names[i], "theta") == 0)
 			{
-				idx_Theta = i;
+				state->idx_theta = i;
 			}
 			else if (strcmp(state_names[i], "omega") == 0)
 			{
-				idx_Omega = i;
+				state->idx_omega = i;
 			}
 		}
 
-		// log_message("*state_vars[idx_Omega]: %f\n", *state_vars[idx_Omega]);
-		// log_message("gravity_acc_g: %f\n", *gravity_Acc_G);
-		// log_message("time_sec: %f\n", *time_Sec);
-
-		first_Run = true;
+		// log_message("*state_vars[idx_Omega]: %f\n", *state_vars[state->idx_omega]);
+		// log_message("gravity_acc_g: %f\n", *state->gravity_acc_g);
+		// log_message("time_sec: %f\n", *state->time_sec);
 	}
 
 	// state_derivative[0] = state[1];
 	// state_derivative[1] = -1.0 * (*gravity_Acc_G);
 	// Directly assign to known indices (no name matching)
-	dx[idx_Theta] = *state_vars[idx_Omega];
-	dx[idx_Omega] = -1.0 * (*gravity_Acc_G);
+	dx[state->idx_theta] = *state_vars[state->idx_omega];
+	dx[state->idx_omega] = -1.0 * (*state->gravity_acc_g);
+}
+
+typedef struct
+{
+	int idx_theta;
+	int idx_omega;
+} eom_simple_ball_jacobian_state_t;
+
+/**
+ * @brief Analytic Jacobian of `eom_simple_ball_thrown_in_air` for the implicit integrators.
+ *
+ * θ' = ω and ω' = −g, so the only non-zero entry is d(θ')/d(ω) = 1.
+ */
+void eom_simple_ball_thrown_in_air_jacobian(EOM_JACOBIAN_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(eom_simple_ball_jacobian_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
+	{
+		state->idx_theta = -1;
+		state->idx_omega = -1;
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			if (strcmp(state_names[i], "theta") == 0)
+			{
+				state->idx_theta = i;
+			}
+			else if (strcmp(state_names[i], "omega") == 0)
+			{
+				state->idx_omega = i;
+			}
+		}
+		if (state->idx_theta < 0 || state->idx_omega < 0)
+		{
+			ERROR_MESSAGE("eom jacobian: required state variables not found\n");
+			shutdownFlag = 1;
+			return;
+		}
+	}
+
+	for (int i = 0; i < n_state_var * n_state_var; ++i)
+	{
+		jac[i] = 0.0;
+	}
+	jac[(state->idx_theta * n_state_var) + state->idx_omega] = 1.0;
 }
 
+typedef struct
+{
+	double *moment_of_inertia;
+	double *drivetrain_drag;
+	double *tau_flow;
+	double *tau_flow_extract;
+	int idx_theta;
+	int idx_omega;
+} example_turbine_eom_state_t;
+
 void example_turbine_eom(EOM_PARAM_LIST)
 {
-	static double *moment_Of_Inertia = NULL;
-	static int idx_Theta = -1;
-	static int idx_Omega = -1;
-	static double *drivetrain_Drag = NULL;
-	static double *tau_Flow = NULL;
-	static double *tau_Flow_Extract = NULL;
-
-	static bool first_Run = false;
-	if (!first_Run)
+	bool first_run = false;
+	STAGE_STATE(example_turbine_eom_state_t, state, first_run);
+	if (!state)
 	{
-		get_param(dynamic_data, "moment_of_inertia", &moment_Of_Inertia);
-		get_param(dynamic_data, "tau_flow", &tau_Flow);
-		get_param(dynamic_data, "tau_flow_extract", &tau_Flow_Extract);
-		get_param(dynamic_data, "drivetrain_drag", &drivetrain_Drag);
+		return;
+	}
+	if (first_run)
+	{
+		get_param(dynamic_data, "moment_of_inertia", &state->moment_of_inertia);
+		get_param(dynamic_data, "tau_flow", &state->tau_flow);
+		get_param(dynamic_data, "tau_flow_extract", &state->tau_flow_extract);
+		get_param(dynamic_data, "drivetrain_drag", &state->drivetrain_drag);
 
 		// Identify indices of state variables
+		state->idx_theta = -1;
+		state->idx_omega = -1;
 		for (int i = 0; i < n_state_var; ++i)
 		{
 			if (strcmp(state_names[i], "theta") == 0)
 			{
-				idx_Theta = i;
+				state->idx_theta = i;
 			}
 			else if (strcmp(state_names[i], "omega") == 0)
 			{
-				idx_Omega = i;
+				state->idx_omega = i;
 			}
 		}
 
-		if (idx_Theta < 0 || idx_Omega < 0)
+		if (state->idx_theta < 0 || state->idx_omega < 0)
 		{
 			ERROR_MESSAGE("eom(): required state variables not found\n");
 			shutdownFlag = 1;
 			return;
 		}
-
-		first_Run = true;
 	}
 
 	flow_sim_model(dynamic_data, fixed_data); // to get the updated tau_flow aero from the last timestep.
@@ -120,6 +191,118 @@ void example_turbine_eom(EOM_PARAM_LIST)
 	drivetrain(dynamic_data, fixed_data); // to get the tau_Flow_Extract from the last timestep.
 
 	// Directly assign to known indices (no name matching)
-	dx[idx_Theta] = *state_vars[idx_Omega];                                                  // θ' = ω
-	dx[idx_Omega] = (*tau_Flow - *tau_Flow_Extract - *drivetrain_Drag) / *moment_Of_Inertia; // ω' = (τ - T)/I
+	dx[state->idx_theta] = *state_vars[state->idx_omega];                                                                // θ' = ω
+	dx[state->idx_omega] = (*state->tau_flow - *state->tau_flow_extract - *state->drivetrain_drag) / *state->moment_of_inertia; // ω' = (τ - T)/I
+}
+
+typedef struct
+{
+	double *gravity_acc_g;
+	uint64_t ensemble_id; // ensemble the indices and channel below were resolved in
+	int idx_theta;
+	int idx_omega;
+	const double *omega;
+} eom_simple_ball_batch_state_t;
+
+/**
+ * @brief Batched `eom_simple_ball_thrown_in_air` for the ensemble engine.
+ *
+ * θ' = ω and ω' = −g for every member, written into the `theta` and `omega` blocks of @p dx.
+ */
+void eom_simple_ball_thrown_in_air_batch(EOM_BATCH_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(eom_simple_ball_batch_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
+	{
+		get_param(fixed_data, "gravity_acc_g", &state->gravity_acc_g);
+	}
+	if (state->ensemble_id != ensemble->id)
+	{
+		ensemble_state(ensemble, "theta", &state->idx_theta);
+		state->omega = ensemble_state(ensemble, "omega", &state->idx_omega);
+		if (state->idx_theta < 0 || state->idx_omega < 0)
+		{
+			ERROR_MESSAGE("eom_batch(): required state variables not found\n");
+			shutdownFlag = 1;
+			return;
+		}
+		state->ensemble_id = ensemble->id;
+	}
+
+	const int n = ensemble->n_members;
+	const double *restrict omega = state->omega;
+	double *restrict d_theta = &dx[(size_t)state->idx_theta * ensemble->stride];
+	double *restrict d_omega = &dx[(size_t)state->idx_omega * ensemble->stride];
+	const double g = *state->gravity_acc_g;
+	for (int m = 0; m < n; ++m)
+	{
+		d_theta[m] = omega[m];
+		d_omega[m] = -g;
+	}
+}
+
+typedef struct
+{
+	uint64_t ensemble_id; // ensemble the indices and channels below were resolved in
+	int idx_theta;
+	int idx_omega;
+	const double *omega;
+	const double *moment_of_inertia;
+	const double *tau_flow;
+	const double *tau_flow_extract;
+	const double *drivetrain_drag;
+} example_turbine_eom_batch_state_t;
+
+/**
+ * @brief Batched `example_turbine_eom` for the ensemble engine.
+ *
+ * Runs `flow_sim_model_batch()` and `drivetrain_batch()` over all members, then evaluates
+ * θ' = ω and ω' = (τ_flow − τ_extract − drag) / I in one flat loop per state variable.
+ */
+void example_turbine_eom_batch(EOM_BATCH_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(example_turbine_eom_batch_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (state->ensemble_id != ensemble->id)
+	{
+		ensemble_state(ensemble, "theta", &state->idx_theta);
+		state->omega = ensemble_state(ensemble, "omega", &state->idx_omega);
+		state->moment_of_inertia = ensemble_channel(ensemble, "moment_of_inertia");
+		state->tau_flow = ensemble_channel(ensemble, "tau_flow");
+		state->tau_flow_extract = ensemble_channel(ensemble, "tau_flow_extract");
+		state->drivetrain_drag = ensemble_channel(ensemble, "drivetrain_drag");
+		if (state->idx_theta < 0 || state->idx_omega < 0 || !state->moment_of_inertia || !state->tau_flow || !state->tau_flow_extract || !state->drivetrain_drag)
+		{
+			ERROR_MESSAGE("eom_batch(): required state variables or parameters not found\n");
+			shutdownFlag = 1;
+			return;
+		}
+		state->ensemble_id = ensemble->id;
+	}
+
+	flow_sim_model_batch(ensemble, fixed_data); // tau_flow for the current stage state
+	drivetrain_batch(ensemble, fixed_data);     // drivetrain_drag for the current stage state
+
+	const int n = ensemble->n_members;
+	const double *restrict omega = state->omega;
+	const double *restrict moment_of_inertia = state->moment_of_inertia;
+	const double *restrict tau_flow = state->tau_flow;
+	const double *restrict tau_flow_extract = state->tau_flow_extract;
+	const double *restrict drivetrain_drag = state->drivetrain_drag;
+	double *restrict d_theta = &dx[(size_t)state->idx_theta * ensemble->stride];
+	double *restrict d_omega = &dx[(size_t)state->idx_omega * ensemble->stride];
+	for (int m = 0; m < n; ++m)
+	{
+		d_theta[m] = omega[m];                                                                     // θ' = ω
+		d_omega[m] = (tau_flow[m] - tau_flow_extract[m] - drivetrain_drag[m]) / moment_of_inertia[m]; // ω' = (τ - T)/I
+	}
 }
@@ -22,12 +22,21 @@
 #include "flow_sim_model.h" // for flow_sim_model
 #include "logger.h"         // IWYU pragma: keep
 #include "make_stage.h"
-#include <math.h>    // for pow, fabs
+#include <math.h>    // for pow, fabs, fmax, fmin
 #include <stdbool.h> // IWYU pragma: keep
 #include <stddef.h>  // for NULL
+#include <stdint.h>  // for uint64_t
+#include <stdio.h>   // for snprintf
+#include <stdlib.h>  // for malloc, free
+#include <string.h>  // for strcmp, strrchr
 
 // expand definitions once, using both the decl‐list and the call‐list
+#ifdef XFE_FUSED_FLOW_SIM_MODEL
+MAKE_STAGE_DEFINE_BOUND(flow_sim_model, void, (FLOW_SIM_MODEL_PARAM_LIST), (FLOW_SIM_MODEL_CALL_ARGS), XFE_FUSED_FLOW_SIM_MODEL)
+#else
 MAKE_STAGE_DEFINE(flow_sim_model, void, (FLOW_SIM_MODEL_PARAM_LIST), (FLOW_SIM_MODEL_CALL_ARGS))
+#endif
+MAKE_STAGE_DEFINE(flow_sim_model_batch, void, (FLOW_SIM_MODEL_BATCH_PARAM_LIST), (FLOW_SIM_MODEL_BATCH_CALL_ARGS))
 
 // Structure to hold turbine data
 typedef struct
@@ -71,44 +80,535 @@ static double tau_flow_calc(double omega, double u, const turbine_data_t *turb_d
 	return cq * 0.5 * turb_dat->rho * pow(u, 2) * turb_dat->area * turb_dat->radius;
 }
 
-void example_flow_sim_model(FLOW_SIM_MODEL_PARAM_LIST)
+typedef struct
 {
-	static double *omega = NULL;
-	static double *flow_Speed = NULL;
-	static double *tau_Flow = NULL;
-
-	static double *radius = NULL;
-	static double *area = NULL;
-	static double *slow_Cq = NULL;
-	static double *rho = NULL;
+	double *omega;
+	double *flow_speed;
+	double *tau_flow;
+	turbine_data_t turb_dat;
+} example_flow_sim_model_state_t;
 
-	static turbine_data_t turb_Dat;
-
-	static bool first_Run = false;
-	if (!first_Run)
+void example_flow_sim_model(FLOW_SIM_MODEL_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(example_flow_sim_model_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
 	{
+		double *radius = NULL;
+		double *area = NULL;
+		double *slow_cq = NULL;
+		double *rho = NULL;
+
 		// initialize variables since this is the first time the function is running.
-		get_param(dynamic_data, "omega", &omega);
-		get_param(dynamic_data, "flow_speed", &flow_Speed);
-		get_param(dynamic_data, "tau_flow", &tau_Flow);
+		get_param(dynamic_data, "omega", &state->omega);
+		get_param(dynamic_data, "flow_speed", &state->flow_speed);
+		get_param(dynamic_data, "tau_flow", &state->tau_flow);
 
 		get_param(fixed_data, "R", &radius);
 		get_param(fixed_data, "A", &area);
-		get_param(fixed_data, "slowCQ", &slow_Cq);
+		get_param(fixed_data, "slowCQ", &slow_cq);
 		get_param(fixed_data, "rho", &rho);
 
-		// Set global turbine data (turb_Dat)
-		turb_Dat.radius = *radius;
-		turb_Dat.area = *area;
-		turb_Dat.slow_cq = *slow_Cq;
-		turb_Dat.rho = *rho;
-
-		first_Run = true;
+		// Snapshot the turbine data for this run
+		state->turb_dat.radius = *radius;
+		state->turb_dat.area = *area;
+		state->turb_dat.slow_cq = *slow_cq;
+		state->turb_dat.rho = *rho;
 	}
 
 	// Get aerodynamic torque
-	*tau_Flow = tau_flow_calc(*omega, *flow_Speed, &turb_Dat);
+	*state->tau_flow = tau_flow_calc(*state->omega, *state->flow_speed, &state->turb_dat);
 
 	// Log results
-	// log_message("Calculated aerodynamic torque  omega: %f, u: %f, tau_flow: %f\n", *omega, *flow_Speed, *tau_Flow);
+	// log_message("Calculated aerodynamic torque  omega: %f, u: %f, tau_flow: %f\n", *state->omega, *state->flow_speed, *state->tau_flow);
+}
+
+typedef struct
+{
+	uint64_t ensemble_id; // ensemble the channels below were resolved in
+	const double *omega;
+	const double *flow_speed;
+	double *tau_flow;
+	turbine_data_t turb_dat;
+} example_flow_sim_model_batch_state_t;
+
+/**
+ * @brief Batched `example_flow_sim_model` for the ensemble engine.
+ *
+ * Same torque model as `tau_flow_calc()`, written as one branch-free loop over all members
+ * so the compiler can vectorise it: the u <= 0, ω <= 0 and |cq| < slowCQ cases become selects.
+ */
+void example_flow_sim_model_batch(FLOW_SIM_MODEL_BATCH_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(example_flow_sim_model_batch_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
+	{
+		double *radius = NULL;
+		double *area = NULL;
+		double *slow_cq = NULL;
+		double *rho = NULL;
+		get_param(fixed_data, "R", &radius);
+		get_param(fixed_data, "A", &area);
+		get_param(fixed_data, "slowCQ", &slow_cq);
+		get_param(fixed_data, "rho", &rho);
+
+		// Snapshot the turbine data for this run
+		state->turb_dat.radius = *radius;
+		state->turb_dat.area = *area;
+		state->turb_dat.slow_cq = *slow_cq;
+		state->turb_dat.rho = *rho;
+	}
+	if (state->ensemble_id != ensemble->id)
+	{
+		state->omega = ensemble_channel(ensemble, "omega");
+		state->flow_speed = ensemble_channel(ensemble, "flow_speed");
+		state->tau_flow = ensemble_channel(ensemble, "tau_flow");
+		if (!state->omega || !state->flow_speed || !state->tau_flow)
+		{
+			ERROR_MESSAGE("flow_sim_model_batch(): omega, flow_speed or tau_flow not found\n");
+			shutdownFlag = 1;
+			return;
+		}
+		state->ensemble_id = ensemble->id;
+	}
+
+	const double *restrict omega = state->omega;
+	const double *restrict flow_speed = state->flow_speed;
+	double *restrict tau_flow = state->tau_flow;
+	const int n = ensemble->n_members;
+	const double r = state->turb_dat.radius;
+	const double slow_cq = state->turb_dat.slow_cq;
+	const double torque_scale = 0.5 * state->turb_dat.rho * state->turb_dat.area * r;
+	for (int m = 0; m < n; ++m)
+	{
+		const double u = flow_speed[m];
+		const double u_safe = u > 0.0 ? u : 1.0;
+		const double tsr = fmax(omega[m] * r / u_safe, 0.0);                  // Tip speed ratio
+		const double cp = (-0.1 * (tsr - 3) * (tsr - 3)) + 0.5;               // oversimplified cp equation
+		const double cq_raw = tsr > 0.0 ? cp / tsr : slow_cq;                 // Torque coefficient
+		const double cq = (omega[m] <= 0.0 || fabs(cq_raw) < slow_cq) ? slow_cq : cq_raw; // Low speed/no speed correction
+		tau_flow[m] = u > 0.0 ? cq * torque_scale * u * u : 0.0;
+	}
+}
+
+#define AERO_TABLE_DEFAULT_GRID_POINTS 256
+#define AERO_TABLE_DEFAULT_PITCH_GRID_POINTS 32
+#define AERO_TABLE_MAX_GRID_POINTS 65536
+#define AERO_TABLE_PATH_MAX 4096
+
+// Cq resampled onto a uniform (pitch, TSR) grid
+typedef struct
+{
+	double *cq;        // n_pitch rows of n_tsr values, row-major by pitch
+	int n_tsr;         // >= 2
+	int n_pitch;       // >= 2, a table without pitch holds its row twice
+	double tsr0;       // TSR of column 0
+	double inv_dtsr;   // 1 / TSR step
+	double pitch0;     // pitch of row 0
+	double inv_dpitch; // 1 / pitch step, 0 for a table without pitch
+	double slow_cq;    // cq for a stopped or backwards rotor, as in tau_flow_calc()
+} aero_table_t;
+
+// One run of rows with the same pitch, TSR ascending
+typedef struct
+{
+	double pitch;
+	int first;
+	int count;
+} aero_table_block_t;
+
+/**
+ * @brief Linear interpolation of a raw block at `tsr`, clamped to the block's end points.
+ */
+static double aero_table_block_sample(double **rows, int tsr_col, const aero_table_block_t *block, double tsr)
+{
+	const int first = block->first;
+	const int last = block->first + block->count - 1;
+	if (tsr <= rows[first][tsr_col])
+	{
+		return rows[first][tsr_col + 1];
+	}
+	if (tsr >= rows[last][tsr_col])
+	{
+		return rows[last][tsr_col + 1];
+	}
+	int i = first;
+	while (rows[i + 1][tsr_col] < tsr)
+	{
+		i++;
+	}
+	const double frac = (tsr - rows[i][tsr_col]) / (rows[i + 1][tsr_col] - rows[i][tsr_col]);
+	return rows[i][tsr_col + 1] + (frac * (rows[i + 1][tsr_col + 1] - rows[i][tsr_col + 1]));
+}
+
+/**
+ * @brief Cq at (`tsr`, `pitch`) by bilinear interpolation on the uniform grid.
+ *
+ * Both indices come from a clamp and a truncation, so the lookup is O(1) with no data-dependent branches.
+ * Points outside the table take the nearest edge value.
+ */
+static double aero_table_cq(const aero_table_t *table, double tsr, double pitch)
+{
+	const double x = fmin(fmax((tsr - table->tsr0) * table->inv_dtsr, 0.0), table->n_tsr - 1.0);
+	const int i = (int)fmin(x, table->n_tsr - 2.0);
+	const double fx = x - i;
+	const double y = fmin(fmax((pitch - table->pitch0) * table->inv_dpitch, 0.0), table->n_pitch - 1.0);
+	const int j = (int)fmin(y, table->n_pitch - 2.0);
+	const double fy = y - j;
+
+	const double *row0 = table->cq + ((size_t)j * table->n_tsr) + i;
+	const double *row1 = row0 + table->n_tsr;
+	const double c0 = row0[0] + (fx * (row0[1] - row0[0]));
+	const double c1 = row1[0] + (fx * (row1[1] - row1[0]));
+	return c0 + (fy * (c1 - c0));
+}
+
+/**
+ * @brief Loads the file named by `aero_table_file` and resamples it into `table`.
+ *
+ * The CSV has no header. Without pitch (`aero_table_pitch_param` = none) each row is `tsr,coefficient`;
+ * with pitch each row is `pitch,tsr,coefficient`, grouped by ascending pitch and ascending TSR within a
+ * pitch. `aero_table_coefficient` says whether the last column is `cp` or `cq`. Cp is converted to
+ * Cq = Cp / TSR, and the `slowCQ` low-speed correction of `tau_flow_calc()` is applied to the grid, so
+ * none of it costs anything per call. `slowCQ` is also kept in `table->slow_cq` for ω <= 0. A relative path is taken from the directory of the system config.
+ *
+ * @param fixed_data  Fixed parameters.
+ * @param table       Receives the grid; release `table->cq` with free().
+ * @param pitch_param Receives the dynamic parameter that holds the pitch, NULL for a table without pitch.
+ * @return 0 on success, -1 on failure (an error has been reported).
+ */
+static int load_aero_table(const param_array_t *fixed_data, aero_table_t *table, const char **pitch_param)
+{
+	const char *file = get_param_string_or_default(fixed_data, "aero_table_file", "");
+	const char *coefficient = get_param_string_or_default(fixed_data, "aero_table_coefficient", "cp");
+	const char *pitch_name = get_param_string_or_default(fixed_data, "aero_table_pitch_param", "none");
+	const int n_tsr = get_param_int_or_default(fixed_data, "aero_table_grid_points", AERO_TABLE_DEFAULT_GRID_POINTS);
+	const bool has_pitch = strcmp(pitch_name, "none") != 0 && pitch_name[0] != '\0';
+	const int n_pitch_grid = has_pitch ? get_param_int_or_default(fixed_data, "aero_table_pitch_grid_points", AERO_TABLE_DEFAULT_PITCH_GRID_POINTS) : 2;
+	const bool is_cp = strcmp(coefficient, "cp") == 0;
+
+	if (file[0] == '\0')
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): aero_table_file is not set\n");
+		return -1;
+	}
+	if (!is_cp && strcmp(coefficient, "cq") != 0)
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): aero_table_coefficient must be cp or cq, got '%s'\n", coefficient);
+		return -1;
+	}
+	if (n_tsr < 2 || n_tsr > AERO_TABLE_MAX_GRID_POINTS || n_pitch_grid < 2 || n_pitch_grid > AERO_TABLE_MAX_GRID_POINTS)
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): grid points must be between 2 and %d\n", AERO_TABLE_MAX_GRID_POINTS);
+		return -1;
+	}
+
+	double *slow_cq = NULL;
+	get_param(fixed_data, "slowCQ", &slow_cq);
+	if (!slow_cq)
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): slowCQ not found\n");
+		return -1;
+	}
+	table->slow_cq = *slow_cq;
+
+	char path[AERO_TABLE_PATH_MAX];
+	snprintf(path, sizeof(path), "%s", file);
+#ifdef SYSTEM_CONFIG_FULL_PATH
+	const char *config_dir_end = strrchr(SYSTEM_CONFIG_FULL_PATH, '/');
+	if (file[0] != '/' && config_dir_end)
+	{
+		snprintf(path, sizeof(path), "%.*s/%s", (int)(config_dir_end - SYSTEM_CONFIG_FULL_PATH), SYSTEM_CONFIG_FULL_PATH, file);
+	}
+#endif
+
+	const int n_cols = has_pitch ? 3 : 2;
+	const int tsr_col = has_pitch ? 1 : 0;
+	int num_rows = 0;
+	double **rows = (double **)read_csv_generic(path, &num_rows, n_cols, DATA_TYPE_DOUBLE);
+	if (!rows || num_rows < 2)
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): could not read at least two rows of %d columns from '%s'\n", n_cols, path);
+		if (rows)
+		{
+			for (int r = 0; r < num_rows; r++)
+			{
+				free(rows[r]);
+			}
+			free((void *)rows);
+		}
+		return -1;
+	}
+
+	int status = -1;
+	aero_table_block_t *blocks = (aero_table_block_t *)malloc(num_rows * sizeof(aero_table_block_t));
+	table->cq = (double *)malloc((size_t)n_pitch_grid * n_tsr * sizeof(double));
+	if (!blocks || !table->cq)
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): could not allocate the table for '%s'\n", path);
+		goto cleanup;
+	}
+
+	// Split into runs of one pitch, each with strictly ascending TSR
+	int n_blocks = 0;
+	double tsr_min = rows[0][tsr_col];
+	double tsr_max = rows[0][tsr_col];
+	for (int r = 0; r < num_rows; r++)
+	{
+		const double pitch = has_pitch ? rows[r][0] : 0.0;
+		if (n_blocks == 0 || pitch != blocks[n_blocks - 1].pitch)
+		{
+			if (n_blocks > 0 && (pitch < blocks[n_blocks - 1].pitch || blocks[n_blocks - 1].count < 2))
+			{
+				ERROR_MESSAGE("table_flow_sim_model(): '%s' row %d: pitch must ascend with at least two TSR rows per pitch\n", path, r + 1);
+				goto cleanup;
+			}
+			blocks[n_blocks].pitch = pitch;
+			blocks[n_blocks].first = r;
+			blocks[n_blocks].count = 0;
+			n_blocks++;
+		}
+		else if (rows[r][tsr_col] <= rows[r - 1][tsr_col])
+		{
+			ERROR_MESSAGE("table_flow_sim_model(): '%s' row %d: TSR must be strictly ascending\n", path, r + 1);
+			goto cleanup;
+		}
+		blocks[n_blocks - 1].count++;
+		tsr_min = fmin(tsr_min, rows[r][tsr_col]);
+		tsr_max = fmax(tsr_max, rows[r][tsr_col]);
+	}
+	if (blocks[n_blocks - 1].count < 2)
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): '%s': every pitch needs at least two TSR rows\n", path);
+		goto cleanup;
+	}
+
+	const double dtsr = (tsr_max - tsr_min) / (n_tsr - 1);
+	const double pitch_min = blocks[0].pitch;
+	const double pitch_max = blocks[n_blocks - 1].pitch;
+	const double dpitch = n_blocks > 1 ? (pitch_max - pitch_min) / (n_pitch_grid - 1) : 0.0;
+
+	int b = 0;
+	for (int j = 0; j < n_pitch_grid; j++)
+	{
+		const double pitch = pitch_min + (j * dpitch);
+		while (b + 2 < n_blocks && blocks[b + 1].pitch <= pitch)
+		{
+			b++;
+		}
+		const aero_table_block_t *lo = &blocks[b];
+		const aero_table_block_t *hi = &blocks[n_blocks > 1 ? b + 1 : b];
+		const double fy = hi->pitch > lo->pitch ? fmin(fmax((pitch - lo->pitch) / (hi->pitch - lo->pitch), 0.0), 1.0) : 0.0;
+		for (int i = 0; i < n_tsr; i++)
+		{
+			const double tsr = tsr_min + (i * dtsr);
+			const double c_lo = aero_table_block_sample(rows, tsr_col, lo, tsr);
+			const double c_hi = aero_table_block_sample(rows, tsr_col, hi, tsr);
+			const double c = c_lo + (fy * (c_hi - c_lo));
+			double cq = is_cp ? (tsr > 0.0 ? c / tsr : *slow_cq) : c;
+			if (fabs(cq) < *slow_cq)
+			{
+				cq = *slow_cq; // low speed/no speed correction, as in tau_flow_calc()
+			}
+			table->cq[((size_t)j * n_tsr) + i] = cq;
+		}
+	}
+
+	table->n_tsr = n_tsr;
+	table->n_pitch = n_pitch_grid;
+	table->tsr0 = tsr_min;
+	table->inv_dtsr = dtsr > 0.0 ? 1.0 / dtsr : 0.0;
+	table->pitch0 = pitch_min;
+	table->inv_dpitch = dpitch > 0.0 ? 1.0 / dpitch : 0.0;
+	*pitch_param = has_pitch ? pitch_name : NULL;
+	status = 0;
+
+cleanup:
+	if (status != 0)
+	{
+		free(table->cq);
+		table->cq = NULL;
+	}
+	free(blocks);
+	for (int r = 0; r < num_rows; r++)
+	{
+		free(rows[r]);
+	}
+	free((void *)rows);
+	return status;
+}
+
+typedef struct
+{
+	double *omega;
+	double *flow_speed;
+	double *tau_flow;
+	const double *pitch; // NULL for a table without pitch
+	double radius;
+	double torque_scale; // 0.5 * rho * A * R
+	aero_table_t table;
+} table_flow_sim_model_state_t;
+
+static void release_table_flow_sim_model_state(void *state)
+{
+	table_flow_sim_model_state_t *s = (table_flow_sim_model_state_t *)state;
+	free(s->table.cq);
+	s->table.cq = NULL;
+}
+
+/**
+ * @brief Binds R, A and rho and loads the Cq grid shared by the scalar and batched table models.
+ */
+static int init_table_flow_sim_model_state(const param_array_t *fixed_data, table_flow_sim_model_state_t *state, const char **pitch_param)
+{
+	double *radius = NULL;
+	double *area = NULL;
+	double *rho = NULL;
+	get_param(fixed_data, "R", &radius);
+	get_param(fixed_data, "A", &area);
+	get_param(fixed_data, "rho", &rho);
+	if (!radius || !area || !rho)
+	{
+		ERROR_MESSAGE("table_flow_sim_model(): R, A or rho not found\n");
+		return -1;
+	}
+	state->radius = *radius;
+	state->torque_scale = 0.5 * (*rho) * (*area) * (*radius);
+	return load_aero_table(fixed_data, &state->table, pitch_param);
+}
+
+/**
+ * @brief Aero torque from a measured Cp or Cq curve instead of the analytic one of `tau_flow_calc()`.
+ *
+ * The table is loaded once per run and resampled onto a uniform grid (see `load_aero_table()`), so each
+ * call inside the integrator is a TSR, a clamped grid lookup and a multiply. A stopped or backwards
+ * rotor (ω <= 0) uses `slowCQ` like `tau_flow_calc()` instead of the table at TSR 0. When
+ * `aero_table_pitch_param` names a dynamic parameter, the table is two-dimensional and that parameter
+ * selects the pitch.
+ */
+void table_flow_sim_model(FLOW_SIM_MODEL_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(table_flow_sim_model_state_t, state, release_table_flow_sim_model_state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
+	{
+		get_param(dynamic_data, "omega", &state->omega);
+		get_param(dynamic_data, "flow_speed", &state->flow_speed);
+		get_param(dynamic_data, "tau_flow", &state->tau_flow);
+
+		const char *pitch_param = NULL;
+		if (init_table_flow_sim_model_state(fixed_data, state, &pitch_param) != 0)
+		{
+			shutdownFlag = 1;
+			return;
+		}
+		if (pitch_param)
+		{
+			double *pitch = NULL;
+			get_param(dynamic_data, pitch_param, &pitch);
+			if (!pitch)
+			{
+				ERROR_MESSAGE("table_flow_sim_model(): pitch parameter '%s' not found\n", pitch_param);
+				shutdownFlag = 1;
+				return;
+			}
+			state->pitch = pitch;
+		}
+	}
+	if (!state->table.cq)
+	{
+		return;
+	}
+
+	const double u = *state->flow_speed;
+	const double u_safe = u > 0.0 ? u : 1.0;
+	const double tsr = fmax(*state->omega * state->radius / u_safe, 0.0);
+	const double cq = *state->omega <= 0.0 ? state->table.slow_cq : aero_table_cq(&state->table, tsr, state->pitch ? *state->pitch : 0.0);
+	*state->tau_flow = u > 0.0 ? cq * state->torque_scale * u * u : 0.0;
+}
+
+typedef struct
+{
+	table_flow_sim_model_state_t model; // omega, flow_speed, tau_flow and pitch unused, read from the ensemble
+	const char *pitch_param;
+	uint64_t ensemble_id; // ensemble the channels below were resolved in
+	const double *omega;
+	const double *flow_speed;
+	double *tau_flow;
+	const double *pitch; // NULL without aero_table_pitch_param
+} table_flow_sim_model_batch_state_t;
+
+static void release_table_flow_sim_model_batch_state(void *state)
+{
+	release_table_flow_sim_model_state(&((table_flow_sim_model_batch_state_t *)state)->model);
+}
+
+/**
+ * @brief Batched `table_flow_sim_model` for the ensemble engine.
+ *
+ * One loop over all members with the same grid lookup and ω <= 0 select as the scalar form; the pitch, if any, is the
+ * ensemble channel of `aero_table_pitch_param`, so members may pitch independently.
+ */
+void table_flow_sim_model_batch(FLOW_SIM_MODEL_BATCH_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(table_flow_sim_model_batch_state_t, state, release_table_flow_sim_model_batch_state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run && init_table_flow_sim_model_state(fixed_data, &state->model, &state->pitch_param) != 0)
+	{
+		shutdownFlag = 1;
+		return;
+	}
+	if (!state->model.table.cq)
+	{
+		return;
+	}
+
+	if (state->ensemble_id != ensemble->id)
+	{
+		state->omega = ensemble_channel(ensemble, "omega");
+		state->flow_speed = ensemble_channel(ensemble, "flow_speed");
+		state->tau_flow = ensemble_channel(ensemble, "tau_flow");
+		state->pitch = state->pitch_param ? ensemble_channel(ensemble, state->pitch_param) : NULL;
+		if (!state->omega || !state->flow_speed || !state->tau_flow || (state->pitch_param && !state->pitch))
+		{
+			ERROR_MESSAGE("flow_sim_model_batch(): omega, flow_speed, tau_flow or the pitch channel not found\n");
+			shutdownFlag = 1;
+			return;
+		}
+		state->ensemble_id = ensemble->id;
+	}
+
+	const double *restrict omega = state->omega;
+	const double *restrict flow_speed = state->flow_speed;
+	double *restrict tau_flow = state->tau_flow;
+	const double *restrict pitch = state->pitch;
+	const aero_table_t *table = &state->model.table;
+	const int n = ensemble->n_members;
+	const double r = state->model.radius;
+	const double torque_scale = state->model.torque_scale;
+	for (int m = 0; m < n; ++m)
+	{
+		const double u = flow_speed[m];
+		const double u_safe = u > 0.0 ? u : 1.0;
+		const double tsr = fmax(omega[m] * r / u_safe, 0.0);
+		const double cq = omega[m] <= 0.0 ? table->slow_cq : aero_table_cq(table, tsr, pitch ? pitch[m] : 0.0);
+		tau_flow[m] = u > 0.0 ? cq * torque_scale * u * u : 0.0;
+	}
 }
@@ -18,19 +18,57 @@
  * with this software. If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
  */
 
+#include "config_snapshot.h" // for load_config, unpublish_config_snapshot
 #include "control_switch.h"
 #include "discon.h" // for turbine_control
 #include "logger.h" // for log_message, ERROR_MESSAGE
 #include "maybe_unused.h"
+#include "param_index.h"            // for build_param_index, invalidate_param_index
 #include "qblade_interface.h"       // for turbine_control
+#include "stage_context.h"          // for create_stage_context, set_current_stage_context
+#include "stage_timing.h"           // for log_stage_timing_table
 #include "xfe_control_sim_common.h" // for param_array_t, (anonymous struct)
 #include "xflow_aero_sim.h"
 #include "xflow_core.h"
+#include <pthread.h> // for pthread_mutex_lock, pthread_mutex_unlock, PTHREAD_MUTEX_INITIALIZER
+#include <stdbool.h> // IWYU pragma: keep
+#include <stddef.h>  // for size_t, NULL
 #include <stdio.h>
+#include <stdlib.h> // for calloc, malloc, free
+#include <string.h> // for memcmp, memcpy, strnlen
 
 #define NINT(a) ((a) >= 0.0 ? (int)((a) + 0.5) : (int)((a) - 0.5))
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 
+#define DISCON_INSTANCE_NAME_MAX 1024 // bytes of acc_in_file / avc_outname used to tell turbines apart
+
+/**
+ * @brief Controller context of one turbine served by this library.
+ *
+ * QBlade loads the controller library once per process and calls `DISCON` for every turbine
+ * with that turbine's own `acc_in_file` / `avc_outname`, so the pair identifies the caller.
+ * Each turbine gets its own dynamic parameters, history tasks and stage context, the fixed
+ * parameters are read once and shared by all of them.
+ */
+typedef struct discon_instance
+{
+	char *key; // acc_in_file, '\0', avc_outname, '\0'
+	size_t key_len; // without the final terminator
+	param_array_t *dynamic_data;
+	history_task_list_t *history_tasks;
+	stage_context_t *context; // STAGE_STATE objects and history rings of this turbine
+	bool primary;             // first turbine: owns the log file and the dynamic data CSV
+	bool running;             // between its first call and its shutdown call (avr_swap[0] == -1)
+	bool failed;              // set by discon_instance_fail(), reported through this turbine's avi_fail only
+	struct discon_instance *next;
+} discon_instance_t;
+
+static discon_instance_t *disconInstances = NULL;
+static param_array_t *disconFixedData = NULL; // loaded by the first turbine, read-only afterwards
+static int nRunningDisconInstances = 0;
+static pthread_mutex_t disconInstancesMutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local discon_instance_t *currentDisconInstance = NULL;
+
 MAKE_STAGE_DEFINE(DISCON, void, (DISCON_PARAM_LIST), (DISCON_DISPATCH_ARGS)) // NOLINT(readability-non-const-parameter)
 
 // needs to be here for initialization.
@@ -39,6 +77,202 @@ __attribute__((constructor)) static void init_discon_hook(void)
 	register_DISCON(example_discon);
 }
 
+/**
+ * @brief Length of a DISCON string argument, bounded by its character count record when the caller set one.
+ */
+static size_t discon_string_length(const char *text, const float char_count)
+{
+	if (!text)
+	{
+		return 0;
+	}
+	size_t limit = DISCON_INSTANCE_NAME_MAX;
+	if (char_count > 0.0F && (size_t)char_count < limit)
+	{
+		limit = (size_t)char_count;
+	}
+	return strnlen(text, limit);
+}
+
+/**
+ * @brief Frees a turbine context that never made it into `disconInstances`.
+ *
+ * The history task list has no destructor and is left behind, as in a single-turbine run.
+ */
+static void free_discon_instance(discon_instance_t *instance)
+{
+	if (!instance)
+	{
+		return;
+	}
+	if (instance->dynamic_data)
+	{
+		invalidate_param_index(instance->dynamic_data);
+		free_input_data(instance->dynamic_data);
+	}
+	free_stage_context(instance->context);
+	free(instance->key);
+	free(instance);
+}
+
+/**
+ * @brief Reads the dynamic parameters of an additional turbine and builds its history tasks.
+ *
+ * The configuration (the snapshot the first turbine published, or the file) also yields a
+ * copy of the fixed parameters, which is dropped in favour of the shared `disconFixedData`.
+ *
+ * @return 0 on success, -1 otherwise; a configuration error also sets `shutdownFlag`, as it does for every turbine.
+ */
+static int load_discon_instance_data(discon_instance_t *instance)
+{
+	param_array_t *scratch_fixed_data = create_input_data(1);
+	instance->dynamic_data = create_input_data(1);
+	if (!scratch_fixed_data || !instance->dynamic_data)
+	{
+		ERROR_MESSAGE("Failed to allocate parameter arrays for DISCON instance\n");
+		if (scratch_fixed_data)
+		{
+			free_input_data(scratch_fixed_data);
+		}
+		return -1;
+	}
+	set_int_param(instance->dynamic_data, 0, "initialize", 1);
+	set_int_param(scratch_fixed_data, 0, "initialize", 1);
+	load_config(SYSTEM_CONFIG_FULL_PATH, instance->dynamic_data, scratch_fixed_data); // copies the first turbine's snapshot
+	invalidate_param_index(scratch_fixed_data);
+	free_input_data(scratch_fixed_data);
+	build_param_index(instance->dynamic_data);
+
+	instance->history_tasks = create_history_update_list(instance->dynamic_data, disconFixedData);
+	return shutdownFlag ? -1 : 0;
+}
+
+/**
+ * @brief Returns the context of the turbine calling with `acc_in_file` / `avc_outname`, creating it on its first call.
+ *
+ * The first turbine initialises the control system as a single-turbine run would (configuration,
+ * log file, stage dispatch). The lookup is a linear scan, a farm has tens of turbines at most.
+ *
+ * A turbine whose parameters cannot be loaded is not kept, its next call tries again; when
+ * that turbine was the first one, the shared fixed parameters are dropped with it.
+ *
+ * @return The turbine's context, or NULL when it could not be created.
+ */
+static discon_instance_t *acquire_discon_instance(const float *avr_swap, const char *acc_in_file, const char *avc_outname)
+{
+	const size_t in_file_len = discon_string_length(acc_in_file, avr_swap[REC_INFILE_CHAR_COUNT]);
+	const size_t out_name_len = discon_string_length(avc_outname, avr_swap[REC_OUTNAME_CHAR_COUNT]);
+	const size_t key_len = in_file_len + 1 + out_name_len;
+
+	pthread_mutex_lock(&disconInstancesMutex);
+	discon_instance_t *instance = disconInstances;
+	while (instance && (instance->key_len != key_len || (in_file_len > 0 && memcmp(instance->key, acc_in_file, in_file_len) != 0) ||
+	                    (out_name_len > 0 && memcmp(instance->key + in_file_len + 1, avc_outname, out_name_len) != 0)))
+	{
+		instance = instance->next;
+	}
+
+	if (!instance)
+	{
+		instance = calloc(1, sizeof(discon_instance_t));
+		char *key = malloc(key_len + 1);
+		stage_context_t *context = create_stage_context();
+		if (!instance || !key || !context)
+		{
+			ERROR_MESSAGE("Failed to allocate DISCON instance\n");
+			free(instance);
+			free(key);
+			free_stage_context(context);
+			pthread_mutex_unlock(&disconInstancesMutex);
+			return NULL;
+		}
+		if (in_file_len > 0)
+		{
+			memcpy(key, acc_in_file, in_file_len);
+		}
+		key[in_file_len] = '\0';
+		if (out_name_len > 0)
+		{
+			memcpy(key + in_file_len + 1, avc_outname, out_name_len);
+		}
+		key[key_len] = '\0';
+		instance->key = key;
+		instance->key_len = key_len;
+		instance->context = context;
+
+		int load_status = 0;
+		if (!disconFixedData)
+		{
+			initialize_control_system(&instance->dynamic_data, &disconFixedData, &instance->history_tasks, 1);
+			if (!shutdownFlag)
+			{
+				control_switch(instance->dynamic_data, disconFixedData);
+			}
+			load_status = shutdownFlag ? -1 : 0;
+			if (load_status != 0 && disconFixedData)
+			{
+				// the next turbine to call starts the control system over
+				invalidate_param_index(disconFixedData);
+				free_input_data(disconFixedData);
+				disconFixedData = NULL;
+			}
+			else if (get_param_int_or_default(disconFixedData, "discon_deferred_logging", 1) > 0)
+			{
+				// CSV rows are formatted on a background thread instead of inside the host's time step
+				defer_dynamic_data_logging(instance->dynamic_data, disconFixedData);
+			}
+			instance->primary = true;
+		}
+		else
+		{
+			load_status = load_discon_instance_data(instance);
+		}
+		if (load_status != 0)
+		{
+			ERROR_MESSAGE("Failed to load DISCON instance '%s'\n", instance->key);
+			free_discon_instance(instance);
+			pthread_mutex_unlock(&disconInstancesMutex);
+			return NULL;
+		}
+		instance->next = disconInstances;
+		disconInstances = instance;
+		log_message("discon init complete for '%s' / '%s'!\n", instance->key, instance->key + in_file_len + 1);
+	}
+
+	if (!instance->running)
+	{
+		instance->running = true;
+		nRunningDisconInstances++;
+	}
+	pthread_mutex_unlock(&disconInstancesMutex);
+	return instance;
+}
+
+/**
+ * @brief Ends a turbine's run after its shutdown call; the last turbine to stop also closes the process-wide outputs.
+ *
+ * The stage context is reset rather than freed, so a turbine that is called again starts over
+ * with first-run initialisation against its existing parameters.
+ */
+static void finish_discon_instance(discon_instance_t *instance)
+{
+	pthread_mutex_lock(&disconInstancesMutex);
+	reset_stage_context(instance->context);
+	if (instance->running)
+	{
+		instance->running = false;
+		nRunningDisconInstances--;
+	}
+	if (nRunningDisconInstances == 0)
+	{
+		log_stage_timing_table();
+		close_log_file();
+		// a host that reloads the library must read the edited CSV, not this run's snapshot
+		unpublish_config_snapshot();
+	}
+	pthread_mutex_unlock(&disconInstancesMutex);
+}
+
 /**
  * @brief Entry point for the DISCON controller called by GH Bladed.
  *
@@ -58,33 +292,31 @@ __attribute__((constructor)) static void init_discon_hook(void)
  * - The controller writes any diagnostic or control messages into the supplied character
  *   buffers (`acc_in_file`, `avc_outname`, `avc_msg`), and sets `avi_fail = 0` on success.
  *
+ * **Several turbines per process:** each distinct `acc_in_file` / `avc_outname` pair gets its
+ * own controller context (dynamic parameters, history tasks, stage state) on its first call;
+ * all of them share the fixed parameters read by the first turbine. Calls for different
+ * turbines may come from different threads. The log file is closed once the last running
+ * turbine has made its shutdown call. A turbine failed by its stages (`discon_instance_fail()`)
+ * reports it through its own `avi_fail` from then on while the others keep running;
+ * `shutdownFlag` (a process-wide error or a host signal) fails every turbine.
+ *
  * @param[in,out] avr_swap     Array of averaged input signals from Bladed (e.g., speeds, loads).
  * @param[out]    avi_fail     Output flag: set to 0 for success, nonzero for failure.
- * @param[in]     acc_in_file   (Unused) Input message or filename passed from Bladed.
- * @param[in]     avc_outname  (Unused) Path for controller output files under the simulation folder.
+ * @param[in]     acc_in_file  Input message or filename passed from Bladed; with `avc_outname` it selects the turbine's controller context.
+ * @param[in]     avc_outname  Path for controller output files under the simulation folder.
  * @param[in]     avc_msg      (Unused) Text message buffer to send status or error back to Bladed.
  */
 void example_discon(DISCON_PARAM_LIST)
 {
-	static bool init_Complete = false;
-	static param_array_t *dynamic_Data = NULL;
-	static param_array_t *fixed_Data = NULL;
-	static history_task_list_t *history_Tasks = NULL;
-
-	if (!init_Complete)
+	discon_instance_t *instance = acquire_discon_instance(avr_swap, acc_in_file, avc_outname);
+	if (!instance || instance->failed || shutdownFlag)
 	{
-		int n_params = 1;
-		dynamic_Data = create_input_data(n_params);
-		fixed_Data = create_input_data(n_params);
-
-		// Pass the address of the pointers (i.e., pointers to pointers)
-		initialize_control_system(&dynamic_Data, &fixed_Data, &history_Tasks, 1);
-
-		control_switch(dynamic_Data, fixed_Data);
-
-		log_message("discon init complete!\n");
-
-		init_Complete = true;
+		if (instance && (int)(avr_swap[0]) == -1)
+		{
+			finish_discon_instance(instance);
+		}
+		*avi_fail = -1;
+		return;
 	}
 
 	// avr_swap - data swap array
@@ -93,8 +325,50 @@ void example_discon(DISCON_PARAM_LIST)
 	// avc_outname - char array to path to sim results folder, for saving controller data internally
 	// avc_msg - char array, can be used to send message up to caller
 
-	qblade_interface(avr_swap, dynamic_Data, fixed_Data, history_Tasks);
+	// every stage below keeps its state in the current stage context, so switching it switches turbines
+	stage_context_t *previous_context = set_current_stage_context(instance->context);
+	currentDisconInstance = instance;
+
+	qblade_interface(avr_swap, instance->dynamic_data, disconFixedData, instance->history_tasks);
+
+	currentDisconInstance = NULL;
+	set_current_stage_context(previous_context);
+
+	if ((int)(avr_swap[0]) == -1)
+	{
+		finish_discon_instance(instance);
+	}
+
+	// a stage failure reaches only this turbine, shutdownFlag stops the whole process
+	*avi_fail = instance->failed || shutdownFlag ? -1 : 0;
+}
+
+/**
+ * @brief Marks the turbine served by the current DISCON call as failed.
+ *
+ * Stages call this for errors that concern one turbine (its swap bindings, its schedule); that
+ * turbine reports `avi_fail` from then on and is no longer run, the others carry on. Outside a
+ * DISCON call there is only one run, so the error sets `shutdownFlag` instead.
+ */
+void discon_instance_fail(void)
+{
+	if (currentDisconInstance)
+	{
+		currentDisconInstance->failed = true;
+	}
+	else
+	{
+		shutdownFlag = 1;
+	}
+}
 
-	// Indicate successful execution
-	*avi_fail = 0;
+/**
+ * @brief Whether the DISCON call being served belongs to the first turbine of the process.
+ *
+ * Process-wide outputs (continuous dynamic data logging, the shutdown CSVs) follow only that
+ * turbine. Also true outside a DISCON call, so stages driven directly behave as before.
+ */
+bool discon_instance_is_primary(void)
+{
+	return !currentDisconInstance || currentDisconInstance->primary;
 }
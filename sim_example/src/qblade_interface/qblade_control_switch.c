@@ -27,6 +27,7 @@
 #include "make_stage.h"
 #include "maybe_unused.h"
 #include "qblade_interface.h"
+#include "stage_timing.h"     // for configure_stage_timing
 #include "turbine_controls.h" // for turbine_control
 #include <stdbool.h>          // IWYU pragma: keep
 #include <stddef.h>           // for NULL
@@ -60,6 +61,8 @@ void control_switch(CONTROL_SWITCH_PARAM_LIST)
 		DISPATCH_STAGE_OR_ERROR(qblade_interface, qbladeInterfaceMap, qblade_Interface_Function_Call);
 		DISPATCH_STAGE_OR_ERROR(DISCON, disconMap, discon_Function_Call);
 
+		configure_stage_timing(fixed_data); // optional per-stage timing table at shutdown
+
 		first_Run = true;
 	}
 }
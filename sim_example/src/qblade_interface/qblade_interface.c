@@ -21,36 +21,65 @@
 #include "bladed_interface.h"
 #include "xfe_control_sim_common.h" // for get_param, param_array_t
 #include "drivetrains.h"            // for drivetrain
+#include "history_ring.h"           // for update_history_rings
+#include "discon.h"                 // for discon_instance_is_primary, discon_instance_fail
 #include "logger.h"                 // for log_message
 #include "make_stage.h"
 #include "qblade_interface.h"
+#include "stage_schedule.h"   // for init_stage_schedule, stage_is_due
+#include "swap_binding.h"     // for compile_swap_bindings, swap_bindings_copy_in, swap_bindings_copy_out
 #include "turbine_controls.h" // for turbine_control
 #include "xflow_core.h"
 #include <stdbool.h> // IWYU pragma: keep
 #include <stddef.h>  // for NULL
 
+// the records example_qblade_interface exchanged by hand before the bindings were configurable
+#define QBLADE_DEFAULT_SWAP_BINDINGS "in:REC_CURRENT_TIME:time_sec;in:REC_MEASURED_ROTOR_SPEED:omega;out:REC_DEMANDED_GENERATOR_TORQUE:tau_flow_extract"
+
 // expand definitions once, using both the decl‐list and the call‐list
 MAKE_STAGE_DEFINE(qblade_interface, void, (QBLADE_INTERFACE_PARAM_LIST), (QBLADE_INTERFACE_CALL_ARGS)) // NOLINT(readability-non-const-parameter)
 
+typedef struct
+{
+	double *time_sec;
+	double *dt_sec;
+	swap_binding_table_t bindings;
+	stage_schedule_t stage_schedule;
+	bool init_failed; // first-run setup failed, the turbine no longer runs its stages
+} example_qblade_interface_state_t;
+
+static void release_example_qblade_interface_state(void *state)
+{
+	free_swap_bindings(&((example_qblade_interface_state_t *)state)->bindings);
+}
+
 /**
  * @brief Executes the QBlade-based control algorithm for each DISCON call.
  *
  * This function implements the core runtime logic of the external controller
- * invoked by the DISCON interface. On first invocation, it binds the required
- * input parameters (`omega`, `tau_Flow_Extract`, `time_sec`, `dt_sec`,
- * `control_dt_sec`) from the dynamic and fixed parameter arrays via `get_param()`
- * and initializes the communication interval (`dt_sec`) from `avr_swap[REC_COMMUNICATION_INTERVAL]`.
+ * invoked by the DISCON interface. On first invocation, it binds `time_sec` and `dt_sec`
+ * via `get_param()`, compiles the `qblade_swap_bindings` specification (`swap_binding.h`)
+ * into flat copy-in / copy-out tables of avr_swap records and dynamic parameters,
+ * initializes the communication interval (`dt_sec`) from `avr_swap[REC_COMMUNICATION_INTERVAL]`
+ * and sets up the stage schedule on that interval. If any of that fails, the turbine is marked
+ * failed (`discon_instance_fail()`) and every later call returns without running a stage.
  *
  * On each call thereafter:
- * 1. Updates the current simulation time (`REC_CURRENT_TIME`) and rotor speed
- *    (`REC_MEASURED_ROTOR_SPEED`) into the bound variables.
- * 2. Accumulates elapsed time and, when it exceeds `control_dt_sec`, invokes
- *    `turbine_control()` to compute the next generator torque command and
- *    resets the accumulator.
+ * 1. Copies the `in` records (by default `REC_CURRENT_TIME` and `REC_MEASURED_ROTOR_SPEED`)
+ *    into their parameters.
+ * 2. Counts the call as one tick of the shared stage schedule (`stage_schedule.h`) and,
+ *    when due (every `control_dt_sec` by default), invokes `turbine_control()` to
+ *    compute the next generator torque command.
  * 3. Always calls `drivetrain()` to update the low-speed shaft torque demand
  *    (`tau_Flow_Extract`).
- * 4. Writes the demanded generator torque back into `avr_swap[REC_DEMANDED_GENERATOR_TORQUE]`.
- * 5. Performs continuous logging via `continuous_logging_function()`.
+ * 4. Copies the `out` parameters back, by default `tau_flow_extract` into
+ *    `avr_swap[REC_DEMANDED_GENERATOR_TORQUE]`.
+ * 5. Performs continuous logging via `continuous_logging_function()` when due; DISCON
+ *    hands the rows to the background writer (`discon_deferred_logging`).
+ *
+ * All state lives in the current stage context, which `example_discon` switches per turbine.
+ * Writes to the shared outputs (`dt_sec`, the dynamic data CSV, the shutdown CSVs) are made
+ * only for the first turbine, see `discon_instance_is_primary()`.
  *
  * @param[in,out] avr_swap       Array of floats passed by Bladed/DISCON containing
  *                              input signals and receiving the output torque command.
@@ -60,58 +89,82 @@ MAKE_STAGE_DEFINE(qblade_interface, void, (QBLADE_INTERFACE_PARAM_LIST), (QBLADE
  */
 void example_qblade_interface(QBLADE_INTERFACE_PARAM_LIST)
 {
-	static double *omega = NULL;
-	static double *tau_Flow_Extract = NULL;
-	static double *time_Sec = NULL;
-	static double *dt_Sec = NULL;
-	static double *control_Dt_Sec = NULL;
-	static double accumulated_Time = 0.0;
-
-	static bool first_Run = false;
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(example_qblade_interface_state_t, state, release_example_qblade_interface_state, first_run);
+	if (!state || state->init_failed)
+	{
+		return;
+	}
 
-	if (!first_Run)
+	if (first_run)
 	{
 		// initialize variables since this is the first time the function is running.
-		get_param(dynamic_data, "omega", &omega);
-		get_param(dynamic_data, "tau_flow_extract", &tau_Flow_Extract);
-		get_param(dynamic_data, "time_sec", &time_Sec);
-		get_param(fixed_data, "dt_sec", &dt_Sec);
-		get_param(fixed_data, "control_dt_sec", &control_Dt_Sec);
-		log_message("omega: %f\n", *omega);
-		log_message("tau_Flow_Extract: %f\n", *tau_Flow_Extract);
-		log_message("time_sec: %f\n", *time_Sec);
+		get_param(dynamic_data, "time_sec", &state->time_sec);
+		get_param(fixed_data, "dt_sec", &state->dt_sec);
+		log_message("time_sec: %f\n", *state->time_sec);
+
+		// avr_swap records <-> dynamic parameters, resolved once into flat copy tables
+		const char *swap_bindings = get_param_string_or_default(fixed_data, "qblade_swap_bindings", QBLADE_DEFAULT_SWAP_BINDINGS);
+		if (compile_swap_bindings(&state->bindings, dynamic_data, swap_bindings) != 0)
+		{
+			ERROR_MESSAGE("Invalid qblade_swap_bindings '%s'\n", swap_bindings);
+			state->init_failed = true;
+			discon_instance_fail();
+			return;
+		}
+		log_message("qblade_interface: %d input and %d output swap bindings\n", state->bindings.n_in, state->bindings.n_out);
 
 		// even though this is fixed data this can still change once to make sure qbalde interval matches...
-		*dt_Sec = avr_swap[REC_COMMUNICATION_INTERVAL];
+		// the fixed data is shared by all turbines of the process, so only the first one writes it.
+		if (discon_instance_is_primary())
+		{
+			*state->dt_sec = avr_swap[REC_COMMUNICATION_INTERVAL];
+		}
 
-		first_Run = true;
+		// each DISCON call is one base tick, so the stage periods are counted in communication intervals.
+		if (init_stage_schedule(&state->stage_schedule, fixed_data, avr_swap[REC_COMMUNICATION_INTERVAL], avr_swap[REC_CURRENT_TIME]) != 0)
+		{
+			state->init_failed = true;
+			discon_instance_fail();
+			return;
+		}
 	}
-	// set current time and speed
-	*time_Sec = avr_swap[REC_CURRENT_TIME];
-	*omega = avr_swap[REC_MEASURED_ROTOR_SPEED];
+	// copy in the bound measurements (current time and speed by default)
+	swap_bindings_copy_in(&state->bindings, avr_swap);
 
-	// Add the elapsed time since the last update
-	accumulated_Time += *dt_Sec;
+	// QBlade owns the clock; the schedule only counts the call as a completed tick.
+	advance_stage_schedule(&state->stage_schedule);
+	update_history_rings(state->stage_schedule.tick);
 
-	perform_history_updates(*time_Sec, history_tasks);
+	if (stage_is_due(&state->stage_schedule, SCHEDULED_HISTORY_UPDATES))
+	{
+		perform_history_updates(*state->time_sec, history_tasks);
+	}
 
-	// Check if the accumulated time has reached or exceeded control_dt_sec
-	if (accumulated_Time >= *control_Dt_Sec)
+	if (stage_is_due(&state->stage_schedule, SCHEDULED_TURBINE_CONTROL))
 	{
-		// call the turbine control every control_dt_sec timestep.
+		// call the turbine control every turbine_control_every_n_ticks (control_dt_sec by default).
 		turbine_control(dynamic_data, fixed_data); // update the vfd torque command
-		accumulated_Time -= *control_Dt_Sec;       // Reset accumulated_Time, preserve any leftover time
 	}
 
 	drivetrain(dynamic_data, fixed_data); // update the low speed torque desired, essentially tau_gen
 
-	avr_swap[REC_DEMANDED_GENERATOR_TORQUE] = (float)(*tau_Flow_Extract);
+	// copy out the bound demands (generator torque from tau_flow_extract by default)
+	swap_bindings_copy_out(&state->bindings, avr_swap);
 
-	continuous_logging_function(dynamic_data, fixed_data);
+	// the dynamic data CSV follows one turbine, the first one DISCON was called for
+	if (stage_is_due(&state->stage_schedule, SCHEDULED_CONTINUOUS_LOGGING) && discon_instance_is_primary())
+	{
+		continuous_logging_function(dynamic_data, fixed_data);
+	}
 
 	if ((int)(avr_swap[0]) == -1)
 	{
-		save_dynamic_fixed_data_at_shutdown(dynamic_data, fixed_data, 1);
-		close_log_file();
+		log_stage_schedule_statistics(&state->stage_schedule);
+		if (discon_instance_is_primary())
+		{
+			save_dynamic_fixed_data_at_shutdown(dynamic_data, fixed_data, 1);
+		}
+		// the stage timing table and the log file are process wide; DISCON closes them after the last turbine.
 	}
 }
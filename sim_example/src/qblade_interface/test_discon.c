@@ -31,11 +31,15 @@
 #include <stdbool.h> // IWYU pragma: keep
 #include <stddef.h>  // for NULL
 #include <stdio.h>   // For printf to see outputs
+#include <stdlib.h>  // for malloc, free, qsort, strtod
+#include <string.h>  // for strcmp
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+#define BENCH_SIMULATION_TIME 600.0 // DISCON calls timed in --bench mode: 6000 at the 0.1 s interval
+
 /**
  * @brief Simulates getting a rotor speed measurement from an external source.
  *
@@ -56,8 +60,50 @@ static double get_speed_from_external_source(double time)
 	return offset + (amplitude * sin(2.0 * M_PI * frequency * time));
 }
 
-int main(void)
+/**
+ * @brief Writes the DISCON call latencies of a `--bench` run as JSON.
+ *
+ * The first call (controller initialisation) is reported separately from the steady-state calls.
+ */
+static int write_discon_bench_json(const char *path, const double init_sec, double *latencies, const long n_calls)
+{
+	FILE *json = fopen(path, "w");
+	if (!json)
+	{
+		ERROR_MESSAGE("Cannot open %s\n", path);
+		return EXIT_FAILURE;
+	}
+	double total = 0.0;
+	for (long i = 0; i < n_calls; i++)
+	{
+		total += latencies[i];
+	}
+	qsort(latencies, (size_t)n_calls, sizeof(double), compare_doubles);
+	const double p50 = n_calls > 0 ? latencies[n_calls / 2] : 0.0;
+	const double p99 = n_calls > 0 ? latencies[(n_calls * 99) / 100] : 0.0;
+	const double max = n_calls > 0 ? latencies[n_calls - 1] : 0.0;
+	fprintf(json, "{\n  \"schema\": \"xfe_control_sim_bench_discon/1\",\n  \"init_ms\": %.3f,\n  \"calls\": %ld,\n"
+	              "  \"mean_us\": %.3f,\n  \"p50_us\": %.3f,\n  \"p99_us\": %.3f,\n  \"max_us\": %.3f\n}\n",
+	        init_sec * 1e3, n_calls, n_calls > 0 ? total / (double)n_calls * 1e6 : 0.0, p50 * 1e6, p99 * 1e6, max * 1e6);
+	fclose(json);
+	printf("DISCON: %ld calls, mean %.2f us, p99 %.2f us, init %.2f ms -> %s\n", n_calls, n_calls > 0 ? total / (double)n_calls * 1e6 : 0.0, p99 * 1e6, init_sec * 1e3, path);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Drives DISCON with a simple plant. `--bench <results.json>` runs longer and records the call latency.
+ */
+int main(int argc, char *argv[])
 {
+	const char *bench_json = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+		{
+			bench_json = argv[++i];
+		}
+	}
+
 	float avr_swap[REC_USER_VARIABLE_10] = {0};
 	int avi_fail = -1;
 	char acc_in_file[1] = {0};
@@ -65,7 +111,7 @@ int main(void)
 	char avc_msg[1] = {0};
 
 	/* Simple plant + sim settings */
-	double simulation_time = 10.0;
+	double simulation_time = bench_json ? BENCH_SIMULATION_TIME : 10.0;
 	double t = 0.0;
 	double omega = 0.0;
 	float dt = 0.1F;
@@ -87,6 +133,17 @@ int main(void)
 	avr_swap[REC_USER_VARIABLE_1] = 2.0F;  /* omega_target [rad/s], example */
 	avr_swap[REC_USER_VARIABLE_2] = 50.0F; /* moment_of_inertia j [kg·m^2], example */
 
+	// one latency slot per call; only allocated when benchmarking
+	const long max_calls = (long)(simulation_time / (double)dt) + 2;
+	double *latencies = bench_json ? (double *)malloc((size_t)max_calls * sizeof(double)) : NULL;
+	long n_calls = 0;
+	double init_sec = -1.0; // negative until the initialising first call has been timed
+	if (bench_json && !latencies)
+	{
+		ERROR_MESSAGE("Cannot allocate %ld latency samples\n", max_calls);
+		return EXIT_FAILURE;
+	}
+
 	while (t < simulation_time)
 	{
 		if (is_first_call)
@@ -113,9 +170,23 @@ int main(void)
 		// **MODIFICATION**: Use the measured speed from the external source
 		avr_swap[REC_MEASURED_ROTOR_SPEED] = (float)measured_rotor_speed;
 
+		const struct timespec call_start = get_monotonic_timestamp();
 		DISCON(DISCON_CALL_ARGS);
+		if (latencies)
+		{
+			const double call_sec = timespec_diff_to_double(call_start, get_monotonic_timestamp());
+			if (init_sec < 0.0)
+			{
+				init_sec = call_sec;
+			}
+			else if (n_calls < max_calls)
+			{
+				latencies[n_calls++] = call_sec;
+			}
+		}
 		if (avi_fail != 0)
 		{
+			free(latencies);
 			return avi_fail;
 		}
 
@@ -136,5 +207,11 @@ int main(void)
 		t += (double)dt;
 	}
 
+	if (latencies)
+	{
+		const int status = write_discon_bench_json(bench_json, init_sec, latencies, n_calls);
+		free(latencies);
+		return status;
+	}
 	return EXIT_SUCCESS;
 }
@@ -24,69 +24,79 @@
 #include "xfe_control_sim_common.h" // for get_param, param_array_t
 #include "logger.h"                 // for log_message
 #include "maybe_unused.h"
+#include "history_ring.h"     // for get_history_ring, history_ring_view, history_view_at
 #include "turbine_controls.h" // for turbine_control
+#include "xfe_log.h"          // for XFE_LOG_DEBUG, xfe_log_site_pass
 #include <stdbool.h>          // IWYU pragma: keep
 #include <stddef.h>           // for NULL
 							  // NOLINTEND(llvm-include-order)
 
 // expand definitions once, using both the decl‐list and the call‐list
+#ifdef XFE_FUSED_TURBINE_CONTROL
+MAKE_STAGE_DEFINE_BOUND(turbine_control, void, (TURBINE_CONTROL_PARAM_LIST), (TURBINE_CONTROL_CALL_ARGS), XFE_FUSED_TURBINE_CONTROL)
+#else
 MAKE_STAGE_DEFINE(turbine_control, void, (TURBINE_CONTROL_PARAM_LIST), (TURBINE_CONTROL_CALL_ARGS))
+#endif
+MAKE_STAGE_DEFINE(turbine_control_batch, void, (TURBINE_CONTROL_BATCH_PARAM_LIST), (TURBINE_CONTROL_BATCH_CALL_ARGS))
 
-void example_turbine_control(TURBINE_CONTROL_PARAM_LIST)
+typedef struct
 {
-	static double *omega = NULL;
-	static double *tau_Flow_Extract = NULL;
-	static double *k = NULL;
-	static double *time_Sec = NULL;
-	static int *total_Loop_Count = NULL;
-	// static char **all_Combined = NULL;
-
-	static param_history_accessor_t omega_History_Accessor;
-	static param_history_accessor_t total_Loop_Count_History_Accessor;
-	// static param_history_accessor_t all_Combined_History_Accessor;
-	static param_history_accessor_t time_Sec_History_Accessor;
+	double *tau_flow_extract;
+	double *k;
 
-	static bool first_Run = false;
+	history_ring_t *omega_history;
+	history_ring_t *total_loop_count_history;
+	history_ring_t *time_sec_history;
+} example_turbine_control_state_t;
 
-	if (!first_Run)
+void example_turbine_control(TURBINE_CONTROL_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(example_turbine_control_state_t, state, first_run);
+	if (!state)
 	{
-		get_param(dynamic_data, "tau_flow_extract", &tau_Flow_Extract);
-		get_param(dynamic_data, "k", &k);
-
-		// Allocate space for 10 historical omega values
-		get_param_history(dynamic_data, "omega", &omega_History_Accessor);
-		get_param_history(dynamic_data, "total_loop_count", &total_Loop_Count_History_Accessor);
-		// get_param_history(dynamic_data, "all_combined", &all_Combined_History_Accessor);
-		get_param_history(dynamic_data, "time_sec", &time_Sec_History_Accessor);
+		return;
+	}
 
-		// Now you can directly access as an array!
-		omega = (double *)omega_History_Accessor.local_buffer;
-		total_Loop_Count = (int *)total_Loop_Count_History_Accessor.local_buffer;
-		// all_Combined = (char **)all_Combined_History_Accessor.local_buffer;
-		time_Sec = (double *)time_Sec_History_Accessor.local_buffer;
+	if (first_run)
+	{
+		get_param(dynamic_data, "tau_flow_extract", &state->tau_flow_extract);
+		get_param(dynamic_data, "k", &state->k);
 
-		first_Run = true;
+		// keep the last few samples of each tracked value; the rings are read in place, never copied
+		const int history_length = get_param_int_or_default(fixed_data, "turbine_control_history_length", 5);
+		const double history_period_sec = get_param_double_or_default(fixed_data, "turbine_control_history_period_sec", 0.15);
+		state->omega_history = get_history_ring(dynamic_data, fixed_data, "omega", history_length, history_period_sec);
+		state->total_loop_count_history = get_history_ring(dynamic_data, fixed_data, "total_loop_count", history_length, history_period_sec);
+		state->time_sec_history = get_history_ring(dynamic_data, fixed_data, "time_sec", history_length, history_period_sec);
+	}
+	if (!state->omega_history || !state->total_loop_count_history || !state->time_sec_history)
+	{
+		return;
 	}
 
-	// Refresh the local buffer with latest values
-	refresh_history_local_buffer(&omega_History_Accessor);
-	refresh_history_local_buffer(&total_Loop_Count_History_Accessor);
-	// refresh_history_local_buffer(&all_Combined_History_Accessor);
-	refresh_history_local_buffer(&time_Sec_History_Accessor);
-
-	int count = omega_History_Accessor.local_valid_count;
+	const history_view_t omega = history_ring_view(state->omega_history);
+	const history_view_t time_sec = history_ring_view(state->time_sec_history);
+	const history_view_t total_loop_count = history_ring_view(state->total_loop_count_history);
 
-	log_message("Omega history has %d/%d values:\n", count, *omega_History_Accessor.size);
-	for (int i = 0; i < count; i++)
+#if XFE_LOG_MIN_LEVEL <= XFE_LOG_LEVEL_DEBUG
+	// runs every tick; at most one dump per second so the log does not distort the loop it describes
+	static xfe_log_site_t HistoryDumpSite;
+	const long suppressed = xfe_log_level_enabled(XFE_LOG_LEVEL_DEBUG) ? xfe_log_site_pass(&HistoryDumpSite, 1.0) : -1;
+	if (suppressed >= 0)
 	{
-		// const char *combined_str = all_Combined[i] ? all_Combined[i] : "(null)";
-		// log_message("time_Sec[%d]: %f, omega[%d] = %f, loop count[%d]: %d, all_combined: %s\n", i, time_Sec[i], i, omega[i], i, total_Loop_Count[i], combined_str);
-		log_message("time_Sec[%d]: %f, omega[%d] = %f, loop count[%d]: %d\n", i, time_Sec[i], i, omega[i], i, total_Loop_Count[i]);
+		xfe_log_write(XFE_LOG_LEVEL_DEBUG, suppressed, "Omega history has %d/%d values:\n", omega.count, omega.capacity);
+		for (int i = 0; i < omega.count; i++)
+		{
+			XFE_LOG_DEBUG("time_Sec[%d]: %f, omega[%d] = %f, loop count[%d]: %d\n", i, history_view_at(&time_sec, i), i, history_view_at(&omega, i), i, (int)history_view_at(&total_loop_count, i));
+		}
 	}
+#endif
 
-	// Use most recent value (index 0)
-	if (count > 0)
+	// Use most recent value (age 0)
+	if (omega.count > 0)
 	{
-		*tau_Flow_Extract = (*k) * omega[0] * omega[0];
+		const double omega_now = history_view_at(&omega, 0);
+		*state->tau_flow_extract = (*state->k) * omega_now * omega_now;
 	}
 }
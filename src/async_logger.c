@@ -0,0 +1,313 @@
+/**
+ * @file    async_logger.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Background writer thread for continuous dynamic data logging
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "async_logger.h"
+#include "logger.h"         // for log_message, ERROR_MESSAGE
+#include "maybe_unused.h"   // for MAYBE_UNUSED
+#include "xflow_aero_sim.h" // for param_array_t, input_param_t
+#include "xflow_core.h"     // for get_monotonic_timestamp, usleep_now
+#include <pthread.h>        // for pthread_create, pthread_join, pthread_t
+#include <stdatomic.h>      // for atomic_size_t, atomic_load_explicit, ...
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stddef.h>         // for size_t
+#include <stdio.h>          // for FILE
+#include <stdlib.h>         // for calloc, free
+#include <string.h>         // for memcpy, strlen
+#include <time.h>           // for timespec
+
+#define ASYNC_LOGGER_IDLE_SLEEP_US 500U // writer back-off when the ring is empty
+#define ASYNC_LOGGER_FULL_SLEEP_US 50U  // producer back-off when blocking on a full ring
+
+/*
+ * Single-producer/single-consumer ring. The simulation thread is the only writer of `head`,
+ * the background thread the only writer of `tail`; each slot holds a copy of every
+ * input_param_t (so the writer can hand it straight to the row writer as a param_array_t)
+ * plus a private copy of every string value.
+ */
+typedef struct
+{
+	FILE *file;
+	async_logger_row_writer_fn row_writer;
+	async_logger_overflow_t overflow;
+
+	int n_param;
+	int n_string;
+	int *string_index; // per parameter: index into the slot string area, or -1
+
+	size_t capacity; // power of two
+	size_t mask;
+	struct timespec *stamps; // capacity timestamps
+	input_param_t *params;   // capacity * n_param parameter copies
+	char *strings;           // capacity * n_string * ASYNC_LOGGER_STRING_WIDTH
+
+	atomic_size_t head; // next slot the producer fills
+	atomic_size_t tail; // next slot the writer drains
+	atomic_bool stop;
+	atomic_bool writer_failed;
+	size_t dropped; // producer-only counters
+	size_t waits;
+	size_t written; // writer-only counter
+
+	pthread_t thread;
+	bool running;
+} async_logger_t;
+
+static async_logger_t asyncLogger;
+
+static void free_async_logger_buffers(void)
+{
+	free(asyncLogger.string_index);
+	free(asyncLogger.stamps);
+	free(asyncLogger.params);
+	free(asyncLogger.strings);
+	asyncLogger.string_index = NULL;
+	asyncLogger.stamps = NULL;
+	asyncLogger.params = NULL;
+	asyncLogger.strings = NULL;
+}
+
+static void *async_logger_thread(MAYBE_UNUSED void *arg)
+{
+	for (;;)
+	{
+		const size_t tail = atomic_load_explicit(&asyncLogger.tail, memory_order_relaxed);
+		const size_t head = atomic_load_explicit(&asyncLogger.head, memory_order_acquire);
+		if (tail == head)
+		{
+			if (atomic_load_explicit(&asyncLogger.stop, memory_order_acquire))
+			{
+				// Re-check after seeing stop so pushes made just before it are drained.
+				if (atomic_load_explicit(&asyncLogger.head, memory_order_acquire) == tail)
+				{
+					break;
+				}
+				continue;
+			}
+			usleep_now(ASYNC_LOGGER_IDLE_SLEEP_US);
+			continue;
+		}
+
+		const size_t slot = tail & asyncLogger.mask;
+		const param_array_t snapshot = {.n_param = asyncLogger.n_param, .params = &asyncLogger.params[slot * (size_t)asyncLogger.n_param]};
+		if (asyncLogger.row_writer(asyncLogger.file, asyncLogger.stamps[slot], &snapshot) != 0)
+		{
+			atomic_store_explicit(&asyncLogger.writer_failed, true, memory_order_relaxed);
+		}
+		asyncLogger.written++;
+		atomic_store_explicit(&asyncLogger.tail, tail + 1, memory_order_release);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Starts the background writer for an already opened and initialized log file.
+ *
+ * Allocates a ring of `ring_rows` (rounded up to a power of two) snapshots sized for the
+ * current layout of `data`, then spawns the writer thread. The header must already have
+ * been written by the backend's `CSV_LOGGER_INIT`; from here on only the writer thread
+ * touches `file` until `async_logger_stop` returns.
+ *
+ * @param file        Open log file.
+ * @param row_writer  Backend row writer (`write_dynamic_data_csv_row` or `write_dynamic_data_binary_row`).
+ * @param data        Dynamic parameter array whose layout every snapshot will copy.
+ * @param ring_rows   Requested number of snapshots the ring can hold.
+ * @param overflow    Behaviour of `async_logger_push` on a full ring.
+ * @return            0 on success, -1 on failure (nothing is left running).
+ */
+int async_logger_start(FILE *file, const async_logger_row_writer_fn row_writer, const param_array_t *data, const int ring_rows, const async_logger_overflow_t overflow)
+{
+	if (asyncLogger.running)
+	{
+		ERROR_MESSAGE("Async logger already running\n");
+		return -1;
+	}
+	if (!file || !row_writer || !data || data->n_param <= 0)
+	{
+		ERROR_MESSAGE("Invalid arguments to async_logger_start\n");
+		return -1;
+	}
+
+	size_t capacity = 1;
+	while (capacity < (size_t)(ring_rows > 1 ? ring_rows : 2))
+	{
+		capacity <<= 1U;
+	}
+
+	asyncLogger.file = file;
+	asyncLogger.row_writer = row_writer;
+	asyncLogger.overflow = overflow;
+	asyncLogger.n_param = data->n_param;
+	asyncLogger.capacity = capacity;
+	asyncLogger.mask = capacity - 1;
+	asyncLogger.dropped = 0;
+	asyncLogger.waits = 0;
+	asyncLogger.written = 0;
+
+	asyncLogger.string_index = calloc((size_t)data->n_param, sizeof(int));
+	if (!asyncLogger.string_index)
+	{
+		ERROR_MESSAGE("Failed to allocate async logger string index\n");
+		return -1;
+	}
+	asyncLogger.n_string = 0;
+	for (int i = 0; i < data->n_param; i++)
+	{
+		asyncLogger.string_index[i] = (data->params[i].type == INPUT_PARAM_STRING) ? asyncLogger.n_string++ : -1;
+	}
+
+	asyncLogger.stamps = calloc(capacity, sizeof(struct timespec));
+	asyncLogger.params = calloc(capacity * (size_t)data->n_param, sizeof(input_param_t));
+	asyncLogger.strings = asyncLogger.n_string > 0 ? calloc(capacity * (size_t)asyncLogger.n_string, ASYNC_LOGGER_STRING_WIDTH) : NULL;
+	if (!asyncLogger.stamps || !asyncLogger.params || (asyncLogger.n_string > 0 && !asyncLogger.strings))
+	{
+		ERROR_MESSAGE("Failed to allocate async logger ring of %zu rows\n", capacity);
+		free_async_logger_buffers();
+		return -1;
+	}
+
+	atomic_store(&asyncLogger.head, 0);
+	atomic_store(&asyncLogger.tail, 0);
+	atomic_store(&asyncLogger.stop, false);
+	atomic_store(&asyncLogger.writer_failed, false);
+
+	if (pthread_create(&asyncLogger.thread, NULL, async_logger_thread, NULL) != 0)
+	{
+		ERROR_MESSAGE("Failed to start async logger thread\n");
+		free_async_logger_buffers();
+		return -1;
+	}
+	asyncLogger.running = true;
+
+	log_message("Async dynamic data logging started (%zu row ring, %s on overflow)\n", capacity, overflow == ASYNC_LOGGER_OVERFLOW_DROP ? "drop" : "block");
+	return 0;
+}
+
+/**
+ * @brief Copies the current values of `data` into the ring and returns.
+ *
+ * Never formats or writes; the only cost on the calling thread is a memcpy of the
+ * parameter array plus the string values. When the ring is full the snapshot is either
+ * dropped (and counted) or the caller spins until the writer frees a slot, depending on
+ * the overflow policy given to `async_logger_start`.
+ *
+ * @param data Dynamic parameter array with the same layout passed to `async_logger_start`.
+ */
+void async_logger_push(const param_array_t *data)
+{
+	if (!asyncLogger.running)
+	{
+		return;
+	}
+	if (data->n_param != asyncLogger.n_param)
+	{
+		asyncLogger.dropped++;
+		return;
+	}
+
+	const size_t head = atomic_load_explicit(&asyncLogger.head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&asyncLogger.tail, memory_order_acquire) >= asyncLogger.capacity)
+	{
+		if (asyncLogger.overflow == ASYNC_LOGGER_OVERFLOW_DROP)
+		{
+			asyncLogger.dropped++;
+			return;
+		}
+		asyncLogger.waits++;
+		while (head - atomic_load_explicit(&asyncLogger.tail, memory_order_acquire) >= asyncLogger.capacity)
+		{
+			usleep_now(ASYNC_LOGGER_FULL_SLEEP_US);
+		}
+	}
+
+	const size_t slot = head & asyncLogger.mask;
+	input_param_t *params = &asyncLogger.params[slot * (size_t)asyncLogger.n_param];
+	asyncLogger.stamps[slot] = get_monotonic_timestamp();
+	memcpy(params, data->params, (size_t)asyncLogger.n_param * sizeof(input_param_t));
+
+	if (asyncLogger.n_string > 0)
+	{
+		char *strings = &asyncLogger.strings[slot * (size_t)asyncLogger.n_string * ASYNC_LOGGER_STRING_WIDTH];
+		for (int i = 0; i < asyncLogger.n_param; i++)
+		{
+			if (asyncLogger.string_index[i] < 0)
+			{
+				continue;
+			}
+			char *dest = &strings[(size_t)asyncLogger.string_index[i] * ASYNC_LOGGER_STRING_WIDTH];
+			size_t n = params[i].value.s ? strlen(params[i].value.s) : 0;
+			if (n >= ASYNC_LOGGER_STRING_WIDTH)
+			{
+				n = ASYNC_LOGGER_STRING_WIDTH - 1;
+			}
+			if (n > 0)
+			{
+				memcpy(dest, params[i].value.s, n);
+			}
+			dest[n] = '\0';
+			params[i].value.s = dest;
+		}
+	}
+
+	atomic_store_explicit(&asyncLogger.head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief Drains every queued snapshot, joins the writer thread and frees the ring.
+ *
+ * Must be called before the backend's `CSV_LOGGER_CLOSE` flushes and closes the file.
+ * Safe to call when the logger was never started.
+ */
+void async_logger_stop(void)
+{
+	if (!asyncLogger.running)
+	{
+		return;
+	}
+
+	atomic_store_explicit(&asyncLogger.stop, true, memory_order_release);
+	if (pthread_join(asyncLogger.thread, NULL) != 0)
+	{
+		ERROR_MESSAGE("Failed to join async logger thread\n");
+	}
+	asyncLogger.running = false;
+
+	if (atomic_load(&asyncLogger.writer_failed))
+	{
+		ERROR_MESSAGE("Async logger writer reported write errors\n");
+	}
+	log_message("Async dynamic data logging: %zu rows written, %zu dropped, %zu full-ring waits\n", asyncLogger.written, asyncLogger.dropped, asyncLogger.waits);
+
+	free_async_logger_buffers();
+	asyncLogger.file = NULL;
+}
+
+/**
+ * @brief Returns true while the background writer owns the log file.
+ */
+bool async_logger_running(void)
+{
+	return asyncLogger.running;
+}
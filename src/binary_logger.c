@@ -0,0 +1,349 @@
+/**
+ * @file    binary_logger.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Fixed-width binary backend for continuous dynamic data logging
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "binary_logger.h"
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "xfe_control_sim_common.h" // for csv_logger_action_t
+#include "xflow_aero_sim.h"         // for param_array_t, input_param_t
+#include "xflow_core.h"             // for get_monotonic_timestamp, timespec_diff
+#include "xflow_file_socket.h"      // IWYU pragma: keep
+#include <errno.h>                  // for errno
+#include <stdint.h>                 // for int32_t, uint16_t, uint32_t
+#include <stdio.h>                  // for FILE, fopen, fwrite, fseek, setvbuf
+#include <stdlib.h>                 // for malloc, free
+#include <string.h>                 // for memcpy, memset, strlen, strrchr
+#include <time.h>                   // for timespec
+
+static unsigned char *binaryRowBuffer = NULL; // one encoded row, row_size bytes
+static size_t binaryRowSize = 0;
+static int binaryLoggerColumns = 0; // n_param the header was written for
+static double binaryLoggerDt = 0.0;
+
+/**
+ * @brief Sets the time step recorded in the header of the next binary log file.
+ *
+ * @param dt  Simulation time step in seconds.
+ */
+void set_binary_logger_dt(const double dt)
+{
+	binaryLoggerDt = dt;
+}
+
+/**
+ * @brief Derives the `.xfelog` file name from the configured CSV path.
+ *
+ * Replaces a trailing `.csv` extension with `XFE_BINARY_LOG_EXTENSION`, or appends the
+ * extension when the path has none.
+ *
+ * @param[out] out       Destination buffer.
+ * @param      out_size  Size of `out` in bytes.
+ * @param      csv_path  Path of the CSV file the text logger would write.
+ */
+void binary_log_path_from_csv(char *out, const size_t out_size, const char *csv_path)
+{
+	const char *dot = strrchr(csv_path, '.');
+	const char *slash = strrchr(csv_path, '/');
+	int stem_len = (int)strlen(csv_path);
+	if (dot != NULL && (slash == NULL || dot > slash))
+	{
+		stem_len = (int)(dot - csv_path);
+	}
+	if (safe_snprintf(out, out_size, "%.*s%s", stem_len, csv_path, XFE_BINARY_LOG_EXTENSION) < 0)
+	{
+		ERROR_MESSAGE("Binary log path too long for %s\n", csv_path);
+	}
+}
+
+/**
+ * @brief Returns the encoded width in bytes of a parameter column.
+ */
+static size_t binary_log_column_size(const input_param_type_t type)
+{
+	switch (type)
+	{
+	case INPUT_PARAM_INT:
+		return sizeof(int32_t);
+	case INPUT_PARAM_DOUBLE:
+		return sizeof(double);
+	case INPUT_PARAM_STRING:
+		return XFE_BINARY_LOG_STRING_WIDTH;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Returns the on-disk type code of a parameter column.
+ */
+static uint16_t binary_log_column_type(const input_param_type_t type)
+{
+	switch (type)
+	{
+	case INPUT_PARAM_INT:
+		return XFE_BINARY_LOG_INT32;
+	case INPUT_PARAM_STRING:
+		return XFE_BINARY_LOG_STRING;
+	default:
+		return XFE_BINARY_LOG_FLOAT64;
+	}
+}
+
+/**
+ * @brief Writes one column descriptor and adds its size to `*header_bytes`.
+ */
+static int write_binary_log_column(FILE *file, const uint16_t type, const char *name, size_t *header_bytes)
+{
+	const size_t name_len = strlen(name);
+	const uint16_t encoded[2] = {type, (uint16_t)name_len};
+	if (name_len > UINT16_MAX || fwrite(encoded, sizeof(encoded), 1, file) != 1 || fwrite(name, 1, name_len, file) != name_len)
+	{
+		return -1;
+	}
+	*header_bytes += sizeof(encoded) + name_len;
+	return 0;
+}
+
+/**
+ * @brief Writes the `.xfelog` header: fixed part, column table and alignment padding.
+ *
+ * The fixed part is written twice: once as a placeholder, and again after the column table is
+ * known so that `header_size` can be filled in.
+ */
+static int write_binary_log_header(FILE *file, const param_array_t *data)
+{
+	xfe_binary_log_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, XFE_BINARY_LOG_MAGIC, XFE_BINARY_LOG_MAGIC_SIZE);
+	header.version = XFE_BINARY_LOG_VERSION;
+	header.byte_order_mark = XFE_BINARY_LOG_BYTE_ORDER_MARK;
+	header.n_columns = (uint32_t)data->n_param + 1U;
+	header.row_size = (uint32_t)binaryRowSize;
+	header.string_width = XFE_BINARY_LOG_STRING_WIDTH;
+	header.dt = binaryLoggerDt;
+
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		return -1;
+	}
+
+	size_t header_bytes = sizeof(header);
+	if (write_binary_log_column(file, XFE_BINARY_LOG_FLOAT64, "epoch_time", &header_bytes) != 0)
+	{
+		return -1;
+	}
+	for (int i = 0; i < data->n_param; i++)
+	{
+		if (write_binary_log_column(file, binary_log_column_type(data->params[i].type), data->params[i].name, &header_bytes) != 0)
+		{
+			return -1;
+		}
+	}
+
+	static const unsigned char padding[8] = {0};
+	const size_t pad = (8U - (header_bytes % 8U)) % 8U;
+	if (pad > 0 && fwrite(padding, 1, pad, file) != pad)
+	{
+		return -1;
+	}
+	header.header_size = (uint32_t)(header_bytes + pad);
+
+	if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1 || fseek(file, 0, SEEK_END) != 0)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Encodes one dynamic data row into fixed-width binary and appends it to `file`.
+ *
+ * Used by `dynamic_data_binary_logger` for synchronous logging and by the asynchronous logger
+ * thread, which passes the timestamp taken when the snapshot was captured.
+ *
+ * @param file  File opened by `dynamic_data_binary_logger(CSV_LOGGER_INIT)`.
+ * @param ts    Timestamp written in the `epoch_time` column.
+ * @param data  Parameter values; must have the layout the header was written for.
+ * @return      0 on success, -1 on a layout or write error.
+ */
+int write_dynamic_data_binary_row(FILE *file, const struct timespec ts, const param_array_t *data)
+{
+	if (!binaryRowBuffer)
+	{
+		ERROR_MESSAGE("Binary logger not initialized\n");
+		return -1;
+	}
+	if (data->n_param != binaryLoggerColumns)
+	{
+		ERROR_MESSAGE("Binary logger column count changed from %d to %d\n", binaryLoggerColumns, data->n_param);
+		return -1;
+	}
+
+	unsigned char *row = binaryRowBuffer;
+	const double epoch_time = (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+	memcpy(row, &epoch_time, sizeof(epoch_time));
+	row += sizeof(epoch_time);
+
+	for (int i = 0; i < data->n_param; i++)
+	{
+		const input_param_t *param = &data->params[i];
+		switch (param->type)
+		{
+		case INPUT_PARAM_INT: {
+			const int32_t value = (int32_t)param->value.i;
+			memcpy(row, &value, sizeof(value));
+			row += sizeof(value);
+		}
+		break;
+		case INPUT_PARAM_DOUBLE:
+			memcpy(row, &param->value.d, sizeof(double));
+			row += sizeof(double);
+			break;
+		case INPUT_PARAM_STRING: {
+			memset(row, 0, XFE_BINARY_LOG_STRING_WIDTH);
+			if (param->value.s)
+			{
+				size_t n = strlen(param->value.s);
+				if (n > XFE_BINARY_LOG_STRING_WIDTH)
+				{
+					n = XFE_BINARY_LOG_STRING_WIDTH;
+				}
+				memcpy(row, param->value.s, n);
+			}
+			row += XFE_BINARY_LOG_STRING_WIDTH;
+		}
+		break;
+		default:
+			ERROR_MESSAGE("Unknown parameter type for %s\n", param->name);
+			break;
+		}
+	}
+
+	const size_t written = fwrite(binaryRowBuffer, 1, binaryRowSize, file);
+	if (written != binaryRowSize)
+	{
+		ERROR_MESSAGE("Write error: %zu of %zu\n", written, binaryRowSize);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Binary counterpart of `dynamic_data_csv_logger`.
+ *
+ * Same action contract as the CSV logger, but each `CSV_LOGGER_LOG` copies the raw 4/8-byte
+ * values of every parameter into one fixed-width row instead of formatting text. The
+ * resulting `.xfelog` file can be opened directly by `misc/plot_viewer.py` or converted to
+ * CSV with `misc/xfe_binary_log.py`.
+ *
+ * @param file      Address of the `FILE*` owned by the caller; opened on INIT, closed on CLOSE.
+ * @param action    One of `CSV_LOGGER_INIT`, `CSV_LOGGER_LOG`, `CSV_LOGGER_CLOSE`.
+ * @param filename  Output path (see `binary_log_path_from_csv`).
+ * @param data      Dynamic parameter array; its layout must not change between INIT and CLOSE.
+ */
+void dynamic_data_binary_logger(FILE **file, const csv_logger_action_t action, const char *filename, const param_array_t *data)
+{
+	static char buf[1U << 22U];
+	static struct timespec total_Logger_Time = {0, 0};
+	struct timespec start_ts = get_monotonic_timestamp();
+
+	if (action == CSV_LOGGER_INIT)
+	{
+		// Opened in binary mode so Windows does not translate 0x0A bytes in the rows.
+		*file = fopen(filename, "wb"); // NOLINT(cert-err33-c)
+		if (!*file)
+		{
+			ERROR_MESSAGE("Failed to open file for writing: %s: %s\n", filename, safe_strerror(errno));
+			return;
+		}
+		if (setvbuf(*file, buf, _IOFBF, sizeof(buf)) != 0)
+		{
+			ERROR_MESSAGE("Failed to set file buffer\n");
+		}
+
+		binaryRowSize = sizeof(double);
+		for (int i = 0; i < data->n_param; i++)
+		{
+			binaryRowSize += binary_log_column_size(data->params[i].type);
+		}
+		binaryLoggerColumns = data->n_param;
+
+		free(binaryRowBuffer);
+		binaryRowBuffer = malloc(binaryRowSize);
+		if (!binaryRowBuffer)
+		{
+			ERROR_MESSAGE("Failed to allocate binary log row of %zu bytes\n", binaryRowSize);
+			return;
+		}
+
+		if (write_binary_log_header(*file, data) != 0)
+		{
+			ERROR_MESSAGE("Failed to write binary log header to %s\n", filename);
+			return;
+		}
+
+		log_message("Successfully initialized binary dynamic file logging at %s\n", filename);
+		return;
+	}
+
+	if (action == CSV_LOGGER_LOG)
+	{
+		if (!*file)
+		{
+			ERROR_MESSAGE("Binary logger not initialized\n");
+			return;
+		}
+
+		if (write_dynamic_data_binary_row(*file, start_ts, data) != 0)
+		{
+			return;
+		}
+		struct timespec end_ts = get_monotonic_timestamp();
+		struct timespec delta = timespec_diff(start_ts, end_ts);
+		total_Logger_Time = timespec_add(total_Logger_Time, delta);
+		return;
+	}
+
+	if (action == CSV_LOGGER_CLOSE)
+	{
+		if (*file)
+		{
+			if (fflush(*file) != 0)
+			{
+				ERROR_MESSAGE("Failed to flush file\n");
+			}
+			if (fclose(*file) == EOF)
+			{
+				ERROR_MESSAGE("Error closing %s: %s\n", filename, safe_strerror(errno));
+			}
+			*file = NULL;
+		}
+		free(binaryRowBuffer);
+		binaryRowBuffer = NULL;
+		binaryRowSize = 0;
+		log_message("write Duration: %ld.%.5ld\n", total_Logger_Time.tv_sec, total_Logger_Time.tv_nsec / 10000);
+		return;
+	}
+}
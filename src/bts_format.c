@@ -0,0 +1,109 @@
+/**
+ * @file    bts_format.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   TurbSim full-field .bts header reader shared by the .bts flow readers
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bts_format.h"
+#include "logger.h"     // for ERROR_MESSAGE
+#include "xflow_core.h" // for safe_strerror
+#include <errno.h>      // for errno
+#include <stdint.h>     // for int16_t, int32_t, uint16_t, uint32_t
+#include <stdio.h>      // for FILE, fread, fseek
+#include <string.h>     // for memcpy
+
+/**
+ * @brief Little-endian int16 as stored in the header and the samples of a .bts file.
+ */
+int16_t bts_le_i16(const unsigned char *p)
+{
+	return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8U));
+}
+
+static int32_t le_i32(const unsigned char *p)
+{
+	return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8U) | ((uint32_t)p[2] << 16U) | ((uint32_t)p[3] << 24U));
+}
+
+static float le_f32(const unsigned char *p)
+{
+	const uint32_t bits = (uint32_t)le_i32(p);
+	float value = 0.0F;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/**
+ * @brief Reads and validates a TurbSim full-field header and positions `file` at the first time step.
+ *
+ * @param file   .bts file opened in binary mode at its start.
+ * @param path   File name used in error messages.
+ * @param header Receives the decoded header.
+ * @return 0 on success, -1 on a truncated or invalid header (reported).
+ */
+int bts_read_header(FILE *file, const char *path, bts_header_t *header)
+{
+	unsigned char raw[BTS_FIXED_HEADER_BYTES];
+	if (fread(raw, 1, sizeof(raw), file) != sizeof(raw))
+	{
+		ERROR_MESSAGE("Truncated .bts header in %s\n", path);
+		return -1;
+	}
+
+	header->id = bts_le_i16(&raw[0]);
+	header->nz = le_i32(&raw[2]);
+	header->ny = le_i32(&raw[6]);
+	header->ntwr = le_i32(&raw[10]);
+	header->nt = le_i32(&raw[14]);
+	header->dz = le_f32(&raw[18]);
+	header->dy = le_f32(&raw[22]);
+	header->dt = le_f32(&raw[26]);
+	header->zhub = le_f32(&raw[34]);
+	header->zbottom = le_f32(&raw[38]);
+	for (int c = 0; c < BTS_COMPONENTS; c++)
+	{
+		header->slope[c] = le_f32(&raw[42 + (8 * c)]);
+		header->offset[c] = le_f32(&raw[46 + (8 * c)]);
+	}
+	const int32_t description_len = le_i32(&raw[66]);
+
+	if ((header->id != 7 && header->id != 8) || header->nz <= 0 || header->ny <= 0 || header->ntwr < 0 || header->nt <= 0 || header->dt <= 0.0F || description_len < 0)
+	{
+		ERROR_MESSAGE("%s is not a TurbSim full-field .bts file (id %d)\n", path, header->id);
+		return -1;
+	}
+	for (int c = 0; c < BTS_COMPONENTS; c++)
+	{
+		if (header->slope[c] == 0.0F)
+		{
+			ERROR_MESSAGE(".bts scaling slope of component %d is zero in %s\n", c, path);
+			return -1;
+		}
+	}
+	if (fseek(file, description_len, SEEK_CUR) != 0)
+	{
+		ERROR_MESSAGE("Cannot skip .bts description in %s: %s\n", path, safe_strerror(errno));
+		return -1;
+	}
+	return 0;
+}
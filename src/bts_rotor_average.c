@@ -0,0 +1,313 @@
+/**
+ * @file    bts_rotor_average.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Rotor-effective wind speed series from the full y-z grid of a TurbSim .bts file
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bts_rotor_average.h"
+#include "bts_format.h" // for bts_read_header, bts_le_i16, BTS_COMPONENTS
+#include "logger.h"     // for log_message, ERROR_MESSAGE
+#include "xflow_core.h" // for safe_strerror
+#include <errno.h>      // for errno
+#include <math.h>       // for sqrt, floor, fmin, fmax
+#include <stdbool.h>    // IWYU pragma: keep
+#include <stddef.h>     // for size_t
+#include <stdint.h>     // for int16_t
+#include <stdio.h>      // for FILE, fopen, fread, fclose
+#include <stdlib.h>     // for malloc, calloc, free
+
+/**
+ * @brief One grid row (fixed z) crossing the rotor disk: `count` neighbouring points from `iy_first`.
+ */
+typedef struct
+{
+	int iz;
+	int iy_first;
+	int count;
+	size_t weight_offset; // first weight of the row in `rotor_disk_t.weights`
+} rotor_disk_row_t;
+
+/**
+ * @brief Grid points inside the rotor disk, stored as contiguous runs per row with normalised weights.
+ */
+typedef struct
+{
+	rotor_disk_row_t *rows;
+	int n_rows;
+	double *weights; // sums to 1 over all rows
+	int n_points;
+} rotor_disk_t;
+
+static void free_rotor_disk(rotor_disk_t *disk)
+{
+	free(disk->rows);
+	free(disk->weights);
+	disk->rows = NULL;
+	disk->weights = NULL;
+}
+
+/**
+ * @brief Weight of the grid point at (`y`, `z`) relative to the hub: 1 or 0 for the plain mean, otherwise
+ *        the part of its dy x dz cell that lies inside the disk, sampled on a sub-grid.
+ */
+static double rotor_point_weight(const double y, const double z, const double dy, const double dz, const double radius, const bool area_weighted)
+{
+	const double r2 = radius * radius;
+	if (!area_weighted)
+	{
+		return ((y * y) + (z * z)) <= r2 ? 1.0 : 0.0;
+	}
+	int inside = 0;
+	for (int a = 0; a < BTS_ROTOR_AVERAGE_CELL_SUBSAMPLES; a++)
+	{
+		const double sy = y + (dy * (((a + 0.5) / BTS_ROTOR_AVERAGE_CELL_SUBSAMPLES) - 0.5));
+		for (int b = 0; b < BTS_ROTOR_AVERAGE_CELL_SUBSAMPLES; b++)
+		{
+			const double sz = z + (dz * (((b + 0.5) / BTS_ROTOR_AVERAGE_CELL_SUBSAMPLES) - 0.5));
+			inside += ((sy * sy) + (sz * sz)) <= r2;
+		}
+	}
+	return (double)inside / (BTS_ROTOR_AVERAGE_CELL_SUBSAMPLES * BTS_ROTOR_AVERAGE_CELL_SUBSAMPLES);
+}
+
+/**
+ * @brief Finds the grid points that cover the disk of `radius` around the hub, once per file.
+ *
+ * A disk crosses each row in one interval, so every row is a single run of neighbouring
+ * points. If the disk is smaller than the grid spacing the point nearest the hub is used alone.
+ */
+static int build_rotor_disk(rotor_disk_t *disk, const int ny, const int nz, const double dy, const double dz, const double zhub, const double zbottom, const double radius, const bool area_weighted)
+{
+	disk->rows = calloc((size_t)nz, sizeof(rotor_disk_row_t));
+	disk->weights = malloc((size_t)ny * (size_t)nz * sizeof(double));
+	if (!disk->rows || !disk->weights)
+	{
+		ERROR_MESSAGE("Rotor average: failed to allocate the %d x %d disk mask\n", ny, nz);
+		free_rotor_disk(disk);
+		return -1;
+	}
+
+	const double y_first = -0.5 * (ny - 1) * dy;
+	double total = 0.0;
+	for (int iz = 0; iz < nz; iz++)
+	{
+		const double z = zbottom + (iz * dz) - zhub;
+		int first = -1;
+		int last = -1;
+		for (int iy = 0; iy < ny; iy++)
+		{
+			if (rotor_point_weight(y_first + (iy * dy), z, dy, dz, radius, area_weighted) > 0.0)
+			{
+				first = first < 0 ? iy : first;
+				last = iy;
+			}
+		}
+		if (first < 0)
+		{
+			continue;
+		}
+		rotor_disk_row_t *row = &disk->rows[disk->n_rows++];
+		row->iz = iz;
+		row->iy_first = first;
+		row->count = last - first + 1;
+		row->weight_offset = (size_t)disk->n_points;
+		for (int iy = first; iy <= last; iy++)
+		{
+			const double w = rotor_point_weight(y_first + (iy * dy), z, dy, dz, radius, area_weighted);
+			disk->weights[disk->n_points++] = w;
+			total += w;
+		}
+	}
+
+	if (total <= 0.0)
+	{
+		const int iy = (int)fmin(fmax(floor((-y_first / dy) + 0.5), 0.0), ny - 1.0);
+		const int iz = (int)fmin(fmax(floor(((zhub - zbottom) / dz) + 0.5), 0.0), nz - 1.0);
+		disk->rows[0] = (rotor_disk_row_t){.iz = iz, .iy_first = iy, .count = 1, .weight_offset = 0};
+		disk->n_rows = 1;
+		disk->weights[0] = 1.0;
+		disk->n_points = 1;
+		return 0;
+	}
+	for (int p = 0; p < disk->n_points; p++)
+	{
+		disk->weights[p] /= total;
+	}
+	return 0;
+}
+
+/**
+ * @brief Weighted mean of the velocity magnitude over the disk for one time step.
+ *
+ * Each row is one contiguous run of interleaved (u, v, w) samples with its own contiguous
+ * weights, and the inner loop has no branches, so the compiler can vectorise it.
+ */
+static double rotor_average_step(const int16_t *restrict step, const int ny, const rotor_disk_t *disk, const double *restrict inv_slope, const double *restrict offset)
+{
+	double sum = 0.0;
+	for (int r = 0; r < disk->n_rows; r++)
+	{
+		const rotor_disk_row_t *row = &disk->rows[r];
+		const int16_t *restrict p = step + ((((size_t)row->iz * (size_t)ny) + (size_t)row->iy_first) * BTS_COMPONENTS);
+		const double *restrict w = disk->weights + row->weight_offset;
+		double row_sum = 0.0;
+		for (int k = 0; k < row->count; k++)
+		{
+			const double u = ((double)p[(BTS_COMPONENTS * k) + 0] - offset[0]) * inv_slope[0];
+			const double v = ((double)p[(BTS_COMPONENTS * k) + 1] - offset[1]) * inv_slope[1];
+			const double x = ((double)p[(BTS_COMPONENTS * k) + 2] - offset[2]) * inv_slope[2];
+			row_sum += w[k] * sqrt((u * u) + (v * v) + (x * x));
+		}
+		sum += row_sum;
+	}
+	return sum;
+}
+
+/**
+ * @brief Computes the rotor-effective wind speed of every time step of a TurbSim full-field file.
+ *
+ * The disk of `radius_m` is centred on the hub (y = 0, z = hub height from the header). Each point
+ * inside counts equally, or with `area_weighted` by the part of its grid cell inside the disk, and
+ * the result is the weighted mean velocity magnitude, the same quantity as the hub-point series of
+ * `u_mag_velocity_for_y_z_position`. The file is read in chunks of `BTS_ROTOR_AVERAGE_CHUNK_STEPS`
+ * steps, so memory is one chunk plus the output series.
+ *
+ * @param path         .bts file.
+ * @param radius_m     Rotor radius in m.
+ * @param area_weighted Weight points by their cell area inside the disk instead of equally.
+ * @param out_series   Receives a malloc'ed array of `*out_n_steps` speeds; the caller frees it.
+ * @param out_n_steps  Receives the number of time steps read.
+ * @param out_dt       Receives the time step of the file.
+ * @return 0 on success, -1 on error (reported).
+ */
+int bts_rotor_average_series(const char *path, const double radius_m, const bool area_weighted, double **out_series, int *out_n_steps, double *out_dt)
+{
+	*out_series = NULL;
+	*out_n_steps = 0;
+	if (radius_m <= 0.0)
+	{
+		ERROR_MESSAGE("Rotor average: radius must be positive, got %g\n", radius_m);
+		return -1;
+	}
+	FILE *file = fopen(path, "rb"); // NOLINT(cert-err33-c)
+	if (!file)
+	{
+		ERROR_MESSAGE("Rotor average: cannot open %s: %s\n", path, safe_strerror(errno));
+		return -1;
+	}
+
+	int status = -1;
+	rotor_disk_t disk = {0};
+	int16_t *chunk = NULL;
+	double *series = NULL;
+
+	bts_header_t header;
+	if (bts_read_header(file, path, &header) != 0)
+	{
+		goto cleanup;
+	}
+	const int nz = header.nz;
+	const int ny = header.ny;
+	const int ntwr = header.ntwr;
+	const int nt = header.nt;
+	const double dz = header.dz;
+	const double dy = header.dy;
+	const double dt = header.dt;
+	const double zhub = header.zhub;
+	const double zbottom = header.zbottom;
+	double inv_slope[BTS_COMPONENTS];
+	double offset[BTS_COMPONENTS];
+	for (int c = 0; c < BTS_COMPONENTS; c++)
+	{
+		inv_slope[c] = 1.0 / header.slope[c];
+		offset[c] = header.offset[c];
+	}
+	// the disk weights need a real grid spacing, the single-point readers do not
+	if (dy <= 0.0 || dz <= 0.0)
+	{
+		ERROR_MESSAGE("Rotor average: %s has a non-positive grid spacing (dy %g, dz %g)\n", path, dy, dz);
+		goto cleanup;
+	}
+	if (build_rotor_disk(&disk, ny, nz, dy, dz, zhub, zbottom, radius_m, area_weighted) != 0)
+	{
+		goto cleanup;
+	}
+
+	const size_t step_values = (((size_t)nz * (size_t)ny) + (size_t)ntwr) * BTS_COMPONENTS;
+	chunk = malloc((size_t)BTS_ROTOR_AVERAGE_CHUNK_STEPS * step_values * sizeof(int16_t));
+	series = malloc((size_t)nt * sizeof(double));
+	if (!chunk || !series)
+	{
+		ERROR_MESSAGE("Rotor average: failed to allocate buffers for %d steps\n", nt);
+		goto cleanup;
+	}
+
+	int steps_read = 0;
+	while (steps_read < nt)
+	{
+		const int want = nt - steps_read < BTS_ROTOR_AVERAGE_CHUNK_STEPS ? nt - steps_read : BTS_ROTOR_AVERAGE_CHUNK_STEPS;
+		const size_t got = fread(chunk, step_values * sizeof(int16_t), (size_t)want, file);
+		if (got == 0)
+		{
+			if (ferror(file))
+			{
+				ERROR_MESSAGE("Rotor average: read error in %s: %s\n", path, safe_strerror(errno));
+				goto cleanup;
+			}
+			break; // shorter than the header claims: the series ends at the last complete step
+		}
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		for (size_t i = 0; i < got * step_values; i++)
+		{
+			chunk[i] = bts_le_i16((const unsigned char *)&chunk[i]);
+		}
+#endif
+		for (size_t s = 0; s < got; s++)
+		{
+			series[steps_read + (int)s] = rotor_average_step(&chunk[s * step_values], ny, &disk, inv_slope, offset);
+		}
+		steps_read += (int)got;
+	}
+	if (steps_read == 0)
+	{
+		ERROR_MESSAGE("Rotor average: %s holds no complete time step\n", path);
+		goto cleanup;
+	}
+
+	log_message("Rotor average: %s, %d x %d grid, %d of %d points inside R = %g m (%s), %d steps at %g s\n", path, ny, nz, disk.n_points, ny * nz, radius_m, area_weighted ? "area weighted" : "equal weights", steps_read, dt);
+	*out_series = series;
+	*out_n_steps = steps_read;
+	*out_dt = dt;
+	series = NULL;
+	status = 0;
+
+cleanup:
+	free(series);
+	free(chunk);
+	free_rotor_disk(&disk);
+	if (fclose(file) == EOF)
+	{
+		ERROR_MESSAGE("Rotor average: error closing %s: %s\n", path, safe_strerror(errno));
+	}
+	return status;
+}
@@ -0,0 +1,521 @@
+/**
+ * @file    checkpoint.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Binary checkpoint of a running simulation and restart from it
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN(llvm-include-order)
+#include "checkpoint.h"
+#include "history_ring.h"           // for get_history_ring_states, restore_history_ring_states
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "param_index.h"            // for get_param_handle, param_from_handle
+#include "xfe_control_sim_common.h" // for get_param_string_or_default
+#include "xflow_aero_sim.h"         // for param_array_t, input_param_t
+#include "xflow_core.h"             // for safe_snprintf, safe_strerror
+#include <errno.h>                  // for errno
+#include <math.h>                   // for fabs
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stdint.h>                 // for uint8_t, uint32_t, uint64_t, int32_t, int64_t
+#include <stdio.h>                  // for FILE, fopen, fread, fwrite, fseek, ftell, rename, remove
+#include <stdlib.h>                 // for malloc, realloc, free
+#include <string.h>                 // for memcmp, memcpy, memset, strcmp, strlen
+
+#ifdef _WIN32
+#include <windows.h> // for MoveFileExA
+#include <process.h> // for _getpid
+#else
+#include <limits.h> // for PATH_MAX
+#include <unistd.h> // for getpid
+#endif
+// NOLINTEND(llvm-include-order)
+
+#ifdef _WIN32
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif
+#endif
+
+#define FNV64_OFFSET 14695981039346656037ULL
+#define FNV64_PRIME 1099511628211ULL
+#define CHECKPOINT_ALIGN 8
+#define CHECKPOINT_INITIAL_CAPACITY 4096
+
+// Dynamic parameters that describe the process rather than the simulation; a restart keeps its own.
+static const char *const checkpointSkippedParams[] = {"parent_pid", "data_processing_status"};
+
+typedef struct
+{
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+	bool failed;
+} checkpoint_writer_t;
+
+typedef struct
+{
+	const unsigned char *data;
+	size_t size;
+	size_t pos;
+	bool failed;
+} checkpoint_reader_t;
+
+static uint64_t fnv1a64(uint64_t h, const void *data, const size_t n)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	for (size_t i = 0; i < n; i++)
+	{
+		h ^= p[i];
+		h *= FNV64_PRIME;
+	}
+	return h;
+}
+
+static void put_bytes(checkpoint_writer_t *writer, const void *bytes, const size_t n)
+{
+	if (writer->failed)
+	{
+		return;
+	}
+	if (writer->size + n > writer->capacity)
+	{
+		size_t capacity = writer->capacity ? writer->capacity : CHECKPOINT_INITIAL_CAPACITY;
+		while (writer->size + n > capacity)
+		{
+			capacity *= 2;
+		}
+		unsigned char *data = realloc(writer->data, capacity);
+		if (!data)
+		{
+			writer->failed = true;
+			return;
+		}
+		writer->data = data;
+		writer->capacity = capacity;
+	}
+	if (bytes)
+	{
+		memcpy(writer->data + writer->size, bytes, n);
+	}
+	else
+	{
+		memset(writer->data + writer->size, 0, n);
+	}
+	writer->size += n;
+}
+
+/**
+ * @brief Writes a length-prefixed, NUL-terminated name padded to 8 bytes, so the values after it stay aligned.
+ */
+static void put_name(checkpoint_writer_t *writer, const char *name)
+{
+	const uint32_t n = (uint32_t)strlen(name) + 1U;
+	const uint32_t padded = (n + CHECKPOINT_ALIGN - 1U) & ~(uint32_t)(CHECKPOINT_ALIGN - 1U);
+	put_bytes(writer, &padded, sizeof(padded));
+	put_bytes(writer, NULL, sizeof(uint32_t)); // keeps the name on an 8-byte boundary
+	put_bytes(writer, name, n);
+	put_bytes(writer, NULL, padded - n);
+}
+
+static const void *get_bytes(checkpoint_reader_t *reader, const size_t n)
+{
+	if (reader->failed || n > reader->size - reader->pos)
+	{
+		reader->failed = true;
+		return NULL;
+	}
+	const void *bytes = reader->data + reader->pos;
+	reader->pos += n;
+	return bytes;
+}
+
+static bool get_value(checkpoint_reader_t *reader, void *out, const size_t n)
+{
+	const void *bytes = get_bytes(reader, n);
+	if (!bytes)
+	{
+		return false;
+	}
+	memcpy(out, bytes, n);
+	return true;
+}
+
+static const char *get_name(checkpoint_reader_t *reader)
+{
+	uint32_t padded = 0;
+	uint32_t reserved = 0;
+	if (!get_value(reader, &padded, sizeof(padded)) || !get_value(reader, &reserved, sizeof(reserved)) || padded == 0)
+	{
+		reader->failed = true;
+		return NULL;
+	}
+	const char *name = get_bytes(reader, padded);
+	if (!name || memchr(name, '\0', padded) == NULL)
+	{
+		reader->failed = true;
+		return NULL;
+	}
+	return name;
+}
+
+static bool is_checkpointed_param(const input_param_t *param)
+{
+	if (param->type != INPUT_PARAM_DOUBLE && param->type != INPUT_PARAM_INT)
+	{
+		return false; // strings name files and shared segments of the writing process
+	}
+	for (size_t i = 0; i < sizeof(checkpointSkippedParams) / sizeof(checkpointSkippedParams[0]); i++)
+	{
+		if (strcmp(param->name, checkpointSkippedParams[i]) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Resolves `checkpoint_file` (default `CHECKPOINT_DEFAULT_FILE`); relative names go in the log directory.
+ *
+ * @return 0 on success, -1 if the path does not fit.
+ */
+int checkpoint_file_path(const param_array_t *fixed_data, char *out, const size_t out_size)
+{
+	const char *name = get_param_string_or_default(fixed_data, "checkpoint_file", CHECKPOINT_DEFAULT_FILE);
+#ifdef OUTPUT_LOG_FILE_PATH
+	if (name[0] != '/' && !(name[0] != '\0' && name[1] == ':'))
+	{
+		return safe_snprintf(out, out_size, "%s/%s", OUTPUT_LOG_FILE_PATH, name) < 0 ? -1 : 0;
+	}
+#endif
+	return safe_snprintf(out, out_size, "%s", name) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Writes the simulation state reached at the current tick of `schedule` to `path`.
+ *
+ * Saves the numeric dynamic parameters (state variables, controller outputs, `time_sec`,
+ * `total_loop_count`, ...), the integrator's multistep history and the history rings.
+ * The flow series needs nothing extra since every flow_gen samples it from `time_sec`.
+ * The file is written under a temporary name and renamed into place, so sweep workers
+ * reading it never see a partial checkpoint.
+ *
+ * @return 0 on success, -1 on error (the run continues).
+ */
+int save_checkpoint(const char *path, const param_array_t *dynamic_data, const numerical_integrator_workspace_t *workspace, const stage_schedule_t *schedule)
+{
+	checkpoint_writer_t writer = {0};
+	checkpoint_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+	header.version = CHECKPOINT_VERSION;
+	header.header_size = sizeof(checkpoint_header_t);
+	header.dt_sec = schedule->base_dt_sec;
+	header.start_time_sec = schedule->start_time_sec;
+	header.tick = schedule->tick;
+	header.time_sec = schedule->start_time_sec + ((double)schedule->tick * schedule->base_dt_sec);
+
+	for (int i = 0; i < dynamic_data->n_param; i++)
+	{
+		const input_param_t *param = &dynamic_data->params[i];
+		if (!is_checkpointed_param(param))
+		{
+			continue;
+		}
+		const int32_t type = (int32_t)param->type;
+		const int64_t int_value = param->value.i;
+		put_name(&writer, param->name);
+		put_bytes(&writer, &type, sizeof(type));
+		put_bytes(&writer, NULL, sizeof(int32_t));
+		put_bytes(&writer, param->type == INPUT_PARAM_DOUBLE ? (const void *)&param->value.d : (const void *)&int_value, sizeof(double));
+		header.n_params++;
+	}
+
+	const int32_t n_state_var = workspace ? workspace->n_state_var : 0;
+	const int32_t first_call = workspace ? workspace->first_call : 1;
+	const double adaptive_dt = workspace ? workspace->adaptive_dt : 0.0;
+	put_bytes(&writer, &n_state_var, sizeof(n_state_var));
+	put_bytes(&writer, &first_call, sizeof(first_call));
+	put_bytes(&writer, &adaptive_dt, sizeof(adaptive_dt));
+	if (n_state_var > 0)
+	{
+		put_bytes(&writer, workspace->prev_dx, (size_t)n_state_var * sizeof(double));
+	}
+
+	history_ring_state_t *rings = NULL;
+	const int n_rings = get_history_ring_states(&rings);
+	for (int r = 0; r < n_rings; r++)
+	{
+		const int32_t layout[4] = {rings[r].head, rings[r].count, rings[r].capacity, 0};
+		put_name(&writer, rings[r].name);
+		put_bytes(&writer, &rings[r].every_n_ticks, sizeof(int64_t));
+		put_bytes(&writer, &rings[r].next_due_tick, sizeof(int64_t));
+		put_bytes(&writer, layout, sizeof(layout));
+		put_bytes(&writer, rings[r].data, (size_t)rings[r].capacity * sizeof(double));
+	}
+	free(rings);
+	if (n_rings < 0 || writer.failed)
+	{
+		ERROR_MESSAGE("Checkpoint: could not build the checkpoint for %s\n", path);
+		free(writer.data);
+		return -1;
+	}
+	header.n_rings = (uint32_t)n_rings;
+	header.body_bytes = writer.size;
+	header.checksum = fnv1a64(FNV64_OFFSET, writer.data, writer.size);
+
+	char tmp_path[PATH_MAX];
+#ifdef _WIN32
+	const int pid = _getpid();
+#else
+	const int pid = (int)getpid();
+#endif
+	if (safe_snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", path, pid) < 0)
+	{
+		free(writer.data);
+		return -1;
+	}
+	FILE *file = fopen(tmp_path, "wb"); // NOLINT(cert-err33-c)
+	if (!file)
+	{
+		ERROR_MESSAGE("Checkpoint: cannot write %s: %s\n", tmp_path, safe_strerror(errno));
+		free(writer.data);
+		return -1;
+	}
+	int ok = fwrite(&header, sizeof(header), 1, file) == 1 && (writer.size == 0 || fwrite(writer.data, writer.size, 1, file) == 1);
+	free(writer.data);
+	if (fclose(file) == EOF)
+	{
+		ok = 0;
+	}
+
+#ifdef _WIN32
+	if (ok && !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+#else
+	if (ok && rename(tmp_path, path) != 0)
+#endif
+	{
+		ok = 0;
+	}
+	if (!ok)
+	{
+		ERROR_MESSAGE("Checkpoint: failed to store %s\n", path);
+		if (remove(tmp_path) != 0)
+		{
+			ERROR_MESSAGE("Checkpoint: could not remove %s\n", tmp_path);
+		}
+		return -1;
+	}
+
+	log_message("Checkpoint written: %s at time_sec %g (tick %lld, %u parameters, %d history rings)\n", path, header.time_sec, (long long)header.tick, header.n_params, n_rings);
+	return 0;
+}
+
+/**
+ * @brief Reads all of `path` into one 8-byte aligned allocation.
+ */
+static unsigned char *read_checkpoint_file(const char *path, size_t *out_size)
+{
+	FILE *file = fopen(path, "rb"); // NOLINT(cert-err33-c)
+	if (!file)
+	{
+		ERROR_MESSAGE("Checkpoint: cannot open %s: %s\n", path, safe_strerror(errno));
+		return NULL;
+	}
+	long size = -1;
+	if (fseek(file, 0, SEEK_END) == 0)
+	{
+		size = ftell(file);
+	}
+	unsigned char *data = NULL;
+	if (size >= (long)sizeof(checkpoint_header_t) && fseek(file, 0, SEEK_SET) == 0)
+	{
+		data = malloc((size_t)size);
+		if (data && fread(data, 1, (size_t)size, file) != (size_t)size)
+		{
+			free(data);
+			data = NULL;
+		}
+	}
+	if (fclose(file) == EOF || !data)
+	{
+		ERROR_MESSAGE("Checkpoint: error reading %s\n", path);
+		free(data);
+		return NULL;
+	}
+	*out_size = (size_t)size;
+	return data;
+}
+
+/**
+ * @brief Restores a checkpoint written by `save_checkpoint()` into the current run.
+ *
+ * Call after `initialize_control_system()` and `control_switch()`, before the main loop. Saved
+ * parameters overwrite the ones of the same name; parameters the config no longer has are
+ * reported and skipped. History rings are put back now or, for rings whose stage has not run
+ * yet, when the stage registers them. `position` goes to `resume_stage_schedule()` once the
+ * loop's schedule is initialised.
+ *
+ * @param dt_sec  Base step of this run; it must match the checkpoint's.
+ * @return 0 on success, -1 (with `shutdownFlag` set) if the file is missing, corrupt or incompatible.
+ */
+int load_checkpoint(const char *path, const param_array_t *dynamic_data, numerical_integrator_workspace_t *workspace, const double dt_sec, checkpoint_position_t *position)
+{
+	size_t size = 0;
+	unsigned char *data = read_checkpoint_file(path, &size);
+	if (!data)
+	{
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	checkpoint_header_t header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE) != 0 || header.version != CHECKPOINT_VERSION || header.header_size != sizeof(checkpoint_header_t) || header.body_bytes != size - sizeof(checkpoint_header_t))
+	{
+		ERROR_MESSAGE("Checkpoint: %s is not a version %u checkpoint\n", path, CHECKPOINT_VERSION);
+		free(data);
+		shutdownFlag = 1;
+		return -1;
+	}
+	if (fnv1a64(FNV64_OFFSET, data + header.header_size, header.body_bytes) != header.checksum)
+	{
+		ERROR_MESSAGE("Checkpoint: %s failed its checksum\n", path);
+		free(data);
+		shutdownFlag = 1;
+		return -1;
+	}
+	if (fabs(header.dt_sec - dt_sec) > 1e-12 * dt_sec)
+	{
+		ERROR_MESSAGE("Checkpoint: %s was taken with dt_sec %g, this run uses %g\n", path, header.dt_sec, dt_sec);
+		free(data);
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	checkpoint_reader_t reader = {.data = data + header.header_size, .size = header.body_bytes};
+	int n_missing = 0;
+	for (uint32_t p = 0; p < header.n_params && !reader.failed; p++)
+	{
+		const char *name = get_name(&reader);
+		int32_t type = 0;
+		int32_t reserved = 0;
+		unsigned char value[sizeof(double)];
+		if (!name || !get_value(&reader, &type, sizeof(type)) || !get_value(&reader, &reserved, sizeof(reserved)) || !get_value(&reader, value, sizeof(value)))
+		{
+			break;
+		}
+		input_param_t *param = param_from_handle(dynamic_data, get_param_handle(dynamic_data, name));
+		if (!param || !is_checkpointed_param(param))
+		{
+			n_missing++;
+			continue;
+		}
+		if ((int32_t)param->type != type)
+		{
+			ERROR_MESSAGE("Checkpoint: '%s' changed type since %s was written\n", name, path);
+			free(data);
+			shutdownFlag = 1;
+			return -1;
+		}
+		if (param->type == INPUT_PARAM_DOUBLE)
+		{
+			memcpy(&param->value.d, value, sizeof(double));
+		}
+		else
+		{
+			int64_t int_value = 0;
+			memcpy(&int_value, value, sizeof(int_value));
+			param->value.i = (int)int_value;
+		}
+	}
+
+	int32_t n_state_var = 0;
+	int32_t first_call = 1;
+	double adaptive_dt = 0.0;
+	get_value(&reader, &n_state_var, sizeof(n_state_var));
+	get_value(&reader, &first_call, sizeof(first_call));
+	get_value(&reader, &adaptive_dt, sizeof(adaptive_dt));
+	const double *prev_dx = n_state_var > 0 ? get_bytes(&reader, (size_t)n_state_var * sizeof(double)) : NULL;
+	if (!reader.failed && workspace)
+	{
+		if (n_state_var != workspace->n_state_var)
+		{
+			ERROR_MESSAGE("Checkpoint: %s holds %d state variables, this run has %d\n", path, n_state_var, workspace->n_state_var);
+			free(data);
+			shutdownFlag = 1;
+			return -1;
+		}
+		if (prev_dx)
+		{
+			memcpy(workspace->prev_dx, prev_dx, (size_t)n_state_var * sizeof(double));
+		}
+		workspace->first_call = first_call != 0;
+		workspace->adaptive_dt = adaptive_dt;
+	}
+
+	history_ring_state_t *rings = header.n_rings > 0 ? calloc(header.n_rings, sizeof(history_ring_state_t)) : NULL;
+	if (header.n_rings > 0 && !rings)
+	{
+		reader.failed = true;
+	}
+	for (uint32_t r = 0; r < header.n_rings && !reader.failed; r++)
+	{
+		int32_t layout[4] = {0};
+		rings[r].name = get_name(&reader);
+		get_value(&reader, &rings[r].every_n_ticks, sizeof(int64_t));
+		get_value(&reader, &rings[r].next_due_tick, sizeof(int64_t));
+		get_value(&reader, layout, sizeof(layout));
+		rings[r].head = layout[0];
+		rings[r].count = layout[1];
+		rings[r].capacity = layout[2];
+		rings[r].data = layout[2] > 0 ? get_bytes(&reader, (size_t)layout[2] * sizeof(double)) : NULL;
+		if (!rings[r].data)
+		{
+			reader.failed = true;
+		}
+	}
+	if (reader.failed || reader.pos != reader.size)
+	{
+		ERROR_MESSAGE("Checkpoint: %s is truncated or malformed\n", path);
+		free(rings);
+		free(data);
+		shutdownFlag = 1;
+		return -1;
+	}
+	const int ring_status = restore_history_ring_states(rings, (int)header.n_rings, header.tick);
+	free(rings);
+	free(data);
+	if (ring_status != 0)
+	{
+		return -1;
+	}
+
+	position->start_time_sec = header.start_time_sec;
+	position->tick = header.tick;
+	if (n_missing > 0)
+	{
+		log_message("Checkpoint: %d saved parameters are not in this config and were skipped\n", n_missing);
+	}
+	log_message("Checkpoint restored: %s at time_sec %g (tick %lld)\n", path, header.time_sec, (long long)header.tick);
+	return 0;
+}
@@ -0,0 +1,725 @@
+/**
+ * @file    config_snapshot.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Parsed configuration published once in shared memory, with run-time overrides layered on top
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN(llvm-include-order)
+#include "config_snapshot.h"
+#include "flow_shmem.h"     // for flow_shmem_make_name
+#include "logger.h"         // for log_message, ERROR_MESSAGE
+#include "param_index.h"    // for get_param_handle, param_from_handle, invalidate_param_index
+#include "shmem_segment.h"  // for shmem_segment_create, shmem_segment_close, shmem_word_checksum
+#include "xflow_aero_sim.h" // for read_csv_and_store, add_param, create_input_data, free_input_data
+#include "xflow_core.h"     // for safe_snprintf, safe_strerror, shutdownFlag
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stddef.h>         // for size_t, NULL
+#include <stdint.h>         // for uint64_t
+#include <stdlib.h>         // for calloc, realloc, free, getenv, setenv, unsetenv
+#include <string.h>         // for memcpy, memcmp, strcmp, strlen
+
+#ifdef _WIN32
+#include <windows.h> // for OpenFileMappingA, MapViewOfFile, VirtualQuery
+#else
+#include <errno.h>    // for errno
+#include <fcntl.h>    // for O_RDONLY
+#include <sys/mman.h> // for shm_open, shm_unlink, mmap, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close, getpid
+#endif
+// NOLINTEND(llvm-include-order)
+
+/**
+ * @brief One configuration value held by this process: a parsed row or an override.
+ */
+typedef struct
+{
+	char *name;
+	input_param_type_t type;
+	bool dynamic;
+	bool is_state_var;
+	int i;
+	double d;
+	char *s;
+} config_value_t;
+
+// The configuration as parsed by the publishing process, with overrides applied. Kept apart
+// from the live arrays, which the simulation changes as it runs.
+static config_value_t *baseConfig = NULL;
+static int nBaseConfig = 0;
+static long publisherPid = 0; // a forked child inherits the copy but must not publish or remove segments
+// Overrides set before load_config(); applied to this process's arrays when they are loaded.
+static config_value_t *pendingOverrides = NULL;
+static int nPendingOverrides = 0;
+static bool configLoaded = false;
+
+// Each publish creates a new, never modified segment `<prefix>_<pid>_<generation>`. Earlier
+// generations stay until unpublish_config_snapshot(): a child started against one may not
+// have mapped it yet.
+static char snapshotName[CONFIG_SNAPSHOT_NAME_MAX] = "";     // latest generation, exported to children
+static char snapshotBaseName[CONFIG_SNAPSHOT_NAME_MAX] = ""; // `<prefix>_<pid>`
+static unsigned snapshotGeneration = 0;                     // generations 1..snapshotGeneration exist
+#ifdef _WIN32
+static shmem_segment_t *snapshotSegments = NULL; // one per generation; a segment lives as long as its handle is open
+#endif
+
+static long current_process_id(void)
+{
+#ifdef _WIN32
+	return (long)GetCurrentProcessId();
+#else
+	return (long)getpid();
+#endif
+}
+
+static char *copy_string(const char *text)
+{
+	const size_t len = text ? strlen(text) : 0;
+	char *copy = malloc(len + 1);
+	if (copy)
+	{
+		if (len > 0)
+		{
+			memcpy(copy, text, len);
+		}
+		copy[len] = '\0';
+	}
+	return copy;
+}
+
+/**
+ * @brief Stores `value` (an `int *`, a `double *` or the `char *` itself, as for `update_csv_value`) in `target`.
+ *
+ * @return 0 on success, -1 on allocation failure or an unsupported type.
+ */
+static int assign_config_value(config_value_t *target, const input_param_type_t type, const void *value)
+{
+	target->type = type;
+	switch (type)
+	{
+	case INPUT_PARAM_INT:
+		target->i = *(const int *)value;
+		return 0;
+	case INPUT_PARAM_DOUBLE:
+		target->d = *(const double *)value;
+		return 0;
+	case INPUT_PARAM_STRING:
+	{
+		char *copy = copy_string((const char *)value);
+		if (!copy)
+		{
+			return -1;
+		}
+		free(target->s);
+		target->s = copy;
+		return 0;
+	}
+	default:
+		return -1;
+	}
+}
+
+static void free_config_values(config_value_t *values, const int n_values)
+{
+	for (int k = 0; k < n_values; k++)
+	{
+		free(values[k].name);
+		free(values[k].s);
+	}
+	free(values);
+}
+
+static config_value_t *find_config_value(config_value_t *values, const int n_values, const char *name)
+{
+	for (int k = 0; k < n_values; k++)
+	{
+		if (strcmp(values[k].name, name) == 0)
+		{
+			return &values[k];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Writes a value into the live parameter of the same name, adding the parameter if the array lacks it.
+ *
+ * @return 0 on success, -1 on a type mismatch or allocation failure (error logged).
+ */
+static int store_in_param_array(param_array_t *data, const config_value_t *value)
+{
+	input_param_t *param = param_from_handle(data, get_param_handle(data, value->name));
+	if (!param)
+	{
+		const void *raw = value->type == INPUT_PARAM_INT ? (const void *)&value->i : value->type == INPUT_PARAM_DOUBLE ? (const void *)&value->d : (const void *)value->s;
+		add_param(data, value->name, value->type, (void *)raw);
+		param = &data->params[data->n_param - 1];
+		param->is_state_var = value->is_state_var;
+		return 0;
+	}
+	if (param->type != value->type)
+	{
+		ERROR_MESSAGE("Config value %s has type %d, the parameter has type %d\n", value->name, (int)value->type, (int)param->type);
+		return -1;
+	}
+	switch (value->type)
+	{
+	case INPUT_PARAM_INT:
+		param->value.i = value->i;
+		break;
+	case INPUT_PARAM_DOUBLE:
+		param->value.d = value->d;
+		break;
+	default:
+	{
+		char *copy = copy_string(value->s);
+		if (!copy)
+		{
+			ERROR_MESSAGE("Failed to copy config value %s\n", value->name);
+			return -1;
+		}
+		free(param->value.s);
+		param->value.s = copy;
+		break;
+	}
+	}
+	return 0;
+}
+
+/**
+ * @brief Applies the overrides set before loading to the live arrays (fixed first, then dynamic).
+ */
+static void apply_pending_overrides(param_array_t *dynamic_data, param_array_t *fixed_data)
+{
+	for (int k = 0; k < nPendingOverrides; k++)
+	{
+		const config_value_t *override = &pendingOverrides[k];
+		param_array_t *target = get_param_handle(fixed_data, override->name) != PARAM_HANDLE_INVALID ? fixed_data : NULL;
+		if (!target && get_param_handle(dynamic_data, override->name) != PARAM_HANDLE_INVALID)
+		{
+			target = dynamic_data;
+		}
+		if (!target)
+		{
+			ERROR_MESSAGE("Config override %s names no configured parameter\n", override->name);
+			continue;
+		}
+		store_in_param_array(target, override);
+	}
+}
+
+/**
+ * @brief Copies the freshly loaded arrays into `baseConfig`, the source of every published snapshot.
+ */
+static int capture_base_config(const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	const int n_values = fixed_data->n_param + dynamic_data->n_param;
+	config_value_t *values = calloc((size_t)n_values, sizeof(config_value_t));
+	if (!values)
+	{
+		ERROR_MESSAGE("Failed to allocate %d config values\n", n_values);
+		return -1;
+	}
+	for (int k = 0; k < n_values; k++)
+	{
+		const bool dynamic = k >= fixed_data->n_param;
+		const input_param_t *param = dynamic ? &dynamic_data->params[k - fixed_data->n_param] : &fixed_data->params[k];
+		values[k].name = copy_string(param->name);
+		values[k].dynamic = dynamic;
+		values[k].is_state_var = param->is_state_var;
+		const void *raw = param->type == INPUT_PARAM_INT ? (const void *)&param->value.i : param->type == INPUT_PARAM_DOUBLE ? (const void *)&param->value.d : (const void *)param->value.s;
+		if (!values[k].name || assign_config_value(&values[k], param->type, raw) != 0)
+		{
+			ERROR_MESSAGE("Failed to copy config value %s\n", param->name ? param->name : "(unnamed)");
+			free_config_values(values, n_values);
+			return -1;
+		}
+	}
+	baseConfig = values;
+	nBaseConfig = n_values;
+	publisherPid = current_process_id();
+	return 0;
+}
+
+static size_t padded_string_size(const char *text)
+{
+	return ((strlen(text) + 1 + 7) / 8) * 8;
+}
+
+/**
+ * @brief Lays `baseConfig` out as a segment image: header, entries, string pool.
+ *
+ * @return Heap buffer of `*out_total` bytes, or NULL on allocation failure.
+ */
+static unsigned char *serialize_base_config(size_t *out_total)
+{
+	size_t total = sizeof(config_snapshot_header_t) + ((size_t)nBaseConfig * sizeof(config_snapshot_entry_t));
+	for (int k = 0; k < nBaseConfig; k++)
+	{
+		total += padded_string_size(baseConfig[k].name);
+		if (baseConfig[k].type == INPUT_PARAM_STRING)
+		{
+			total += padded_string_size(baseConfig[k].s);
+		}
+	}
+
+	unsigned char *image = calloc(1, total);
+	if (!image)
+	{
+		return NULL;
+	}
+	config_snapshot_header_t *header = (config_snapshot_header_t *)image;
+	config_snapshot_entry_t *entries = (config_snapshot_entry_t *)(image + sizeof(config_snapshot_header_t));
+	uint64_t offset = sizeof(config_snapshot_header_t) + ((uint64_t)nBaseConfig * sizeof(config_snapshot_entry_t));
+	for (int k = 0; k < nBaseConfig; k++)
+	{
+		const config_value_t *value = &baseConfig[k];
+		entries[k].name_offset = offset;
+		memcpy(image + offset, value->name, strlen(value->name));
+		offset += padded_string_size(value->name);
+		if (value->type == INPUT_PARAM_STRING)
+		{
+			entries[k].string_offset = offset;
+			memcpy(image + offset, value->s, strlen(value->s));
+			offset += padded_string_size(value->s);
+		}
+		entries[k].d = value->d;
+		entries[k].i = value->i;
+		entries[k].type = (int32_t)value->type;
+		entries[k].dynamic = value->dynamic ? 1U : 0U;
+		entries[k].is_state_var = value->is_state_var ? 1U : 0U;
+	}
+
+	header->version = CONFIG_SNAPSHOT_VERSION;
+	header->header_size = sizeof(config_snapshot_header_t);
+	header->n_entries = (uint32_t)nBaseConfig;
+	header->entry_size = sizeof(config_snapshot_entry_t);
+	header->total_bytes = total;
+	header->checksum = shmem_word_checksum(image + sizeof(config_snapshot_header_t), total - sizeof(config_snapshot_header_t));
+	memcpy(header->magic, CONFIG_SNAPSHOT_MAGIC, CONFIG_SNAPSHOT_MAGIC_SIZE);
+	*out_total = total;
+	return image;
+}
+
+/**
+ * @brief Removes every generation of the snapshot published by this process, if any.
+ */
+static void remove_published_snapshots(void)
+{
+	if (snapshotName[0] == '\0' || publisherPid != current_process_id())
+	{
+		return;
+	}
+#ifdef _WIN32
+	for (unsigned g = 0; g < snapshotGeneration; g++)
+	{
+		shmem_segment_close(&snapshotSegments[g]);
+	}
+	free(snapshotSegments);
+	snapshotSegments = NULL;
+#else
+	for (unsigned g = 1; g <= snapshotGeneration; g++)
+	{
+		char name[CONFIG_SNAPSHOT_NAME_MAX];
+		if (safe_snprintf(name, sizeof(name), "%s_%u", snapshotBaseName, g) >= 0 && shm_unlink(name) == -1)
+		{
+			ERROR_MESSAGE("shm_unlink %s failed: %s\n", name, safe_strerror(errno));
+		}
+	}
+#endif
+	snapshotName[0] = '\0';
+	snapshotGeneration = 0;
+}
+
+/**
+ * @brief Publishes `baseConfig` as a new segment and points `CONFIG_SNAPSHOT_ENV_NAME` at it.
+ *
+ * A published segment is never written again: an override publishes the next generation.
+ * The previous ones are kept, so a child exec'd against an earlier name can still map it;
+ * overrides are a handful per run, and `unpublish_config_snapshot()` removes them all.
+ */
+static int publish_config_snapshot(void)
+{
+	size_t total = 0;
+	unsigned char *image = serialize_base_config(&total);
+	if (!image)
+	{
+		ERROR_MESSAGE("Failed to allocate the config snapshot\n");
+		return -1;
+	}
+
+	if (snapshotGeneration == 0 && flow_shmem_make_name(snapshotBaseName, sizeof(snapshotBaseName), CONFIG_SNAPSHOT_DEFAULT_PREFIX) != 0)
+	{
+		free(image);
+		return -1;
+	}
+	char name[CONFIG_SNAPSHOT_NAME_MAX];
+	if (safe_snprintf(name, sizeof(name), "%s_%u", snapshotBaseName, snapshotGeneration + 1) < 0)
+	{
+		free(image);
+		return -1;
+	}
+#ifdef _WIN32
+	shmem_segment_t *segments = realloc(snapshotSegments, (size_t)(snapshotGeneration + 1) * sizeof(shmem_segment_t));
+	if (!segments)
+	{
+		ERROR_MESSAGE("Failed to track config snapshot %s\n", name);
+		free(image);
+		return -1;
+	}
+	snapshotSegments = segments;
+#endif
+
+	shmem_segment_t segment;
+	if (shmem_segment_create(name, total, &segment) != 0)
+	{
+		free(image);
+		return -1;
+	}
+	memcpy(segment.base, image, total);
+#ifdef _WIN32
+	snapshotSegments[snapshotGeneration] = segment;
+#else
+	shmem_segment_close(&segment);
+#endif
+	free(image);
+
+	snapshotGeneration++;
+	safe_snprintf(snapshotName, sizeof(snapshotName), "%s", name);
+#ifdef _WIN32
+	if (_putenv_s(CONFIG_SNAPSHOT_ENV_NAME, snapshotName) != 0)
+#else
+	if (setenv(CONFIG_SNAPSHOT_ENV_NAME, snapshotName, 1) != 0)
+#endif
+	{
+		ERROR_MESSAGE("Failed to export %s=%s\n", CONFIG_SNAPSHOT_ENV_NAME, snapshotName);
+	}
+	log_message("Published config snapshot of %d parameters (%zu bytes) in %s\n", nBaseConfig, total, snapshotName);
+	return 0;
+}
+
+/**
+ * @brief Checks the header, the entry and string bounds and the checksum of a mapped snapshot.
+ */
+static int validate_config_snapshot(const unsigned char *base, const size_t map_size, const char *segment_name)
+{
+	const config_snapshot_header_t *header = (const config_snapshot_header_t *)base;
+	if (memcmp(header->magic, CONFIG_SNAPSHOT_MAGIC, CONFIG_SNAPSHOT_MAGIC_SIZE) != 0 || header->version != CONFIG_SNAPSHOT_VERSION || header->header_size != sizeof(config_snapshot_header_t) ||
+	    header->entry_size != sizeof(config_snapshot_entry_t))
+	{
+		ERROR_MESSAGE("%s is not a version %u config snapshot\n", segment_name, CONFIG_SNAPSHOT_VERSION);
+		return -1;
+	}
+	const uint64_t table_end = sizeof(config_snapshot_header_t) + ((uint64_t)header->n_entries * sizeof(config_snapshot_entry_t));
+	if (header->total_bytes > map_size || table_end > header->total_bytes || header->total_bytes % sizeof(uint64_t) != 0 || (header->n_entries > 0 && base[header->total_bytes - 1] != '\0'))
+	{
+		ERROR_MESSAGE("%s: header claims %llu bytes, mapping has %zu\n", segment_name, (unsigned long long)header->total_bytes, map_size);
+		return -1;
+	}
+	const config_snapshot_entry_t *entries = (const config_snapshot_entry_t *)(base + sizeof(config_snapshot_header_t));
+	for (uint32_t k = 0; k < header->n_entries; k++)
+	{
+		const bool has_string = entries[k].type == INPUT_PARAM_STRING;
+		if (entries[k].name_offset < table_end || entries[k].name_offset >= header->total_bytes || (has_string && (entries[k].string_offset < table_end || entries[k].string_offset >= header->total_bytes)))
+		{
+			ERROR_MESSAGE("%s: entry %u lies outside the segment\n", segment_name, k);
+			return -1;
+		}
+	}
+	if (shmem_word_checksum(base + sizeof(config_snapshot_header_t), (size_t)header->total_bytes - sizeof(config_snapshot_header_t)) != header->checksum)
+	{
+		ERROR_MESSAGE("%s: checksum mismatch\n", segment_name);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Creates an empty parameter array prepared the way the `load_config()` callers prepare theirs.
+ */
+static param_array_t *create_scratch_param_array(void)
+{
+	param_array_t *data = create_input_data(1);
+	if (data)
+	{
+		set_int_param(data, 0, "initialize", 1);
+	}
+	return data;
+}
+
+/**
+ * @brief Frees an array from `create_scratch_param_array()` together with any index built for it.
+ */
+static void free_scratch_param_array(param_array_t *data)
+{
+	if (data)
+	{
+		invalidate_param_index(data);
+		free_input_data(data);
+	}
+}
+
+/**
+ * @brief Maps a published snapshot read-only, copies it into the arrays and unmaps it again.
+ *
+ * The entries are copied into scratch arrays first and swapped into @p dynamic_data and
+ * @p fixed_data only once all of them are stored, so a failure part-way leaves the arrays
+ * as they were for the CSV fallback.
+ *
+ * @return 0 on success, -1 if the snapshot is missing or invalid (the arrays are untouched).
+ */
+static int load_config_snapshot(const char *segment_name, param_array_t *dynamic_data, param_array_t *fixed_data)
+{
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, segment_name);
+	if (mapping == NULL)
+	{
+		ERROR_MESSAGE("OpenFileMapping %s failed: %ld\n", segment_name, GetLastError());
+		return -1;
+	}
+	void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); // the view keeps the section alive
+	if (base == NULL)
+	{
+		ERROR_MESSAGE("MapViewOfFile %s failed: %ld\n", segment_name, GetLastError());
+		return -1;
+	}
+	MEMORY_BASIC_INFORMATION info;
+	const size_t map_size = VirtualQuery(base, &info, sizeof(info)) ? info.RegionSize : 0;
+#else
+	const int fd = shm_open(segment_name, O_RDONLY, 0666);
+	if (fd == -1)
+	{
+		ERROR_MESSAGE("shm_open %s failed: %s\n", segment_name, safe_strerror(errno));
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(config_snapshot_header_t))
+	{
+		ERROR_MESSAGE("%s is too small to be a config snapshot\n", segment_name);
+		close(fd);
+		return -1;
+	}
+	const size_t map_size = (size_t)st.st_size;
+	void *base = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		ERROR_MESSAGE("mmap %s failed: %s\n", segment_name, safe_strerror(errno));
+		return -1;
+	}
+#endif
+
+	int rc = map_size >= sizeof(config_snapshot_header_t) ? validate_config_snapshot((const unsigned char *)base, map_size, segment_name) : -1;
+	param_array_t *scratch_dynamic = rc == 0 ? create_scratch_param_array() : NULL;
+	param_array_t *scratch_fixed = rc == 0 ? create_scratch_param_array() : NULL;
+	if (rc == 0 && (!scratch_dynamic || !scratch_fixed))
+	{
+		ERROR_MESSAGE("Failed to allocate parameter arrays for config snapshot %s\n", segment_name);
+		rc = -1;
+	}
+	if (rc == 0)
+	{
+		const unsigned char *bytes = (const unsigned char *)base;
+		const config_snapshot_header_t *header = (const config_snapshot_header_t *)base;
+		const config_snapshot_entry_t *entries = (const config_snapshot_entry_t *)(bytes + sizeof(config_snapshot_header_t));
+		for (uint32_t k = 0; k < header->n_entries && rc == 0; k++)
+		{
+			// the value points into the mapping; store_in_param_array copies what it keeps
+			const config_value_t value = {
+				.name = (char *)(bytes + entries[k].name_offset),
+				.type = (input_param_type_t)entries[k].type,
+				.dynamic = entries[k].dynamic != 0,
+				.is_state_var = entries[k].is_state_var != 0,
+				.i = entries[k].i,
+				.d = entries[k].d,
+				.s = entries[k].type == INPUT_PARAM_STRING ? (char *)(bytes + entries[k].string_offset) : NULL,
+			};
+			rc = store_in_param_array(value.dynamic ? scratch_dynamic : scratch_fixed, &value);
+		}
+	}
+	if (rc == 0)
+	{
+		// the scratch arrays take over the old contents and are freed with them
+		const param_array_t loaded_dynamic = *scratch_dynamic;
+		const param_array_t loaded_fixed = *scratch_fixed;
+		*scratch_dynamic = *dynamic_data;
+		*scratch_fixed = *fixed_data;
+		*dynamic_data = loaded_dynamic;
+		*fixed_data = loaded_fixed;
+		invalidate_param_index(dynamic_data);
+		invalidate_param_index(fixed_data);
+	}
+	free_scratch_param_array(scratch_dynamic);
+	free_scratch_param_array(scratch_fixed);
+
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	if (munmap(base, map_size) == -1)
+	{
+		ERROR_MESSAGE("munmap failed: %s\n", safe_strerror(errno));
+	}
+#endif
+	return rc;
+}
+
+/**
+ * @brief Fills the parameter arrays from the inherited config snapshot, or parses the CSV and publishes one.
+ *
+ * A process whose parent published a snapshot (`CONFIG_SNAPSHOT_ENV_NAME` is set) copies it
+ * from shared memory and never opens the CSV. Otherwise the CSV is parsed once, and the
+ * result is published for the children this process starts. In both cases the overrides
+ * set so far with `set_config_override()` are applied to the arrays.
+ *
+ * @param config_path   Configuration CSV, read only when no snapshot was inherited.
+ * @param dynamic_data  Dynamic parameter array, as prepared for `read_csv_and_store`.
+ * @param fixed_data    Fixed parameter array, as prepared for `read_csv_and_store`.
+ * @return 0 when loaded from the snapshot, 1 when parsed from the CSV, -1 (with `shutdownFlag` set) on failure.
+ */
+int load_config(const char *config_path, param_array_t *dynamic_data, param_array_t *fixed_data)
+{
+	const char *inherited = getenv(CONFIG_SNAPSHOT_ENV_NAME);
+	if (inherited && inherited[0] != '\0')
+	{
+		if (load_config_snapshot(inherited, dynamic_data, fixed_data) == 0)
+		{
+			apply_pending_overrides(dynamic_data, fixed_data);
+			configLoaded = true;
+			return 0;
+		}
+		log_message("Config snapshot %s not available, reading %s\n", inherited, config_path);
+	}
+
+	read_csv_and_store(config_path, dynamic_data, fixed_data);
+	if (shutdownFlag)
+	{
+		ERROR_MESSAGE("Failed to read %s\n", config_path);
+		return -1;
+	}
+	apply_pending_overrides(dynamic_data, fixed_data);
+	configLoaded = true;
+
+	// children fall back to the CSV when there is no snapshot, so failing to publish is not fatal
+	if (!baseConfig && capture_base_config(dynamic_data, fixed_data) == 0)
+	{
+		publish_config_snapshot();
+	}
+	return 1;
+}
+
+/**
+ * @brief Overrides a configuration value for this run without touching the CSV on disk.
+ *
+ * Before `load_config()` the override is applied to this process's arrays when they are
+ * loaded. In the process that published the snapshot, every override is also layered into
+ * it, so children started afterwards see the value; the live arrays of the running process
+ * are left alone, as they were when the value was written to the CSV. Elsewhere a late
+ * override has no effect.
+ *
+ * @param name   Configured parameter name.
+ * @param type   Type of the parameter.
+ * @param value  `int *`, `double *`, or the `char *` itself, as for `update_csv_value`.
+ */
+void set_config_override(const char *name, const input_param_type_t type, const void *value)
+{
+	if (!configLoaded)
+	{
+		config_value_t *override = find_config_value(pendingOverrides, nPendingOverrides, name);
+		if (!override)
+		{
+			config_value_t *grown = realloc(pendingOverrides, (size_t)(nPendingOverrides + 1) * sizeof(config_value_t));
+			if (!grown)
+			{
+				ERROR_MESSAGE("Failed to store config override %s\n", name);
+				return;
+			}
+			pendingOverrides = grown;
+			override = &pendingOverrides[nPendingOverrides];
+			*override = (config_value_t){.name = copy_string(name)};
+			if (!override->name)
+			{
+				ERROR_MESSAGE("Failed to store config override %s\n", name);
+				return;
+			}
+			nPendingOverrides++;
+		}
+		if (assign_config_value(override, type, value) != 0)
+		{
+			ERROR_MESSAGE("Failed to store config override %s\n", name);
+		}
+		return;
+	}
+
+	if (!baseConfig || publisherPid != current_process_id())
+	{
+		return;
+	}
+	config_value_t *entry = find_config_value(baseConfig, nBaseConfig, name);
+	if (!entry || entry->type != type)
+	{
+		ERROR_MESSAGE("Config override %s does not match a configured parameter of type %d\n", name, (int)type);
+		return;
+	}
+	if (assign_config_value(entry, type, value) != 0)
+	{
+		ERROR_MESSAGE("Failed to store config override %s\n", name);
+		return;
+	}
+	publish_config_snapshot();
+}
+
+/**
+ * @brief Name of the snapshot currently published by this process, or "" if none.
+ */
+const char *config_snapshot_name(void)
+{
+	return snapshotName;
+}
+
+/**
+ * @brief Removes every published generation of the snapshot and drops the parsed copy. Safe to call in any process.
+ *
+ * In the publisher `CONFIG_SNAPSHOT_ENV_NAME` is cleared as well, so a later `load_config()`
+ * in the same process (e.g. the controller library reloaded by its host) reads the CSV again.
+ */
+void unpublish_config_snapshot(void)
+{
+	const bool is_publisher = snapshotName[0] != '\0' && publisherPid == current_process_id();
+	remove_published_snapshots();
+	if (is_publisher)
+	{
+#ifdef _WIN32
+		_putenv_s(CONFIG_SNAPSHOT_ENV_NAME, "");
+#else
+		unsetenv(CONFIG_SNAPSHOT_ENV_NAME);
+#endif
+	}
+	configLoaded = false;
+	free_config_values(baseConfig, nBaseConfig);
+	baseConfig = NULL;
+	nBaseConfig = 0;
+	free_config_values(pendingOverrides, nPendingOverrides);
+	pendingOverrides = NULL;
+	nPendingOverrides = 0;
+}
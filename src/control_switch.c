@@ -32,9 +32,11 @@
 #include "flow_sim_model.h"       // for flowSimModelMap, register_flow_...
 #include "make_stage.h"           // for DEFINE_STAGE_DISPATCHER, DISPATCH_...
 #include "numerical_integrator.h" // for numericalIntegratorMap, register...
+#include "stage_timing.h"         // for configure_stage_timing
 #include "turbine_controls.h"     // for turbineControlMap, register_turb...
 #include <stdbool.h>              // IWYU pragma: keep
 #include <stddef.h>               // for NULL
+#include <string.h>               // for strcmp
 
 DEFINE_STAGE_DISPATCHER(flow_gen, flowMap)
 DEFINE_STAGE_DISPATCHER(numerical_integrator, numericalIntegratorMap)
@@ -43,6 +45,28 @@ DEFINE_STAGE_DISPATCHER(eom, eomMap)
 DEFINE_STAGE_DISPATCHER(drivetrain, drivetrainMap)
 DEFINE_STAGE_DISPATCHER(flow_sim_model, flowSimModelMap)
 DEFINE_STAGE_DISPATCHER(data_processing, dataProcessingMap)
+DEFINE_STAGE_DISPATCHER(eom_batch, eomBatchMap)
+DEFINE_STAGE_DISPATCHER(flow_sim_model_batch, flowSimModelBatchMap)
+DEFINE_STAGE_DISPATCHER(drivetrain_batch, drivetrainBatchMap)
+DEFINE_STAGE_DISPATCHER(turbine_control_batch, turbineControlBatchMap)
+
+#ifdef XFE_FUSED_PIPELINE
+#define FUSED_STAGE_ID_(impl) #impl
+#define FUSED_STAGE_ID(impl) FUSED_STAGE_ID_(impl)
+
+/**
+ * @brief Reports a stage whose configured function differs from the one bound at build time.
+ *
+ * The configured function still runs, through the stage callback instead of the inlined call.
+ */
+static void check_fused_stage(const char *stage, const char *selected, const char *bound)
+{
+	if (selected != NULL && strcmp(selected, bound) != 0)
+	{
+		log_message("Fused pipeline: %s_function_call '%s' is not the bound '%s', dispatching it at run time\n", stage, selected, bound);
+	}
+}
+#endif
 
 void control_switch(CONTROL_SWITCH_PARAM_LIST)
 {
@@ -76,6 +100,41 @@ void control_switch(CONTROL_SWITCH_PARAM_LIST)
 		DISPATCH_STAGE_OR_ERROR(flow_sim_model, flowSimModelMap, flow_Sim_Model_Function_Call);
 		DISPATCH_STAGE_OR_ERROR(data_processing, dataProcessingMap, data_Processing_Function_Call);
 
+		configure_stage_timing(fixed_data); // optional per-stage timing table at shutdown
+
+#ifdef XFE_FUSED_PIPELINE
+		check_fused_stage("numerical_integrator", numerical_Integrator_Function_Call, FUSED_STAGE_ID(XFE_FUSED_NUMERICAL_INTEGRATOR));
+		check_fused_stage("eom", eom_Function_Call, FUSED_STAGE_ID(XFE_FUSED_EOM));
+		check_fused_stage("flow_sim_model", flow_Sim_Model_Function_Call, FUSED_STAGE_ID(XFE_FUSED_FLOW_SIM_MODEL));
+		check_fused_stage("drivetrain", drivetrain_Function_Call, FUSED_STAGE_ID(XFE_FUSED_DRIVETRAIN));
+		check_fused_stage("turbine_control", turbine_Control_Function_Call, FUSED_STAGE_ID(XFE_FUSED_TURBINE_CONTROL));
+#endif
+
 		first_Run = true;
 	}
 }
+
+/**
+ * @brief Registers the batched stage implementations used by the ensemble engine.
+ *
+ * Uses the same `*_function_call` ids as `control_switch()`, so one config selects both
+ * the scalar and the batched form of each stage. Errors (with the list of valid ids) if a
+ * selected stage has no batched form.
+ */
+void ensemble_control_switch(const param_array_t *fixed_data)
+{
+	const char *turbine_Control_Function_Call = NULL;
+	const char *eom_Function_Call = NULL;
+	const char *drivetrain_Function_Call = NULL;
+	const char *flow_Sim_Model_Function_Call = NULL;
+
+	get_param(fixed_data, "turbine_control_function_call", &turbine_Control_Function_Call);
+	get_param(fixed_data, "eom_function_call", &eom_Function_Call);
+	get_param(fixed_data, "drivetrain_function_call", &drivetrain_Function_Call);
+	get_param(fixed_data, "flow_sim_model_function_call", &flow_Sim_Model_Function_Call);
+
+	DISPATCH_STAGE_OR_ERROR(turbine_control_batch, turbineControlBatchMap, turbine_Control_Function_Call);
+	DISPATCH_STAGE_OR_ERROR(eom_batch, eomBatchMap, eom_Function_Call);
+	DISPATCH_STAGE_OR_ERROR(drivetrain_batch, drivetrainBatchMap, drivetrain_Function_Call);
+	DISPATCH_STAGE_OR_ERROR(flow_sim_model_batch, flowSimModelBatchMap, flow_Sim_Model_Function_Call);
+}
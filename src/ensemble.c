@@ -0,0 +1,242 @@
+/**
+ * @file    ensemble.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Structure-of-arrays ensemble storage: N parameter/state sets as contiguous channels
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ensemble.h"
+#include "logger.h"                 // for ERROR_MESSAGE
+#include "xfe_control_sim_common.h" // for get_param_double_or_default
+#include "xflow_aero_sim.h"         // for param_array_t, input_param_t
+#include "xflow_core.h"             // for shutdownFlag
+#include <stdatomic.h>               // for atomic_fetch_add_explicit, memory_order_relaxed
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stddef.h>                 // for NULL, size_t
+#include <stdint.h>                 // for uint64_t
+#include <stdlib.h>                 // for calloc, free, malloc
+#include <string.h>                 // for strcmp
+
+/** Channel stride is padded to a multiple of this many members (doubles); the allocations themselves are only malloc-aligned. */
+#define ENSEMBLE_MEMBER_ALIGNMENT 8
+
+static atomic_uint_fast64_t nextEnsembleId = 1;
+
+/**
+ * @brief Creates an ensemble of @p n_members copies of the current dynamic parameter set.
+ *
+ * Every `INPUT_PARAM_DOUBLE` and `INPUT_PARAM_INT` dynamic parameter becomes a channel,
+ * initialised by broadcasting its current scalar value to all members (and to the
+ * padding slots up to `stride`, so full-stride loops never see garbage). State variables
+ * (parameters flagged `is_state_var`) are recorded in the same order `init_state_bindings()`
+ * walks them, and the rk4 stage buffers are allocated once here.
+ *
+ * @param dynamic_data  Dynamic parameters that define the channels and their initial values.
+ * @param n_members     Number of members N (> 0).
+ *
+ * @return New ensemble, or NULL on failure (after logging and setting `shutdownFlag`).
+ *
+ * @note Channel names are borrowed from @p dynamic_data, which must outlive the ensemble.
+ */
+ensemble_t *create_ensemble(const param_array_t *dynamic_data, const int n_members)
+{
+	if (dynamic_data == NULL || n_members <= 0)
+	{
+		ERROR_MESSAGE("Ensemble: invalid arguments (n_members = %d).\n", n_members);
+		shutdownFlag = 1;
+		return NULL;
+	}
+
+	ensemble_t *ensemble = calloc(1, sizeof(ensemble_t));
+	if (ensemble == NULL)
+	{
+		ERROR_MESSAGE("Ensemble: failed to allocate ensemble.\n");
+		shutdownFlag = 1;
+		return NULL;
+	}
+
+	ensemble->id = (uint64_t)atomic_fetch_add_explicit(&nextEnsembleId, 1, memory_order_relaxed);
+	ensemble->n_members = n_members;
+	ensemble->stride = ((n_members + ENSEMBLE_MEMBER_ALIGNMENT - 1) / ENSEMBLE_MEMBER_ALIGNMENT) * ENSEMBLE_MEMBER_ALIGNMENT;
+
+	for (int i = 0; i < dynamic_data->n_param; i++)
+	{
+		const input_param_t *param = &dynamic_data->params[i];
+		if (param->type == INPUT_PARAM_DOUBLE || param->type == INPUT_PARAM_INT)
+		{
+			ensemble->n_channels++;
+			if (param->is_state_var)
+			{
+				ensemble->n_state_var++;
+			}
+		}
+	}
+
+	const size_t stride = (size_t)ensemble->stride;
+	ensemble->channel_names = (const char **)malloc(ensemble->n_channels * sizeof(char *));
+	ensemble->values = calloc((size_t)ensemble->n_channels * stride, sizeof(double));
+	ensemble->state_channel = calloc(ensemble->n_state_var > 0 ? ensemble->n_state_var : 1, sizeof(int));
+	ensemble->buffer = calloc(5 * (size_t)(ensemble->n_state_var > 0 ? ensemble->n_state_var : 1) * stride, sizeof(double));
+	if (ensemble->channel_names == NULL || ensemble->values == NULL || ensemble->state_channel == NULL || ensemble->buffer == NULL)
+	{
+		ERROR_MESSAGE("Ensemble: failed to allocate %d channels for %d members.\n", ensemble->n_channels, n_members);
+		shutdownFlag = 1;
+		free_ensemble(ensemble);
+		return NULL;
+	}
+
+	const size_t state_block = (size_t)ensemble->n_state_var * stride;
+	ensemble->k1 = ensemble->buffer;
+	ensemble->k2 = ensemble->k1 + state_block;
+	ensemble->k3 = ensemble->k2 + state_block;
+	ensemble->k4 = ensemble->k3 + state_block;
+	ensemble->temp = ensemble->k4 + state_block;
+
+	int channel = 0;
+	int state = 0;
+	for (int i = 0; i < dynamic_data->n_param; i++)
+	{
+		const input_param_t *param = &dynamic_data->params[i];
+		if (param->type != INPUT_PARAM_DOUBLE && param->type != INPUT_PARAM_INT)
+		{
+			continue;
+		}
+
+		ensemble->channel_names[channel] = param->name;
+		const double value = param->type == INPUT_PARAM_DOUBLE ? param->value.d : (double)param->value.i;
+		double *values = &ensemble->values[(size_t)channel * stride];
+		for (size_t m = 0; m < stride; m++)
+		{
+			values[m] = value;
+		}
+
+		if (param->is_state_var)
+		{
+			ensemble->state_channel[state++] = channel;
+		}
+		channel++;
+	}
+
+	return ensemble;
+}
+
+/**
+ * @brief Releases an ensemble created by `create_ensemble()`.
+ *
+ * @param ensemble  Ensemble to free (NULL is ignored).
+ */
+void free_ensemble(ensemble_t *ensemble)
+{
+	if (ensemble == NULL)
+	{
+		return;
+	}
+
+	free((void *)ensemble->channel_names);
+	free(ensemble->values);
+	free(ensemble->state_channel);
+	free(ensemble->buffer);
+	free(ensemble);
+}
+
+/**
+ * @brief Finds the channel index of a parameter.
+ *
+ * @param ensemble  Ensemble to search.
+ * @param name      Parameter name.
+ * @return Channel index, or -1 if the ensemble has no such channel.
+ */
+int ensemble_channel_index(const ensemble_t *ensemble, const char *name)
+{
+	for (int c = 0; c < ensemble->n_channels; c++)
+	{
+		if (strcmp(ensemble->channel_names[c], name) == 0)
+		{
+			return c;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Returns the contiguous `double[n_members]` array of a channel.
+ *
+ * @param ensemble  Ensemble to search.
+ * @param name      Parameter name.
+ * @return Pointer to the first member's value, or NULL if the channel does not exist.
+ */
+double *ensemble_channel(const ensemble_t *ensemble, const char *name)
+{
+	const int c = ensemble_channel_index(ensemble, name);
+	return c < 0 ? NULL : &ensemble->values[(size_t)c * ensemble->stride];
+}
+
+/**
+ * @brief Returns the channel array of a state variable together with its state index.
+ *
+ * The state index selects the matching block of a batched derivative buffer:
+ * `dx[state_index * stride + m]`.
+ *
+ * @param ensemble             Ensemble to search.
+ * @param name                 State variable name.
+ * @param[out] out_state_index Receives the state index, or -1 if @p name is not a state variable.
+ * @return Pointer to the channel array, or NULL if @p name is not a state variable.
+ */
+double *ensemble_state(const ensemble_t *ensemble, const char *name, int *out_state_index)
+{
+	*out_state_index = -1;
+	const int c = ensemble_channel_index(ensemble, name);
+	for (int s = 0; s < ensemble->n_state_var && c >= 0; s++)
+	{
+		if (ensemble->state_channel[s] == c)
+		{
+			*out_state_index = s;
+			return &ensemble->values[(size_t)c * ensemble->stride];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Copies the current scalar value of a dynamic parameter into every member.
+ *
+ * Used for inputs shared by the whole ensemble, such as the `flow_speed` produced
+ * once per step by the scalar `flow_gen`.
+ *
+ * @param ensemble      Ensemble to update.
+ * @param dynamic_data  Scalar dynamic parameters.
+ * @param name          Parameter to broadcast (ignored if not a channel).
+ */
+void ensemble_broadcast_param(ensemble_t *ensemble, const param_array_t *dynamic_data, const char *name)
+{
+	double *values = ensemble_channel(ensemble, name);
+	if (values == NULL)
+	{
+		return;
+	}
+
+	const double value = get_param_double_or_default(dynamic_data, name, 0.0);
+	for (int m = 0; m < ensemble->stride; m++)
+	{
+		values[m] = value;
+	}
+}
@@ -0,0 +1,361 @@
+/**
+ * @file    ensemble_simulation.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Batched rk4 step and simulation loop of a structure-of-arrays ensemble
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ensemble.h"
+#include "control_switch.h"         // for ensemble_control_switch
+#include "equation_of_motion.h"     // for eom_batch
+#include "flow_gen.h"               // for flow_gen
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "stage_schedule.h"         // for init_stage_schedule, stage_is_due
+#include "turbine_controls.h"       // for turbine_control_batch
+#include "xfe_control_sim_common.h" // for get_param_*_or_default, parse_delimited_list
+#include "xflow_aero_sim.h"         // for get_param
+#include "xflow_core.h"             // for shutdownFlag, get_monotonic_timestamp
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stddef.h>                 // for NULL, size_t
+#include <stdio.h>                  // for FILE, fclose
+#include <stdlib.h>                 // for calloc, free, malloc
+#include <string.h>                 // for strcmp, strlen, memcpy
+
+#ifdef _WIN32
+#include <windows.h> // for MAX_PATH
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif
+#else
+#include <limits.h> // for PATH_MAX
+#endif
+
+/**
+ * @brief Advances every member by one classical 4th-order Runge–Kutta step.
+ *
+ * Mirrors `rk4_numerical_integrator()`: the stage states are written into the live state
+ * channels so the batched `eom_batch()` (and the `flow_sim_model_batch()` /
+ * `drivetrain_batch()` it calls) read them exactly like the scalar path reads
+ * `state_vars`. Each update is one flat loop over `n_state_var * stride` doubles.
+ *
+ * @param ensemble    Ensemble to advance.
+ * @param dt          Time step size.
+ * @param fixed_data  Fixed parameters passed through to `eom_batch()`.
+ */
+void ensemble_rk4_step(ensemble_t *ensemble, const double dt, const param_array_t *fixed_data)
+{
+	const int stride = ensemble->stride;
+	const int n_state_var = ensemble->n_state_var;
+	double *restrict k1 = ensemble->k1;
+	double *restrict k2 = ensemble->k2;
+	double *restrict k3 = ensemble->k3;
+	double *restrict k4 = ensemble->k4;
+	double *restrict temp = ensemble->temp;
+
+	// Save original state x_n
+	for (int s = 0; s < n_state_var; ++s)
+	{
+		const double *restrict x = &ensemble->values[(size_t)ensemble->state_channel[s] * stride];
+		double *restrict x_n = &temp[(size_t)s * stride];
+		for (int m = 0; m < stride; ++m)
+		{
+			x_n[m] = x[m];
+		}
+	}
+
+	// k1 = f(x_n)
+	eom_batch(ensemble, k1, fixed_data);
+
+	// state = x_n + (dt/2) * k1
+	for (int s = 0; s < n_state_var; ++s)
+	{
+		double *restrict x = &ensemble->values[(size_t)ensemble->state_channel[s] * stride];
+		const double *restrict x_n = &temp[(size_t)s * stride];
+		const double *restrict k = &k1[(size_t)s * stride];
+		for (int m = 0; m < stride; ++m)
+		{
+			x[m] = x_n[m] + (0.5 * dt * k[m]);
+		}
+	}
+	eom_batch(ensemble, k2, fixed_data);
+
+	// state = x_n + (dt/2) * k2
+	for (int s = 0; s < n_state_var; ++s)
+	{
+		double *restrict x = &ensemble->values[(size_t)ensemble->state_channel[s] * stride];
+		const double *restrict x_n = &temp[(size_t)s * stride];
+		const double *restrict k = &k2[(size_t)s * stride];
+		for (int m = 0; m < stride; ++m)
+		{
+			x[m] = x_n[m] + (0.5 * dt * k[m]);
+		}
+	}
+	eom_batch(ensemble, k3, fixed_data);
+
+	// state = x_n + dt * k3
+	for (int s = 0; s < n_state_var; ++s)
+	{
+		double *restrict x = &ensemble->values[(size_t)ensemble->state_channel[s] * stride];
+		const double *restrict x_n = &temp[(size_t)s * stride];
+		const double *restrict k = &k3[(size_t)s * stride];
+		for (int m = 0; m < stride; ++m)
+		{
+			x[m] = x_n[m] + (dt * k[m]);
+		}
+	}
+	eom_batch(ensemble, k4, fixed_data);
+
+	// Final update: x_{n+1} = x_n + (dt/6)*(k1 + 2*k2 + 2*k3 + k4)
+	for (int s = 0; s < n_state_var; ++s)
+	{
+		double *restrict x = &ensemble->values[(size_t)ensemble->state_channel[s] * stride];
+		const double *restrict x_n = &temp[(size_t)s * stride];
+		const size_t off = (size_t)s * stride;
+		for (int m = 0; m < stride; ++m)
+		{
+			x[m] = x_n[m] + ((dt / 6.0) * (k1[off + m] + (2 * k2[off + m]) + (2 * k3[off + m]) + k4[off + m]));
+		}
+	}
+}
+
+/**
+ * @brief Writes one row per member with the swept value and the final and time-averaged output channels.
+ */
+static void save_ensemble_results(const ensemble_t *ensemble, const char *sweep_param, char **output_channels, const int n_output, const double *channel_sums, const long n_samples, const char *filename)
+{
+	FILE *file = xflow_fopen_safe(filename, XFLOW_FILE_WRITE_ONLY);
+	if (file == NULL)
+	{
+		ERROR_MESSAGE("Ensemble: could not open results file '%s'.\n", filename);
+		return;
+	}
+
+	const double *sweep_values = sweep_param != NULL ? ensemble_channel(ensemble, sweep_param) : NULL;
+
+	safe_fprintf(file, "member");
+	if (sweep_values != NULL)
+	{
+		safe_fprintf(file, ",%s", sweep_param);
+	}
+	for (int o = 0; o < n_output; o++)
+	{
+		safe_fprintf(file, ",final_%s,mean_%s", output_channels[o], output_channels[o]);
+	}
+	safe_fprintf(file, "\n");
+
+	for (int m = 0; m < ensemble->n_members; m++)
+	{
+		safe_fprintf(file, "%d", m);
+		if (sweep_values != NULL)
+		{
+			safe_fprintf(file, ",%.10g", sweep_values[m]);
+		}
+		for (int o = 0; o < n_output; o++)
+		{
+			const double *values = ensemble_channel(ensemble, output_channels[o]);
+			const double mean = n_samples > 0 ? channel_sums[((size_t)o * ensemble->stride) + m] / (double)n_samples : 0.0;
+			safe_fprintf(file, ",%.10g,%.10g", values[m], mean);
+		}
+		safe_fprintf(file, "\n");
+	}
+
+	fclose(file);
+	log_message("Ensemble results for %d members saved to %s\n", ensemble->n_members, filename);
+}
+
+/**
+ * @brief Runs the whole simulation for an ensemble of @p n_members turbines in one process.
+ *
+ * Replaces the single-instance loop of `main()` when `ensemble_size > 0`. Each step:
+ *   1. Calls the scalar `flow_gen()` once (when due) and broadcasts `flow_speed` (shared wind) to all members.
+ *   2. Advances all members with `ensemble_rk4_step()`.
+ *   3. Applies the brake clamp (`omega = 0` below 0.5 rad/s when braking) member-wise.
+ *   4. Advances `time_sec` and calls `turbine_control_batch()` when the stage schedule has it due
+ *      (every `control_dt_sec` by default).
+ *   5. Accumulates the time average of every output channel.
+ *
+ * Members differ in one swept dynamic parameter, spaced linearly between
+ * `ensemble_sweep_min` and `ensemble_sweep_max`. Optional fixed parameters:
+ * - `ensemble_sweep_param`: channel to sweep (default `k`, "none" to disable)
+ * - `ensemble_sweep_min` / `ensemble_sweep_max`: sweep range (default: the configured value)
+ * - `ensemble_output_channels`: channels to report (default: the state variables)
+ * - `ensemble_results_file`: results CSV written to `OUTPUT_LOG_FILE_PATH`
+ *   (default `ensemble_results.csv`)
+ *
+ * @param dynamic_data  Scalar dynamic parameters; supply the initial values and drive `flow_gen`.
+ * @param fixed_data    Fixed parameters.
+ * @param n_members     Number of ensemble members.
+ *
+ * @note The ensemble always integrates with rk4; a different
+ *       `numerical_integrator_function_call` is reported and ignored.
+ */
+void run_ensemble_simulation(const param_array_t *dynamic_data, const param_array_t *fixed_data, const int n_members)
+{
+	ensemble_control_switch(fixed_data);
+	if (shutdownFlag)
+	{
+		return;
+	}
+
+	ensemble_t *ensemble = create_ensemble(dynamic_data, n_members);
+	if (ensemble == NULL)
+	{
+		return;
+	}
+
+	double *dt_Sec = NULL;
+	double *dur_Sec = NULL;
+	double *time_Sec = NULL;
+	int *total_Loop_Count = NULL;
+	get_param(fixed_data, "dt_sec", &dt_Sec);
+	get_param(fixed_data, "dur_sec", &dur_Sec);
+	get_param(dynamic_data, "time_sec", &time_Sec);
+	get_param(dynamic_data, "total_loop_count", &total_Loop_Count);
+
+	const char *integrator = get_param_string_or_default(fixed_data, "numerical_integrator_function_call", "rk4_numerical_integrator");
+	if (strcmp(integrator, "rk4_numerical_integrator") != 0)
+	{
+		log_message("Ensemble: '%s' has no batched form, integrating with rk4_numerical_integrator\n", integrator);
+	}
+
+	// sweep definition
+	const char *sweep_param = get_param_string_or_default(fixed_data, "ensemble_sweep_param", "k");
+	double *sweep_values = strcmp(sweep_param, "none") == 0 ? NULL : ensemble_channel(ensemble, sweep_param);
+	if (strcmp(sweep_param, "none") != 0 && sweep_values == NULL)
+	{
+		ERROR_MESSAGE("Ensemble: ensemble_sweep_param '%s' is not a numeric dynamic parameter.\n", sweep_param);
+		shutdownFlag = 1;
+		free_ensemble(ensemble);
+		return;
+	}
+	if (sweep_values != NULL)
+	{
+		const double sweep_min = get_param_double_or_default(fixed_data, "ensemble_sweep_min", sweep_values[0]);
+		const double sweep_max = get_param_double_or_default(fixed_data, "ensemble_sweep_max", sweep_values[0]);
+		const double step = n_members > 1 ? (sweep_max - sweep_min) / (n_members - 1) : 0.0;
+		for (int m = 0; m < n_members; m++)
+		{
+			sweep_values[m] = sweep_min + (m * step);
+		}
+		log_message("Ensemble: %d members, %s swept from %g to %g\n", n_members, sweep_param, sweep_min, sweep_max);
+	}
+
+	// output channels and their running sums
+	char **output_channels = NULL;
+	int n_output = parse_delimited_list(get_param_string_or_default(fixed_data, "ensemble_output_channels", NULL), &output_channels);
+	if (n_output == 0)
+	{
+		output_channels = (char **)calloc(ensemble->n_state_var > 0 ? ensemble->n_state_var : 1, sizeof(char *));
+		for (int s = 0; output_channels != NULL && s < ensemble->n_state_var; s++)
+		{
+			const char *name = ensemble->channel_names[ensemble->state_channel[s]];
+			output_channels[s] = malloc(strlen(name) + 1);
+			if (output_channels[s] != NULL)
+			{
+				memcpy(output_channels[s], name, strlen(name) + 1);
+				n_output++;
+			}
+		}
+	}
+	double *channel_sums = calloc((size_t)(n_output > 0 ? n_output : 1) * ensemble->stride, sizeof(double));
+	const double **output_values = (const double **)calloc(n_output > 0 ? n_output : 1, sizeof(double *));
+	if (n_output < 0 || channel_sums == NULL || output_values == NULL)
+	{
+		ERROR_MESSAGE("Ensemble: failed to allocate output buffers.\n");
+		shutdownFlag = 1;
+	}
+	for (int o = 0; o < n_output && !shutdownFlag; o++)
+	{
+		output_values[o] = ensemble_channel(ensemble, output_channels[o]);
+		if (output_values[o] == NULL)
+		{
+			ERROR_MESSAGE("Ensemble: output channel '%s' is not a numeric dynamic parameter.\n", output_channels[o]);
+			shutdownFlag = 1;
+		}
+	}
+
+	double *omega = ensemble_channel(ensemble, "omega");
+	const double *enable_Brake_Signal = ensemble_channel(ensemble, "enable_brake_signal");
+
+	const struct timespec ensemble_start = get_monotonic_timestamp();
+	stage_schedule_t schedule;
+	const bool schedule_ready = init_stage_schedule(&schedule, fixed_data, *dt_Sec, *time_Sec) == 0;
+	long n_samples = 0;
+	while (schedule_ready && *time_Sec < *dur_Sec && !shutdownFlag)
+	{
+		if (stage_is_due(&schedule, SCHEDULED_FLOW_GEN))
+		{
+			flow_gen(dynamic_data, fixed_data);
+			ensemble_broadcast_param(ensemble, dynamic_data, "flow_speed");
+		}
+		ensemble_broadcast_param(ensemble, dynamic_data, "time_sec");
+
+		ensemble_rk4_step(ensemble, *dt_Sec, fixed_data);
+
+		if (omega != NULL && enable_Brake_Signal != NULL)
+		{
+			for (int m = 0; m < n_members; m++)
+			{
+				omega[m] = (enable_Brake_Signal[m] != 0.0 && omega[m] < 0.5) ? 0.0 : omega[m];
+			}
+		}
+
+		*time_Sec = advance_stage_schedule(&schedule);
+		if (stage_is_due(&schedule, SCHEDULED_TURBINE_CONTROL))
+		{
+			turbine_control_batch(ensemble, fixed_data);
+		}
+
+		for (int o = 0; o < n_output; o++)
+		{
+			double *restrict sums = &channel_sums[(size_t)o * ensemble->stride];
+			const double *restrict values = output_values[o];
+			for (int m = 0; m < n_members; m++)
+			{
+				sums[m] += values[m];
+			}
+		}
+		n_samples++;
+		(*total_Loop_Count)++;
+	}
+
+	const double wall_time = timespec_diff_to_double(ensemble_start, get_monotonic_timestamp());
+	log_message("Ensemble: %ld steps x %d members in %.3f s (%.0f member-steps/s)\n", n_samples, n_members, wall_time,
+	            wall_time > 0.0 ? ((double)n_samples * n_members) / wall_time : 0.0);
+	if (schedule_ready)
+	{
+		log_stage_schedule_statistics(&schedule);
+	}
+
+	if (n_samples > 0 && channel_sums != NULL && output_values != NULL)
+	{
+		const char *results_name = get_param_string_or_default(fixed_data, "ensemble_results_file", "ensemble_results.csv");
+		char results_filename[PATH_MAX];
+		create_dynamic_file_path(results_filename, PATH_MAX, "%s/%s", OUTPUT_LOG_FILE_PATH, results_name);
+		save_ensemble_results(ensemble, sweep_values != NULL ? sweep_param : NULL, output_channels, n_output, channel_sums, n_samples, results_filename);
+	}
+
+	free((void *)output_values);
+	free(channel_sums);
+	free_delimited_list(output_channels, n_output > 0 ? n_output : 0);
+	free_ensemble(ensemble);
+}
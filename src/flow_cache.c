@@ -0,0 +1,385 @@
+/**
+ * @file    flow_cache.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Persistent memory-mapped cache of preprocessed flow series (.xfeflow)
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN(llvm-include-order)
+#include "flow_cache.h"
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "xfe_control_sim_common.h" // for get_param_int_or_default, get_param_string_or_default
+#include "xflow_aero_sim.h"         // for param_array_t
+#include "xflow_core.h"             // for safe_snprintf, safe_strerror
+#include <errno.h>                  // for errno, EEXIST
+#include <stdint.h>                 // for uint64_t, uint8_t
+#include <stdio.h>                  // for FILE, fopen, fread, fwrite, rename, remove
+#include <string.h>                 // for memcmp, memcpy, memset, strrchr, strlen, strcmp
+
+#ifdef _WIN32
+#include <windows.h> // for CreateFileA, CreateFileMappingA, MapViewOfFile, MoveFileExA
+#include <direct.h>  // for _mkdir
+#include <process.h> // for _getpid
+#else
+#include <fcntl.h>    // for open, O_RDONLY
+#include <limits.h>   // for PATH_MAX
+#include <sys/mman.h> // for mmap, munmap, MAP_FAILED
+#include <sys/stat.h> // for fstat, mkdir
+#include <unistd.h>   // for close, getpid
+#endif
+// NOLINTEND(llvm-include-order)
+
+#ifdef _WIN32
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif
+#endif
+
+#define FLOW_CACHE_HASH_CHUNK (1U << 16U)
+#define FNV64_OFFSET 14695981039346656037ULL
+#define FNV64_PRIME 1099511628211ULL
+
+// Last hashed source, so flow_cache_store after a miss does not read the source a second time.
+static char lastHashedSource[PATH_MAX] = "";
+static uint64_t lastSourceHash = 0;
+static uint64_t lastSourceSize = 0;
+
+static uint64_t fnv1a64(uint64_t h, const void *data, const size_t n)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	for (size_t i = 0; i < n; i++)
+	{
+		h ^= p[i];
+		h *= FNV64_PRIME;
+	}
+	return h;
+}
+
+/**
+ * @brief Hashes the full contents of the source flow file.
+ */
+static int hash_source_file(const char *source_path, uint64_t *out_hash, uint64_t *out_size)
+{
+	if (strcmp(lastHashedSource, source_path) == 0)
+	{
+		*out_hash = lastSourceHash;
+		*out_size = lastSourceSize;
+		return 0;
+	}
+
+	FILE *file = fopen(source_path, "rb"); // NOLINT(cert-err33-c)
+	if (!file)
+	{
+		ERROR_MESSAGE("Flow cache: cannot open source %s: %s\n", source_path, safe_strerror(errno));
+		return -1;
+	}
+
+	static unsigned char chunk[FLOW_CACHE_HASH_CHUNK];
+	uint64_t h = FNV64_OFFSET;
+	uint64_t size = 0;
+	size_t n = 0;
+	while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+	{
+		h = fnv1a64(h, chunk, n);
+		size += n;
+	}
+	const int read_error = ferror(file);
+	if (fclose(file) == EOF || read_error)
+	{
+		ERROR_MESSAGE("Flow cache: error reading %s\n", source_path);
+		return -1;
+	}
+
+	*out_hash = h;
+	*out_size = size;
+	if (safe_snprintf(lastHashedSource, sizeof(lastHashedSource), "%s", source_path) < 0)
+	{
+		lastHashedSource[0] = '\0';
+	}
+	lastSourceHash = h;
+	lastSourceSize = size;
+	return 0;
+}
+
+/**
+ * @brief Builds `<cache_dir>/<source stem>-<key>.xfeflow` and makes sure the directory exists.
+ *
+ * The key mixes the source hash with `dt_sec` and `flow_time_step_dt`, so different time
+ * steps of the same source live side by side instead of evicting each other.
+ */
+static int flow_cache_path(const param_array_t *fixed_data, const char *source_path, const uint64_t source_hash, const double dt_sec, const double flow_time_step_dt, char *out, const size_t out_size)
+{
+	char default_dir[PATH_MAX];
+#ifdef OUTPUT_LOG_FILE_PATH
+	if (safe_snprintf(default_dir, sizeof(default_dir), "%s/flow_cache", OUTPUT_LOG_FILE_PATH) < 0)
+#else
+	if (safe_snprintf(default_dir, sizeof(default_dir), "flow_cache") < 0)
+#endif
+	{
+		return -1;
+	}
+	const char *dir = get_param_string_or_default(fixed_data, "flow_cache_dir", default_dir);
+	if (dir[0] == '\0')
+	{
+		dir = default_dir;
+	}
+
+#ifdef _WIN32
+	if (_mkdir(dir) != 0 && errno != EEXIST)
+#else
+	if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+#endif
+	{
+		ERROR_MESSAGE("Flow cache: cannot create %s: %s\n", dir, safe_strerror(errno));
+		return -1;
+	}
+
+	const char *base = strrchr(source_path, '/');
+#ifdef _WIN32
+	const char *back = strrchr(source_path, '\\');
+	if (back && (!base || back > base))
+	{
+		base = back;
+	}
+#endif
+	base = base ? base + 1 : source_path;
+	const char *dot = strrchr(base, '.');
+	const int stem_len = dot ? (int)(dot - base) : (int)strlen(base);
+
+	uint64_t key = fnv1a64(FNV64_OFFSET, &source_hash, sizeof(source_hash));
+	key = fnv1a64(key, &dt_sec, sizeof(dt_sec));
+	key = fnv1a64(key, &flow_time_step_dt, sizeof(flow_time_step_dt));
+
+	if (safe_snprintf(out, out_size, "%s/%.*s-%016llx%s", dir, stem_len, base, (unsigned long long)key, FLOW_CACHE_EXTENSION) < 0)
+	{
+		ERROR_MESSAGE("Flow cache: path too long for %s\n", source_path);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Returns non-zero when the optional fixed parameter `flow_cache_enable` is > 0.
+ */
+int flow_cache_is_enabled(const param_array_t *fixed_data)
+{
+	return get_param_int_or_default(fixed_data, "flow_cache_enable", 0) > 0;
+}
+
+static int map_cache_file(const char *path, flow_cache_view_t *view)
+{
+	memset(view, 0, sizeof(*view));
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return -1;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(flow_cache_header_t))
+	{
+		CloseHandle(file);
+		return -1;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return -1;
+	}
+	void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!base)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return -1;
+	}
+	view->file_handle = file;
+	view->mapping_handle = mapping;
+	view->map_size = (size_t)size.QuadPart;
+#else
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(flow_cache_header_t))
+	{
+		close(fd);
+		return -1;
+	}
+	void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps the file referenced
+	if (base == MAP_FAILED)
+	{
+		return -1;
+	}
+	view->map_size = (size_t)st.st_size;
+#endif
+	view->map_base = base;
+	return 0;
+}
+
+/**
+ * @brief Maps a cached, already interpolated flow series if one matches the source and time steps.
+ *
+ * @param fixed_data         Fixed parameters (`flow_cache_dir`).
+ * @param source_path        Flow source file (.csv or .bts).
+ * @param dt_sec             Simulation time step.
+ * @param flow_time_step_dt  Configured flow series step.
+ * @param[out] view          Mapped view on success; release with `flow_cache_close()`.
+ * @return 0 on a cache hit, -1 on a miss or any error.
+ */
+int flow_cache_open(const param_array_t *fixed_data, const char *source_path, const double dt_sec, const double flow_time_step_dt, flow_cache_view_t *view)
+{
+	uint64_t source_hash = 0;
+	uint64_t source_size = 0;
+	char path[PATH_MAX];
+	if (hash_source_file(source_path, &source_hash, &source_size) != 0 || flow_cache_path(fixed_data, source_path, source_hash, dt_sec, flow_time_step_dt, path, sizeof(path)) != 0)
+	{
+		return -1;
+	}
+	if (map_cache_file(path, view) != 0)
+	{
+		return -1;
+	}
+
+	const flow_cache_header_t *header = (const flow_cache_header_t *)view->map_base;
+	const size_t payload = header->n_sim_steps >= 0 && header->n_raw >= 0 ? (size_t)(header->n_sim_steps + header->n_raw) * sizeof(double) : SIZE_MAX;
+	if (memcmp(header->magic, FLOW_CACHE_MAGIC, FLOW_CACHE_MAGIC_SIZE) != 0 || header->version != FLOW_CACHE_VERSION || header->header_size != sizeof(flow_cache_header_t) ||
+	    header->source_hash != source_hash || header->source_size != source_size || header->dt_sec != dt_sec || header->flow_time_step_dt != flow_time_step_dt ||
+	    payload == SIZE_MAX || view->map_size < sizeof(flow_cache_header_t) + payload)
+	{
+		log_message("Flow cache: %s is stale, rebuilding\n", path);
+		flow_cache_close(view);
+		return -1;
+	}
+
+	view->header = header;
+	view->interp = (const double *)((const char *)view->map_base + header->header_size);
+	view->raw = view->interp + header->n_sim_steps;
+	log_message("Flow cache hit: %s (%lld steps)\n", path, (long long)header->n_sim_steps);
+	return 0;
+}
+
+/**
+ * @brief Writes a preprocessed flow series to the cache.
+ *
+ * The file is written under a temporary name and renamed into place, so a concurrent
+ * reader never maps a partially written cache.
+ *
+ * @return 0 on success, -1 on error (the simulation continues without a cache).
+ */
+int flow_cache_store(const param_array_t *fixed_data, const char *source_path, const double dt_sec, const double flow_time_step_dt, const double raw_dt, const double total_time, const double *interp, const int n_sim_steps, const double *raw, const int n_raw)
+{
+	uint64_t source_hash = 0;
+	uint64_t source_size = 0;
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	if (hash_source_file(source_path, &source_hash, &source_size) != 0 || flow_cache_path(fixed_data, source_path, source_hash, dt_sec, flow_time_step_dt, path, sizeof(path)) != 0)
+	{
+		return -1;
+	}
+#ifdef _WIN32
+	const int pid = _getpid();
+#else
+	const int pid = (int)getpid();
+#endif
+	if (safe_snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", path, pid) < 0)
+	{
+		return -1;
+	}
+
+	flow_cache_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FLOW_CACHE_MAGIC, FLOW_CACHE_MAGIC_SIZE);
+	header.version = FLOW_CACHE_VERSION;
+	header.header_size = sizeof(flow_cache_header_t);
+	header.source_hash = source_hash;
+	header.source_size = source_size;
+	header.dt_sec = dt_sec;
+	header.flow_time_step_dt = flow_time_step_dt;
+	header.raw_dt = raw_dt;
+	header.total_time = total_time;
+	header.n_sim_steps = n_sim_steps;
+	header.n_raw = raw ? n_raw : 0;
+
+	FILE *file = fopen(tmp_path, "wb"); // NOLINT(cert-err33-c)
+	if (!file)
+	{
+		ERROR_MESSAGE("Flow cache: cannot write %s: %s\n", tmp_path, safe_strerror(errno));
+		return -1;
+	}
+	int ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(interp, sizeof(double), (size_t)n_sim_steps, file) == (size_t)n_sim_steps;
+	if (ok && header.n_raw > 0)
+	{
+		ok = fwrite(raw, sizeof(double), (size_t)n_raw, file) == (size_t)n_raw;
+	}
+	if (fclose(file) == EOF)
+	{
+		ok = 0;
+	}
+
+#ifdef _WIN32
+	if (ok && !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+#else
+	if (ok && rename(tmp_path, path) != 0)
+#endif
+	{
+		ok = 0;
+	}
+	if (!ok)
+	{
+		ERROR_MESSAGE("Flow cache: failed to store %s\n", path);
+		if (remove(tmp_path) != 0)
+		{
+			ERROR_MESSAGE("Flow cache: could not remove %s\n", tmp_path);
+		}
+		return -1;
+	}
+
+	log_message("Flow cache stored: %s (%d steps)\n", path, n_sim_steps);
+	return 0;
+}
+
+/**
+ * @brief Unmaps a view returned by `flow_cache_open()`. Safe on an unopened view.
+ */
+void flow_cache_close(flow_cache_view_t *view)
+{
+	if (!view->map_base)
+	{
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(view->map_base);
+	CloseHandle((HANDLE)view->mapping_handle);
+	CloseHandle((HANDLE)view->file_handle);
+#else
+	if (munmap(view->map_base, view->map_size) != 0)
+	{
+		ERROR_MESSAGE("Flow cache: munmap failed: %s\n", safe_strerror(errno));
+	}
+#endif
+	memset(view, 0, sizeof(*view));
+}
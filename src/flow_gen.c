@@ -24,7 +24,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "xflow_core.h"
+#include "flow_cache.h"             // for flow_cache_open, flow_cache_store, flow_cache_close
 #include "flow_gen.h"               // for flow
+#include "flow_stream.h"            // for flow_stream_open, flow_stream_sample, flow_stream_close
 #include "xfe_control_sim_common.h" // for shutdownFlag, create_shared_interp
 #include "xflow_aero_sim.h"
 #include <stddef.h> // for NULL
@@ -50,9 +52,13 @@
 #include <sys/mman.h> // for shm_unlink, shm_open, mmap, MAP_FAILED
 #endif
 
-#include "logger.h" // for log_message, ERROR_MESSAGE
+#include "bts_rotor_average.h" // for bts_rotor_average_series
+#include "config_snapshot.h"   // for set_config_override
+#include "logger.h"            // for log_message, ERROR_MESSAGE
 #include "make_stage.h"
-#include "xflow_data_types.h" // for DATA_TYPE_DOUBLE
+#include "maybe_unused.h"      // for MAYBE_UNUSED
+#include "stage_context.h"     // for STAGE_STATE_WITH_RELEASE
+#include "xflow_data_types.h"  // for DATA_TYPE_DOUBLE
 
 // expand definitions once, using both the decl‐list and the call‐list
 MAKE_STAGE_DEFINE(flow_gen, void, (FLOW_GEN_PARAM_LIST), (FLOW_GEN_CALL_ARGS))
@@ -63,6 +69,175 @@ __attribute__((constructor)) static void init_flow_gen_hook(void)
 	register_flow_gen(csv_fixed_interp_flow_gen);
 }
 
+/**
+ * @brief Per-run state of `bts_fixed_interp_flow_gen` and `csv_fixed_interp_flow_gen`.
+ */
+typedef struct
+{
+	double *flow_speed;
+	double *time_sec;          // sim current time, updated outside this funciton.
+	double *flow_time_step_dt; // flow series time step
+	double *dt_sec;            // simulation time step
+	double *dur_sec;
+
+	double *vel_data;
+	int vel_data_count;
+
+	double total_time;
+	double *flow_total_time;
+
+	// precomputed array for flow interpolation values at simulation time steps.
+	double *precomputed_flow_interp;
+	int num_sim_steps;
+	flow_cache_view_t flow_cache_view; // mapped .xfeflow cache, map_base is NULL when not in use
+	bool owns_series;                  // series was loaded (not attached) by this run
+
+	int *data_processing_first_run;
+	int *data_processing_single_run_only;
+
+	const char *flow_gen_file_location_and_or_name;
+} fixed_interp_flow_gen_state_t;
+
+/**
+ * @brief Releases the series held by a fixed interp flow_gen run. Safe to call more than once.
+ */
+static void release_fixed_interp_flow_gen_state(void *state_ptr)
+{
+	fixed_interp_flow_gen_state_t *state = state_ptr;
+	if (state->owns_series)
+	{
+		if (state->flow_cache_view.map_base)
+		{
+			flow_cache_close(&state->flow_cache_view);
+		}
+		else
+		{
+			free(state->precomputed_flow_interp);
+			free(state->vel_data);
+		}
+		state->owns_series = false;
+	}
+	state->precomputed_flow_interp = NULL;
+	state->vel_data = NULL;
+	destroy_shared_interp();
+}
+
+/**
+ * @brief Interpolates the raw series onto every simulation step, `total_time / dt_sec + 1` samples.
+ *
+ * @param raw_dt  Time step of `state->vel_data`.
+ * @return 0 on success, -1 (with `shutdownFlag` set) if the allocation fails.
+ */
+static int precompute_fixed_interp_series(fixed_interp_flow_gen_state_t *state, const double raw_dt)
+{
+	// Number of simulation steps is based on total_time and dt_sec.
+	state->num_sim_steps = (int)(state->total_time / (*state->dt_sec)) + 1;
+	state->precomputed_flow_interp = (double *)malloc(state->num_sim_steps * sizeof(double));
+	if (state->precomputed_flow_interp == NULL)
+	{
+		ERROR_MESSAGE("Error: Could not allocate precomputed_flow_interp.\n");
+		shutdownFlag = 1;
+		return -1;
+	}
+	for (int i = 0; i < state->num_sim_steps; i++)
+	{
+		double sim_time = i * (*state->dt_sec);
+		// Use your existing interpolation function to compute the flow speed at sim_time.
+		state->precomputed_flow_interp[i] = interpolate_umag(state->vel_data, state->vel_data_count, sim_time, raw_dt);
+	}
+	return 0;
+}
+
+/**
+ * @brief Layers the loaded series' total time into the config and shares the series with the workers.
+ */
+static void publish_fixed_interp_series(fixed_interp_flow_gen_state_t *state, const param_array_t *fixed_data)
+{
+	set_config_override("flow_total_time", INPUT_PARAM_DOUBLE, &state->total_time);
+
+	state->owns_series = true;
+	create_shared_interp(fixed_data, state->flow_gen_file_location_and_or_name, state->precomputed_flow_interp, state->num_sim_steps, *state->dt_sec, state->total_time);
+	set_config_override("flow_shmem_name", INPUT_PARAM_STRING, shared_interp_name());
+}
+
+/**
+ * @brief Maps the series the data-processing parent published; the count and total time come from the segment header.
+ *
+ * @return 0 on success, -1 (with `shutdownFlag` set) if the segment cannot be attached.
+ */
+static int attach_fixed_interp_series(fixed_interp_flow_gen_state_t *state, const param_array_t *dynamic_data)
+{
+	const char *flow_shmem_name = get_param_string_or_default(dynamic_data, "flow_shmem_name", "");
+	state->precomputed_flow_interp = (double *)get_shared_interp(flow_shmem_name, state->flow_gen_file_location_and_or_name, *state->dt_sec, &state->num_sim_steps, &state->total_time);
+	*state->flow_total_time = state->total_time;
+
+	if (state->precomputed_flow_interp == NULL)
+	{
+		ERROR_MESSAGE("Error: Could not allocate precomputed_flow_interp.\n");
+		shutdownFlag = 1;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Samples the precomputed series at `time_sec`, shared by the fixed interp flow_gens.
+ *
+ * - Computes the exact index `t_sim/dt_sec`, clamped within bounds.
+ * - Uses the precomputed value on a grid point, otherwise interpolates the raw series.
+ * - Past the end of the series holds the last value (`FLOW_RUN_AFTER_END`) or sets `shutdownFlag`.
+ * - On shutdown releases the series.
+ */
+static void sample_fixed_interp_series(fixed_interp_flow_gen_state_t *state)
+{
+	// current simulation time in seconds
+	double t_sim = *state->time_sec;
+	double idx_fp = t_sim / (*state->dt_sec);
+	double idx_round = round(idx_fp);
+
+	// clamp to bounds
+	if (idx_round < 0)
+	{
+		idx_round = 0;
+	}
+	else if (idx_round > state->num_sim_steps - 1)
+	{
+		idx_round = state->num_sim_steps - 1;
+	}
+
+	if (fabs(idx_fp - idx_round) < 1e-9)
+	{
+		// “exact” multiple of dt: use precomputed
+		int idx = (int)idx_round;
+		*state->flow_speed = state->precomputed_flow_interp[idx];
+		// log_message("no interp (snapped), idx_fp≈%f, idx=%d\n", idx_fp, idx);
+	}
+	else
+	{
+		// fractional: interpolate on the fly
+		*state->flow_speed = interpolate_umag(state->vel_data, state->vel_data_count, t_sim, *state->flow_time_step_dt);
+		// log_message("interp needed, idx_fp=%f, idx_floor=%d, frac=%f\n", idx_fp, (int)floor(idx_fp), idx_fp - floor(idx_fp));
+	}
+
+	// Check if the simulation time exceeds the available flow data time.
+	if (*state->time_sec > state->total_time)
+	{
+#ifdef FLOW_RUN_AFTER_END
+		// after end-of-data: hold last value steady
+		int last_idx = state->num_sim_steps - 1;
+		*state->flow_speed = state->precomputed_flow_interp[last_idx];
+#else
+		// log_message("Error: Requested time %f exceeds available time %f in flow. Exiting program.\n", *state->time_sec, state->total_time);
+		shutdownFlag = 1;
+#endif
+	}
+
+	if (shutdownFlag)
+	{
+		release_fixed_interp_flow_gen_state(state);
+	}
+}
+
 /**
  * @brief Computes and provides a time‐series of flow speed for the aero model using BTS data.
  *
@@ -73,12 +248,13 @@ __attribute__((constructor)) static void init_flow_gen_hook(void)
  *   1. Reads the full BTS file (`readfile_bts`) into a `bts_data_t` structure.
  *   2. Allocates a temporary array `vel_Data` and extracts the hub‐height flow speed time series
  *      via `u_mag_velocity_for_y_z_position`.
- *   3. Computes `total_Time` and stores it back via `update_csv_value()`.
+ *   3. Computes `total_Time` and layers it into the config snapshot via `set_config_override()`.
  *   4. Precomputes `num_Sim_Steps = total_Time/dt_sec + 1` samples of interpolated flow speed
  *      at simulation intervals (`dt_sec`) using `interpolate_umag`, storing them in
  *      `precomputed_Flow_Interp`.
  *   5. Creates a shared‐memory segment containing `precomputed_Flow_Interp` for other processes.
- * Otherwise, it attaches to the existing shared‐memory interpolation array.
+ * Otherwise, it attaches to the existing shared‐memory interpolation array, taking the sample
+ * count and total time from the validated segment header.
  *
  * On every call, given the current simulation time `time_sec`, it:
  *   - Computes the exact index `t_sim/dt_sec`, clamping within bounds.
@@ -89,52 +265,37 @@ __attribute__((constructor)) static void init_flow_gen_hook(void)
  *     sets `shutdownFlag`, depending on `FLOW_RUN_AFTER_END`.
  *   - On shutdown, cleans up the shared memory and local buffers if this was the first run.
  *
+ * The loaded series is per-run state (`fixed_interp_flow_gen_state_t`), released on shutdown
+ * or when the stage context is reset, so the next run reloads it (from the flow cache when enabled).
+ *
  * @param dynamic_data  Pointer to the parameter array holding dynamic (state) variables.
  * @param fixed_data    Pointer to the parameter array holding fixed configuration variables.
  */
 void bts_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST)
 {
-	static double *flow_Speed = NULL;
-	static double *time_Sec = NULL;          // sim current time, updated outside this funciton.
-	static double *flow_Time_Step_Dt = NULL; // flow series time step
-	static double *dt_Sec = NULL;            // simulation time step
-	static double *dur_Sec = NULL;
-
-	static double *vel_Data = NULL;
-	static int vel_Data_Count = 0;
-
-	static bts_data_t bts_Data;
-
-	static double total_Time = 0;
-	static double *flow_Total_Time = NULL;
-
-	// New: precomputed array for flow interpolation values at simulation time steps.
-	static double *precomputed_Flow_Interp = NULL;
-	static int num_Sim_Steps = 0;
-
-	static int *data_Processing_First_Run = NULL;
-	static int *data_Processing_Single_Run_Only = NULL;
-
-	static const char *flow_Gen_File_Location_And_Or_Name = NULL;
-
-	static bool first_Run = false;
-	if (!first_Run)
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(fixed_interp_flow_gen_state_t, state, release_fixed_interp_flow_gen_state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
 	{
 		// initialize variables since this is the first time the function is running.
 
-		get_param(dynamic_data, "flow_speed", &flow_Speed);
-		get_param(dynamic_data, "time_sec", &time_Sec);
-		get_param(fixed_data, "dt_sec", &dt_Sec);
-		get_param(fixed_data, "dur_sec", &dur_Sec);
-		get_param(fixed_data, "flow_time_step_dt", &flow_Time_Step_Dt);
-		get_param(dynamic_data, "flow_total_time", &flow_Total_Time);
+		get_param(dynamic_data, "flow_speed", &state->flow_speed);
+		get_param(dynamic_data, "time_sec", &state->time_sec);
+		get_param(fixed_data, "dt_sec", &state->dt_sec);
+		get_param(fixed_data, "dur_sec", &state->dur_sec);
+		get_param(fixed_data, "flow_time_step_dt", &state->flow_time_step_dt);
+		get_param(dynamic_data, "flow_total_time", &state->flow_total_time);
 
-		get_param(fixed_data, "data_processing_first_run", &data_Processing_First_Run);
-		get_param(fixed_data, "data_processing_single_run_only", &data_Processing_Single_Run_Only);
+		get_param(fixed_data, "data_processing_first_run", &state->data_processing_first_run);
+		get_param(fixed_data, "data_processing_single_run_only", &state->data_processing_single_run_only);
 
-		get_param(fixed_data, "flow_gen_file_location_and_or_name", &flow_Gen_File_Location_And_Or_Name);
+		get_param(fixed_data, "flow_gen_file_location_and_or_name", &state->flow_gen_file_location_and_or_name);
 
-		if (*data_Processing_First_Run || *data_Processing_Single_Run_Only)
+		if (*state->data_processing_first_run || *state->data_processing_single_run_only)
 		{
 
 #ifndef FLOW_GEN_FILE_DIR
@@ -143,148 +304,161 @@ void bts_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST)
 			return;
 #endif
 			char flow_filename[PATH_MAX];
-			create_dynamic_file_path(flow_filename, PATH_MAX, "%s/%s", FLOW_GEN_FILE_DIR, flow_Gen_File_Location_And_Or_Name);
+			create_dynamic_file_path(flow_filename, PATH_MAX, "%s/%s", FLOW_GEN_FILE_DIR, state->flow_gen_file_location_and_or_name);
 			if (strlen(flow_filename) < 4 || strcmp(flow_filename + strlen(flow_filename) - 4, ".bts") != 0)
 			{
 				ERROR_MESSAGE("Log file '%s' must end in .bts\n", flow_filename);
 				shutdownFlag = 1;
 				return;
 			}
-			readfile_bts(flow_filename, "int16_t", &bts_Data);
-			// save_velocity_to_csv(&bts_Data, 0, -1, OUTPUT_LOG_FILE_PATH, "bts");
-			// pass negative 1 for hub height
-			// print_velocity_for_y_z_position(&bts_Data, 0, -1);
-			// print_velocity_for_yz(&bts_Data, 12, 12);
-			vel_Data = (double *)malloc(bts_Data.nt * sizeof(double));
-
-			if (vel_Data == NULL)
+			if (flow_cache_is_enabled(fixed_data) && flow_cache_open(fixed_data, flow_filename, *state->dt_sec, *state->flow_time_step_dt, &state->flow_cache_view) == 0)
 			{
-				ERROR_MESSAGE("Error: Could not allocate vel_Data.\n");
-				shutdownFlag = 1;
-				return;
+				// Cache hit: the raw and interpolated series are mapped read-only, no parsing needed.
+				state->vel_data = (double *)state->flow_cache_view.raw;
+				state->vel_data_count = (int)state->flow_cache_view.header->n_raw;
+				state->total_time = state->flow_cache_view.header->total_time;
+				*state->flow_total_time = state->total_time;
+				state->num_sim_steps = (int)state->flow_cache_view.header->n_sim_steps;
+				state->precomputed_flow_interp = (double *)state->flow_cache_view.interp;
 			}
+			else
+			{
+				bts_data_t bts_data;
+				readfile_bts(flow_filename, "int16_t", &bts_data);
+				// save_velocity_to_csv(&bts_data, 0, -1, OUTPUT_LOG_FILE_PATH, "bts");
+				// pass negative 1 for hub height
+				// print_velocity_for_y_z_position(&bts_data, 0, -1);
+				// print_velocity_for_yz(&bts_data, 12, 12);
+				state->vel_data = (double *)malloc(bts_data.nt * sizeof(double));
+
+				if (state->vel_data == NULL)
+				{
+					ERROR_MESSAGE("Error: Could not allocate vel_data.\n");
+					shutdownFlag = 1;
+					return;
+				}
 
-			vel_Data_Count = bts_Data.nt;
+				state->vel_data_count = bts_data.nt;
 
-			// Call the function
-			u_mag_velocity_for_y_z_position(&bts_Data, 0, -1, vel_Data);
+				// Call the function
+				u_mag_velocity_for_y_z_position(&bts_data, 0, -1, state->vel_data);
 
-			// save_umag_velocity_data_to_csv(vel_Data, bts_Data.nt, OUTPUT_LOG_FILE_PATH, "csv", bts_Data.dt);
+				// save_umag_velocity_data_to_csv(state->vel_data, bts_data.nt, OUTPUT_LOG_FILE_PATH, "csv", bts_data.dt);
 
-			// Calculate the total available time
-			total_Time = bts_Data.nt * bts_Data.dt;
-			*flow_Total_Time = total_Time;
+				// Calculate the total available time
+				state->total_time = bts_data.nt * bts_data.dt;
+				*state->flow_total_time = state->total_time;
 
-			// Precompute flow interpolation values for each simulation time step.
-			// Number of simulation steps is based on total_Time and dt_sec.
-			num_Sim_Steps = (int)(total_Time / (*dt_Sec)) + 1;
-			precomputed_Flow_Interp = (double *)malloc(num_Sim_Steps * sizeof(double));
-			if (precomputed_Flow_Interp == NULL)
-			{
-				ERROR_MESSAGE("Error: Could not allocate precomputed_Flow_Interp.\n");
-				shutdownFlag = 1;
-				return;
-			}
-			for (int i = 0; i < num_Sim_Steps; i++)
-			{
-				double sim_time = i * (*dt_Sec);
-				// Use your existing interpolation function to compute the flow speed at sim_time.
-				precomputed_Flow_Interp[i] = interpolate_umag(vel_Data, bts_Data.nt, sim_time, bts_Data.dt);
-			}
+				// Precompute flow interpolation values for each simulation time step.
+				if (precompute_fixed_interp_series(state, bts_data.dt) != 0)
+				{
+					return;
+				}
 
-			update_csv_value(SYSTEM_CONFIG_FULL_PATH, "flow_total_time", INPUT_PARAM_DOUBLE, &total_Time);
+				if (flow_cache_is_enabled(fixed_data))
+				{
+					flow_cache_store(fixed_data, flow_filename, *state->dt_sec, *state->flow_time_step_dt, bts_data.dt, state->total_time, state->precomputed_flow_interp, state->num_sim_steps, state->vel_data, state->vel_data_count);
+				}
+			}
 
-			create_shared_interp(precomputed_Flow_Interp, num_Sim_Steps);
+			publish_fixed_interp_series(state, fixed_data);
 		}
-		else
+		else if (attach_fixed_interp_series(state, dynamic_data) != 0)
 		{
-			total_Time = *flow_Total_Time;
-			num_Sim_Steps = (int)(total_Time / (*dt_Sec)) + 1;
-
-			// Access the precomputed interpolation data.
-			precomputed_Flow_Interp = get_shared_interp(shmemName, num_Sim_Steps);
-
-			if (precomputed_Flow_Interp == NULL)
-			{
-				ERROR_MESSAGE("Error: Could not allocate precomputed_Flow_Interp.\n");
-				shutdownFlag = 1;
-				return;
-			}
-
-			// Use precomputed_Flow_Interp as needed in your simulation.
-			// For example, printing the first value:
-			// log_message("First interpolation value: %f\n", precomputed_Flow_Interp[0]);
+			return;
 		}
-		first_Run = true;
 	}
 
-	// current simulation time in seconds
-	double t_sim = *time_Sec;
-	double idx_fp = t_sim / (*dt_Sec);
-	double idx_round = round(idx_fp);
+	sample_fixed_interp_series(state);
+}
 
-	// clamp to bounds
-	if (idx_round < 0)
+/**
+ * @brief Provides the rotor-disk-averaged flow speed of a BTS grid, precomputed once at load.
+ *
+ * Same lifecycle as `bts_fixed_interp_flow_gen`, but the raw series is the mean velocity
+ * magnitude over every grid point inside the rotor disk (`bts_rotor_average_series`) instead
+ * of the single hub point:
+ *   - The radius is `bts_rotor_radius_m`, or the turbine `R` when that is not positive.
+ *   - `bts_rotor_area_weighted` (default 1) weights each point by the part of its grid cell
+ *     that lies inside the disk; 0 gives every point inside the disk the same weight.
+ * The averaged series is interpolated onto the simulation steps and shared through
+ * `create_shared_interp`, so the per-step cost is the same as the hub-point variant.
+ * The flow cache is not used, its key does not tell a rotor average from a hub series.
+ *
+ * @param dynamic_data  Pointer to the parameter array holding dynamic (state) variables.
+ * @param fixed_data    Pointer to the parameter array holding fixed configuration variables.
+ */
+void bts_rotor_avg_interp_flow_gen(FLOW_GEN_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(fixed_interp_flow_gen_state_t, state, release_fixed_interp_flow_gen_state, first_run);
+	if (!state)
 	{
-		idx_round = 0;
+		return;
 	}
-	else if (idx_round > num_Sim_Steps - 1)
+	if (first_run)
 	{
-		idx_round = num_Sim_Steps - 1;
-	}
+		get_param(dynamic_data, "flow_speed", &state->flow_speed);
+		get_param(dynamic_data, "time_sec", &state->time_sec);
+		get_param(fixed_data, "dt_sec", &state->dt_sec);
+		get_param(fixed_data, "dur_sec", &state->dur_sec);
+		get_param(fixed_data, "flow_time_step_dt", &state->flow_time_step_dt);
+		get_param(dynamic_data, "flow_total_time", &state->flow_total_time);
 
-	if (fabs(idx_fp - idx_round) < 1e-9)
-	{
-		// “exact” multiple of dt: use precomputed
-		int idx = (int)idx_round;
-		*flow_Speed = precomputed_Flow_Interp[idx];
-		// log_message("no interp (snapped), idx_fp≈%f, idx=%d\n", idx_fp, idx);
-	}
-	else
-	{
-		// fractional: interpolate on the fly
-		*flow_Speed = interpolate_umag(vel_Data, vel_Data_Count, t_sim, *flow_Time_Step_Dt);
-		// log_message("interp needed, idx_fp=%f, idx_floor=%d, frac=%f\n", idx_fp, (int)floor(idx_fp), idx_fp - floor(idx_fp));
-	}
+		get_param(fixed_data, "data_processing_first_run", &state->data_processing_first_run);
+		get_param(fixed_data, "data_processing_single_run_only", &state->data_processing_single_run_only);
 
-	// Check if the simulation time exceeds the available flow data time.
-	if (*time_Sec > total_Time)
-	{
-#ifdef FLOW_RUN_AFTER_END
-		// after end-of-data: hold last value steady
-		int last_idx = num_Sim_Steps - 1;
-		*flow_Speed = precomputed_Flow_Interp[last_idx];
-#else
-		// log_message("Error: Requested time %f exceeds available time %f in flow. Exiting program.\n", *time_Sec, total_Time);
-		shutdownFlag = 1;
-#endif
-	}
+		get_param(fixed_data, "flow_gen_file_location_and_or_name", &state->flow_gen_file_location_and_or_name);
 
-	if (shutdownFlag)
-	{
-		if (*data_Processing_First_Run || *data_Processing_Single_Run_Only)
-		{
-			free(precomputed_Flow_Interp);
-			destroy_shared_interp();
-		}
-		else
+		if (*state->data_processing_first_run || *state->data_processing_single_run_only)
 		{
-#ifdef _WIN32
-			if (!UnmapViewOfFile(precomputed_Flow_Interp))
+
+#ifndef FLOW_GEN_FILE_DIR
+			ERROR_MESSAGE("FLOW_GEN_FILE_DIR needs to be defined through cmake, exiting...\n");
+			shutdownFlag = 1;
+			return;
+#endif
+			char flow_filename[PATH_MAX];
+			create_dynamic_file_path(flow_filename, PATH_MAX, "%s/%s", FLOW_GEN_FILE_DIR, state->flow_gen_file_location_and_or_name);
+			if (strlen(flow_filename) < 4 || strcmp(flow_filename + strlen(flow_filename) - 4, ".bts") != 0)
 			{
-				ERROR_MESSAGE("UnmapViewOfFile failed (child)");
-				exit(EXIT_FAILURE);
+				ERROR_MESSAGE("Log file '%s' must end in .bts\n", flow_filename);
+				shutdownFlag = 1;
+				return;
 			}
-#else
-			if (munmap(precomputed_Flow_Interp, num_Sim_Steps * sizeof(double)) == -1)
+
+			double radius_m = get_param_double_or_default(fixed_data, "bts_rotor_radius_m", 0.0);
+			if (radius_m <= 0.0)
 			{
-				ERROR_MESSAGE("munmap (child)");
-				exit(EXIT_FAILURE);
+				radius_m = get_param_double_or_default(fixed_data, "R", 0.0);
 			}
-#endif
-			destroy_shared_interp();
+			const bool area_weighted = get_param_int_or_default(fixed_data, "bts_rotor_area_weighted", 1) != 0;
+
+			double raw_dt = 0.0;
+			if (bts_rotor_average_series(flow_filename, radius_m, area_weighted, &state->vel_data, &state->vel_data_count, &raw_dt) != 0)
+			{
+				shutdownFlag = 1;
+				return;
+			}
+			state->owns_series = true;
+
+			state->total_time = state->vel_data_count * raw_dt;
+			*state->flow_total_time = state->total_time;
+
+			if (precompute_fixed_interp_series(state, raw_dt) != 0)
+			{
+				return;
+			}
+
+			publish_fixed_interp_series(state, fixed_data);
+		}
+		else if (attach_fixed_interp_series(state, dynamic_data) != 0)
+		{
+			return;
 		}
 	}
+
+	sample_fixed_interp_series(state);
 }
 
 /**
@@ -297,74 +471,59 @@ void bts_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST)
  * 2. Validates that `FLOW_CSV_FULL_PATH` is defined; errors out otherwise.
  * 3. If data processing is enabled for the first run or single run only:
  *    - Calls `read_csv_generic()` to read a single-column CSV (flow speed) into a
- *      temporary `double**` (`vel_Data_Temp`) of `num_rows`.
- *    - Flattens `vel_Data_Temp` into a contiguous `vel_Data[]` array (length `num_rows`)
+ *      temporary `double**` (`vel_data_temp`) of `num_rows`.
+ *    - Flattens `vel_data_temp` into a contiguous `vel_data[]` array (length `num_rows`)
  *      and frees the temporary buffers.
- *    - Sets `vel_Data_Count = num_rows` and computes `total_Time = vel_Data_Count * flow_time_step_dt`.
- *    - Stores `total_Time` back into the parameters via `update_csv_value()`.
- *    - Precomputes `num_Sim_Steps = total_Time/dt_sec + 1` samples by interpolating
- *      `vel_Data` at each simulation time step (`dt_sec`) using `interpolate_umag()`,
- *      storing results in `precomputed_Flow_Interp`.
- *    - Creates a shared-memory segment containing `precomputed_Flow_Interp` for use by
+ *    - Sets `vel_data_count = num_rows` and computes `total_time = vel_data_count * flow_time_step_dt`.
+ *    - Layers `total_time` into the config snapshot via `set_config_override()`.
+ *    - Precomputes `num_sim_steps = total_time/dt_sec + 1` samples by interpolating
+ *      `vel_data` at each simulation time step (`dt_sec`) using `interpolate_umag()`,
+ *      storing results in `precomputed_flow_interp`.
+ *    - Creates a shared-memory segment containing `precomputed_flow_interp` for use by
  *      other processes via `create_shared_interp()`.
  * 4. Otherwise (not first run), attaches to existing shared memory via
- *    `get_shared_interp()` to retrieve `precomputed_Flow_Interp`.
+ *    `get_shared_interp()` to retrieve `precomputed_flow_interp`.
  *
  * On every call:
- * - Computes the floating-point index `idx_fp = time_sec/dt_sec`, clamps to [0, num_Sim_Steps-1].
+ * - Computes the floating-point index `idx_fp = time_sec/dt_sec`, clamps to [0, num_sim_steps-1].
  * - If `idx_fp` is within 1e-9 of an integer, uses the corresponding precomputed value;
  *   otherwise performs on-the-fly interpolation via `interpolate_umag()`.
- * - Assigns the resulting flow speed into `*flow_Speed`.
- * - If `time_sec > total_Time`, either holds the last value (`FLOW_RUN_AFTER_END`) or
+ * - Assigns the resulting flow speed into `*flow_speed`.
+ * - If `time_sec > total_time`, either holds the last value (`FLOW_RUN_AFTER_END`) or
  *   sets `shutdownFlag` to terminate.
  * - On shutdown, if this was the initial data-processing run, frees the shared memory
  *   (`destroy_shared_interp()`).
+ * - Shares its per-run state layout and release hook with `bts_fixed_interp_flow_gen`.
  *
  * @param dynamic_data  Pointer to the `param_array_t` containing dynamic parameters.
  * @param fixed_data    Pointer to the `param_array_t` containing fixed parameters.
  */
 void csv_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST)
 {
-	static double *flow_Speed = NULL;
-	static double *time_Sec = NULL;          // sim current time, updated outside this funciton.
-	static double *flow_Time_Step_Dt = NULL; // flow series time step
-	static double *dt_Sec = NULL;            // simulation time step
-	static double *dur_Sec = NULL;
-
-	static double *vel_Data = NULL;
-	static int vel_Data_Count = 0;
-
-	static double **vel_Data_Temp = NULL;
+	double **vel_data_temp = NULL;
 	int num_rows = 0;
 
-	static double total_Time = 0;
-	static double *flow_Total_Time = NULL;
-
-	// New: precomputed array for flow interpolation values at simulation time steps.
-	static double *precomputed_Flow_Interp = NULL;
-	static int num_Sim_Steps = 0;
-
-	static int *data_Processing_First_Run = NULL;
-	static int *data_Processing_Single_Run_Only = NULL;
-
-	static const char *flow_Gen_File_Location_And_Or_Name = NULL;
-
-	static bool first_Run = false;
-	if (!first_Run)
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(fixed_interp_flow_gen_state_t, state, release_fixed_interp_flow_gen_state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
 	{
 		// initialize variables since this is the first time the function is running.
 
-		get_param(dynamic_data, "flow_speed", &flow_Speed);
-		get_param(dynamic_data, "time_sec", &time_Sec);
-		get_param(fixed_data, "dt_sec", &dt_Sec);
-		get_param(fixed_data, "dur_sec", &dur_Sec);
-		get_param(fixed_data, "flow_time_step_dt", &flow_Time_Step_Dt);
-		get_param(dynamic_data, "flow_total_time", &flow_Total_Time);
+		get_param(dynamic_data, "flow_speed", &state->flow_speed);
+		get_param(dynamic_data, "time_sec", &state->time_sec);
+		get_param(fixed_data, "dt_sec", &state->dt_sec);
+		get_param(fixed_data, "dur_sec", &state->dur_sec);
+		get_param(fixed_data, "flow_time_step_dt", &state->flow_time_step_dt);
+		get_param(dynamic_data, "flow_total_time", &state->flow_total_time);
 
-		get_param(fixed_data, "data_processing_first_run", &data_Processing_First_Run);
-		get_param(fixed_data, "data_processing_single_run_only", &data_Processing_Single_Run_Only);
+		get_param(fixed_data, "data_processing_first_run", &state->data_processing_first_run);
+		get_param(fixed_data, "data_processing_single_run_only", &state->data_processing_single_run_only);
 
-		get_param(fixed_data, "flow_gen_file_location_and_or_name", &flow_Gen_File_Location_And_Or_Name);
+		get_param(fixed_data, "flow_gen_file_location_and_or_name", &state->flow_gen_file_location_and_or_name);
 
 #ifndef FLOW_GEN_FILE_DIR
 		ERROR_MESSAGE("FLOW_GEN_FILE_DIR needs to be defined through cmake, exiting...\n");
@@ -372,7 +531,7 @@ void csv_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST)
 		return;
 #endif
 		char flow_filename[PATH_MAX];
-		create_dynamic_file_path(flow_filename, PATH_MAX, "%s/%s", FLOW_GEN_FILE_DIR, flow_Gen_File_Location_And_Or_Name);
+		create_dynamic_file_path(flow_filename, PATH_MAX, "%s/%s", FLOW_GEN_FILE_DIR, state->flow_gen_file_location_and_or_name);
 		if (strlen(flow_filename) < 4 || strcmp(flow_filename + strlen(flow_filename) - 4, ".csv") != 0)
 		{
 			ERROR_MESSAGE("Log file '%s' must end in .csv\n", flow_filename);
@@ -380,103 +539,121 @@ void csv_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST)
 			return;
 		}
 
-		if (*data_Processing_First_Run || *data_Processing_Single_Run_Only)
+		if (*state->data_processing_first_run || *state->data_processing_single_run_only)
 		{
-			// Example: call read_csv_generic to retrieve a single-column CSV as double**
-			vel_Data_Temp = (double **)read_csv_generic(flow_filename, &num_rows, 1, DATA_TYPE_DOUBLE);
-			if (vel_Data_Temp == NULL)
+			if (flow_cache_is_enabled(fixed_data) && flow_cache_open(fixed_data, flow_filename, *state->dt_sec, *state->flow_time_step_dt, &state->flow_cache_view) == 0)
 			{
-				ERROR_MESSAGE("Error: vel_Data_Temp is NULL, could not read CSV.\n");
-				shutdownFlag = 1;
-				return;
+				// Cache hit: the raw and interpolated series are mapped read-only, no parsing needed.
+				state->vel_data = (double *)state->flow_cache_view.raw;
+				state->vel_data_count = (int)state->flow_cache_view.header->n_raw;
+				state->total_time = state->flow_cache_view.header->total_time;
+				*state->flow_total_time = state->total_time;
+				state->num_sim_steps = (int)state->flow_cache_view.header->n_sim_steps;
+				state->precomputed_flow_interp = (double *)state->flow_cache_view.interp;
 			}
-
-			// Allocate a single contiguous array to hold all rows in a single column
-			vel_Data = (double *)malloc(num_rows * sizeof(double));
-			if (vel_Data == NULL)
+			else
 			{
-				ERROR_MESSAGE("Error: Could not allocate vel_Data.\n");
-				// Clean up vel_Data_Temp before exiting
-				for (int i = 0; i < num_rows; i++)
+				// Example: call read_csv_generic to retrieve a single-column CSV as double**
+				vel_data_temp = (double **)read_csv_generic(flow_filename, &num_rows, 1, DATA_TYPE_DOUBLE);
+				if (vel_data_temp == NULL)
 				{
-					free(vel_Data_Temp[i]);
+					ERROR_MESSAGE("Error: vel_data_temp is NULL, could not read CSV.\n");
+					shutdownFlag = 1;
+					return;
 				}
-				free((void *)vel_Data_Temp);
-				vel_Data_Temp = NULL;
 
-				shutdownFlag = 1;
-				return;
-			}
+				// Allocate a single contiguous array to hold all rows in a single column
+				state->vel_data = (double *)malloc(num_rows * sizeof(double));
+				if (state->vel_data == NULL)
+				{
+					ERROR_MESSAGE("Error: Could not allocate vel_data.\n");
+					// Clean up vel_data_temp before exiting
+					for (int i = 0; i < num_rows; i++)
+					{
+						free(vel_data_temp[i]);
+					}
+					free((void *)vel_data_temp);
+					vel_data_temp = NULL;
+
+					shutdownFlag = 1;
+					return;
+				}
 
-			vel_Data_Count = num_rows;
+				state->vel_data_count = num_rows;
 
-			// Flatten the 2D data (num_rows x 1) into the 1D array vel_Data
-			for (int i = 0; i < num_rows; i++)
-			{
-				vel_Data[i] = vel_Data_Temp[i][0];
-			}
+				// Flatten the 2D data (num_rows x 1) into the 1D array vel_data
+				for (int i = 0; i < num_rows; i++)
+				{
+					state->vel_data[i] = vel_data_temp[i][0];
+				}
 
-			// We can now free vel_Data_Temp since vel_Data is holding the actual numbers
-			for (int i = 0; i < num_rows; i++)
-			{
-				free(vel_Data_Temp[i]); // free each row
-			}
-			free((void *)vel_Data_Temp); // free the array of pointers
-			vel_Data_Temp = NULL;
+				// We can now free vel_data_temp since vel_data is holding the actual numbers
+				for (int i = 0; i < num_rows; i++)
+				{
+					free(vel_data_temp[i]); // free each row
+				}
+				free((void *)vel_data_temp); // free the array of pointers
+				vel_data_temp = NULL;
 
-			// save_umag_velocity_data_to_csv(vel_Data, num_rows, OUTPUT_LOG_FILE_PATH, "csv", *flow_Time_Step_Dt);
+				// save_umag_velocity_data_to_csv(state->vel_data, num_rows, OUTPUT_LOG_FILE_PATH, "csv", *state->flow_time_step_dt);
 
-			// Calculate the total available time
-			total_Time = vel_Data_Count * *flow_Time_Step_Dt;
-			*flow_Total_Time = total_Time;
+				// Calculate the total available time
+				state->total_time = state->vel_data_count * *state->flow_time_step_dt;
+				*state->flow_total_time = state->total_time;
 
-			// Precompute flow interpolation values for each simulation time step.
-			// Number of simulation steps is based on total_Time and dt_sec.
-			num_Sim_Steps = (int)(total_Time / (*dt_Sec)) + 1;
-			precomputed_Flow_Interp = (double *)malloc(num_Sim_Steps * sizeof(double));
-			if (precomputed_Flow_Interp == NULL)
-			{
-				ERROR_MESSAGE("Error: Could not allocate precomputed_Flow_Interp.\n");
-				shutdownFlag = 1;
-				return;
-			}
-			for (int i = 0; i < num_Sim_Steps; i++)
-			{
-				double sim_time = i * (*dt_Sec);
-				// Use your existing interpolation function to compute the flow speed at sim_time.
-				precomputed_Flow_Interp[i] = interpolate_umag(vel_Data, vel_Data_Count, sim_time, *flow_Time_Step_Dt);
+				// Precompute flow interpolation values for each simulation time step.
+				// Number of simulation steps is based on total_time and dt_sec.
+				state->num_sim_steps = (int)(state->total_time / (*state->dt_sec)) + 1;
+				state->precomputed_flow_interp = (double *)malloc(state->num_sim_steps * sizeof(double));
+				if (state->precomputed_flow_interp == NULL)
+				{
+					ERROR_MESSAGE("Error: Could not allocate precomputed_flow_interp.\n");
+					shutdownFlag = 1;
+					return;
+				}
+				for (int i = 0; i < state->num_sim_steps; i++)
+				{
+					double sim_time = i * (*state->dt_sec);
+					// Use your existing interpolation function to compute the flow speed at sim_time.
+					state->precomputed_flow_interp[i] = interpolate_umag(state->vel_data, state->vel_data_count, sim_time, *state->flow_time_step_dt);
+				}
+
+				if (flow_cache_is_enabled(fixed_data))
+				{
+					flow_cache_store(fixed_data, flow_filename, *state->dt_sec, *state->flow_time_step_dt, *state->flow_time_step_dt, state->total_time, state->precomputed_flow_interp, state->num_sim_steps, state->vel_data, state->vel_data_count);
+				}
 			}
 
-			update_csv_value(SYSTEM_CONFIG_FULL_PATH, "flow_total_time", INPUT_PARAM_DOUBLE, &total_Time);
+			set_config_override("flow_total_time", INPUT_PARAM_DOUBLE, &state->total_time);
 
-			create_shared_interp(precomputed_Flow_Interp, num_Sim_Steps);
+			state->owns_series = true;
+			create_shared_interp(fixed_data, state->flow_gen_file_location_and_or_name, state->precomputed_flow_interp, state->num_sim_steps, *state->dt_sec, state->total_time);
+			set_config_override("flow_shmem_name", INPUT_PARAM_STRING, shared_interp_name());
 		}
 		else
 		{
-			total_Time = *flow_Total_Time;
-			num_Sim_Steps = (int)(total_Time / (*dt_Sec)) + 1;
-
-			// Access the precomputed interpolation data.
-			precomputed_Flow_Interp = get_shared_interp(shmemName, num_Sim_Steps);
+			// Access the precomputed interpolation data; the count and total time come from the segment header.
+			const char *flow_shmem_name = get_param_string_or_default(dynamic_data, "flow_shmem_name", "");
+			state->precomputed_flow_interp = (double *)get_shared_interp(flow_shmem_name, state->flow_gen_file_location_and_or_name, *state->dt_sec, &state->num_sim_steps, &state->total_time);
+			*state->flow_total_time = state->total_time;
 
-			if (precomputed_Flow_Interp == NULL)
+			if (state->precomputed_flow_interp == NULL)
 			{
-				ERROR_MESSAGE("Error: Could not allocate precomputed_Flow_Interp.\n");
+				ERROR_MESSAGE("Error: Could not allocate precomputed_flow_interp.\n");
 				shutdownFlag = 1;
 				return;
 			}
 
-			// Use precomputed_Flow_Interp as needed in your simulation.
+			// Use precomputed_flow_interp as needed in your simulation.
 			// For example, printing the first value:
-			// log_message("First interpolation value: %f\n", precomputed_Flow_Interp[0]);
+			// log_message("First interpolation value: %f\n", state->precomputed_flow_interp[0]);
 		}
 
-		first_Run = true;
 	}
 
 	// current simulation time in seconds
-	double t_sim = *time_Sec;
-	double idx_fp = t_sim / (*dt_Sec);
+	double t_sim = *state->time_sec;
+	double idx_fp = t_sim / (*state->dt_sec);
 	double idx_round = round(idx_fp);
 
 	// clamp to bounds
@@ -484,68 +661,151 @@ void csv_fixed_interp_flow_gen(FLOW_GEN_PARAM_LIST)
 	{
 		idx_round = 0;
 	}
-	else if (idx_round > num_Sim_Steps - 1)
+	else if (idx_round > state->num_sim_steps - 1)
 	{
-		idx_round = num_Sim_Steps - 1;
+		idx_round = state->num_sim_steps - 1;
 	}
 
 	if (fabs(idx_fp - idx_round) < 1e-9)
 	{
 		// “exact” multiple of dt: use precomputed
 		int idx = (int)idx_round;
-		*flow_Speed = precomputed_Flow_Interp[idx];
+		*state->flow_speed = state->precomputed_flow_interp[idx];
 		// log_message("no interp (snapped), idx_fp≈%f, idx=%d\n", idx_fp, idx);
 	}
 	else
 	{
 		// fractional: interpolate on the fly
-		*flow_Speed = interpolate_umag(vel_Data, vel_Data_Count, t_sim, *flow_Time_Step_Dt);
+		*state->flow_speed = interpolate_umag(state->vel_data, state->vel_data_count, t_sim, *state->flow_time_step_dt);
 		// log_message("interp needed, idx_fp=%f, idx_floor=%d, frac=%f\n", idx_fp, (int)floor(idx_fp), idx_fp - floor(idx_fp));
 	}
 
-	// if (*flow_Speed > 6.0)
+	// if (*state->flow_speed > 6.0)
 	// {
-	// 	*flow_Speed = 6.0;
+	// 	*state->flow_speed = 6.0;
 	// }
 
-	// *flow_Speed = *flow_Speed / 2.5;
+	// *state->flow_speed = *state->flow_speed / 2.5;
 
 	// Check if the simulation time exceeds the available flow data time.
-	if (*time_Sec > total_Time)
+	if (*state->time_sec > state->total_time)
 	{
 #ifdef FLOW_RUN_AFTER_END
 		// after end-of-data: hold last value steady
-		int last_idx = num_Sim_Steps - 1;
-		*flow_Speed = precomputed_Flow_Interp[last_idx];
+		int last_idx = state->num_sim_steps - 1;
+		*state->flow_speed = state->precomputed_flow_interp[last_idx];
 #else
-		// log_message("Error: Requested time %f exceeds available time %f in flow. Exiting program.\n", *time_Sec, total_Time);
+		// log_message("Error: Requested time %f exceeds available time %f in flow. Exiting program.\n", *state->time_sec, state->total_time);
 		shutdownFlag = 1;
 #endif
 	}
 
 	if (shutdownFlag)
 	{
-		if (*data_Processing_First_Run || *data_Processing_Single_Run_Only)
+		release_fixed_interp_flow_gen_state(state);
+	}
+}
+
+/**
+ * @brief Per-run state of `stream_interp_flow_gen`.
+ */
+typedef struct
+{
+	double *flow_speed;
+	double *time_sec;
+	double *flow_time_step_dt;
+	double *flow_total_time;
+	const char *flow_gen_file_location_and_or_name;
+	bool total_time_published;
+} stream_interp_flow_gen_state_t;
+
+static void release_stream_interp_flow_gen_state(MAYBE_UNUSED void *state)
+{
+	flow_stream_close();
+}
+
+/**
+ * @brief Streams the flow speed from a long .bts or .csv series with bounded memory.
+ *
+ * Unlike `bts_fixed_interp_flow_gen`/`csv_fixed_interp_flow_gen`, nothing is loaded or
+ * precomputed up front: `flow_stream_open()` starts a prefetch thread that reads the file
+ * in chunks, decodes only the selected grid point of a .bts file, and keeps a window of
+ * raw samples ahead of `time_sec`. Each call linearly interpolates between the two raw
+ * samples around `time_sec`, which gives the same values as `interpolate_umag()`.
+ *
+ * Optional fixed parameters:
+ * - `flow_stream_window_samples`: raw samples held ahead of the simulation (default 8192).
+ * - `flow_stream_chunk_steps`: samples decoded per read (default 256).
+ * - `flow_stream_y_position`, `flow_stream_z_position`: .bts grid point in m (defaults 0 and -1, hub height).
+ *
+ * `flow_total_time` is written back once it is known: immediately for .bts (from the header),
+ * at end of file for .csv. Past the end of the series the last value is held under
+ * `FLOW_RUN_AFTER_END`, otherwise `shutdownFlag` is set. Every process streams its own
+ * copy, so no shared-memory interpolation array is created.
+ *
+ * @param dynamic_data  Pointer to the parameter array holding dynamic (state) variables.
+ * @param fixed_data    Pointer to the parameter array holding fixed configuration variables.
+ */
+void stream_interp_flow_gen(FLOW_GEN_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE_WITH_RELEASE(stream_interp_flow_gen_state_t, state, release_stream_interp_flow_gen_state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
+	{
+		get_param(dynamic_data, "flow_speed", &state->flow_speed);
+		get_param(dynamic_data, "time_sec", &state->time_sec);
+		get_param(fixed_data, "flow_time_step_dt", &state->flow_time_step_dt);
+		get_param(dynamic_data, "flow_total_time", &state->flow_total_time);
+		get_param(fixed_data, "flow_gen_file_location_and_or_name", &state->flow_gen_file_location_and_or_name);
+
+#ifndef FLOW_GEN_FILE_DIR
+		ERROR_MESSAGE("FLOW_GEN_FILE_DIR needs to be defined through cmake, exiting...\n");
+		shutdownFlag = 1;
+		return;
+#endif
+		char flow_filename[PATH_MAX];
+		create_dynamic_file_path(flow_filename, PATH_MAX, "%s/%s", FLOW_GEN_FILE_DIR, state->flow_gen_file_location_and_or_name);
+
+		const int window_samples = get_param_int_or_default(fixed_data, "flow_stream_window_samples", FLOW_STREAM_DEFAULT_WINDOW_SAMPLES);
+		const int chunk_steps = get_param_int_or_default(fixed_data, "flow_stream_chunk_steps", FLOW_STREAM_DEFAULT_CHUNK_STEPS);
+		const double y_position = get_param_double_or_default(fixed_data, "flow_stream_y_position", 0.0);
+		const double z_position = get_param_double_or_default(fixed_data, "flow_stream_z_position", -1.0);
+
+		if (flow_stream_open(flow_filename, *state->flow_time_step_dt, y_position, z_position, window_samples, chunk_steps) != 0)
 		{
-			free(precomputed_Flow_Interp);
-			destroy_shared_interp();
+			ERROR_MESSAGE("Error: Could not open flow stream %s\n", flow_filename);
+			shutdownFlag = 1;
+			return;
 		}
-		else
-		{
-#ifdef _WIN32
-			if (!UnmapViewOfFile(precomputed_Flow_Interp))
-			{
-				ERROR_MESSAGE("UnmapViewOfFile failed (child)\n");
-				exit(EXIT_FAILURE);
-			}
-#else
-			if (munmap(precomputed_Flow_Interp, num_Sim_Steps * sizeof(double)) == -1)
-			{
-				ERROR_MESSAGE("munmap (child)\n");
-				exit(EXIT_FAILURE);
-			}
+	}
+
+	if (!state->total_time_published && flow_stream_total_time_known())
+	{
+		double total_time = flow_stream_total_time();
+		*state->flow_total_time = total_time;
+		set_config_override("flow_total_time", INPUT_PARAM_DOUBLE, &total_time);
+		state->total_time_published = true;
+	}
+
+	bool past_end = false;
+	if (flow_stream_sample(*state->time_sec, state->flow_speed, &past_end) != 0)
+	{
+		shutdownFlag = 1;
+	}
+	else if (past_end)
+	{
+#ifndef FLOW_RUN_AFTER_END
+		// log_message("Error: Requested time %f exceeds available time %f in flow. Exiting program.\n", *state->time_sec, *state->flow_total_time);
+		shutdownFlag = 1;
 #endif
-			destroy_shared_interp();
-		}
+	}
+
+	if (shutdownFlag)
+	{
+		flow_stream_close();
 	}
 }
@@ -0,0 +1,361 @@
+/**
+ * @file    flow_shmem.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Named shared-memory segments holding one or more validated flow series
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN(llvm-include-order)
+#include "flow_shmem.h"
+#include "logger.h"        // for log_message, ERROR_MESSAGE
+#include "shmem_segment.h" // for shmem_segment_create, shmem_segment_close, shmem_word_checksum
+#include "xflow_core.h"    // for safe_snprintf, safe_strerror
+#include <stdbool.h>       // IWYU pragma: keep
+#include <stddef.h>        // for size_t, NULL
+#include <stdint.h>        // for uint64_t, int64_t
+#include <string.h>        // for memcpy, memcmp, memset, strncmp, strnlen
+
+#ifdef _WIN32
+#include <windows.h> // for OpenFileMappingA, MapViewOfFile, VirtualQuery
+#else
+#include <errno.h>    // for errno
+#include <fcntl.h>    // for O_RDONLY
+#include <sys/mman.h> // for shm_open, shm_unlink, mmap, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close, getpid, pid_t
+#endif
+// NOLINTEND(llvm-include-order)
+
+// The segment this process published, kept so it can be removed at shutdown.
+static char publishedName[FLOW_SHMEM_SEGMENT_NAME_MAX] = "";
+#ifdef _WIN32
+static shmem_segment_t publishedSegment; // the segment lives as long as its handle is open
+#else
+static pid_t publisherPid = 0; // a forked child (e.g. a sweep case) inherits publishedName but must not unlink it
+#endif
+
+/**
+ * @brief Builds a segment name unique to this process, e.g. `/xfe_flow_12345`.
+ *
+ * Two runs on the same machine get different names, so concurrent sweeps no longer
+ * overwrite each other's flow data.
+ *
+ * @param out       Receives the name.
+ * @param out_size  Size of `out`.
+ * @param prefix    Name prefix, or NULL for `FLOW_SHMEM_DEFAULT_PREFIX`.
+ * @return          0 on success, -1 if the name does not fit.
+ */
+int flow_shmem_make_name(char *out, const size_t out_size, const char *prefix)
+{
+	if (!prefix || prefix[0] == '\0')
+	{
+		prefix = FLOW_SHMEM_DEFAULT_PREFIX;
+	}
+#ifdef _WIN32
+	const int rc = safe_snprintf(out, out_size, "Local\\%s_%lu", prefix, (unsigned long)GetCurrentProcessId());
+#else
+	const int rc = safe_snprintf(out, out_size, "/%s_%ld", prefix, (long)getpid());
+#endif
+	if (rc < 0)
+	{
+		ERROR_MESSAGE("Shared flow segment name too long for prefix '%s'\n", prefix);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Fills a freshly created, zeroed segment. The magic is written last so a reader
+ * never accepts a half-filled segment.
+ */
+static void fill_segment(unsigned char *base, const size_t total, const flow_shmem_series_desc_t *series, const int n_series)
+{
+	flow_shmem_header_t *header = (flow_shmem_header_t *)base;
+	flow_shmem_series_t *table = (flow_shmem_series_t *)(base + sizeof(flow_shmem_header_t));
+	uint64_t offset = sizeof(flow_shmem_header_t) + ((uint64_t)n_series * sizeof(flow_shmem_series_t));
+
+	for (int i = 0; i < n_series; i++)
+	{
+		const size_t name_len = series[i].name ? strnlen(series[i].name, FLOW_SHMEM_SERIES_NAME_MAX - 1) : 0;
+		if (name_len > 0)
+		{
+			memcpy(table[i].name, series[i].name, name_len); // the segment is zeroed, so the name stays terminated
+		}
+		table[i].dt = series[i].dt;
+		table[i].total_time = series[i].total_time;
+		table[i].offset = offset;
+		table[i].count = series[i].count;
+		const size_t bytes = (size_t)series[i].count * sizeof(double);
+		if (bytes > 0)
+		{
+			memcpy(base + offset, series[i].values, bytes);
+		}
+		offset += bytes;
+	}
+
+	header->version = FLOW_SHMEM_VERSION;
+	header->header_size = sizeof(flow_shmem_header_t);
+	header->n_series = (uint32_t)n_series;
+	header->series_entry_size = sizeof(flow_shmem_series_t);
+	header->total_bytes = total;
+	header->checksum = shmem_word_checksum(base + sizeof(flow_shmem_header_t), total - sizeof(flow_shmem_header_t));
+	memcpy(header->magic, FLOW_SHMEM_MAGIC, FLOW_SHMEM_MAGIC_SIZE);
+}
+
+/**
+ * @brief Publishes `n_series` flow series in one named segment.
+ *
+ * The segment stays available until `flow_shmem_unpublish()`; a process publishes at most
+ * one segment at a time, which can hold every series its children need (e.g. all training
+ * flows of a sweep).
+ *
+ * @param segment_name  Name from `flow_shmem_make_name()`.
+ * @param series        Series to copy in; names should be unique within the segment.
+ * @param n_series      Number of entries in `series`.
+ * @return              0 on success, -1 on failure.
+ */
+int flow_shmem_publish(const char *segment_name, const flow_shmem_series_desc_t *series, const int n_series)
+{
+	if (publishedName[0] != '\0')
+	{
+		ERROR_MESSAGE("Shared flow segment %s is already published\n", publishedName);
+		return -1;
+	}
+	if (!segment_name || !series || n_series <= 0)
+	{
+		ERROR_MESSAGE("Invalid arguments to flow_shmem_publish\n");
+		return -1;
+	}
+
+	size_t total = sizeof(flow_shmem_header_t) + ((size_t)n_series * sizeof(flow_shmem_series_t));
+	for (int i = 0; i < n_series; i++)
+	{
+		if (series[i].count < 0 || (series[i].count > 0 && !series[i].values))
+		{
+			ERROR_MESSAGE("Shared flow series %d has no data\n", i);
+			return -1;
+		}
+		total += (size_t)series[i].count * sizeof(double);
+	}
+
+	shmem_segment_t segment;
+	if (shmem_segment_create(segment_name, total, &segment) != 0)
+	{
+		return -1;
+	}
+	fill_segment((unsigned char *)segment.base, total, series, n_series);
+#ifdef _WIN32
+	publishedSegment = segment;
+#else
+	shmem_segment_close(&segment);
+#endif
+
+	safe_snprintf(publishedName, sizeof(publishedName), "%s", segment_name);
+#ifndef _WIN32
+	publisherPid = getpid();
+#endif
+	log_message("Published %d flow series (%zu bytes) in %s\n", n_series, total, segment_name);
+	return 0;
+}
+
+/**
+ * @brief Removes the segment published by this process. Existing mappings in other
+ * processes stay valid until they detach. Safe to call when nothing was published, and in a
+ * forked child of the publisher, which only forgets the inherited name.
+ */
+void flow_shmem_unpublish(void)
+{
+	if (publishedName[0] == '\0')
+	{
+		return;
+	}
+#ifdef _WIN32
+	shmem_segment_close(&publishedSegment);
+#else
+	if (publisherPid != getpid())
+	{
+		publishedName[0] = '\0'; // inherited across fork(); the publisher removes it
+		return;
+	}
+	if (shm_unlink(publishedName) == -1)
+	{
+		ERROR_MESSAGE("shm_unlink %s failed: %s\n", publishedName, safe_strerror(errno));
+	}
+#endif
+	publishedName[0] = '\0';
+}
+
+/**
+ * @brief Checks the header, the series table bounds and the checksum of a mapped segment.
+ */
+static int validate_segment(const unsigned char *base, const size_t map_size, const char *segment_name)
+{
+	const flow_shmem_header_t *header = (const flow_shmem_header_t *)base;
+	if (memcmp(header->magic, FLOW_SHMEM_MAGIC, FLOW_SHMEM_MAGIC_SIZE) != 0 || header->version != FLOW_SHMEM_VERSION || header->header_size != sizeof(flow_shmem_header_t) || header->series_entry_size != sizeof(flow_shmem_series_t))
+	{
+		ERROR_MESSAGE("%s is not a version %u flow segment\n", segment_name, FLOW_SHMEM_VERSION);
+		return -1;
+	}
+	const uint64_t table_end = sizeof(flow_shmem_header_t) + ((uint64_t)header->n_series * sizeof(flow_shmem_series_t));
+	if (header->total_bytes > map_size || table_end > header->total_bytes)
+	{
+		ERROR_MESSAGE("%s: header claims %llu bytes, mapping has %zu\n", segment_name, (unsigned long long)header->total_bytes, map_size);
+		return -1;
+	}
+	const flow_shmem_series_t *table = (const flow_shmem_series_t *)(base + sizeof(flow_shmem_header_t));
+	for (uint32_t i = 0; i < header->n_series; i++)
+	{
+		if (table[i].count < 0 || table[i].offset < table_end || table[i].offset % sizeof(double) != 0 || table[i].offset + ((uint64_t)table[i].count * sizeof(double)) > header->total_bytes)
+		{
+			ERROR_MESSAGE("%s: series %u lies outside the segment\n", segment_name, i);
+			return -1;
+		}
+	}
+	if (shmem_word_checksum(base + sizeof(flow_shmem_header_t), (size_t)header->total_bytes - sizeof(flow_shmem_header_t)) != header->checksum)
+	{
+		ERROR_MESSAGE("%s: checksum mismatch\n", segment_name);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Maps a published segment read-only and validates it.
+ *
+ * The sizes come from the segment header, so the caller does not need to know how many
+ * samples were published.
+ *
+ * @param segment_name  Name the publisher used (see `FLOW_SHMEM_ENV_NAME`).
+ * @param view          Receives the mapping; release it with `flow_shmem_detach()`.
+ * @return              0 on success, -1 on failure (nothing stays mapped).
+ */
+int flow_shmem_attach(const char *segment_name, flow_shmem_view_t *view)
+{
+	memset(view, 0, sizeof(*view));
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, segment_name);
+	if (mapping == NULL)
+	{
+		ERROR_MESSAGE("OpenFileMapping %s failed: %ld\n", segment_name, GetLastError());
+		return -1;
+	}
+	void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); // the view keeps the section alive
+	if (base == NULL)
+	{
+		ERROR_MESSAGE("MapViewOfFile %s failed: %ld\n", segment_name, GetLastError());
+		return -1;
+	}
+	MEMORY_BASIC_INFORMATION info;
+	const size_t map_size = VirtualQuery(base, &info, sizeof(info)) ? info.RegionSize : 0;
+#else
+	const int fd = shm_open(segment_name, O_RDONLY, 0666);
+	if (fd == -1)
+	{
+		ERROR_MESSAGE("shm_open %s failed: %s\n", segment_name, safe_strerror(errno));
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(flow_shmem_header_t))
+	{
+		ERROR_MESSAGE("%s is too small to be a flow segment\n", segment_name);
+		close(fd);
+		return -1;
+	}
+	const size_t map_size = (size_t)st.st_size;
+	void *base = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		ERROR_MESSAGE("mmap %s failed: %s\n", segment_name, safe_strerror(errno));
+		return -1;
+	}
+#endif
+
+	view->map_base = base;
+	view->map_size = map_size;
+	if (map_size < sizeof(flow_shmem_header_t) || validate_segment((const unsigned char *)base, map_size, segment_name) != 0)
+	{
+		flow_shmem_detach(view);
+		return -1;
+	}
+	view->header = (const flow_shmem_header_t *)base;
+	view->series = (const flow_shmem_series_t *)((const unsigned char *)base + sizeof(flow_shmem_header_t));
+	return 0;
+}
+
+/**
+ * @brief Looks up a series by name in an attached segment.
+ *
+ * Names are compared on their first `FLOW_SHMEM_SERIES_NAME_MAX - 1` characters, the part
+ * the publisher stored.
+ *
+ * @param view  Attached segment.
+ * @param name  Series name, or NULL to take the first series.
+ * @return      Table entry (dt, total_time, count), or NULL if no series has that name.
+ */
+const flow_shmem_series_t *flow_shmem_find_series(const flow_shmem_view_t *view, const char *name)
+{
+	if (!view || !view->header)
+	{
+		return NULL;
+	}
+	for (uint32_t i = 0; i < view->header->n_series; i++)
+	{
+		if (!name || strncmp(view->series[i].name, name, FLOW_SHMEM_SERIES_NAME_MAX - 1) == 0)
+		{
+			return &view->series[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Zero-copy pointer to the samples of a table entry returned by `flow_shmem_find_series()`.
+ */
+const double *flow_shmem_series_values(const flow_shmem_view_t *view, const flow_shmem_series_t *entry)
+{
+	return (const double *)((const unsigned char *)view->map_base + entry->offset);
+}
+
+/**
+ * @brief Unmaps a segment mapped by `flow_shmem_attach()`. Safe to call on a zeroed view.
+ */
+void flow_shmem_detach(flow_shmem_view_t *view)
+{
+	if (!view || !view->map_base)
+	{
+		return;
+	}
+#ifdef _WIN32
+	if (!UnmapViewOfFile(view->map_base))
+	{
+		ERROR_MESSAGE("UnmapViewOfFile failed: %ld\n", GetLastError());
+	}
+#else
+	if (munmap(view->map_base, view->map_size) == -1)
+	{
+		ERROR_MESSAGE("munmap failed: %s\n", safe_strerror(errno));
+	}
+#endif
+	memset(view, 0, sizeof(*view));
+}
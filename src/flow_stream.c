@@ -0,0 +1,478 @@
+/**
+ * @file    flow_stream.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Bounded-memory streaming reader for long .bts and .csv flow series
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "flow_stream.h"
+#include "bts_format.h"   // for bts_read_header, bts_le_i16, BTS_COMPONENTS
+#include "logger.h"       // for log_message, ERROR_MESSAGE
+#include "maybe_unused.h" // for MAYBE_UNUSED
+#include "xflow_core.h"   // for usleep_now, safe_strerror
+#include <errno.h>        // for errno
+#include <math.h>         // for floor, sqrt, fabs
+#include <pthread.h>      // for pthread_create, pthread_join, pthread_t
+#include <stdatomic.h>    // for atomic_size_t, atomic_bool, atomic_load_explicit, ...
+#include <stdbool.h>      // IWYU pragma: keep
+#include <stddef.h>       // for size_t
+#include <stdint.h>       // for int16_t
+#include <stdio.h>        // for FILE, fopen, fread, fgets, fclose
+#include <stdlib.h>       // for calloc, free, strtod
+#include <string.h>       // for memcpy, strlen, strcmp
+
+#define FLOW_STREAM_IDLE_SLEEP_US 200U // prefetch back-off when the window is full
+#define FLOW_STREAM_WAIT_SLEEP_US 50U  // consumer back-off when it caught up with the prefetcher
+#define FLOW_STREAM_LINE_MAX 256
+
+/*
+ * Single-producer/single-consumer window of raw samples. The prefetch thread is the only
+ * writer of `produced`, the simulation thread the only writer of `consumed`; sample `i`
+ * lives in slot `i & mask` for as long as `i >= consumed`.
+ */
+typedef struct
+{
+	FILE *file;
+	bool is_bts;
+	double raw_dt;
+	int chunk_steps;
+
+	// .bts layout
+	int nz;
+	int ny;
+	int ntwr;
+	int nt;
+	size_t step_bytes;   // grid plus tower points of one time step
+	size_t point_offset; // byte offset of the selected grid point inside a step
+	float slope[BTS_COMPONENTS];
+	float offset[BTS_COMPONENTS];
+	unsigned char *chunk; // chunk_steps * step_bytes
+	int steps_read;
+
+	double *batch; // chunk_steps samples decoded before they enter the window
+
+	double *samples;
+	size_t capacity; // power of two
+	size_t mask;
+	atomic_size_t produced;
+	atomic_size_t consumed;
+	atomic_bool eof;
+	atomic_bool stop;
+	atomic_bool failed;
+	size_t stalls; // consumer-only counter
+
+	pthread_t thread;
+	bool running;
+} flow_stream_t;
+
+static flow_stream_t flowStream;
+
+static int nearest_grid_index(const double position, const double first, const double spacing, const int count)
+{
+	if (count <= 1 || spacing <= 0.0)
+	{
+		return 0;
+	}
+	int index = (int)floor(((position - first) / spacing) + 0.5);
+	if (index < 0)
+	{
+		index = 0;
+	}
+	else if (index > count - 1)
+	{
+		index = count - 1;
+	}
+	return index;
+}
+
+/**
+ * @brief Parses a TurbSim full-field header and positions the file at the first time step.
+ *
+ * Only the grid point nearest to (`y_position`, `z_position`) is decoded later; a negative
+ * `z_position` selects hub height, matching `u_mag_velocity_for_y_z_position`.
+ */
+static int open_bts_stream(const char *path, const double y_position, const double z_position)
+{
+	bts_header_t header;
+	if (bts_read_header(flowStream.file, path, &header) != 0)
+	{
+		return -1;
+	}
+	flowStream.nz = header.nz;
+	flowStream.ny = header.ny;
+	flowStream.ntwr = header.ntwr;
+	flowStream.nt = header.nt;
+	const float dz = header.dz;
+	const float dy = header.dy;
+	const float dt = header.dt;
+	const float zhub = header.zhub;
+	const float zbottom = header.zbottom;
+	memcpy(flowStream.slope, header.slope, sizeof(flowStream.slope));
+	memcpy(flowStream.offset, header.offset, sizeof(flowStream.offset));
+
+	const double y_first = -0.5 * (flowStream.ny - 1) * dy;
+	const int iy = nearest_grid_index(y_position, y_first, dy, flowStream.ny);
+	const int iz = nearest_grid_index(z_position < 0.0 ? zhub : z_position, zbottom, dz, flowStream.nz);
+
+	flowStream.raw_dt = dt;
+	flowStream.step_bytes = ((size_t)flowStream.nz * (size_t)flowStream.ny + (size_t)flowStream.ntwr) * BTS_COMPONENTS * sizeof(int16_t);
+	flowStream.point_offset = ((size_t)iz * (size_t)flowStream.ny + (size_t)iy) * BTS_COMPONENTS * sizeof(int16_t);
+	flowStream.chunk = malloc((size_t)flowStream.chunk_steps * flowStream.step_bytes);
+	if (!flowStream.chunk)
+	{
+		ERROR_MESSAGE("Flow stream: failed to allocate %d step read buffer\n", flowStream.chunk_steps);
+		return -1;
+	}
+
+	log_message("Flow stream: .bts %d x %d grid, %d steps at %g s, reading point iy=%d iz=%d\n", flowStream.ny, flowStream.nz, flowStream.nt, (double)dt, iy, iz);
+	return 0;
+}
+
+/**
+ * @brief Decodes up to `chunk_steps` samples into `flowStream.batch`. Returns the count, 0 at end of file, -1 on error.
+ */
+static int read_bts_batch(void)
+{
+	const int remaining = flowStream.nt - flowStream.steps_read;
+	const int want = remaining < flowStream.chunk_steps ? remaining : flowStream.chunk_steps;
+	if (want <= 0)
+	{
+		return 0;
+	}
+
+	const size_t got = fread(flowStream.chunk, flowStream.step_bytes, (size_t)want, flowStream.file);
+	if (got == 0)
+	{
+		if (ferror(flowStream.file))
+		{
+			ERROR_MESSAGE("Flow stream: read error: %s\n", safe_strerror(errno));
+			return -1;
+		}
+		// Shorter than the header claims: the series ends at the last complete step.
+		return 0;
+	}
+
+	for (size_t s = 0; s < got; s++)
+	{
+		const unsigned char *point = &flowStream.chunk[(s * flowStream.step_bytes) + flowStream.point_offset];
+		double magnitude_sq = 0.0;
+		for (int c = 0; c < BTS_COMPONENTS; c++)
+		{
+			const double v = ((double)bts_le_i16(&point[c * (int)sizeof(int16_t)]) - flowStream.offset[c]) / flowStream.slope[c];
+			magnitude_sq += v * v;
+		}
+		flowStream.batch[s] = sqrt(magnitude_sq);
+	}
+	flowStream.steps_read += (int)got;
+	return (int)got;
+}
+
+/**
+ * @brief Reads up to `chunk_steps` values from the first column of a flow .csv, skipping non-numeric lines.
+ */
+static int read_csv_batch(void)
+{
+	char line[FLOW_STREAM_LINE_MAX];
+	int count = 0;
+	while (count < flowStream.chunk_steps && fgets(line, sizeof(line), flowStream.file))
+	{
+		char *end = NULL;
+		const double value = strtod(line, &end);
+		if (end == line)
+		{
+			continue; // header or blank line
+		}
+		flowStream.batch[count++] = value;
+	}
+	if (count == 0 && ferror(flowStream.file))
+	{
+		ERROR_MESSAGE("Flow stream: read error: %s\n", safe_strerror(errno));
+		return -1;
+	}
+	return count;
+}
+
+static void *flow_stream_thread(MAYBE_UNUSED void *arg)
+{
+	while (!atomic_load_explicit(&flowStream.stop, memory_order_acquire))
+	{
+		const int n = flowStream.is_bts ? read_bts_batch() : read_csv_batch();
+		if (n < 0)
+		{
+			atomic_store_explicit(&flowStream.failed, true, memory_order_release);
+			break;
+		}
+		if (n == 0)
+		{
+			atomic_store_explicit(&flowStream.eof, true, memory_order_release);
+			break;
+		}
+
+		size_t produced = atomic_load_explicit(&flowStream.produced, memory_order_relaxed);
+		for (int i = 0; i < n; i++)
+		{
+			for (;;)
+			{
+				const size_t consumed = atomic_load_explicit(&flowStream.consumed, memory_order_acquire);
+				// The consumer may have jumped past samples not produced yet; those slots are free.
+				if (produced < consumed || produced - consumed < flowStream.capacity)
+				{
+					break;
+				}
+				if (atomic_load_explicit(&flowStream.stop, memory_order_acquire))
+				{
+					return NULL;
+				}
+				usleep_now(FLOW_STREAM_IDLE_SLEEP_US);
+			}
+			flowStream.samples[produced & flowStream.mask] = flowStream.batch[i];
+			produced++;
+			atomic_store_explicit(&flowStream.produced, produced, memory_order_release);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Opens a flow series and starts prefetching it on a background thread.
+ *
+ * Memory is bounded by `window_samples` raw samples plus one read chunk, independent of
+ * the series length. `.bts` files are decoded at a single grid point; `.csv` files are
+ * read from their first column with `flow_time_step_dt` as the sample interval.
+ *
+ * @param path              Flow file (.bts or .csv).
+ * @param flow_time_step_dt Sample interval of a .csv series (the .bts header dt is used for .bts).
+ * @param y_position        Horizontal grid position in m for .bts input.
+ * @param z_position        Vertical grid position in m for .bts input, negative for hub height.
+ * @param window_samples    Raw samples kept ahead of the simulation time (rounded up to a power of two).
+ * @param chunk_steps       Samples decoded per read.
+ * @return                  0 on success, -1 on failure (nothing is left running).
+ */
+int flow_stream_open(const char *path, const double flow_time_step_dt, const double y_position, const double z_position, const int window_samples, const int chunk_steps)
+{
+	if (flowStream.running)
+	{
+		ERROR_MESSAGE("Flow stream already open\n");
+		return -1;
+	}
+
+	const size_t len = strlen(path);
+	flowStream.is_bts = len >= 4 && strcmp(path + len - 4, ".bts") == 0;
+	if (!flowStream.is_bts && (len < 4 || strcmp(path + len - 4, ".csv") != 0))
+	{
+		ERROR_MESSAGE("Flow stream: '%s' must end in .bts or .csv\n", path);
+		return -1;
+	}
+
+	flowStream.chunk_steps = chunk_steps > 0 ? chunk_steps : FLOW_STREAM_DEFAULT_CHUNK_STEPS;
+	flowStream.steps_read = 0;
+	flowStream.stalls = 0;
+	flowStream.file = fopen(path, flowStream.is_bts ? "rb" : "r"); // NOLINT(cert-err33-c)
+	if (!flowStream.file)
+	{
+		ERROR_MESSAGE("Flow stream: cannot open %s: %s\n", path, safe_strerror(errno));
+		return -1;
+	}
+
+	if (flowStream.is_bts)
+	{
+		if (open_bts_stream(path, y_position, z_position) != 0)
+		{
+			flow_stream_close();
+			return -1;
+		}
+	}
+	else
+	{
+		if (flow_time_step_dt <= 0.0)
+		{
+			ERROR_MESSAGE("Flow stream: flow_time_step_dt must be positive for .csv input\n");
+			flow_stream_close();
+			return -1;
+		}
+		flowStream.raw_dt = flow_time_step_dt;
+	}
+
+	size_t capacity = 2;
+	while (capacity < (size_t)(window_samples > 2 ? window_samples : 2))
+	{
+		capacity <<= 1U;
+	}
+	flowStream.capacity = capacity;
+	flowStream.mask = capacity - 1;
+	flowStream.samples = calloc(capacity, sizeof(double));
+	flowStream.batch = calloc((size_t)flowStream.chunk_steps, sizeof(double));
+	if (!flowStream.samples || !flowStream.batch)
+	{
+		ERROR_MESSAGE("Flow stream: failed to allocate %zu sample window\n", capacity);
+		flow_stream_close();
+		return -1;
+	}
+
+	atomic_store(&flowStream.produced, 0);
+	atomic_store(&flowStream.consumed, 0);
+	atomic_store(&flowStream.eof, false);
+	atomic_store(&flowStream.stop, false);
+	atomic_store(&flowStream.failed, false);
+
+	if (pthread_create(&flowStream.thread, NULL, flow_stream_thread, NULL) != 0)
+	{
+		ERROR_MESSAGE("Flow stream: failed to start prefetch thread\n");
+		flow_stream_close();
+		return -1;
+	}
+	flowStream.running = true;
+
+	log_message("Flow stream opened: %s (%zu sample window, %d samples per read)\n", path, capacity, flowStream.chunk_steps);
+	return 0;
+}
+
+/**
+ * @brief Returns the linearly interpolated flow speed at `time_sec`.
+ *
+ * Samples older than `time_sec` are released back to the prefetcher, so `time_sec` must
+ * not move backwards by more than one raw sample. Waits for the prefetcher only when the
+ * simulation has caught up with it. Past the end of the series the last sample is held
+ * and `*past_end` is set.
+ *
+ * @param time_sec  Simulation time in seconds.
+ * @param value     Receives the flow speed.
+ * @param past_end  Set to true once `time_sec` lies beyond the total series time.
+ * @return          0 on success, -1 if the stream is closed or the prefetcher failed.
+ */
+int flow_stream_sample(const double time_sec, double *value, bool *past_end)
+{
+	*past_end = false;
+	if (!flowStream.running)
+	{
+		return -1;
+	}
+
+	const double position = time_sec > 0.0 ? time_sec / flowStream.raw_dt : 0.0;
+	const size_t k = (size_t)floor(position);
+	double frac = position - (double)k;
+	if (frac < 1e-9)
+	{
+		frac = 0.0;
+	}
+	const size_t need = frac > 0.0 ? k + 1 : k;
+
+	const size_t consumed = atomic_load_explicit(&flowStream.consumed, memory_order_relaxed);
+	if (k > consumed)
+	{
+		atomic_store_explicit(&flowStream.consumed, k, memory_order_release);
+	}
+
+	size_t produced = atomic_load_explicit(&flowStream.produced, memory_order_acquire);
+	bool waited = false;
+	while (produced <= need && !atomic_load_explicit(&flowStream.eof, memory_order_acquire))
+	{
+		if (atomic_load_explicit(&flowStream.failed, memory_order_acquire))
+		{
+			ERROR_MESSAGE("Flow stream: prefetch thread failed\n");
+			return -1;
+		}
+		waited = true;
+		usleep_now(FLOW_STREAM_WAIT_SLEEP_US);
+		produced = atomic_load_explicit(&flowStream.produced, memory_order_acquire);
+	}
+	if (waited)
+	{
+		flowStream.stalls++;
+	}
+	// Re-read after eof so samples published just before the flag are seen.
+	produced = atomic_load_explicit(&flowStream.produced, memory_order_acquire);
+	if (produced == 0)
+	{
+		ERROR_MESSAGE("Flow stream: series is empty\n");
+		return -1;
+	}
+
+	if (need >= produced)
+	{
+		// End of data: hold the last sample, which is never released.
+		const size_t last = produced - 1;
+		atomic_store_explicit(&flowStream.consumed, last, memory_order_release);
+		*value = flowStream.samples[last & flowStream.mask];
+		*past_end = time_sec > flow_stream_total_time();
+		return 0;
+	}
+	if (k < consumed)
+	{
+		ERROR_MESSAGE("Flow stream: time %f moved back past the streaming window\n", time_sec);
+		return -1;
+	}
+
+	const double v0 = flowStream.samples[k & flowStream.mask];
+	*value = frac > 0.0 ? v0 + (frac * (flowStream.samples[(k + 1) & flowStream.mask] - v0)) : v0;
+	return 0;
+}
+
+/**
+ * @brief Length of the series in seconds (samples x sample interval). Taken from the .bts
+ * header; for .csv only valid once `flow_stream_total_time_known()` is true.
+ */
+double flow_stream_total_time(void)
+{
+	if (flowStream.is_bts && !atomic_load_explicit(&flowStream.eof, memory_order_acquire))
+	{
+		return flowStream.nt * flowStream.raw_dt;
+	}
+	return (double)atomic_load_explicit(&flowStream.produced, memory_order_acquire) * flowStream.raw_dt;
+}
+
+/**
+ * @brief True once the series length is known: always for .bts, at end of file for .csv.
+ */
+bool flow_stream_total_time_known(void)
+{
+	return flowStream.is_bts || atomic_load_explicit(&flowStream.eof, memory_order_acquire);
+}
+
+/**
+ * @brief Stops the prefetch thread and releases the window. Safe to call when not open.
+ */
+void flow_stream_close(void)
+{
+	if (flowStream.running)
+	{
+		atomic_store_explicit(&flowStream.stop, true, memory_order_release);
+		if (pthread_join(flowStream.thread, NULL) != 0)
+		{
+			ERROR_MESSAGE("Flow stream: failed to join prefetch thread\n");
+		}
+		flowStream.running = false;
+		log_message("Flow stream closed: %zu samples read, %zu waits on the prefetcher\n", atomic_load(&flowStream.produced), flowStream.stalls);
+	}
+
+	if (flowStream.file && fclose(flowStream.file) == EOF)
+	{
+		ERROR_MESSAGE("Flow stream: error closing file: %s\n", safe_strerror(errno));
+	}
+	flowStream.file = NULL;
+	free(flowStream.chunk);
+	free(flowStream.batch);
+	free(flowStream.samples);
+	flowStream.chunk = NULL;
+	flowStream.batch = NULL;
+	flowStream.samples = NULL;
+}
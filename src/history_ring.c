@@ -0,0 +1,421 @@
+/**
+ * @file    history_ring.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Zero-copy ring buffers of recent parameter values, sampled on their own tick schedule
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "history_ring.h"
+#include "logger.h"                 // for ERROR_MESSAGE
+#include "param_index.h"            // for get_param_handle, param_double_from_handle, param_int_from_handle
+#include "stage_context.h"          // for get_stage_state_cached, stage_state_slot_t
+#include "xfe_control_sim_common.h" // for get_param_double_or_default
+#include "xflow_core.h"             // for shutdownFlag
+#include <math.h>                   // for llround
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stddef.h>                 // for NULL, size_t
+#include <stdint.h>                 // for int64_t
+#include <stdlib.h>                 // for calloc, malloc, realloc, free
+#include <string.h>                 // for memcpy, strcmp, strlen
+
+#define HISTORY_RING_INITIAL_RINGS 8
+
+struct history_ring
+{
+	const char *name;            // the source parameter's name, owned by dynamic_data
+	const double *source_double; // exactly one of the two sources is set
+	const int *source_int;
+	int64_t every_n_ticks;
+	int64_t next_due_tick;
+	int head;
+	int count;
+	int capacity;
+	double *data;
+};
+
+/**
+ * @brief All rings of one run, kept as a binary min-heap on `next_due_tick`.
+ *
+ * An update pops only the rings that are due, so a tick where nothing is due costs one
+ * comparison however many rings are registered.
+ */
+typedef struct
+{
+	history_ring_t **rings;
+	int n_rings;
+	int capacity;
+	int64_t last_tick; // tick of the latest update, aligns rings registered mid-run
+	history_ring_t *pending; // restored rings not registered yet, name stored behind data; see restore_history_ring_states()
+	int n_pending;
+} history_ring_set_t;
+
+static const char historyRingSetKey = 0; // address identifies the ring set in the stage context
+
+static void release_history_ring_set(void *state)
+{
+	history_ring_set_t *set = state;
+	for (int i = 0; i < set->n_rings; i++)
+	{
+		free(set->rings[i]->data);
+		free(set->rings[i]);
+	}
+	free(set->rings);
+	for (int i = 0; i < set->n_pending; i++)
+	{
+		free(set->pending[i].data);
+	}
+	free(set->pending);
+}
+
+/**
+ * @brief The calling thread's ring set, owned by its current stage context and freed on reset.
+ */
+static history_ring_set_t *current_history_ring_set(void)
+{
+	static _Thread_local stage_state_slot_t slot;
+	bool first_run = false;
+	return get_stage_state_cached(&slot, &historyRingSetKey, sizeof(history_ring_set_t), release_history_ring_set, &first_run);
+}
+
+static void swap_rings(history_ring_set_t *set, const int a, const int b)
+{
+	history_ring_t *ring = set->rings[a];
+	set->rings[a] = set->rings[b];
+	set->rings[b] = ring;
+}
+
+static void sift_up(history_ring_set_t *set, int i)
+{
+	while (i > 0)
+	{
+		const int parent = (i - 1) / 2;
+		if (set->rings[parent]->next_due_tick <= set->rings[i]->next_due_tick)
+		{
+			return;
+		}
+		swap_rings(set, parent, i);
+		i = parent;
+	}
+}
+
+static void sift_down(history_ring_set_t *set, int i)
+{
+	for (;;)
+	{
+		const int left = (2 * i) + 1;
+		const int right = left + 1;
+		int earliest = i;
+		if (left < set->n_rings && set->rings[left]->next_due_tick < set->rings[earliest]->next_due_tick)
+		{
+			earliest = left;
+		}
+		if (right < set->n_rings && set->rings[right]->next_due_tick < set->rings[earliest]->next_due_tick)
+		{
+			earliest = right;
+		}
+		if (earliest == i)
+		{
+			return;
+		}
+		swap_rings(set, earliest, i);
+		i = earliest;
+	}
+}
+
+static bool same_ring_layout(const history_ring_t *ring, const char *name, const int64_t every_n_ticks, const int capacity)
+{
+	return ring->every_n_ticks == every_n_ticks && ring->capacity == capacity && strcmp(ring->name, name) == 0;
+}
+
+static void copy_ring_contents(history_ring_t *ring, const int64_t next_due_tick, const int head, const int count, const double *data)
+{
+	ring->next_due_tick = next_due_tick;
+	ring->head = head;
+	ring->count = count;
+	memcpy(ring->data, data, (size_t)ring->capacity * sizeof(double));
+}
+
+/**
+ * @brief Fills a ring being registered from a restored one with the same layout, if there is one.
+ */
+static bool take_pending_ring(history_ring_set_t *set, history_ring_t *ring)
+{
+	for (int i = 0; i < set->n_pending; i++)
+	{
+		history_ring_t *pending = &set->pending[i];
+		if (same_ring_layout(ring, pending->name, pending->every_n_ticks, pending->capacity))
+		{
+			copy_ring_contents(ring, pending->next_due_tick, pending->head, pending->count, pending->data);
+			free(pending->data);
+			set->pending[i] = set->pending[--set->n_pending];
+			return true;
+		}
+	}
+	return false;
+}
+
+static void sample_history_ring(history_ring_t *ring)
+{
+	ring->head = ring->head + 1 == ring->capacity ? 0 : ring->head + 1;
+	ring->data[ring->head] = ring->source_double ? *ring->source_double : (double)*ring->source_int;
+	if (ring->count < ring->capacity)
+	{
+		ring->count++;
+	}
+}
+
+/**
+ * @brief Returns a ring holding the last `capacity` values of the dynamic parameter `name`,
+ *        sampled every `period_sec` (rounded to whole `dt_sec` ticks; 0 samples every tick).
+ *
+ * Call from a stage's first-run initialisation. A ring with the same parameter, period and at
+ * least the same capacity is shared. The ring is seeded with the current value and lives until
+ * the stage context is reset. Int parameters are stored as doubles.
+ *
+ * @return  The ring, or NULL (with `shutdownFlag` set) if `name` is not an int or double
+ *          parameter or allocation fails.
+ */
+history_ring_t *get_history_ring(const param_array_t *dynamic_data, const param_array_t *fixed_data, const char *name, const int capacity, const double period_sec)
+{
+	if (capacity <= 0)
+	{
+		ERROR_MESSAGE("History ring for '%s' needs a positive capacity, got %d\n", name, capacity);
+		shutdownFlag = 1;
+		return NULL;
+	}
+
+	const param_handle_t handle = get_param_handle(dynamic_data, name);
+	const double *source_double = param_double_from_handle(dynamic_data, handle);
+	const int *source_int = source_double ? NULL : param_int_from_handle(dynamic_data, handle);
+	if (!source_double && !source_int)
+	{
+		ERROR_MESSAGE("History ring needs an int or double dynamic parameter, '%s' is %s\n", name, handle == PARAM_HANDLE_INVALID ? "missing" : "neither");
+		shutdownFlag = 1;
+		return NULL;
+	}
+
+	int64_t every_n_ticks = 1;
+	const double dt_sec = get_param_double_or_default(fixed_data, "dt_sec", 0.0);
+	if (period_sec > 0.0 && dt_sec > 0.0 && llround(period_sec / dt_sec) > 1)
+	{
+		every_n_ticks = (int64_t)llround(period_sec / dt_sec);
+	}
+
+	history_ring_set_t *set = current_history_ring_set();
+	if (!set)
+	{
+		return NULL;
+	}
+	for (int i = 0; i < set->n_rings; i++)
+	{
+		history_ring_t *ring = set->rings[i];
+		if (ring->source_double == source_double && ring->source_int == source_int && ring->every_n_ticks == every_n_ticks && ring->capacity >= capacity)
+		{
+			return ring;
+		}
+	}
+
+	if (set->n_rings == set->capacity)
+	{
+		const int new_capacity = set->capacity ? set->capacity * 2 : HISTORY_RING_INITIAL_RINGS;
+		history_ring_t **rings = realloc(set->rings, (size_t)new_capacity * sizeof(history_ring_t *));
+		if (!rings)
+		{
+			ERROR_MESSAGE("Failed to grow history ring set to %d rings\n", new_capacity);
+			shutdownFlag = 1;
+			return NULL;
+		}
+		set->rings = rings;
+		set->capacity = new_capacity;
+	}
+
+	history_ring_t *ring = calloc(1, sizeof(history_ring_t));
+	double *data = calloc((size_t)capacity, sizeof(double));
+	if (!ring || !data)
+	{
+		ERROR_MESSAGE("Failed to allocate a %d sample history ring for '%s'\n", capacity, name);
+		free(ring);
+		free(data);
+		shutdownFlag = 1;
+		return NULL;
+	}
+	ring->name = param_from_handle(dynamic_data, handle)->name;
+	ring->source_double = source_double;
+	ring->source_int = source_int;
+	ring->every_n_ticks = every_n_ticks;
+	ring->capacity = capacity;
+	ring->head = capacity - 1;
+	ring->data = data;
+
+	if (!take_pending_ring(set, ring))
+	{
+		sample_history_ring(ring);
+		ring->next_due_tick = ((set->last_tick / every_n_ticks) + 1) * every_n_ticks;
+	}
+	set->rings[set->n_rings] = ring;
+	sift_up(set, set->n_rings);
+	set->n_rings++;
+	return ring;
+}
+
+/**
+ * @brief Current view of `ring`'s live storage.
+ */
+history_view_t history_ring_view(const history_ring_t *ring)
+{
+	return (history_view_t){.data = ring->data, .head = ring->head, .count = ring->count, .capacity = ring->capacity};
+}
+
+/**
+ * @brief Sample `age` steps back from the newest (0 = newest); `age` must be below `view->count`.
+ */
+double history_view_at(const history_view_t *view, const int age)
+{
+	const int index = view->head - age;
+	return view->data[index < 0 ? index + view->capacity : index];
+}
+
+/**
+ * @brief Samples every ring that is due at `tick`, the number of completed base steps.
+ *
+ * Call once per base step, after the step has advanced the clock. A ring with period `n`
+ * samples on every multiple of `n` ticks.
+ */
+void update_history_rings(const int64_t tick)
+{
+	history_ring_set_t *set = current_history_ring_set();
+	if (!set)
+	{
+		return;
+	}
+	set->last_tick = tick;
+	while (set->n_rings > 0 && set->rings[0]->next_due_tick <= tick)
+	{
+		history_ring_t *ring = set->rings[0];
+		sample_history_ring(ring);
+		ring->next_due_tick = ((tick / ring->every_n_ticks) + 1) * ring->every_n_ticks;
+		sift_down(set, 0);
+	}
+}
+
+/**
+ * @brief Describes every ring of the calling thread's set, for a checkpoint.
+ *
+ * @param states  Receives an array the caller frees; `data` and `name` point into the live rings.
+ * @return        Number of rings, or -1 on allocation failure.
+ */
+int get_history_ring_states(history_ring_state_t **states)
+{
+	*states = NULL;
+	history_ring_set_t *set = current_history_ring_set();
+	if (!set || set->n_rings == 0)
+	{
+		return 0;
+	}
+	history_ring_state_t *out = calloc((size_t)set->n_rings, sizeof(history_ring_state_t));
+	if (!out)
+	{
+		ERROR_MESSAGE("Failed to allocate %d history ring states\n", set->n_rings);
+		return -1;
+	}
+	for (int i = 0; i < set->n_rings; i++)
+	{
+		const history_ring_t *ring = set->rings[i];
+		out[i] = (history_ring_state_t){.name = ring->name, .every_n_ticks = ring->every_n_ticks, .next_due_tick = ring->next_due_tick, .head = ring->head, .count = ring->count, .capacity = ring->capacity, .data = ring->data};
+	}
+	*states = out;
+	return set->n_rings;
+}
+
+/**
+ * @brief Puts saved ring contents back and moves the set to `tick`.
+ *
+ * A state is copied into the registered ring with the same parameter, period and capacity.
+ * States without one are kept and fill that ring when a stage registers it with
+ * `get_history_ring()`, so rings come back whether their stage has run yet or not.
+ *
+ * @return 0 on success, -1 (with `shutdownFlag` set) on an invalid state or allocation failure.
+ */
+int restore_history_ring_states(const history_ring_state_t *states, const int n_states, const int64_t tick)
+{
+	history_ring_set_t *set = current_history_ring_set();
+	if (!set)
+	{
+		return -1;
+	}
+	set->last_tick = tick;
+	for (int s = 0; s < n_states; s++)
+	{
+		const history_ring_state_t *state = &states[s];
+		if (state->capacity <= 0 || state->every_n_ticks <= 0 || state->head < 0 || state->head >= state->capacity || state->count < 0 || state->count > state->capacity)
+		{
+			ERROR_MESSAGE("Restored history ring for '%s' is inconsistent\n", state->name);
+			shutdownFlag = 1;
+			return -1;
+		}
+
+		bool restored = false;
+		for (int i = 0; i < set->n_rings && !restored; i++)
+		{
+			if (same_ring_layout(set->rings[i], state->name, state->every_n_ticks, state->capacity))
+			{
+				copy_ring_contents(set->rings[i], state->next_due_tick, state->head, state->count, state->data);
+				restored = true;
+			}
+		}
+		if (restored)
+		{
+			continue;
+		}
+
+		history_ring_t *pending = realloc(set->pending, (size_t)(set->n_pending + 1) * sizeof(history_ring_t));
+		if (!pending)
+		{
+			ERROR_MESSAGE("Failed to keep the restored history ring for '%s'\n", state->name);
+			shutdownFlag = 1;
+			return -1;
+		}
+		set->pending = pending;
+		history_ring_t *ring = &set->pending[set->n_pending];
+		// one block: the samples, then a copy of the name, which must outlive the caller's states
+		const size_t name_size = strlen(state->name) + 1;
+		double *data = malloc(((size_t)state->capacity * sizeof(double)) + name_size);
+		if (!data)
+		{
+			ERROR_MESSAGE("Failed to keep the restored history ring for '%s'\n", state->name);
+			shutdownFlag = 1;
+			return -1;
+		}
+		char *name = (char *)(data + state->capacity);
+		memcpy(name, state->name, name_size);
+		*ring = (history_ring_t){.name = name, .every_n_ticks = state->every_n_ticks, .capacity = state->capacity, .data = data};
+		copy_ring_contents(ring, state->next_due_tick, state->head, state->count, state->data);
+		set->n_pending++;
+	}
+
+	// next_due_tick changed under the heap
+	for (int i = (set->n_rings / 2) - 1; i >= 0; i--)
+	{
+		sift_down(set, i);
+	}
+	return 0;
+}
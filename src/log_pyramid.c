@@ -0,0 +1,342 @@
+/**
+ * @file    log_pyramid.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Multi-resolution min/max companion file of the dynamic data log, written alongside it
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "log_pyramid.h"
+#include "logger.h"            // for log_message, ERROR_MESSAGE
+#include "xflow_aero_sim.h"    // for param_array_t, input_param_t
+#include "xflow_core.h"        // for safe_snprintf
+#include "xflow_file_socket.h" // IWYU pragma: keep
+#include <limits.h>            // for PATH_MAX
+#include <math.h>              // for NAN
+#include <stddef.h>            // for offsetof, size_t
+#include <stdint.h>            // for uint32_t, uint64_t, UINT64_MAX
+#include <stdio.h>             // for FILE, fopen, fwrite, fseek, ftell, fclose
+#include <stdlib.h>            // for calloc, free
+#include <string.h>            // for memcpy, memset, strlen, strncpy, strrchr
+
+/**
+ * @brief Derives the `.xfepyr` file name from the path of the full log.
+ *
+ * Replaces the extension of @p log_path (`.csv` or `.xfelog`) with `LOG_PYRAMID_EXTENSION`,
+ * or appends it when the path has none.
+ *
+ * @param[out] out       Destination buffer.
+ * @param      out_size  Size of `out` in bytes.
+ * @param      log_path  Path of the full dynamic data log.
+ */
+void log_pyramid_path_from_log(char *out, const size_t out_size, const char *log_path)
+{
+	const char *dot = strrchr(log_path, '.');
+	const char *slash = strrchr(log_path, '/');
+	int stem_len = (int)strlen(log_path);
+	if (dot != NULL && (slash == NULL || dot > slash))
+	{
+		stem_len = (int)(dot - log_path);
+	}
+	if (safe_snprintf(out, out_size, "%.*s%s", stem_len, log_path, LOG_PYRAMID_EXTENSION) < 0)
+	{
+		ERROR_MESSAGE("Pyramid path too long for %s\n", log_path);
+	}
+}
+
+/**
+ * @brief Returns the value of one channel as a double, NAN for strings.
+ */
+static double log_pyramid_channel_value(const input_param_t *param)
+{
+	switch (param->type)
+	{
+	case INPUT_PARAM_INT:
+		return (double)param->value.i;
+	case INPUT_PARAM_DOUBLE:
+		return param->value.d;
+	default:
+		return NAN;
+	}
+}
+
+/**
+ * @brief Returns the current position of the full log, UINT64_MAX when it cannot be told.
+ */
+static uint64_t log_pyramid_tell(FILE *log_file)
+{
+	const long offset = log_file != NULL ? ftell(log_file) : -1L;
+	return offset < 0 ? UINT64_MAX : (uint64_t)offset;
+}
+
+/**
+ * @brief Appends the group accumulated at @p level as one record and folds it into the next level.
+ *
+ * The group is reset afterwards. When the fold completes the next level's group, that group is
+ * emitted in turn.
+ */
+static void log_pyramid_emit(log_pyramid_t *pyramid, const int level)
+{
+	log_pyramid_level_t *group = &pyramid->levels[level];
+	const size_t n_values = 2U * (size_t)pyramid->n_channels;
+
+	log_pyramid_record_t record = {
+	    .level = (uint32_t)level,
+	    .n_rows = (uint32_t)group->n_rows,
+	    .first_row = group->first_row,
+	    .byte_offset = group->byte_offset,
+	};
+	memcpy(pyramid->record, &record, sizeof(record));
+	memcpy(pyramid->record + sizeof(record), group->min_max, n_values * sizeof(double));
+	if (fwrite(pyramid->record, pyramid->record_size, 1, pyramid->file) != 1)
+	{
+		ERROR_MESSAGE("Failed to write log pyramid record\n");
+	}
+	pyramid->n_records++;
+
+	if (level + 1 < pyramid->n_levels)
+	{
+		log_pyramid_level_t *parent = &pyramid->levels[level + 1];
+		if (parent->n_rows == 0)
+		{
+			parent->first_row = group->first_row;
+			parent->byte_offset = group->byte_offset;
+			memcpy(parent->min_max, group->min_max, n_values * sizeof(double));
+		}
+		else
+		{
+			for (size_t k = 0; k < n_values; k += 2)
+			{
+				if (group->min_max[k] < parent->min_max[k])
+				{
+					parent->min_max[k] = group->min_max[k];
+				}
+				if (group->min_max[k + 1] > parent->min_max[k + 1])
+				{
+					parent->min_max[k + 1] = group->min_max[k + 1];
+				}
+			}
+		}
+		parent->n_rows += group->n_rows;
+	}
+	group->n_rows = 0;
+
+	if (level + 1 < pyramid->n_levels && pyramid->levels[level + 1].n_rows == pyramid->factors[level + 1])
+	{
+		log_pyramid_emit(pyramid, level + 1);
+	}
+}
+
+/**
+ * @brief Releases the buffers of a pyramid; the side file must already be closed.
+ */
+static void log_pyramid_release(log_pyramid_t *pyramid)
+{
+	for (int l = 0; l < LOG_PYRAMID_MAX_LEVELS; l++)
+	{
+		free(pyramid->levels[l].min_max);
+	}
+	free(pyramid->record);
+	memset(pyramid, 0, sizeof(*pyramid));
+}
+
+/**
+ * @brief Creates the min/max pyramid companion of a dynamic data log that was just opened.
+ *
+ * The channels are the parameters of @p data, in order; @p data must keep its layout until
+ * `log_pyramid_close()`. Level 0 summarises @p factor rows and each further level @p factor
+ * records of the one below, so with the defaults the levels cover 10, 100 and 1000 rows.
+ *
+ * @param[out] pyramid   Writer state, zero-initialised or closed.
+ * @param      log_path  Path of the full log; the pyramid is written next to it (see
+ *                       `log_pyramid_path_from_log`).
+ * @param      data      Logged parameters.
+ * @param      log_file  Full log, positioned after its header.
+ * @param      factor    Decimation between levels, >= 2.
+ * @param      n_levels  Number of levels, 1 to `LOG_PYRAMID_MAX_LEVELS`.
+ * @return 0 on success, -1 on error (nothing is written afterwards).
+ */
+int log_pyramid_open(log_pyramid_t *pyramid, const char *log_path, const param_array_t *data, FILE *log_file, const int factor, const int n_levels)
+{
+	memset(pyramid, 0, sizeof(*pyramid));
+	if (factor < 2 || n_levels < 1 || n_levels > LOG_PYRAMID_MAX_LEVELS)
+	{
+		ERROR_MESSAGE("Log pyramid needs a factor >= 2 and 1 to %d levels, got %d and %d\n", LOG_PYRAMID_MAX_LEVELS, factor, n_levels);
+		return -1;
+	}
+	if (log_file == NULL || data == NULL || data->n_param <= 0)
+	{
+		ERROR_MESSAGE("Log pyramid needs an open log with at least one channel\n");
+		return -1;
+	}
+
+	pyramid->n_channels = data->n_param;
+	pyramid->n_levels = n_levels;
+	pyramid->record_size = sizeof(log_pyramid_record_t) + 2U * (size_t)data->n_param * sizeof(double);
+	pyramid->record = calloc(1, pyramid->record_size);
+	uint64_t rows_per_record = 1;
+	for (int l = 0; l < n_levels; l++)
+	{
+		rows_per_record *= (uint64_t)factor;
+		pyramid->factors[l] = rows_per_record;
+		pyramid->levels[l].min_max = calloc(2U * (size_t)data->n_param, sizeof(double));
+		if (pyramid->levels[l].min_max == NULL)
+		{
+			break;
+		}
+	}
+	if (pyramid->record == NULL || pyramid->levels[n_levels - 1].min_max == NULL)
+	{
+		ERROR_MESSAGE("Failed to allocate log pyramid buffers\n");
+		log_pyramid_release(pyramid);
+		return -1;
+	}
+
+	char path[PATH_MAX];
+	log_pyramid_path_from_log(path, sizeof(path), log_path);
+	FILE *file = fopen(path, "wb"); // NOLINT(cert-err33-c)
+	if (file == NULL)
+	{
+		ERROR_MESSAGE("Failed to open log pyramid %s\n", path);
+		log_pyramid_release(pyramid);
+		return -1;
+	}
+
+	log_pyramid_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LOG_PYRAMID_MAGIC, LOG_PYRAMID_MAGIC_SIZE);
+	header.version = LOG_PYRAMID_VERSION;
+	header.byte_order_mark = LOG_PYRAMID_BYTE_ORDER_MARK;
+	header.header_size = (uint32_t)(sizeof(header) + (size_t)data->n_param * LOG_PYRAMID_NAME_WIDTH);
+	header.n_channels = (uint32_t)data->n_param;
+	header.n_levels = (uint32_t)n_levels;
+	header.record_size = (uint32_t)pyramid->record_size;
+	memcpy(header.factors, pyramid->factors, sizeof(header.factors));
+	header.log_data_offset = log_pyramid_tell(log_file);
+
+	int status = fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+	for (int i = 0; i < data->n_param && status == 0; i++)
+	{
+		char name[LOG_PYRAMID_NAME_WIDTH] = {0};
+		strncpy(name, data->params[i].name, sizeof(name) - 1);
+		status = fwrite(name, sizeof(name), 1, file) == 1 ? 0 : -1;
+	}
+	if (status != 0)
+	{
+		ERROR_MESSAGE("Failed to write log pyramid header to %s\n", path);
+		(void)fclose(file);
+		log_pyramid_release(pyramid);
+		return -1;
+	}
+
+	pyramid->file = file;
+	log_message("Writing log pyramid (%d levels, factor %d) to %s\n", n_levels, factor, path);
+	return 0;
+}
+
+/**
+ * @brief Folds one logged row into the pyramid; call it right before the row is written.
+ *
+ * Only the first row of each level-0 group queries the position of @p log_file, so the
+ * per-row cost is one min/max update per channel. No-op when the pyramid is not open.
+ *
+ * @param pyramid   Writer state.
+ * @param log_file  Full log the row is about to be appended to.
+ * @param data      The row, same layout as at `log_pyramid_open()`.
+ */
+void log_pyramid_add_row(log_pyramid_t *pyramid, FILE *log_file, const param_array_t *data)
+{
+	if (pyramid->file == NULL)
+	{
+		return;
+	}
+
+	log_pyramid_level_t *group = &pyramid->levels[0];
+	if (group->n_rows == 0)
+	{
+		group->first_row = pyramid->n_rows;
+		group->byte_offset = log_pyramid_tell(log_file);
+		for (int i = 0; i < pyramid->n_channels; i++)
+		{
+			const double value = log_pyramid_channel_value(&data->params[i]);
+			group->min_max[2 * i] = value;
+			group->min_max[2 * i + 1] = value;
+		}
+	}
+	else
+	{
+		for (int i = 0; i < pyramid->n_channels; i++)
+		{
+			const double value = log_pyramid_channel_value(&data->params[i]);
+			if (value < group->min_max[2 * i])
+			{
+				group->min_max[2 * i] = value;
+			}
+			if (value > group->min_max[2 * i + 1])
+			{
+				group->min_max[2 * i + 1] = value;
+			}
+		}
+	}
+	group->n_rows++;
+	pyramid->n_rows++;
+
+	if (group->n_rows == pyramid->factors[0])
+	{
+		log_pyramid_emit(pyramid, 0);
+	}
+}
+
+/**
+ * @brief Flushes the partial groups, records the final row count in the header and closes the file.
+ *
+ * No-op when the pyramid is not open.
+ *
+ * @param pyramid  Writer state, zeroed on return.
+ */
+void log_pyramid_close(log_pyramid_t *pyramid)
+{
+	if (pyramid->file == NULL)
+	{
+		return;
+	}
+
+	for (int l = 0; l < pyramid->n_levels; l++)
+	{
+		if (pyramid->levels[l].n_rows > 0)
+		{
+			log_pyramid_emit(pyramid, l);
+		}
+	}
+
+	// n_rows and n_records are adjacent in the header, patch both in place
+	const uint64_t counts[2] = {pyramid->n_rows, pyramid->n_records};
+	if (fseek(pyramid->file, (long)offsetof(log_pyramid_header_t, n_rows), SEEK_SET) != 0 || fwrite(counts, sizeof(counts), 1, pyramid->file) != 1)
+	{
+		ERROR_MESSAGE("Failed to finalise log pyramid header\n");
+	}
+	if (fclose(pyramid->file) != 0)
+	{
+		ERROR_MESSAGE("Failed to close log pyramid\n");
+	}
+	pyramid->file = NULL;
+	log_pyramid_release(pyramid);
+}
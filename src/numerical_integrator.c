@@ -26,28 +26,210 @@
 
 #include "numerical_integrator.h"
 #include "equation_of_motion.h" // for eom
-#include "logger.h"             // for ERROR_MESSAGE
-#include "make_stage.h"         // for MAKE_STAGE_DEFINE
-#include "xflow_core.h"         // for shutdownFlag
-#include <stdbool.h>            // IWYU pragma: keep
-#include <stddef.h>             // for NULL
-#include <stdlib.h>             // for free, malloc
+#include "logger.h"                 // for ERROR_MESSAGE, log_message
+#include "make_stage.h"             // for MAKE_STAGE_DEFINE
+#include "xfe_control_sim_common.h" // for get_param_double_or_default
+#include "xflow_core.h"             // for shutdownFlag
+#include <float.h>                  // for DBL_EPSILON
+#include <math.h>                   // for fabs, fmax, fmin, pow, sqrt
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stddef.h>                 // for NULL
+#include <stdlib.h>                 // for free, calloc, malloc
+#include <string.h>                 // for strcmp
 
 // expand definitions once, using both the decl‐list and the call‐list
+#ifdef XFE_FUSED_NUMERICAL_INTEGRATOR // fused pipeline build, bound at configure time (cmake/fused_pipeline.cmake)
+MAKE_STAGE_DEFINE_BOUND(numerical_integrator, void, (NUMERICAL_INTEGRATOR_PARAM_LIST), (NUMERICAL_INTEGRATOR_CALL_ARGS), XFE_FUSED_NUMERICAL_INTEGRATOR)
+#else
 MAKE_STAGE_DEFINE(numerical_integrator, void, (NUMERICAL_INTEGRATOR_PARAM_LIST), (NUMERICAL_INTEGRATOR_CALL_ARGS))
+#endif
+
+/** Number of length-n_state_var double buffers carved out of workspace->buffer. */
+#define INTEGRATOR_WORKSPACE_BUFFER_COUNT 12
+
+/**
+ * @brief Allocates an integrator workspace sized for @p n_state_var state variables.
+ *
+ * All double buffers (`k1`–`k7`, `temp`, `x_values`, `x_new`, `prev_dx`) are carved out of a single
+ * zero-initialised allocation, the Jacobian and iteration matrix of the implicit integrator
+ * out of a second one, and `x_ptrs[i]` is pointed at `x_values[i]` once here so the
+ * integrators can hand a scratch state vector to `eom()` without rebuilding it every step.
+ * Create the workspace once after `init_state_bindings()` and pass it to every
+ * `numerical_integrator()` call for the lifetime of the simulation.
+ *
+ * @param n_state_var  Number of state variables (as returned by `init_state_bindings()`).
+ *
+ * @return Pointer to the new workspace, or NULL on failure.
+ *
+ * @note
+ * - On failure, logs via `ERROR_MESSAGE()`, sets `shutdownFlag = 1`, and returns NULL.
+ * - Release with `free_numerical_integrator_workspace()`.
+ */
+numerical_integrator_workspace_t *create_numerical_integrator_workspace(const int n_state_var)
+{
+	if (n_state_var <= 0)
+	{
+		ERROR_MESSAGE("Integrator workspace: invalid number of state variables (%d).\n", n_state_var);
+		shutdownFlag = 1;
+		return NULL;
+	}
+
+	numerical_integrator_workspace_t *workspace = calloc(1, sizeof(numerical_integrator_workspace_t));
+	if (!workspace)
+	{
+		ERROR_MESSAGE("Integrator workspace: failed to allocate workspace.\n");
+		shutdownFlag = 1;
+		return NULL;
+	}
+
+	workspace->buffer = calloc((size_t)INTEGRATOR_WORKSPACE_BUFFER_COUNT * n_state_var, sizeof(double));
+	workspace->x_ptrs = (double **)malloc(n_state_var * sizeof(double *));
+	workspace->matrix_buffer = calloc((size_t)2 * n_state_var * n_state_var, sizeof(double));
+	workspace->pivots = calloc((size_t)n_state_var, sizeof(int));
+	if (!workspace->buffer || !workspace->x_ptrs || !workspace->matrix_buffer || !workspace->pivots)
+	{
+		ERROR_MESSAGE("Integrator workspace: failed to allocate buffers.\n");
+		shutdownFlag = 1;
+		free_numerical_integrator_workspace(workspace);
+		return NULL;
+	}
+
+	workspace->n_state_var = n_state_var;
+	workspace->k1 = workspace->buffer;
+	workspace->k2 = workspace->k1 + n_state_var;
+	workspace->k3 = workspace->k2 + n_state_var;
+	workspace->k4 = workspace->k3 + n_state_var;
+	workspace->k5 = workspace->k4 + n_state_var;
+	workspace->k6 = workspace->k5 + n_state_var;
+	workspace->k7 = workspace->k6 + n_state_var;
+	workspace->temp = workspace->k7 + n_state_var;
+	workspace->x_values = workspace->temp + n_state_var;
+	workspace->x_new = workspace->x_values + n_state_var;
+	workspace->prev_dx = workspace->x_new + n_state_var;
+	workspace->jacobian = workspace->matrix_buffer;
+	workspace->iteration_matrix = workspace->jacobian + ((size_t)n_state_var * n_state_var);
+
+	for (int i = 0; i < n_state_var; ++i)
+	{
+		workspace->x_ptrs[i] = &workspace->x_values[i];
+	}
+
+	reset_numerical_integrator_workspace(workspace);
+	return workspace;
+}
+
+/**
+ * @brief Clears the multistep history, adaptive step size and statistics of a workspace.
+ *
+ * After a reset the next AB2 step re-seeds itself with the Heun starter, the next
+ * DOPRI45 step restarts its step-size control and the next SDIRK2 step rebuilds its
+ * Jacobian, exactly as on the very first call.
+ * Use this when the same workspace is reused for a new run.
+ *
+ * @param workspace  Workspace to reset (NULL is ignored).
+ */
+void reset_numerical_integrator_workspace(numerical_integrator_workspace_t *workspace)
+{
+	if (!workspace)
+	{
+		return;
+	}
+
+	for (int i = 0; i < workspace->n_state_var; ++i)
+	{
+		workspace->prev_dx[i] = 0.0;
+	}
+	workspace->first_call = true;
+	workspace->adaptive_dt = 0.0;
+	workspace->jacobian_stale = true;
+	workspace->jacobian_fresh = false;
+	workspace->factored_h = 0.0;
+	workspace->steps_accepted = 0;
+	workspace->steps_rejected = 0;
+	workspace->steps_forced = 0;
+	workspace->eom_evaluations = 0;
+	workspace->jacobian_evaluations = 0;
+	workspace->factorizations = 0;
+	workspace->newton_iterations = 0;
+}
+
+/**
+ * @brief Logs the step and `eom()` evaluation counts accumulated in a workspace.
+ *
+ * Call at shutdown to compare integrators on the same run, e.g. the number of
+ * right-hand-side evaluations `dopri45_numerical_integrator` needed against
+ * `rk4_numerical_integrator` at the same `dt_sec`.
+ *
+ * @param workspace  Workspace to report (NULL is ignored).
+ */
+void log_numerical_integrator_statistics(const numerical_integrator_workspace_t *workspace)
+{
+	if (!workspace)
+	{
+		return;
+	}
+
+	log_message("Numerical integrator: %ld accepted steps, %ld rejected steps, %ld forced at min dt, %ld eom evaluations\n",
+	            workspace->steps_accepted, workspace->steps_rejected, workspace->steps_forced, workspace->eom_evaluations);
+	if (workspace->jacobian_evaluations > 0)
+	{
+		log_message("Numerical integrator: %ld Jacobian evaluations, %ld factorizations, %ld Newton iterations\n",
+		            workspace->jacobian_evaluations, workspace->factorizations, workspace->newton_iterations);
+	}
+}
+
+/**
+ * @brief Releases an integrator workspace created by `create_numerical_integrator_workspace()`.
+ *
+ * @param workspace  Workspace to free (NULL is ignored).
+ */
+void free_numerical_integrator_workspace(numerical_integrator_workspace_t *workspace)
+{
+	if (!workspace)
+	{
+		return;
+	}
+
+	free(workspace->buffer);
+	free(workspace->matrix_buffer);
+	free(workspace->pivots);
+	free((void *)workspace->x_ptrs);
+	free(workspace);
+}
+
+/**
+ * @brief Checks that a workspace is present and sized for the current state vector.
+ *
+ * @param workspace    Workspace handed to the integrator.
+ * @param n_state_var  Number of state variables being integrated.
+ * @param who          Integrator name used in the error message.
+ *
+ * @return true if the workspace can be used, false otherwise (after setting `shutdownFlag`).
+ */
+static bool integrator_workspace_valid(const numerical_integrator_workspace_t *workspace, const int n_state_var, const char *who)
+{
+	if (!workspace || workspace->n_state_var < n_state_var)
+	{
+		ERROR_MESSAGE("%s integrator: workspace missing or too small for %d state variables.\n", who, n_state_var);
+		shutdownFlag = 1;
+		return false;
+	}
+	return true;
+}
 
 /**
  * @brief Advances a system of ODE state variables using a 2nd-order Adams–Bashforth integrator with a Heun starter.
  *
- * On the first invocation, uses Heun’s method (a 2nd-order Runge–Kutta) to compute the first step:
+ * On the first invocation (or after `reset_numerical_integrator_workspace()`), uses Heun’s method
+ * (a 2nd-order Runge–Kutta) to compute the first step:
  *   1. Evaluates f(x₀) → k1
  *   2. Computes x* = x₀ + dt·k1
  *   3. Evaluates f(x*) → k2
- *   4. Sets x₁ = x₀ + (dt/2)·(k1 + k2) and stores prev_Dx = k2
+ *   4. Sets x₁ = x₀ + (dt/2)·(k1 + k2) and stores prev_dx = k2
  *
  * On subsequent invocations, performs the AB2 step:
  *   xₙ₊₁ = xₙ + (dt/2)·[3·f(xₙ) – f(xₙ₋₁)],
- *   updating prev_Dx for the next step.
+ *   updating prev_dx for the next step.
  *
  * @param state_vars     Array of pointers to the current state variables xₙ (length n_state_var).
  *                       Each element is updated in place to xₙ₊₁.
@@ -56,48 +238,29 @@ MAKE_STAGE_DEFINE(numerical_integrator, void, (NUMERICAL_INTEGRATOR_PARAM_LIST),
  * @param dt             Time step size.
  * @param dynamic_data   Pointer to dynamic parameters used by the ODE right‐hand side (`eom`).
  * @param fixed_data     Pointer to fixed parameters used by the ODE right‐hand side (`eom`).
+ * @param workspace      Integrator workspace; holds the scratch buffers and the f(xₙ₋₁) history,
+ *                       so each simulation instance keeps its own AB2 state.
  *
  * @note
- * - Allocates a temporary buffer `dx` of length `n_state_var` to hold f(xₙ).
- * - On the first call, allocates additional buffers for Heun’s method and frees them before returning.
- * - On error (malloc failure), logs via `ERROR_MESSAGE()`, sets `shutdownFlag = 1`, and returns.
+ * - Does not allocate; all buffers come from @p workspace.
+ * - On a missing or undersized workspace, logs via `ERROR_MESSAGE()`, sets `shutdownFlag = 1`, and returns.
  */
 void ab2_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
 {
-	static double *prev_Dx = NULL; // f(x_{n-1})
-	static bool first_Call = true;
-
-	double *dx = malloc(n_state_var * sizeof(double));
-	if (!dx)
+	if (!integrator_workspace_valid(workspace, n_state_var, "AB2"))
 	{
-		ERROR_MESSAGE("AB2 integrator: failed to allocate dx buffer.\n");
-		shutdownFlag = 1;
 		return;
 	}
 
-	if (first_Call)
+	double *dx = workspace->k1;
+	double *prev_dx = workspace->prev_dx;
+
+	if (workspace->first_call)
 	{
 		// --- Heun starter (2nd-order) ---
-		double *k1 = malloc(n_state_var * sizeof(double));
-		double *k2 = malloc(n_state_var * sizeof(double));
-		double *x_temp_values = malloc(n_state_var * sizeof(double));
-		double **x_ptrs = (double **)malloc(n_state_var * sizeof(double *));
-		if (!k1 || !k2 || !x_temp_values || !x_ptrs)
-		{
-			ERROR_MESSAGE("AB2 integrator: failed to allocate Heun buffers.\n");
-			shutdownFlag = 1;
-			free(k1);
-			free(k2);
-			free(x_temp_values);
-			free((void *)x_ptrs);
-			free(dx);
-			return;
-		}
-
-		for (int i = 0; i < n_state_var; ++i)
-		{
-			x_ptrs[i] = &x_temp_values[i];
-		}
+		double *k1 = workspace->k1;
+		double *k2 = workspace->k2;
+		double *x_temp_values = workspace->x_values;
 
 		// 1) k1 = f(x₀)
 		eom(state_vars, state_names, n_state_var, k1, dynamic_data, fixed_data);
@@ -109,65 +272,43 @@ void ab2_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
 		}
 
 		// 3) k2 = f(x*)
-		eom(x_ptrs, state_names, n_state_var, k2, dynamic_data, fixed_data);
+		eom(workspace->x_ptrs, state_names, n_state_var, k2, dynamic_data, fixed_data);
 
-		// allocate prev_Dx
-		prev_Dx = malloc(n_state_var * sizeof(double));
-		if (!prev_Dx)
-		{
-			ERROR_MESSAGE("AB2 integrator: failed to allocate prev_Dx.\n");
-			shutdownFlag = 1;
-			free(k1);
-			free(k2);
-			free(x_temp_values);
-			free((void *)x_ptrs);
-			free(dx);
-			return;
-		}
-
-		// 4) x₁ = x₀ + dt/2 * (k1 + k2), seed prev_Dx = k2
+		// 4) x₁ = x₀ + dt/2 * (k1 + k2), seed prev_dx = k2
 		for (int i = 0; i < n_state_var; ++i)
 		{
 			*state_vars[i] += dt * 0.5 * (k1[i] + k2[i]);
-			prev_Dx[i] = k2[i];
+			prev_dx[i] = k2[i];
 		}
 
-		first_Call = false;
-		free(k1);
-		free(k2);
-		free(x_temp_values);
-		free((void *)x_ptrs);
-		free(dx);
+		workspace->first_call = false;
+		workspace->steps_accepted++;
+		workspace->eom_evaluations += 2;
 		return;
 	}
 
 	// Normal AB2 step
 	eom(state_vars, state_names, n_state_var, dx, dynamic_data, fixed_data);
 
-	// x_{n+1} = x_n + dt/2 * (3f(x_n) - f(x_{n-1}))
-	for (int i = 0; i < n_state_var; ++i)
-	{
-		*state_vars[i] += dt * 0.5 * (3.0 * dx[i] - prev_Dx[i]);
-	}
-
-	// Update prev_Dx for next step
+	// x_{n+1} = x_n + dt/2 * (3f(x_n) - f(x_{n-1})), then keep f(x_n) for the next step
 	for (int i = 0; i < n_state_var; ++i)
 	{
-		prev_Dx[i] = dx[i];
+		*state_vars[i] += dt * 0.5 * (3.0 * dx[i] - prev_dx[i]);
+		prev_dx[i] = dx[i];
 	}
 
-	free(dx);
+	workspace->steps_accepted++;
+	workspace->eom_evaluations++;
 }
 
 /**
  * @brief Advances a system of ODE state variables using the forward Euler method.
  *
- * Allocates a temporary buffer `dx` of length `n_state_var`, computes the time derivatives
- * at the current state by calling `eom()`, then updates each state variable in place:
+ * Computes the time derivatives at the current state into the workspace buffer `k1`
+ * by calling `eom()`, then updates each state variable in place:
  * \f[
  *   x_i \;\gets\; x_i + dt \cdot \dot{x}_i
  * \f]
- * Finally, frees the temporary buffer.
  *
  * @param state_vars     Array of pointers to the current state variables (length \c n_state_var);
  *                       each pointer is updated to the new value.
@@ -177,21 +318,21 @@ void ab2_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
  * @param dt             Time step size.
  * @param dynamic_data   Pointer to dynamic parameters passed through to the ODE right-hand side (\c eom).
  * @param fixed_data     Pointer to fixed parameters passed through to the ODE right-hand side (\c eom).
+ * @param workspace      Integrator workspace providing the derivative buffer.
  *
  * @note
- * - On memory allocation failure for the \c dx buffer, logs an error via \c ERROR_MESSAGE(),
+ * - On a missing or undersized workspace, logs an error via \c ERROR_MESSAGE(),
  *   sets \c shutdownFlag = 1, and returns without updating the state.
  */
 void euler_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
 {
-	double *dx = malloc(n_state_var * sizeof(double));
-	if (!dx)
+	if (!integrator_workspace_valid(workspace, n_state_var, "Euler"))
 	{
-		ERROR_MESSAGE("Euler integrator: failed to allocate dx.\n");
-		shutdownFlag = 1;
 		return;
 	}
 
+	double *dx = workspace->k1;
+
 	// Evaluate derivatives at the current state
 	eom(state_vars, state_names, n_state_var, dx, dynamic_data, fixed_data);
 
@@ -201,13 +342,14 @@ void euler_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
 		*state_vars[i] += dt * dx[i];
 	}
 
-	free(dx);
+	workspace->steps_accepted++;
+	workspace->eom_evaluations++;
 }
 
 /**
  * @brief Advances ODE state variables using the classical 4th-order Runge–Kutta method.
  *
- * Allocates temporary buffers `k1`–`k4` and `temp` (all length `n_state_var`), then computes:
+ * Uses the workspace buffers `k1`–`k4` and `temp` (all length `n_state_var`) to compute:
  *   1. `k1 = f(xₙ)`
  *   2. `k2 = f(xₙ + (dt/2)·k1)`
  *   3. `k3 = f(xₙ + (dt/2)·k2)`
@@ -216,7 +358,6 @@ void euler_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
  * \f[
  *   x_{n+1} = x_n + \frac{dt}{6}\bigl(k1 + 2k2 + 2k3 + k4\bigr).
  * \f]
- * Frees all temporary buffers on exit.
  *
  * @param state_vars     Array of pointers to the current state variables xₙ (length \c n_state_var);
  *                       each pointer is updated to xₙ₊₁.
@@ -225,26 +366,25 @@ void euler_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
  * @param dt             Time step size.
  * @param dynamic_data   Pointer to dynamic parameters passed through to the ODE right-hand side (\c eom).
  * @param fixed_data     Pointer to fixed parameters passed through to the ODE right-hand side (\c eom).
+ * @param workspace      Integrator workspace providing the stage buffers.
  *
  * @note
- * - If any `malloc()` for the temporary buffers fails, logs an error via `ERROR_MESSAGE()`,
- *   sets `shutdownFlag = 1`, and skips the update (but still frees any allocated buffers).
+ * - On a missing or undersized workspace, logs an error via `ERROR_MESSAGE()`,
+ *   sets `shutdownFlag = 1`, and skips the update.
  */
 void rk4_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
 {
-	double *k1 = malloc(n_state_var * sizeof(double));
-	double *k2 = malloc(n_state_var * sizeof(double));
-	double *k3 = malloc(n_state_var * sizeof(double));
-	double *k4 = malloc(n_state_var * sizeof(double));
-	double *temp = malloc(n_state_var * sizeof(double));
-
-	if (!k1 || !k2 || !k3 || !k4 || !temp)
+	if (!integrator_workspace_valid(workspace, n_state_var, "RK4"))
 	{
-		ERROR_MESSAGE("RK4 integrator allocation failed.\n");
-		shutdownFlag = 1;
-		goto cleanup;
+		return;
 	}
 
+	double *k1 = workspace->k1;
+	double *k2 = workspace->k2;
+	double *k3 = workspace->k3;
+	double *k4 = workspace->k4;
+	double *temp = workspace->temp;
+
 	// Save original state x_n
 	for (int i = 0; i < n_state_var; ++i)
 	{
@@ -281,10 +421,671 @@ void rk4_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
 		*state_vars[i] = temp[i] + ((dt / 6.0) * (k1[i] + (2 * k2[i]) + (2 * k3[i]) + k4[i]));
 	}
 
-cleanup:
-	free(k1);
-	free(k2);
-	free(k3);
-	free(k4);
-	free(temp);
+	workspace->steps_accepted++;
+	workspace->eom_evaluations += 4;
+}
+
+// Dormand–Prince 5(4) tableau (Dormand & Prince, 1980).
+#define DP_A21 (1.0 / 5.0)
+#define DP_A31 (3.0 / 40.0)
+#define DP_A32 (9.0 / 40.0)
+#define DP_A41 (44.0 / 45.0)
+#define DP_A42 (-56.0 / 15.0)
+#define DP_A43 (32.0 / 9.0)
+#define DP_A51 (19372.0 / 6561.0)
+#define DP_A52 (-25360.0 / 2187.0)
+#define DP_A53 (64448.0 / 6561.0)
+#define DP_A54 (-212.0 / 729.0)
+#define DP_A61 (9017.0 / 3168.0)
+#define DP_A62 (-355.0 / 33.0)
+#define DP_A63 (46732.0 / 5247.0)
+#define DP_A64 (49.0 / 176.0)
+#define DP_A65 (-5103.0 / 18656.0)
+// 5th-order weights (also the last row of A, which makes the method first-same-as-last)
+#define DP_B1 (35.0 / 384.0)
+#define DP_B3 (500.0 / 1113.0)
+#define DP_B4 (125.0 / 192.0)
+#define DP_B5 (-2187.0 / 6784.0)
+#define DP_B6 (11.0 / 84.0)
+// difference between the 5th- and embedded 4th-order weights
+#define DP_E1 (71.0 / 57600.0)
+#define DP_E3 (-71.0 / 16695.0)
+#define DP_E4 (71.0 / 1920.0)
+#define DP_E5 (-17253.0 / 339200.0)
+#define DP_E6 (22.0 / 525.0)
+#define DP_E7 (-1.0 / 40.0)
+
+// step-size controller constants
+#define DP_SAFETY 0.9
+#define DP_MIN_FACTOR 0.2
+#define DP_MAX_FACTOR 5.0
+
+/**
+ * @brief Reads the DOPRI45 tolerances and step limits from the fixed parameters, once per workspace.
+ *
+ * Optional config keys (defaults in parentheses):
+ * - `dopri45_abs_tol` (1e-6)
+ * - `dopri45_rel_tol` (1e-6)
+ * - `dopri45_min_dt_sec` (1e-6)
+ * - `dopri45_max_dt_sec` (0, meaning one full `dt_sec` tick)
+ *
+ * @return true if the configuration is usable, false otherwise (after setting `shutdownFlag`).
+ */
+static bool configure_dopri45(numerical_integrator_workspace_t *workspace, const param_array_t *fixed_data)
+{
+	if (workspace->adaptive_configured)
+	{
+		return true;
+	}
+
+	workspace->abs_tol = get_param_double_or_default(fixed_data, "dopri45_abs_tol", 1e-6);
+	workspace->rel_tol = get_param_double_or_default(fixed_data, "dopri45_rel_tol", 1e-6);
+	workspace->min_dt = get_param_double_or_default(fixed_data, "dopri45_min_dt_sec", 1e-6);
+	workspace->max_dt = get_param_double_or_default(fixed_data, "dopri45_max_dt_sec", 0.0);
+
+	if (workspace->abs_tol <= 0.0 && workspace->rel_tol <= 0.0)
+	{
+		ERROR_MESSAGE("DOPRI45 integrator: dopri45_abs_tol and dopri45_rel_tol cannot both be <= 0.\n");
+		shutdownFlag = 1;
+		return false;
+	}
+	if (workspace->min_dt <= 0.0 || (workspace->max_dt > 0.0 && workspace->max_dt < workspace->min_dt))
+	{
+		ERROR_MESSAGE("DOPRI45 integrator: invalid step limits (min %g, max %g).\n", workspace->min_dt, workspace->max_dt);
+		shutdownFlag = 1;
+		return false;
+	}
+
+	workspace->adaptive_configured = true;
+	return true;
+}
+
+/**
+ * @brief Advances ODE state variables over one `dt` tick with the adaptive Dormand–Prince 5(4) method.
+ *
+ * The tick from the `main()` loop is covered by as many internal substeps as the error
+ * control requires, so logging and `turbine_control` still run exactly once per `dt_sec`
+ * while the integrator itself takes long steps through calm stretches and short ones
+ * through gusts. For each substep of size h:
+ *   1. Evaluates the seven stages k1–k7 (k1 is reused from the previous accepted
+ *      substep's k7 within the same tick, first-same-as-last).
+ *   2. Forms the 5th-order solution and the embedded 4th-order error estimate.
+ *   3. Computes the RMS error norm scaled by `abs_tol + rel_tol·max(|xₙ|, |xₙ₊₁|)`.
+ *   4. Accepts the substep if the norm is <= 1, otherwise rejects it and retries
+ *      with a smaller h. The next h is `0.9·err^(-1/5)·h`, limited to [0.2·h, 5·h]
+ *      and to [`dopri45_min_dt_sec`, `dopri45_max_dt_sec`].
+ *
+ * The last proposed h is kept in the workspace so the next tick starts from it.
+ * Inputs that `eom()` reads from `dynamic_data` (flow speed, control torque) are
+ * held constant across the substeps of one tick, as with the fixed-step methods.
+ *
+ * @param state_vars     Array of pointers to the current state variables xₙ (length \c n_state_var);
+ *                       each pointer is updated to the state at the end of the tick.
+ * @param state_names    Array of \c n_state_var null-terminated names for each state variable.
+ * @param n_state_var    Number of state variables.
+ * @param dt             Tick length to integrate over (the output/control step).
+ * @param dynamic_data   Pointer to dynamic parameters passed through to the ODE right-hand side (\c eom).
+ * @param fixed_data     Pointer to fixed parameters; also holds the `dopri45_*` settings.
+ * @param workspace      Integrator workspace providing the stage buffers, step-size state and statistics.
+ *
+ * @note
+ * - If the error cannot be met at `dopri45_min_dt_sec`, the substep is accepted anyway and
+ *   counted in `steps_forced`.
+ * - On a missing workspace or invalid settings, logs via `ERROR_MESSAGE()`, sets
+ *   `shutdownFlag = 1`, and returns without updating the state.
+ */
+void dopri45_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
+{
+	if (!integrator_workspace_valid(workspace, n_state_var, "DOPRI45") || !configure_dopri45(workspace, fixed_data))
+	{
+		return;
+	}
+
+	double *k1 = workspace->k1;
+	double *k2 = workspace->k2;
+	double *k3 = workspace->k3;
+	double *k4 = workspace->k4;
+	double *k5 = workspace->k5;
+	double *k6 = workspace->k6;
+	double *k7 = workspace->k7;
+	double *x_n = workspace->temp;
+	double *x_new = workspace->x_new;
+
+	const double max_dt = workspace->max_dt > 0.0 ? workspace->max_dt : dt;
+	double h = workspace->adaptive_dt > 0.0 ? workspace->adaptive_dt : fmin(dt, max_dt);
+	double t = 0.0;
+	bool k1_valid = false;
+
+	for (int i = 0; i < n_state_var; ++i)
+	{
+		x_n[i] = *state_vars[i];
+	}
+
+	while (t < dt && !shutdownFlag)
+	{
+		h = fmin(fmax(h, workspace->min_dt), max_dt);
+		// do not step past the end of the tick, and avoid leaving a sliver behind
+		const double remaining = dt - t;
+		const bool last_substep = h >= remaining * (1.0 - 1e-12);
+		const double h_step = last_substep ? remaining : h;
+
+		if (!k1_valid)
+		{
+			for (int i = 0; i < n_state_var; ++i)
+			{
+				*state_vars[i] = x_n[i];
+			}
+			eom(state_vars, state_names, n_state_var, k1, dynamic_data, fixed_data);
+			workspace->eom_evaluations++;
+		}
+
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			*state_vars[i] = x_n[i] + (h_step * DP_A21 * k1[i]);
+		}
+		eom(state_vars, state_names, n_state_var, k2, dynamic_data, fixed_data);
+
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			*state_vars[i] = x_n[i] + (h_step * ((DP_A31 * k1[i]) + (DP_A32 * k2[i])));
+		}
+		eom(state_vars, state_names, n_state_var, k3, dynamic_data, fixed_data);
+
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			*state_vars[i] = x_n[i] + (h_step * ((DP_A41 * k1[i]) + (DP_A42 * k2[i]) + (DP_A43 * k3[i])));
+		}
+		eom(state_vars, state_names, n_state_var, k4, dynamic_data, fixed_data);
+
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			*state_vars[i] = x_n[i] + (h_step * ((DP_A51 * k1[i]) + (DP_A52 * k2[i]) + (DP_A53 * k3[i]) + (DP_A54 * k4[i])));
+		}
+		eom(state_vars, state_names, n_state_var, k5, dynamic_data, fixed_data);
+
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			*state_vars[i] = x_n[i] + (h_step * ((DP_A61 * k1[i]) + (DP_A62 * k2[i]) + (DP_A63 * k3[i]) + (DP_A64 * k4[i]) + (DP_A65 * k5[i])));
+		}
+		eom(state_vars, state_names, n_state_var, k6, dynamic_data, fixed_data);
+
+		// 5th-order solution, then k7 = f(x_{n+1}) for the error estimate (and FSAL)
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			x_new[i] = x_n[i] + (h_step * ((DP_B1 * k1[i]) + (DP_B3 * k3[i]) + (DP_B4 * k4[i]) + (DP_B5 * k5[i]) + (DP_B6 * k6[i])));
+			*state_vars[i] = x_new[i];
+		}
+		eom(state_vars, state_names, n_state_var, k7, dynamic_data, fixed_data);
+		workspace->eom_evaluations += 6;
+
+		// RMS of the scaled embedded error estimate
+		double err_sum = 0.0;
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			const double err_i = h_step * ((DP_E1 * k1[i]) + (DP_E3 * k3[i]) + (DP_E4 * k4[i]) + (DP_E5 * k5[i]) + (DP_E6 * k6[i]) + (DP_E7 * k7[i]));
+			const double scale = workspace->abs_tol + (workspace->rel_tol * fmax(fabs(x_n[i]), fabs(x_new[i])));
+			const double ratio = err_i / scale;
+			err_sum += ratio * ratio;
+		}
+		const double err_norm = sqrt(err_sum / n_state_var);
+
+		double factor = DP_MAX_FACTOR;
+		if (err_norm > 0.0)
+		{
+			factor = fmin(DP_MAX_FACTOR, fmax(DP_MIN_FACTOR, DP_SAFETY * pow(err_norm, -0.2)));
+		}
+
+		const bool at_min_dt = h_step <= workspace->min_dt;
+		if (err_norm <= 1.0 || at_min_dt)
+		{
+			if (err_norm > 1.0)
+			{
+				workspace->steps_forced++;
+			}
+			workspace->steps_accepted++;
+
+			t = last_substep ? dt : t + h_step;
+			for (int i = 0; i < n_state_var; ++i)
+			{
+				x_n[i] = x_new[i];
+				k1[i] = k7[i];
+			}
+			k1_valid = true;
+
+			// a truncated final substep says little about the step the dynamics allow
+			if (!last_substep || h_step >= h)
+			{
+				h = h_step * factor;
+			}
+		}
+		else
+		{
+			workspace->steps_rejected++;
+			h = h_step * factor;
+		}
+	}
+
+	workspace->adaptive_dt = h;
+
+	for (int i = 0; i < n_state_var; ++i)
+	{
+		*state_vars[i] = x_n[i];
+	}
+}
+
+// L-stable, stiffly accurate two-stage SDIRK of order 2 (Alexander, 1977): gamma = 1 - 1/sqrt(2)
+#define SDIRK2_GAMMA (1.0 - (1.0 / 1.4142135623730951))
+#define SDIRK2_MAX_GROWTH 2.0       // largest substep increase after a step that converged quickly
+#define SDIRK2_FAST_ITERATIONS 2    // stages converging within this many iterations let the substep grow
+
+/**
+ * @brief Reads the SDIRK2 Newton settings and picks the Jacobian source, once per workspace.
+ *
+ * Optional config keys (defaults in parentheses):
+ * - `sdirk2_abs_tol` (1e-6), `sdirk2_rel_tol` (1e-6): Newton stops once the scaled RMS update is <= 1
+ * - `sdirk2_max_newton_iterations` (6)
+ * - `sdirk2_jacobian_refresh_rate` (0.5): contraction rate above which the Jacobian is rebuilt
+ * - `sdirk2_min_dt_sec` (1e-6): smallest substep tried when Newton does not converge
+ * - `sdirk2_analytic_jacobian` (1): use the `eomJacobianMap` entry of `eom_function_call` if there is one
+ *
+ * @return true if the configuration is usable, false otherwise (after setting `shutdownFlag`).
+ */
+static bool configure_sdirk2(numerical_integrator_workspace_t *workspace, const param_array_t *fixed_data)
+{
+	if (workspace->implicit_configured)
+	{
+		return true;
+	}
+
+	workspace->abs_tol = get_param_double_or_default(fixed_data, "sdirk2_abs_tol", 1e-6);
+	workspace->rel_tol = get_param_double_or_default(fixed_data, "sdirk2_rel_tol", 1e-6);
+	workspace->max_newton_iterations = get_param_int_or_default(fixed_data, "sdirk2_max_newton_iterations", 6);
+	workspace->jacobian_refresh_rate = get_param_double_or_default(fixed_data, "sdirk2_jacobian_refresh_rate", 0.5);
+	workspace->min_dt = get_param_double_or_default(fixed_data, "sdirk2_min_dt_sec", 1e-6);
+
+	if (workspace->abs_tol <= 0.0 && workspace->rel_tol <= 0.0)
+	{
+		ERROR_MESSAGE("SDIRK2 integrator: sdirk2_abs_tol and sdirk2_rel_tol cannot both be <= 0.\n");
+		shutdownFlag = 1;
+		return false;
+	}
+	if (workspace->max_newton_iterations < 1 || workspace->min_dt <= 0.0)
+	{
+		ERROR_MESSAGE("SDIRK2 integrator: invalid Newton settings (max iterations %d, min dt %g).\n", workspace->max_newton_iterations, workspace->min_dt);
+		shutdownFlag = 1;
+		return false;
+	}
+
+	workspace->analytic_jacobian = NULL;
+	const char *eom_id = get_param_string_or_default(fixed_data, "eom_function_call", "");
+	if (get_param_int_or_default(fixed_data, "sdirk2_analytic_jacobian", 1) > 0)
+	{
+		for (size_t i = 0; i < sizeof(eomJacobianMap) / sizeof(eomJacobianMap[0]); ++i)
+		{
+			if (strcmp(eom_id, eomJacobianMap[i].id) == 0)
+			{
+				workspace->analytic_jacobian = eomJacobianMap[i].fn;
+				break;
+			}
+		}
+	}
+	log_message("SDIRK2 integrator: %s Jacobian for %s\n", workspace->analytic_jacobian ? "analytic" : "finite-difference", eom_id);
+
+	workspace->implicit_configured = true;
+	return true;
+}
+
+/**
+ * @brief Evaluates f(@p x) with @p x written into the live state variables.
+ *
+ * As in rk4 and dopri45, the trial state goes through `state_vars` rather than a scratch
+ * vector: stages called by `eom()` (the aero and drivetrain torques of `example_turbine_eom`)
+ * read the state through their own `dynamic_data` pointers, so only then do they see @p x.
+ * The caller restores xₙ when the tick ends.
+ */
+static void sdirk2_eom_at(double **state_vars, const double *x, const char **state_names, const int n_state_var, double *f, const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	for (int i = 0; i < n_state_var; ++i)
+	{
+		*state_vars[i] = x[i];
+	}
+	eom(state_vars, state_names, n_state_var, f, dynamic_data, fixed_data);
+}
+
+/**
+ * @brief Evaluates the Jacobian of `eom()` at @p x, analytically or by forward differences.
+ *
+ * The finite-difference columns perturb one live state variable at a time by
+ * `sqrt(eps)·max(|x_j|, 1)` and reuse @p f_x = f(x), so one Jacobian costs n `eom()` calls.
+ * The live state is left at @p x.
+ */
+static void sdirk2_build_jacobian(numerical_integrator_workspace_t *workspace, double **state_vars, const double *x, const double *f_x, const char **state_names, const int n_state_var, const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	double *jac = workspace->jacobian;
+	double *f_pert = workspace->k6;
+
+	for (int i = 0; i < n_state_var; ++i)
+	{
+		*state_vars[i] = x[i];
+	}
+
+	if (workspace->analytic_jacobian)
+	{
+		workspace->analytic_jacobian(state_vars, state_names, n_state_var, jac, dynamic_data, fixed_data);
+	}
+	else
+	{
+		for (int j = 0; j < n_state_var; ++j)
+		{
+			const double delta = sqrt(DBL_EPSILON) * fmax(fabs(x[j]), 1.0);
+			*state_vars[j] = x[j] + delta;
+			eom(state_vars, state_names, n_state_var, f_pert, dynamic_data, fixed_data);
+			*state_vars[j] = x[j];
+			for (int i = 0; i < n_state_var; ++i)
+			{
+				jac[(i * n_state_var) + j] = (f_pert[i] - f_x[i]) / delta;
+			}
+		}
+		workspace->eom_evaluations += n_state_var;
+	}
+
+	workspace->jacobian_evaluations++;
+	workspace->jacobian_stale = false;
+	workspace->jacobian_fresh = true;
+	workspace->factored_h = 0.0;
+}
+
+/**
+ * @brief Forms I - h·γ·J and factors it in place with partially pivoted LU decomposition.
+ *
+ * @return 0 on success, -1 if the matrix is singular.
+ */
+static int sdirk2_factor(numerical_integrator_workspace_t *workspace, const int n, const double h)
+{
+	double *a = workspace->iteration_matrix;
+	int *piv = workspace->pivots;
+
+	for (int i = 0; i < n; ++i)
+	{
+		for (int j = 0; j < n; ++j)
+		{
+			a[(i * n) + j] = (i == j ? 1.0 : 0.0) - (h * SDIRK2_GAMMA * workspace->jacobian[(i * n) + j]);
+		}
+	}
+	workspace->factorizations++;
+	workspace->factored_h = 0.0;
+
+	for (int k = 0; k < n; ++k)
+	{
+		int p = k;
+		for (int i = k + 1; i < n; ++i)
+		{
+			if (fabs(a[(i * n) + k]) > fabs(a[(p * n) + k]))
+			{
+				p = i;
+			}
+		}
+		if (a[(p * n) + k] == 0.0)
+		{
+			return -1;
+		}
+		piv[k] = p;
+		if (p != k)
+		{
+			for (int j = 0; j < n; ++j)
+			{
+				const double tmp = a[(k * n) + j];
+				a[(k * n) + j] = a[(p * n) + j];
+				a[(p * n) + j] = tmp;
+			}
+		}
+		for (int i = k + 1; i < n; ++i)
+		{
+			const double l = a[(i * n) + k] / a[(k * n) + k];
+			a[(i * n) + k] = l;
+			for (int j = k + 1; j < n; ++j)
+			{
+				a[(i * n) + j] -= l * a[(k * n) + j];
+			}
+		}
+	}
+
+	workspace->factored_h = h;
+	return 0;
+}
+
+/**
+ * @brief Solves (I - h·γ·J)·x = b in place with the factors from `sdirk2_factor()`.
+ */
+static void sdirk2_solve(const numerical_integrator_workspace_t *workspace, const int n, double *b)
+{
+	const double *a = workspace->iteration_matrix;
+	const int *piv = workspace->pivots;
+
+	for (int k = 0; k < n; ++k)
+	{
+		if (piv[k] != k)
+		{
+			const double tmp = b[k];
+			b[k] = b[piv[k]];
+			b[piv[k]] = tmp;
+		}
+		for (int i = k + 1; i < n; ++i)
+		{
+			b[i] -= a[(i * n) + k] * b[k];
+		}
+	}
+	for (int i = n - 1; i >= 0; --i)
+	{
+		for (int j = i + 1; j < n; ++j)
+		{
+			b[i] -= a[(i * n) + j] * b[j];
+		}
+		b[i] /= a[(i * n) + i];
+	}
+}
+
+/**
+ * @brief Solves one SDIRK stage y = base + h·γ·f(y) by simplified Newton with the cached factors.
+ *
+ * @param[in,out] y      Initial guess on entry, the stage value on return.
+ * @param[out]    rate   Largest observed contraction rate ||Δ_k|| / ||Δ_{k-1}||.
+ * @param[out]    iters  Iterations used.
+ *
+ * @return true once the scaled RMS update is <= 1, false if Newton diverges or runs out of iterations.
+ */
+static bool sdirk2_newton_stage(numerical_integrator_workspace_t *workspace, double **state_vars, const char **state_names, const int n_state_var, const double h, const double *base, double *y, double *rate, int *iters, const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	double *f_y = workspace->k5;
+	double *delta = workspace->k4;
+	double prev_norm = 0.0;
+	*rate = 0.0;
+
+	for (int iter = 1; iter <= workspace->max_newton_iterations && !shutdownFlag; ++iter)
+	{
+		*iters = iter;
+		sdirk2_eom_at(state_vars, y, state_names, n_state_var, f_y, dynamic_data, fixed_data);
+		workspace->eom_evaluations++;
+		workspace->newton_iterations++;
+
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			delta[i] = base[i] + (h * SDIRK2_GAMMA * f_y[i]) - y[i];
+		}
+		sdirk2_solve(workspace, n_state_var, delta);
+
+		double sum = 0.0;
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			y[i] += delta[i];
+			const double scale = workspace->abs_tol + (workspace->rel_tol * fabs(y[i]));
+			const double ratio = delta[i] / scale;
+			sum += ratio * ratio;
+		}
+		const double norm = sqrt(sum / n_state_var);
+
+		if (iter > 1)
+		{
+			const double this_rate = prev_norm > 0.0 ? norm / prev_norm : 0.0;
+			*rate = fmax(*rate, this_rate);
+			if (this_rate >= 1.0)
+			{
+				return false;
+			}
+		}
+		if (norm <= 1.0 || !isfinite(norm))
+		{
+			return isfinite(norm);
+		}
+		prev_norm = norm;
+	}
+	return false;
+}
+
+/**
+ * @brief Advances ODE state variables over one `dt` tick with an implicit, L-stable SDIRK2 method.
+ *
+ * For stiff models (stiff shaft compliance, fast VFD dynamics in `drivetrain`) whose explicit
+ * integration needs a `dt_sec` orders of magnitude below the control rate. Each substep of
+ * size h solves the two stages
+ *   Y₁ = xₙ + h·γ·f(Y₁)
+ *   Y₂ = xₙ + h·(1−γ)·K₁ + h·γ·f(Y₂),   K₁ = (Y₁ − xₙ)/(h·γ)
+ * and sets xₙ₊₁ = Y₂, with γ = 1 − 1/√2. Both stages share the iteration matrix I − h·γ·J,
+ * so a substep costs one LU solve and one `eom()` call per Newton iteration.
+ *
+ * The Jacobian J comes from the `eomJacobianMap` entry of the selected eom when there is one,
+ * otherwise from forward differences of `eom()`. It and its factors are kept in the workspace
+ * and reused across substeps and ticks:
+ * - a Newton contraction rate above `sdirk2_jacobian_refresh_rate` rebuilds J before the next substep;
+ * - a substep whose Newton iteration fails with an old J is retried after rebuilding J at xₙ;
+ * - with a fresh J it is retried at half the size, down to `sdirk2_min_dt_sec`.
+ * The matrix is only refactored when J or h changes. After substeps that converged within
+ * two iterations per stage the substep size grows again, up to the full tick.
+ *
+ * @param state_vars     Array of pointers to the current state variables xₙ (length \c n_state_var);
+ *                       they hold each Newton trial state while `eom()` runs, and the state at
+ *                       the end of the tick on return.
+ * @param state_names    Array of \c n_state_var null-terminated names for each state variable.
+ * @param n_state_var    Number of state variables.
+ * @param dt             Tick length to integrate over (the output/control step).
+ * @param dynamic_data   Pointer to dynamic parameters passed through to the ODE right-hand side (\c eom).
+ * @param fixed_data     Pointer to fixed parameters; also holds the `sdirk2_*` settings.
+ * @param workspace      Integrator workspace providing the stage buffers, cached Jacobian and statistics.
+ *
+ * @note
+ * - If Newton does not converge at `sdirk2_min_dt_sec` with a fresh Jacobian, or the iteration
+ *   matrix is singular, logs via `ERROR_MESSAGE()`, sets `shutdownFlag = 1`, and leaves the state at
+ *   the last accepted substep.
+ */
+void sdirk2_numerical_integrator(NUMERICAL_INTEGRATOR_PARAM_LIST)
+{
+	if (!integrator_workspace_valid(workspace, n_state_var, "SDIRK2") || !configure_sdirk2(workspace, fixed_data))
+	{
+		return;
+	}
+
+	double *x_n = workspace->temp;
+	double *f_n = workspace->k1;
+	double *k_1 = workspace->k2;
+	double *base = workspace->k3;
+	double *y = workspace->x_new;
+
+	double h = workspace->adaptive_dt > 0.0 ? fmin(workspace->adaptive_dt, dt) : dt;
+	double t = 0.0;
+	bool f_n_valid = false;
+
+	for (int i = 0; i < n_state_var; ++i)
+	{
+		x_n[i] = *state_vars[i];
+	}
+
+	while (t < dt && !shutdownFlag)
+	{
+		const double remaining = dt - t;
+		const bool last_substep = h >= remaining * (1.0 - 1e-12);
+		const double h_step = last_substep ? remaining : h;
+
+		if (!f_n_valid)
+		{
+			sdirk2_eom_at(state_vars, x_n, state_names, n_state_var, f_n, dynamic_data, fixed_data);
+			workspace->eom_evaluations++;
+			f_n_valid = true;
+		}
+		if (workspace->jacobian_stale)
+		{
+			sdirk2_build_jacobian(workspace, state_vars, x_n, f_n, state_names, n_state_var, dynamic_data, fixed_data);
+		}
+		if (workspace->factored_h != h_step && sdirk2_factor(workspace, n_state_var, h_step) != 0)
+		{
+			ERROR_MESSAGE("SDIRK2 integrator: singular iteration matrix at h = %g.\n", h_step);
+			shutdownFlag = 1;
+			break;
+		}
+
+		// stage 1, predicted by an explicit Euler step
+		double rate_1 = 0.0;
+		double rate_2 = 0.0;
+		int iters_1 = 0;
+		int iters_2 = 0;
+		for (int i = 0; i < n_state_var; ++i)
+		{
+			y[i] = x_n[i] + (h_step * SDIRK2_GAMMA * f_n[i]);
+		}
+		bool converged = sdirk2_newton_stage(workspace, state_vars, state_names, n_state_var, h_step, x_n, y, &rate_1, &iters_1, dynamic_data, fixed_data);
+
+		// stage 2, predicted by continuing with K₁
+		if (converged)
+		{
+			for (int i = 0; i < n_state_var; ++i)
+			{
+				k_1[i] = (y[i] - x_n[i]) / (h_step * SDIRK2_GAMMA);
+				base[i] = x_n[i] + (h_step * (1.0 - SDIRK2_GAMMA) * k_1[i]);
+				y[i] = base[i] + (h_step * SDIRK2_GAMMA * k_1[i]);
+			}
+			converged = sdirk2_newton_stage(workspace, state_vars, state_names, n_state_var, h_step, base, y, &rate_2, &iters_2, dynamic_data, fixed_data);
+		}
+
+		if (converged)
+		{
+			workspace->steps_accepted++;
+			t = last_substep ? dt : t + h_step;
+			for (int i = 0; i < n_state_var; ++i)
+			{
+				x_n[i] = y[i];
+			}
+			f_n_valid = false;
+			workspace->jacobian_fresh = false;
+			if (fmax(rate_1, rate_2) > workspace->jacobian_refresh_rate)
+			{
+				workspace->jacobian_stale = true;
+			}
+			if (iters_1 <= SDIRK2_FAST_ITERATIONS && iters_2 <= SDIRK2_FAST_ITERATIONS && (!last_substep || h_step >= h))
+			{
+				h = fmin(h_step * SDIRK2_MAX_GROWTH, dt);
+			}
+			continue;
+		}
+
+		workspace->steps_rejected++;
+		if (!workspace->jacobian_fresh)
+		{
+			workspace->jacobian_stale = true;
+		}
+		else if (h_step > workspace->min_dt)
+		{
+			h = fmax(0.5 * h_step, workspace->min_dt);
+		}
+		else
+		{
+			ERROR_MESSAGE("SDIRK2 integrator: Newton did not converge at the minimum substep %g.\n", h_step);
+			shutdownFlag = 1;
+		}
+	}
+
+	workspace->adaptive_dt = h;
+
+	for (int i = 0; i < n_state_var; ++i)
+	{
+		*state_vars[i] = x_n[i];
+	}
 }
@@ -0,0 +1,382 @@
+/**
+ * @file    online_stats.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Constant-memory running statistics of one channel: Welford moments, P-square quantiles and rainflow damage
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "online_stats.h"
+#include "logger.h" // for ERROR_MESSAGE
+#include <math.h>   // for fabs, pow, NAN
+#include <stddef.h> // for NULL
+#include <stdlib.h> // for malloc, realloc, free
+#include <string.h> // for memcpy
+
+/**
+ * @brief Resets one P-square sketch for quantile @p p.
+ */
+static void init_p2_quantile(p2_quantile_t *sketch, const double p)
+{
+	sketch->p = p;
+	sketch->count = 0;
+	sketch->increment[0] = 0.0;
+	sketch->increment[1] = p / 2.0;
+	sketch->increment[2] = p;
+	sketch->increment[3] = (1.0 + p) / 2.0;
+	sketch->increment[4] = 1.0;
+}
+
+/**
+ * @brief Sorts the first @p n values in place; used on at most `ONLINE_STATS_P2_MARKERS` values.
+ */
+static void insertion_sort(double *values, const long n)
+{
+	for (long i = 1; i < n; i++)
+	{
+		const double v = values[i];
+		long j = i - 1;
+		while (j >= 0 && values[j] > v)
+		{
+			values[j + 1] = values[j];
+			j--;
+		}
+		values[j + 1] = v;
+	}
+}
+
+/**
+ * @brief Piecewise-parabolic prediction of marker @p i moved by @p d (+1 or -1) positions.
+ */
+static double p2_parabolic(const p2_quantile_t *sketch, const int i, const double d)
+{
+	const double *q = sketch->height;
+	const double *n = sketch->position;
+	return q[i] + (d / (n[i + 1] - n[i - 1])) * (((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i])) + ((n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1])));
+}
+
+/**
+ * @brief Adds one sample to a P-square sketch.
+ *
+ * The first five samples are kept as the initial marker heights; after that the markers are
+ * shifted towards their desired positions with the parabolic (or, if that would break the
+ * ordering, linear) prediction.
+ */
+static void p2_quantile_update(p2_quantile_t *sketch, const double x)
+{
+	double *q = sketch->height;
+	double *n = sketch->position;
+
+	if (sketch->count < ONLINE_STATS_P2_MARKERS)
+	{
+		q[sketch->count++] = x;
+		if (sketch->count == ONLINE_STATS_P2_MARKERS)
+		{
+			insertion_sort(q, ONLINE_STATS_P2_MARKERS);
+			const double p = sketch->p;
+			for (int i = 0; i < ONLINE_STATS_P2_MARKERS; i++)
+			{
+				n[i] = i;
+			}
+			sketch->desired[0] = 0.0;
+			sketch->desired[1] = 2.0 * p;
+			sketch->desired[2] = 4.0 * p;
+			sketch->desired[3] = 2.0 + (2.0 * p);
+			sketch->desired[4] = 4.0;
+		}
+		return;
+	}
+
+	// cell k holds x; the extreme markers follow the sample range.
+	int k = 0;
+	if (x < q[0])
+	{
+		q[0] = x;
+	}
+	else if (x >= q[4])
+	{
+		q[4] = x;
+		k = 3;
+	}
+	else
+	{
+		while (k < 3 && x >= q[k + 1])
+		{
+			k++;
+		}
+	}
+
+	for (int i = k + 1; i < ONLINE_STATS_P2_MARKERS; i++)
+	{
+		n[i] += 1.0;
+	}
+	for (int i = 0; i < ONLINE_STATS_P2_MARKERS; i++)
+	{
+		sketch->desired[i] += sketch->increment[i];
+	}
+	sketch->count++;
+
+	for (int i = 1; i < ONLINE_STATS_P2_MARKERS - 1; i++)
+	{
+		const double offset = sketch->desired[i] - n[i];
+		if ((offset >= 1.0 && n[i + 1] - n[i] > 1.0) || (offset <= -1.0 && n[i - 1] - n[i] < -1.0))
+		{
+			const double d = offset >= 0.0 ? 1.0 : -1.0;
+			const double predicted = p2_parabolic(sketch, i, d);
+			if (q[i - 1] < predicted && predicted < q[i + 1])
+			{
+				q[i] = predicted;
+			}
+			else
+			{
+				const int j = i + (int)d;
+				q[i] += d * (q[j] - q[i]) / (n[j] - n[i]);
+			}
+			n[i] += d;
+		}
+	}
+}
+
+/**
+ * @brief Current estimate of a P-square sketch; exact (interpolated) while fewer than five samples were seen.
+ */
+static double p2_quantile_value(const p2_quantile_t *sketch)
+{
+	if (sketch->count == 0)
+	{
+		return NAN;
+	}
+	if (sketch->count >= ONLINE_STATS_P2_MARKERS)
+	{
+		return sketch->height[2];
+	}
+
+	double sorted[ONLINE_STATS_P2_MARKERS];
+	memcpy(sorted, sketch->height, (size_t)sketch->count * sizeof(double));
+	insertion_sort(sorted, sketch->count);
+	const double rank = sketch->p * (double)(sketch->count - 1);
+	const long lower = (long)rank;
+	if (lower + 1 >= sketch->count)
+	{
+		return sorted[sketch->count - 1];
+	}
+	return sorted[lower] + ((rank - (double)lower) * (sorted[lower + 1] - sorted[lower]));
+}
+
+/**
+ * @brief Pushes a reversal and closes every cycle the four-point rule finds on top of the residue.
+ *
+ * @return 0 on success, -1 if the residue could not grow (the reversal is dropped).
+ */
+static int rainflow_push_reversal(rainflow_counter_t *rainflow, const double reversal)
+{
+	if (rainflow->n_residue == rainflow->capacity)
+	{
+		const int capacity = rainflow->capacity * 2;
+		double *grown = realloc(rainflow->residue, (size_t)capacity * sizeof(double));
+		if (grown == NULL)
+		{
+			ERROR_MESSAGE("Online stats: failed to grow the rainflow residue to %d reversals\n", capacity);
+			return -1;
+		}
+		rainflow->residue = grown;
+		rainflow->capacity = capacity;
+	}
+
+	double *r = rainflow->residue;
+	r[rainflow->n_residue++] = reversal;
+	while (rainflow->n_residue >= 4)
+	{
+		const int n = rainflow->n_residue;
+		const double inner = fabs(r[n - 2] - r[n - 3]);
+		if (inner > fabs(r[n - 3] - r[n - 4]) || inner > fabs(r[n - 1] - r[n - 2]))
+		{
+			break;
+		}
+		rainflow->damage_sum += pow(inner, rainflow->wohler_m);
+		rainflow->n_cycles++;
+		r[n - 3] = r[n - 1];
+		rainflow->n_residue -= 2;
+	}
+	return 0;
+}
+
+/**
+ * @brief Feeds one sample to the rainflow counter; only turning points reach the residue.
+ */
+static void rainflow_update(rainflow_counter_t *rainflow, const double x)
+{
+	if (!rainflow->started)
+	{
+		rainflow->started = true;
+		rainflow->extreme = x;
+		rainflow->direction = 0;
+		rainflow_push_reversal(rainflow, x); // the first sample opens the first half cycle
+		return;
+	}
+	if (x == rainflow->extreme)
+	{
+		return;
+	}
+
+	const int direction = x > rainflow->extreme ? 1 : -1;
+	if (rainflow->direction != 0 && direction != rainflow->direction)
+	{
+		rainflow_push_reversal(rainflow, rainflow->extreme);
+	}
+	rainflow->direction = direction;
+	rainflow->extreme = x;
+}
+
+/**
+ * @brief Prepares @p stats for a new series.
+ *
+ * @param stats        Statistics to initialise; release with `free_online_stats()`.
+ * @param quantiles    Quantiles in [0, 1] to track, may be NULL when @p n_quantiles is 0.
+ * @param n_quantiles  At most `ONLINE_STATS_MAX_QUANTILES`.
+ * @param wohler_m     Positive S-N (Woehler) slope used by the rainflow damage sum.
+ * @return 0 on success, -1 (reported) on invalid arguments or allocation failure.
+ */
+int init_online_stats(online_stats_t *stats, const double *quantiles, const int n_quantiles, const double wohler_m)
+{
+	*stats = (online_stats_t){0};
+	if (n_quantiles < 0 || n_quantiles > ONLINE_STATS_MAX_QUANTILES)
+	{
+		ERROR_MESSAGE("Online stats: %d quantiles requested, at most %d are supported\n", n_quantiles, ONLINE_STATS_MAX_QUANTILES);
+		return -1;
+	}
+	if (!(wohler_m > 0.0))
+	{
+		ERROR_MESSAGE("Online stats: Woehler exponent must be positive, got %g\n", wohler_m);
+		return -1;
+	}
+	for (int k = 0; k < n_quantiles; k++)
+	{
+		if (!(quantiles[k] >= 0.0 && quantiles[k] <= 1.0))
+		{
+			ERROR_MESSAGE("Online stats: quantile %g is outside [0, 1]\n", quantiles[k]);
+			return -1;
+		}
+		init_p2_quantile(&stats->quantiles[k], quantiles[k]);
+	}
+	stats->n_quantiles = n_quantiles;
+
+	stats->rainflow.residue = malloc(ONLINE_STATS_RAINFLOW_INITIAL_RESIDUE * sizeof(double));
+	if (stats->rainflow.residue == NULL)
+	{
+		ERROR_MESSAGE("Online stats: failed to allocate the rainflow residue\n");
+		return -1;
+	}
+	stats->rainflow.capacity = ONLINE_STATS_RAINFLOW_INITIAL_RESIDUE;
+	stats->rainflow.wohler_m = wohler_m;
+	return 0;
+}
+
+/**
+ * @brief Adds one sample to every statistic.
+ */
+void online_stats_update(online_stats_t *stats, const double x)
+{
+	if (stats->count == 0)
+	{
+		stats->min = x;
+		stats->max = x;
+	}
+	else if (x < stats->min)
+	{
+		stats->min = x;
+	}
+	else if (x > stats->max)
+	{
+		stats->max = x;
+	}
+
+	// Welford: numerically stable running mean and sum of squared deviations.
+	stats->count++;
+	const double delta = x - stats->mean;
+	stats->mean += delta / (double)stats->count;
+	stats->m2 += delta * (x - stats->mean);
+
+	for (int k = 0; k < stats->n_quantiles; k++)
+	{
+		p2_quantile_update(&stats->quantiles[k], x);
+	}
+	rainflow_update(&stats->rainflow, x);
+}
+
+/**
+ * @brief Sample variance (n - 1 denominator), 0 with fewer than two samples.
+ */
+double online_stats_variance(const online_stats_t *stats)
+{
+	return stats->count > 1 ? stats->m2 / (double)(stats->count - 1) : 0.0;
+}
+
+/**
+ * @brief Estimate of the @p k-th tracked quantile, NAN before the first sample or for an invalid @p k.
+ */
+double online_stats_quantile(const online_stats_t *stats, const int k)
+{
+	if (k < 0 || k >= stats->n_quantiles)
+	{
+		return NAN;
+	}
+	return p2_quantile_value(&stats->quantiles[k]);
+}
+
+/**
+ * @brief Damage-equivalent load: the range that, repeated @p n_equivalent times, does the same damage.
+ *
+ * `DEL = (sum(n_i * S_i^m) / n_equivalent)^(1/m)` over the closed cycles, with the residue and the
+ * last, still open, extreme counted as half cycles. Does not modify the counter, so it can be
+ * queried mid-run.
+ *
+ * @return The DEL, or 0 if @p n_equivalent is not positive or no cycle was seen.
+ */
+double online_stats_damage_equivalent_load(const online_stats_t *stats, const double n_equivalent)
+{
+	const rainflow_counter_t *rainflow = &stats->rainflow;
+	if (!(n_equivalent > 0.0) || !rainflow->started)
+	{
+		return 0.0;
+	}
+
+	double damage = rainflow->damage_sum;
+	double previous = rainflow->n_residue > 0 ? rainflow->residue[0] : rainflow->extreme;
+	for (int i = 1; i <= rainflow->n_residue; i++)
+	{
+		const double current = i < rainflow->n_residue ? rainflow->residue[i] : rainflow->extreme;
+		damage += 0.5 * pow(fabs(current - previous), rainflow->wohler_m);
+		previous = current;
+	}
+	return pow(damage / n_equivalent, 1.0 / rainflow->wohler_m);
+}
+
+/**
+ * @brief Releases the rainflow residue. Safe to call more than once.
+ */
+void free_online_stats(online_stats_t *stats)
+{
+	free(stats->rainflow.residue);
+	stats->rainflow.residue = NULL;
+	stats->rainflow.n_residue = 0;
+	stats->rainflow.capacity = 0;
+}
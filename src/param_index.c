@@ -0,0 +1,311 @@
+/**
+ * @file    param_index.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Hashed name lookup and stable handles for parameter arrays
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "param_index.h"
+#include "logger.h"         // for ERROR_MESSAGE
+#include "xflow_aero_sim.h" // for param_array_t, input_param_t
+#include <pthread.h>        // for pthread_mutex_lock, pthread_mutex_unlock, PTHREAD_MUTEX_INITIALIZER
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stddef.h>         // for size_t, NULL
+#include <stdint.h>         // for uint32_t
+#include <stdlib.h>         // for calloc, free
+#include <string.h>         // for strcmp
+
+// Arrays indexed at once: dynamic + fixed per run, plus one dynamic array per DISCON turbine, so
+// a farm of up to ~100 turbines fits. Beyond that, tables are evicted round-robin and rebuilt on
+// the next lookup of their array. Call invalidate_param_index() before freeing an array.
+#define PARAM_INDEX_MAX_ARRAYS 128
+#define PARAM_INDEX_EMPTY (-1)
+
+/*
+ * One open-addressing table per parameter array. The table is keyed by the array address
+ * and remembers the `params` pointer and `n_param` it was built for, so an array that grew
+ * (add_param reallocates) is re-indexed on its next lookup.
+ */
+typedef struct
+{
+	const param_array_t *owner;
+	const input_param_t *params;
+	int n_param;
+	uint32_t mask;  // capacity - 1, capacity is a power of two >= 2 * n_param
+	int *slots;     // parameter index or PARAM_INDEX_EMPTY
+	uint32_t *hash; // full hash of each occupied slot, avoids most strcmp calls
+} param_index_t;
+
+static param_index_t paramIndices[PARAM_INDEX_MAX_ARRAYS];
+static int paramIndexNextEvict = 0;
+static pthread_mutex_t paramIndexMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 32-bit FNV-1a hash of a parameter name.
+ */
+static uint32_t param_name_hash(const char *name)
+{
+	uint32_t h = 2166136261U;
+	for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+	{
+		h ^= *p;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static void clear_param_index(param_index_t *index)
+{
+	free(index->slots);
+	free(index->hash);
+	index->owner = NULL;
+	index->params = NULL;
+	index->n_param = 0;
+	index->mask = 0;
+	index->slots = NULL;
+	index->hash = NULL;
+}
+
+static param_index_t *find_param_index_entry(const param_array_t *data)
+{
+	for (int i = 0; i < PARAM_INDEX_MAX_ARRAYS; i++)
+	{
+		if (paramIndices[i].owner == data)
+		{
+			return &paramIndices[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief (Re)builds the table for `data` in `index`. Assumes the mutex is held.
+ */
+static int fill_param_index(param_index_t *index, const param_array_t *data)
+{
+	clear_param_index(index);
+
+	uint32_t capacity = 16;
+	while (capacity < (uint32_t)data->n_param * 2U)
+	{
+		capacity <<= 1U;
+	}
+
+	index->slots = malloc(capacity * sizeof(int));
+	index->hash = calloc(capacity, sizeof(uint32_t));
+	if (!index->slots || !index->hash)
+	{
+		ERROR_MESSAGE("Failed to allocate parameter index of %u slots\n", capacity);
+		clear_param_index(index);
+		return -1;
+	}
+	for (uint32_t s = 0; s < capacity; s++)
+	{
+		index->slots[s] = PARAM_INDEX_EMPTY;
+	}
+
+	index->owner = data;
+	index->params = data->params;
+	index->n_param = data->n_param;
+	index->mask = capacity - 1U;
+
+	for (int i = 0; i < data->n_param; i++)
+	{
+		const char *name = data->params[i].name;
+		if (!name)
+		{
+			continue;
+		}
+		const uint32_t h = param_name_hash(name);
+		uint32_t s = h & index->mask;
+		bool duplicate = false;
+		while (index->slots[s] != PARAM_INDEX_EMPTY)
+		{
+			if (index->hash[s] == h && strcmp(data->params[index->slots[s]].name, name) == 0)
+			{
+				duplicate = true; // keep the first entry, matching the old linear scan
+				break;
+			}
+			s = (s + 1U) & index->mask;
+		}
+		if (!duplicate)
+		{
+			index->slots[s] = i;
+			index->hash[s] = h;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Returns an up-to-date table for `data`, building or rebuilding it if needed.
+ * Assumes the mutex is held.
+ */
+static param_index_t *acquire_param_index(const param_array_t *data)
+{
+	param_index_t *index = find_param_index_entry(data);
+	if (index && index->params == data->params && index->n_param == data->n_param)
+	{
+		return index;
+	}
+	if (!index)
+	{
+		index = find_param_index_entry(NULL);
+	}
+	if (!index)
+	{
+		index = &paramIndices[paramIndexNextEvict];
+		paramIndexNextEvict = (paramIndexNextEvict + 1) % PARAM_INDEX_MAX_ARRAYS;
+	}
+	return fill_param_index(index, data) == 0 ? index : NULL;
+}
+
+/**
+ * @brief Builds (or rebuilds) the hash index for a parameter array.
+ *
+ * Called by `initialize_control_system` right after `read_csv_and_store` populates the
+ * arrays. Lookups also build the index lazily, so calling this is an optimisation, not a
+ * requirement.
+ *
+ * @param data Parameter array to index.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int build_param_index(const param_array_t *data)
+{
+	if (!data)
+	{
+		return -1;
+	}
+	pthread_mutex_lock(&paramIndexMutex);
+	param_index_t *index = find_param_index_entry(data);
+	if (!index)
+	{
+		index = acquire_param_index(data);
+	}
+	else if (fill_param_index(index, data) != 0)
+	{
+		index = NULL;
+	}
+	pthread_mutex_unlock(&paramIndexMutex);
+	return index ? 0 : -1;
+}
+
+/**
+ * @brief Drops the index of `data`. Call before freeing or repopulating the array.
+ *
+ * @param data Parameter array whose index should be discarded.
+ */
+void invalidate_param_index(const param_array_t *data)
+{
+	pthread_mutex_lock(&paramIndexMutex);
+	param_index_t *index = find_param_index_entry(data);
+	if (index)
+	{
+		clear_param_index(index);
+	}
+	pthread_mutex_unlock(&paramIndexMutex);
+}
+
+/**
+ * @brief Releases every parameter index.
+ */
+void free_param_indices(void)
+{
+	pthread_mutex_lock(&paramIndexMutex);
+	for (int i = 0; i < PARAM_INDEX_MAX_ARRAYS; i++)
+	{
+		clear_param_index(&paramIndices[i]);
+	}
+	paramIndexNextEvict = 0;
+	pthread_mutex_unlock(&paramIndexMutex);
+}
+
+/**
+ * @brief Resolves a parameter name to a stable handle with one hash probe sequence.
+ *
+ * @param data Parameter array to search.
+ * @param name Null-terminated parameter name.
+ * @return Handle usable with `param_from_handle()`, or `PARAM_HANDLE_INVALID` if not found.
+ */
+param_handle_t get_param_handle(const param_array_t *data, const char *name)
+{
+	if (!data || !name)
+	{
+		return PARAM_HANDLE_INVALID;
+	}
+
+	param_handle_t handle = PARAM_HANDLE_INVALID;
+	pthread_mutex_lock(&paramIndexMutex);
+	const param_index_t *index = acquire_param_index(data);
+	if (index)
+	{
+		const uint32_t h = param_name_hash(name);
+		for (uint32_t s = h & index->mask; index->slots[s] != PARAM_INDEX_EMPTY; s = (s + 1U) & index->mask)
+		{
+			if (index->hash[s] == h && strcmp(data->params[index->slots[s]].name, name) == 0)
+			{
+				handle = index->slots[s];
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&paramIndexMutex);
+
+	if (!index)
+	{
+		// Allocation failed: fall back to the linear scan so callers still get an answer.
+		for (int i = 0; i < data->n_param; i++)
+		{
+			if (data->params[i].name && strcmp(data->params[i].name, name) == 0)
+			{
+				return i;
+			}
+		}
+	}
+	return handle;
+}
+
+/**
+ * @brief Returns the parameter behind a handle, or NULL for an invalid handle.
+ */
+input_param_t *param_from_handle(const param_array_t *data, const param_handle_t handle)
+{
+	return (data && handle >= 0 && handle < data->n_param) ? &data->params[handle] : NULL;
+}
+
+/**
+ * @brief Returns a pointer to the double value behind a handle, or NULL on a type mismatch.
+ */
+double *param_double_from_handle(const param_array_t *data, const param_handle_t handle)
+{
+	input_param_t *param = param_from_handle(data, handle);
+	return (param && param->type == INPUT_PARAM_DOUBLE) ? &param->value.d : NULL;
+}
+
+/**
+ * @brief Returns a pointer to the int value behind a handle, or NULL on a type mismatch.
+ */
+int *param_int_from_handle(const param_array_t *data, const param_handle_t handle)
+{
+	input_param_t *param = param_from_handle(data, handle);
+	return (param && param->type == INPUT_PARAM_INT) ? &param->value.i : NULL;
+}
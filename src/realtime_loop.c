@@ -0,0 +1,346 @@
+/**
+ * @file    realtime_loop.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Fixed-period loop timing on absolute deadlines, with jitter and overrun statistics
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // for CPU_SET, sched_setaffinity
+#endif
+
+#ifdef _WIN32
+// NOLINTBEGIN(llvm-include-order)
+#include <winsock2.h>
+#include <windows.h>
+// NOLINTEND(llvm-include-order)
+#else
+#include <errno.h> // for errno, EINTR
+#include <sched.h> // for sched_setaffinity, sched_setscheduler, sched_get_priority_max, SCHED_FIFO
+#include <time.h>  // for clock_gettime, clock_nanosleep, nanosleep
+#endif
+
+#include "realtime_loop.h"
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "xfe_control_sim_common.h" // for get_param_int_or_default, get_num_cores
+#include "xfe_log.h"                // for XFE_LOG_WARN_EVERY
+#include "xflow_core.h"             // for safe_strerror, shutdownFlag
+#include <stdint.h>                 // for int64_t, INT64_MAX
+#include <string.h>                 // for memset
+
+#define NSEC_PER_SEC 1000000000LL
+#define NSEC_PER_USEC 1000LL
+#define NSEC_PER_MSEC 1000000LL
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+static int64_t monotonic_now_ns(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER Frequency = {0};
+	if (Frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&Frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (int64_t)((counter.QuadPart / Frequency.QuadPart) * NSEC_PER_SEC + ((counter.QuadPart % Frequency.QuadPart) * NSEC_PER_SEC) / Frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Sleeps until the absolute monotonic time `deadline_ns`.
+ */
+static void sleep_until_ns(realtime_loop_t *loop, const int64_t deadline_ns)
+{
+#ifdef _WIN32
+	const int64_t remaining_ns = deadline_ns - monotonic_now_ns();
+	if (remaining_ns <= 0)
+	{
+		return;
+	}
+	if (loop->timer)
+	{
+		// waitable timers take negative due times as relative intervals in 100 ns units.
+		LARGE_INTEGER due_time;
+		due_time.QuadPart = -(remaining_ns / 100);
+		if (SetWaitableTimer(loop->timer, &due_time, 0, NULL, NULL, FALSE))
+		{
+			WaitForSingleObject(loop->timer, INFINITE);
+			return;
+		}
+	}
+	Sleep((DWORD)(remaining_ns / 1000000));
+#elifdef __APPLE__
+	(void)loop;
+	// no clock_nanosleep on macOS, so recompute the remaining interval after every interruption.
+	int64_t remaining_ns = deadline_ns - monotonic_now_ns();
+	while (remaining_ns > 0)
+	{
+		const struct timespec interval = {.tv_sec = remaining_ns / NSEC_PER_SEC, .tv_nsec = remaining_ns % NSEC_PER_SEC};
+		if (nanosleep(&interval, NULL) == 0)
+		{
+			return;
+		}
+		remaining_ns = deadline_ns - monotonic_now_ns();
+	}
+#else
+	(void)loop;
+	const struct timespec deadline = {.tv_sec = deadline_ns / NSEC_PER_SEC, .tv_nsec = deadline_ns % NSEC_PER_SEC};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+	{
+		// an absolute deadline is simply retried after a signal.
+	}
+#endif
+}
+
+/**
+ * @brief Pins the calling thread to `cpu_core` and/or raises it to real-time priority.
+ *
+ * Failures (typically missing privileges) are logged and the loop runs without them.
+ */
+static void apply_realtime_settings(const int cpu_core, const int rt_priority)
+{
+	if (cpu_core >= 0)
+	{
+		if (cpu_core >= get_num_cores())
+		{
+			ERROR_MESSAGE("scada_cpu_core %d is out of range (%d cores), not pinning\n", cpu_core, get_num_cores());
+		}
+		else
+		{
+#ifdef _WIN32
+			if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu_core) == 0)
+			{
+				ERROR_MESSAGE("SetThreadAffinityMask(%d) failed: %ld\n", cpu_core, GetLastError());
+			}
+			else
+			{
+				log_message("SCADA loop pinned to core %d\n", cpu_core);
+			}
+#elifdef __linux__
+			cpu_set_t cpu_set;
+			CPU_ZERO(&cpu_set);
+			CPU_SET(cpu_core, &cpu_set);
+			if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == -1)
+			{
+				ERROR_MESSAGE("sched_setaffinity(%d) failed: %s\n", cpu_core, safe_strerror(errno));
+			}
+			else
+			{
+				log_message("SCADA loop pinned to core %d\n", cpu_core);
+			}
+#else
+			log_message("scada_cpu_core is not supported on this platform, not pinning\n");
+#endif
+		}
+	}
+
+	if (rt_priority > 0)
+	{
+#ifdef _WIN32
+		if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+		{
+			ERROR_MESSAGE("SetThreadPriority failed: %ld\n", GetLastError());
+		}
+		else
+		{
+			log_message("SCADA loop running at THREAD_PRIORITY_TIME_CRITICAL\n");
+		}
+#elifdef __linux__
+		const int max_priority = sched_get_priority_max(SCHED_FIFO);
+		const struct sched_param param = {.sched_priority = rt_priority < max_priority ? rt_priority : max_priority};
+		if (sched_setscheduler(0, SCHED_FIFO, &param) == -1)
+		{
+			ERROR_MESSAGE("sched_setscheduler(SCHED_FIFO, %d) failed: %s\n", param.sched_priority, safe_strerror(errno));
+		}
+		else
+		{
+			log_message("SCADA loop running at SCHED_FIFO priority %d\n", param.sched_priority);
+		}
+#else
+		log_message("scada_rt_priority is not supported on this platform, keeping normal scheduling\n");
+#endif
+	}
+}
+
+/**
+ * @brief Starts a periodic loop whose first deadline is one period from now.
+ *
+ * Reads the optional `scada_cpu_core` (`-1` = no pinning) and `scada_rt_priority`
+ * (`0` = normal scheduling) entries from `fixed_data`.
+ *
+ * @param loop        Loop state to initialise.
+ * @param period_sec  Loop period in seconds.
+ * @param fixed_data  Fixed parameters with the optional real-time settings.
+ * @return            0 on success, -1 (with `shutdownFlag` set) when the period is not positive.
+ */
+int realtime_loop_start(realtime_loop_t *loop, const double period_sec, const param_array_t *fixed_data)
+{
+	memset(loop, 0, sizeof(*loop));
+	loop->period_ns = (int64_t)(period_sec * (double)NSEC_PER_SEC);
+	if (loop->period_ns <= 0)
+	{
+		ERROR_MESSAGE("Real-time loop period must be positive, got %f s\n", period_sec);
+		shutdownFlag = 1;
+		return -1;
+	}
+	loop->jitter_min_ns = INT64_MAX;
+
+	apply_realtime_settings(get_param_int_or_default(fixed_data, "scada_cpu_core", -1), get_param_int_or_default(fixed_data, "scada_rt_priority", 0));
+
+#ifdef _WIN32
+	loop->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!loop->timer)
+	{
+		// older Windows versions lack high-resolution timers; fall back to a standard one.
+		loop->timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	}
+	if (!loop->timer)
+	{
+		ERROR_MESSAGE("CreateWaitableTimerExW failed: %ld, falling back to Sleep\n", GetLastError());
+	}
+#endif
+
+	loop->start_ns = monotonic_now_ns();
+	loop->next_deadline_ns = loop->start_ns + loop->period_ns;
+	return 0;
+}
+
+/**
+ * @brief Seconds since `realtime_loop_start()` on the loop's monotonic clock.
+ */
+double realtime_loop_elapsed_sec(const realtime_loop_t *loop)
+{
+	return (double)(monotonic_now_ns() - loop->start_ns) / (double)NSEC_PER_SEC;
+}
+
+static int jitter_bin(const int64_t jitter_ns)
+{
+	int64_t jitter_us = jitter_ns / NSEC_PER_USEC;
+	int bin = 0;
+	while (jitter_us > 0 && bin < REALTIME_LOOP_HISTOGRAM_BINS - 1)
+	{
+		jitter_us >>= 1;
+		bin++;
+	}
+	return bin;
+}
+
+/**
+ * @brief Call at the end of each iteration: sleeps until the current deadline and advances it by one period.
+ *
+ * An iteration that ends after its deadline counts as an overrun and does not sleep. Whole periods
+ * it ran past are skipped so the loop lands back on the `start + k * period` grid instead of
+ * running a burst of back-to-back iterations to catch up.
+ *
+ * @param loop  Loop started with `realtime_loop_start()`.
+ */
+void realtime_loop_wait(realtime_loop_t *loop)
+{
+	const int64_t now_ns = monotonic_now_ns();
+	if (now_ns >= loop->next_deadline_ns)
+	{
+		const int64_t overrun_ns = now_ns - loop->next_deadline_ns;
+		const int64_t missed = overrun_ns / loop->period_ns;
+		loop->n_overruns++;
+		loop->n_missed_periods += missed;
+		if (overrun_ns > loop->worst_overrun_ns)
+		{
+			loop->worst_overrun_ns = overrun_ns;
+		}
+		loop->next_deadline_ns += (missed + 1) * loop->period_ns;
+		XFE_LOG_WARN_EVERY(1.0, "Real-time loop overran its deadline by %.3f ms (%lld periods missed)\n", (double)overrun_ns / (double)NSEC_PER_MSEC, (long long)missed);
+		return;
+	}
+
+	sleep_until_ns(loop, loop->next_deadline_ns);
+
+	const int64_t jitter_ns = monotonic_now_ns() - loop->next_deadline_ns;
+	loop->n_periods++;
+	loop->jitter_sum_ns += (double)jitter_ns;
+	if (jitter_ns < loop->jitter_min_ns)
+	{
+		loop->jitter_min_ns = jitter_ns;
+	}
+	if (jitter_ns > loop->jitter_max_ns)
+	{
+		loop->jitter_max_ns = jitter_ns;
+	}
+	loop->histogram[jitter_bin(jitter_ns > 0 ? jitter_ns : 0)]++;
+	loop->next_deadline_ns += loop->period_ns;
+}
+
+/**
+ * @brief Logs the overrun counts and the wake-up jitter histogram in one block.
+ */
+void realtime_loop_log_statistics(const realtime_loop_t *loop)
+{
+	log_message("Real-time loop: period %.3f ms, %lld on-time periods, %lld overruns (%lld missed periods, worst %.3f ms)\n",
+	            (double)loop->period_ns / 1e6, (long long)loop->n_periods, (long long)loop->n_overruns, (long long)loop->n_missed_periods, (double)loop->worst_overrun_ns / 1e6);
+	if (loop->n_periods == 0)
+	{
+		return;
+	}
+	log_message("Wake-up jitter: min %.1f us, mean %.1f us, max %.1f us\n",
+	            (double)loop->jitter_min_ns / 1e3, loop->jitter_sum_ns / (double)loop->n_periods / 1e3, (double)loop->jitter_max_ns / 1e3);
+	for (int bin = 0; bin < REALTIME_LOOP_HISTOGRAM_BINS; bin++)
+	{
+		if (loop->histogram[bin] == 0)
+		{
+			continue;
+		}
+		const long long lower_us = bin == 0 ? 0 : 1LL << (bin - 1);
+		if (bin == REALTIME_LOOP_HISTOGRAM_BINS - 1)
+		{
+			log_message("  >= %8lld us: %lld\n", lower_us, (long long)loop->histogram[bin]);
+		}
+		else
+		{
+			log_message("  %6lld-%-6lld us: %lld\n", lower_us, 1LL << bin, (long long)loop->histogram[bin]);
+		}
+	}
+}
+
+/**
+ * @brief Releases the loop's timer. The statistics stay readable.
+ */
+void realtime_loop_stop(realtime_loop_t *loop)
+{
+#ifdef _WIN32
+	if (loop->timer)
+	{
+		CloseHandle(loop->timer);
+		loop->timer = NULL;
+	}
+#else
+	(void)loop;
+#endif
+}
@@ -0,0 +1,444 @@
+/**
+ * @file    result_shmem.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Lock-free shared-memory area collecting data-processing result rows from worker processes
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN(llvm-include-order)
+#include "result_shmem.h"
+#include "logger.h"        // for log_message, ERROR_MESSAGE
+#include "shmem_segment.h" // for shmem_segment_create
+#include "xflow_core.h"    // for safe_snprintf, safe_strerror, safe_fprintf, xflow_fopen_safe, get_monotonic_timestamp
+#include <errno.h>         // for errno
+#include <stdatomic.h>     // for atomic_load_explicit, atomic_store_explicit, atomic_fetch_add_explicit
+#include <stdbool.h>       // IWYU pragma: keep
+#include <stddef.h>        // for size_t, NULL
+#include <stdint.h>        // for uint64_t, int64_t
+#include <stdio.h>         // for FILE, fwrite, fclose
+#include <string.h>        // for memcpy, memcmp, memset
+
+#ifdef _WIN32
+#include <windows.h> // for OpenFileMappingA, MapViewOfFile, VirtualQuery
+#else
+#include <fcntl.h>    // for O_RDWR
+#include <sys/mman.h> // for shm_open, shm_unlink, mmap, munmap
+#include <sys/stat.h> // for fstat
+#include <sys/types.h> // for pid_t
+#include <unistd.h>   // for close, getpid
+#endif
+// NOLINTEND(llvm-include-order)
+
+#define RESULT_SHMEM_SEGMENT_NAME_MAX 64
+#define RESULT_BINARY_MAGIC "XFERESB\0"
+
+/**
+ * @brief This process's mapping of the result area.
+ */
+typedef struct
+{
+	result_shmem_header_t *header;
+	unsigned char *slots;
+	void *map_base;
+	size_t map_size;
+	bool is_creator; // created the segment, so saves and removes it
+	bool saved;      // result_shmem_save() has run
+#ifndef _WIN32
+	pid_t creator_pid; // a forked child inherits the mapping but must not save or unlink it
+#endif
+	char name[RESULT_SHMEM_SEGMENT_NAME_MAX];
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+} result_area_t;
+
+static result_area_t resultArea;
+
+static result_shmem_slot_t *slot_at(const uint64_t index)
+{
+	return (result_shmem_slot_t *)(resultArea.slots + (index * resultArea.header->slot_size));
+}
+
+static double *slot_values(result_shmem_slot_t *slot)
+{
+	return (double *)((unsigned char *)slot + sizeof(result_shmem_slot_t));
+}
+
+/**
+ * @brief Creates the result area with `n_slots` rows of up to `max_columns` values.
+ *
+ * Called once by the process that owns the results file (the data-processing parent).
+ * Slots are cache-line aligned so workers writing neighbouring rows do not contend.
+ *
+ * @param segment_name  Name from `flow_shmem_make_name()` with `RESULT_SHMEM_DEFAULT_PREFIX`.
+ * @param n_slots       Rows the area can hold; later rows fall back to direct file appends.
+ * @param max_columns   Values per row.
+ * @return              0 on success, -1 on failure.
+ */
+int result_shmem_create(const char *segment_name, const int64_t n_slots, const int max_columns)
+{
+	if (resultArea.map_base)
+	{
+		ERROR_MESSAGE("Result area %s is already mapped\n", resultArea.name);
+		return -1;
+	}
+	if (!segment_name || n_slots <= 0 || max_columns <= 0)
+	{
+		ERROR_MESSAGE("Invalid arguments to result_shmem_create\n");
+		return -1;
+	}
+
+	const size_t raw_slot = sizeof(result_shmem_slot_t) + ((size_t)max_columns * sizeof(double));
+	const size_t slot_size = (raw_slot + RESULT_SHMEM_SLOT_ALIGN - 1) / RESULT_SHMEM_SLOT_ALIGN * RESULT_SHMEM_SLOT_ALIGN;
+	const size_t header_bytes = (sizeof(result_shmem_header_t) + RESULT_SHMEM_SLOT_ALIGN - 1) / RESULT_SHMEM_SLOT_ALIGN * RESULT_SHMEM_SLOT_ALIGN;
+	const size_t total = header_bytes + ((size_t)n_slots * slot_size);
+
+	shmem_segment_t segment;
+	if (shmem_segment_create(segment_name, total, &segment) != 0)
+	{
+		return -1;
+	}
+	void *base = segment.base;
+#ifdef _WIN32
+	resultArea.mapping = segment.mapping;
+#endif
+
+	// The new mapping is zeroed, so every slot starts RESULT_SLOT_EMPTY. The magic goes in last.
+	result_shmem_header_t *header = (result_shmem_header_t *)base;
+	header->version = RESULT_SHMEM_VERSION;
+	header->header_size = (uint32_t)header_bytes;
+	header->max_columns = (uint32_t)max_columns;
+	header->slot_size = (uint32_t)slot_size;
+	header->n_slots = (uint64_t)n_slots;
+	header->total_bytes = total;
+	atomic_store_explicit(&header->next_slot, 0, memory_order_relaxed);
+	atomic_store_explicit(&header->n_overflow, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	memcpy(header->magic, RESULT_SHMEM_MAGIC, RESULT_SHMEM_MAGIC_SIZE);
+
+	resultArea.header = header;
+	resultArea.slots = (unsigned char *)base + header_bytes;
+	resultArea.map_base = base;
+	resultArea.map_size = total;
+	resultArea.is_creator = true;
+#ifndef _WIN32
+	resultArea.creator_pid = getpid();
+#endif
+	safe_snprintf(resultArea.name, sizeof(resultArea.name), "%s", segment_name);
+	log_message("Created result area %s: %lld slots of %d values (%zu bytes)\n", segment_name, (long long)n_slots, max_columns, total);
+	return 0;
+}
+
+/**
+ * @brief Maps an existing result area read-write so this worker can publish rows into it.
+ *
+ * @param segment_name  Name the creator used (see `RESULT_SHMEM_ENV_NAME`).
+ * @return              0 on success, -1 on failure (rows then go to the file directly).
+ */
+int result_shmem_attach(const char *segment_name)
+{
+	if (resultArea.map_base)
+	{
+		return 0;
+	}
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, segment_name);
+	if (mapping == NULL)
+	{
+		ERROR_MESSAGE("OpenFileMapping %s failed: %ld\n", segment_name, GetLastError());
+		return -1;
+	}
+	void *base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	CloseHandle(mapping); // the view keeps the section alive
+	if (base == NULL)
+	{
+		ERROR_MESSAGE("MapViewOfFile %s failed: %ld\n", segment_name, GetLastError());
+		return -1;
+	}
+	MEMORY_BASIC_INFORMATION info;
+	const size_t map_size = VirtualQuery(base, &info, sizeof(info)) ? info.RegionSize : 0;
+#else
+	const int fd = shm_open(segment_name, O_RDWR, 0666);
+	if (fd == -1)
+	{
+		ERROR_MESSAGE("shm_open %s failed: %s\n", segment_name, safe_strerror(errno));
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(result_shmem_header_t))
+	{
+		ERROR_MESSAGE("%s is too small to be a result area\n", segment_name);
+		close(fd);
+		return -1;
+	}
+	const size_t map_size = (size_t)st.st_size;
+	void *base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		ERROR_MESSAGE("mmap %s failed: %s\n", segment_name, safe_strerror(errno));
+		return -1;
+	}
+#endif
+
+	const result_shmem_header_t *header = (const result_shmem_header_t *)base;
+	if (map_size < sizeof(result_shmem_header_t) || memcmp(header->magic, RESULT_SHMEM_MAGIC, RESULT_SHMEM_MAGIC_SIZE) != 0 || header->version != RESULT_SHMEM_VERSION || header->total_bytes > map_size ||
+	    header->header_size + (header->n_slots * header->slot_size) > header->total_bytes)
+	{
+		ERROR_MESSAGE("%s is not a version %u result area\n", segment_name, RESULT_SHMEM_VERSION);
+#ifdef _WIN32
+		UnmapViewOfFile(base);
+#else
+		munmap(base, map_size);
+#endif
+		return -1;
+	}
+
+	resultArea.header = (result_shmem_header_t *)base;
+	resultArea.slots = (unsigned char *)base + header->header_size;
+	resultArea.map_base = base;
+	resultArea.map_size = map_size;
+	resultArea.is_creator = false;
+	safe_snprintf(resultArea.name, sizeof(resultArea.name), "%s", segment_name);
+	return 0;
+}
+
+/**
+ * @brief True while this process has a result area mapped.
+ */
+bool result_shmem_is_active(void)
+{
+	return resultArea.map_base != NULL;
+}
+
+/**
+ * @brief True in the process that created the mapped area and therefore saves it.
+ */
+bool result_shmem_is_creator(void)
+{
+#ifdef _WIN32
+	return resultArea.map_base != NULL && resultArea.is_creator;
+#else
+	return resultArea.map_base != NULL && resultArea.is_creator && resultArea.creator_pid == getpid();
+#endif
+}
+
+/**
+ * @brief Name of the mapped result area, or an empty string.
+ */
+const char *result_shmem_name(void)
+{
+	return resultArea.name;
+}
+
+/**
+ * @brief Records the CSV the rows belong to, so the creator can append them at the end.
+ */
+void result_shmem_set_results_path(const char *filename)
+{
+	if (!resultArea.map_base || !filename)
+	{
+		return;
+	}
+	safe_snprintf(resultArea.header->results_path, RESULT_SHMEM_PATH_MAX, "%s", filename);
+}
+
+/**
+ * @brief Publishes one result row without locks.
+ *
+ * The row claims the next slot with one atomic increment, is copied in, and becomes visible
+ * to the creator when the slot state is stored as `RESULT_SLOT_READY` with release ordering.
+ *
+ * @param data    Row values.
+ * @param n_data  Number of values, at most the area's `max_columns`.
+ * @return        0 when stored, -1 if no area is mapped, the row is too wide or all slots are taken.
+ */
+int result_shmem_write(const double *data, const int n_data)
+{
+	if (!resultArea.map_base || n_data < 0 || (uint32_t)n_data > resultArea.header->max_columns)
+	{
+		return -1;
+	}
+	const uint64_t index = atomic_fetch_add_explicit(&resultArea.header->next_slot, 1, memory_order_relaxed);
+	if (index >= resultArea.header->n_slots)
+	{
+		atomic_fetch_add_explicit(&resultArea.header->n_overflow, 1, memory_order_relaxed);
+		return -1;
+	}
+
+	result_shmem_slot_t *slot = slot_at(index);
+	atomic_store_explicit(&slot->state, RESULT_SLOT_WRITING, memory_order_relaxed);
+	const struct timespec ts = get_monotonic_timestamp();
+	slot->tv_sec = (int64_t)ts.tv_sec;
+	slot->tv_nsec = (int64_t)ts.tv_nsec;
+	slot->n_values = (uint32_t)n_data;
+	if (n_data > 0)
+	{
+		memcpy(slot_values(slot), data, (size_t)n_data * sizeof(double));
+	}
+	atomic_store_explicit(&slot->state, RESULT_SLOT_READY, memory_order_release);
+	return 0;
+}
+
+/**
+ * @brief Writes every ready row to the results file in one pass, once all workers have finished.
+ *
+ * CSV output appends `epoch_time,<values>` rows (same format as `save_double_array_data_to_csv`)
+ * to `filename`, whose header `save_csv_header()` has already written. Binary output replaces
+ * `<filename>.xferes` with one block: the magic `XFERESB`, the `uint64_t` row count, then per row
+ * a `uint32_t` value count, the `int64_t` seconds and nanoseconds of the timestamp, and the values.
+ * The area is saved once; later calls write nothing. Rows a worker is still writing are skipped
+ * and reported.
+ *
+ * @param filename  Results file, or NULL for the path recorded by `save_csv_header()`.
+ * @param binary    Write the binary format instead of CSV.
+ * @return          Rows written, or -1 on failure.
+ */
+int64_t result_shmem_save(const char *filename, const bool binary)
+{
+	if (!resultArea.map_base)
+	{
+		return -1;
+	}
+	if (resultArea.saved)
+	{
+		return 0;
+	}
+	if (!filename || filename[0] == '\0')
+	{
+		filename = resultArea.header->results_path;
+	}
+	if (filename[0] == '\0')
+	{
+		ERROR_MESSAGE("Result area %s has no results file; call save_csv_header() first\n", resultArea.name);
+		return -1;
+	}
+	resultArea.saved = true;
+
+	uint64_t n_used = atomic_load_explicit(&resultArea.header->next_slot, memory_order_relaxed);
+	n_used = n_used < resultArea.header->n_slots ? n_used : resultArea.header->n_slots;
+	uint64_t n_ready = 0;
+	for (uint64_t i = 0; i < n_used; i++)
+	{
+		n_ready += atomic_load_explicit(&slot_at(i)->state, memory_order_acquire) == RESULT_SLOT_READY;
+	}
+	if (n_used > n_ready)
+	{
+		ERROR_MESSAGE("Result area %s: %llu rows were still being written and are not saved\n", resultArea.name, (unsigned long long)(n_used - n_ready));
+	}
+	if (n_ready == 0 && !binary)
+	{
+		return 0;
+	}
+
+	char binary_filename[RESULT_SHMEM_PATH_MAX + 8];
+	if (binary)
+	{
+		safe_snprintf(binary_filename, sizeof(binary_filename), "%s.xferes", filename);
+	}
+	const char *path = binary ? binary_filename : filename;
+	FILE *file = xflow_fopen_safe(path, binary ? XFLOW_FILE_WRITE_ONLY : XFLOW_FILE_APPEND);
+	if (file == NULL)
+	{
+		ERROR_MESSAGE("Failed to open results file %s\n", path);
+		return -1;
+	}
+	bool ok = true;
+	if (binary)
+	{
+		ok = fwrite(RESULT_BINARY_MAGIC, 1, RESULT_SHMEM_MAGIC_SIZE, file) == RESULT_SHMEM_MAGIC_SIZE && fwrite(&n_ready, sizeof(n_ready), 1, file) == 1;
+	}
+
+	int64_t n_written = 0;
+	for (uint64_t i = 0; ok && i < n_used && (uint64_t)n_written < n_ready; i++)
+	{
+		result_shmem_slot_t *slot = slot_at(i);
+		if (atomic_load_explicit(&slot->state, memory_order_acquire) != RESULT_SLOT_READY)
+		{
+			continue;
+		}
+		const double *values = slot_values(slot);
+		if (binary)
+		{
+			ok = fwrite(&slot->n_values, sizeof(slot->n_values), 1, file) == 1 && fwrite(&slot->tv_sec, sizeof(slot->tv_sec), 1, file) == 1 && fwrite(&slot->tv_nsec, sizeof(slot->tv_nsec), 1, file) == 1 &&
+			     fwrite(values, sizeof(double), slot->n_values, file) == slot->n_values;
+		}
+		else
+		{
+			ok = safe_fprintf(file, TIME_FORMAT ".%.5ld", (long)slot->tv_sec, (long)slot->tv_nsec) >= 0;
+			for (uint32_t c = 0; ok && c < slot->n_values; c++)
+			{
+				ok = safe_fprintf(file, ",%.10f", values[c]) >= 0;
+			}
+			ok = ok && safe_fprintf(file, "\n") >= 0;
+		}
+		if (ok)
+		{
+			atomic_store_explicit(&slot->state, RESULT_SLOT_SAVED, memory_order_relaxed);
+			n_written++;
+		}
+	}
+
+	if (fclose(file) == EOF)
+	{
+		ok = false;
+	}
+	if (!ok)
+	{
+		ERROR_MESSAGE("Failed to write results file %s after %lld rows: %s\n", path, (long long)n_written, safe_strerror(errno));
+		return -1;
+	}
+	const uint64_t n_overflow = atomic_load_explicit(&resultArea.header->n_overflow, memory_order_relaxed);
+	log_message("Saved %lld result rows from %s%s\n", (long long)n_written, resultArea.name, n_overflow ? " (some rows overflowed to direct appends)" : "");
+	return n_written;
+}
+
+/**
+ * @brief Unmaps the result area; the creator also removes the segment. Safe to call when nothing is mapped.
+ */
+void result_shmem_close(void)
+{
+	if (!resultArea.map_base)
+	{
+		return;
+	}
+#ifdef _WIN32
+	if (!UnmapViewOfFile(resultArea.map_base))
+	{
+		ERROR_MESSAGE("UnmapViewOfFile failed: %ld\n", GetLastError());
+	}
+	if (resultArea.mapping)
+	{
+		CloseHandle(resultArea.mapping);
+	}
+#else
+	if (munmap(resultArea.map_base, resultArea.map_size) == -1)
+	{
+		ERROR_MESSAGE("munmap failed: %s\n", safe_strerror(errno));
+	}
+	if (result_shmem_is_creator() && shm_unlink(resultArea.name) == -1)
+	{
+		ERROR_MESSAGE("shm_unlink %s failed: %s\n", resultArea.name, safe_strerror(errno));
+	}
+#endif
+	memset(&resultArea, 0, sizeof(resultArea));
+}
@@ -0,0 +1,156 @@
+/**
+ * @file    shmem_segment.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Creation of named shared memory segments and the word checksum their headers carry
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// NOLINTBEGIN(llvm-include-order)
+#include "shmem_segment.h"
+#include "logger.h"     // for ERROR_MESSAGE
+#include "xflow_core.h" // for safe_strerror
+#include <stddef.h>     // for size_t, NULL
+#include <stdint.h>     // for uint64_t
+#include <string.h>     // for memcpy
+
+#ifdef _WIN32
+#include <windows.h> // for CreateFileMappingA, MapViewOfFile, UnmapViewOfFile, CloseHandle
+#else
+#include <errno.h>     // for errno
+#include <fcntl.h>     // for O_CREAT, O_EXCL, O_RDWR
+#include <sys/mman.h>  // for shm_open, shm_unlink, mmap, munmap
+#include <sys/types.h> // for off_t
+#include <unistd.h>    // for ftruncate, close
+#endif
+// NOLINTEND(llvm-include-order)
+
+#define FNV64_OFFSET 14695981039346656037ULL
+#define FNV64_PRIME 1099511628211ULL
+
+/**
+ * @brief FNV-1a over 64-bit words. `n` must be a multiple of 8, which the segment layouts guarantee.
+ */
+uint64_t shmem_word_checksum(const unsigned char *data, const size_t n)
+{
+	uint64_t h = FNV64_OFFSET;
+	for (size_t i = 0; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t))
+	{
+		uint64_t word = 0;
+		memcpy(&word, &data[i], sizeof(word));
+		h ^= word;
+		h *= FNV64_PRIME;
+	}
+	return h;
+}
+
+/**
+ * @brief Creates the named segment `name` of `size` zeroed bytes and maps it read-write.
+ *
+ * A segment that already exists under the name is an error on Windows. On POSIX it can only
+ * be left over from a crashed run of a process with the same pid (every name embeds the
+ * pid), so it is removed first.
+ *
+ * @param[out] segment  Receives the mapping; `shmem_segment_close()` releases it.
+ * @return              0 on success, -1 (after logging) on failure.
+ */
+int shmem_segment_create(const char *name, const size_t size, shmem_segment_t *segment)
+{
+	*segment = (shmem_segment_t){0};
+#ifdef _WIN32
+	const uint64_t size64 = size;
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(size64 >> 32U), (DWORD)(size64 & 0xFFFFFFFFU), name);
+	if (mapping == NULL)
+	{
+		ERROR_MESSAGE("CreateFileMapping %s failed: %ld\n", name, GetLastError());
+		return -1;
+	}
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		ERROR_MESSAGE("Shared memory segment %s already exists\n", name);
+		CloseHandle(mapping);
+		return -1;
+	}
+	void *base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (base == NULL)
+	{
+		ERROR_MESSAGE("MapViewOfFile %s failed: %ld\n", name, GetLastError());
+		CloseHandle(mapping);
+		return -1;
+	}
+	segment->mapping = mapping;
+#else
+	shm_unlink(name);
+	const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+	if (fd == -1)
+	{
+		ERROR_MESSAGE("shm_open %s failed: %s\n", name, safe_strerror(errno));
+		return -1;
+	}
+	if (ftruncate(fd, (off_t)size) == -1)
+	{
+		ERROR_MESSAGE("ftruncate %s failed: %s\n", name, safe_strerror(errno));
+		close(fd);
+		shm_unlink(name);
+		return -1;
+	}
+	void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		ERROR_MESSAGE("mmap %s failed: %s\n", name, safe_strerror(errno));
+		shm_unlink(name);
+		return -1;
+	}
+#endif
+	segment->base = base;
+	segment->size = size;
+	return 0;
+}
+
+/**
+ * @brief Unmaps a segment from `shmem_segment_create()`. Safe to call on a closed segment.
+ *
+ * On POSIX the segment itself stays until its name is unlinked, so a publisher may close its
+ * mapping as soon as the contents are written. On Windows closing the last handle ends the
+ * segment, so a publisher keeps it open for as long as the segment must exist.
+ */
+void shmem_segment_close(shmem_segment_t *segment)
+{
+	if (segment->base)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(segment->base);
+#else
+		if (munmap(segment->base, segment->size) == -1)
+		{
+			ERROR_MESSAGE("munmap failed: %s\n", safe_strerror(errno));
+		}
+#endif
+	}
+#ifdef _WIN32
+	if (segment->mapping)
+	{
+		CloseHandle(segment->mapping);
+	}
+#endif
+	*segment = (shmem_segment_t){0};
+}
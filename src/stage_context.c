@@ -0,0 +1,238 @@
+/**
+ * @file    stage_context.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Per-run state objects for stage implementations, replacing function-local statics
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stage_context.h"
+#include "logger.h"     // for ERROR_MESSAGE
+#include "xflow_core.h" // for shutdownFlag
+#include <stdatomic.h>  // for atomic_fetch_add_explicit, memory_order_relaxed
+#include <stdbool.h>    // IWYU pragma: keep
+#include <stddef.h>     // for size_t, NULL
+#include <stdint.h>     // for uint64_t
+#include <stdlib.h>     // for calloc, realloc, free
+
+#define STAGE_CONTEXT_INITIAL_CAPACITY 16
+
+typedef struct
+{
+	const void *key; // the owning function's __func__
+	void *state;
+	stage_state_release_fn release;
+} stage_state_entry_t;
+
+struct stage_context
+{
+	stage_state_entry_t *entries;
+	int n_entries;
+	int capacity;
+	uint64_t generation; // renewed on every reset, so slots cached for an earlier run miss
+};
+
+// Used by threads that never installed a context of their own, which keeps the
+// single-run executable and existing integrations working unchanged.
+static stage_context_t defaultStageContext = {.generation = 1};
+static _Thread_local stage_context_t *currentStageContext = NULL;
+
+// Generations are unique across all contexts, so a slot filled under one context never matches another.
+static atomic_uint_fast64_t nextStageGeneration = 2;
+
+static uint64_t new_stage_generation(void)
+{
+	return (uint64_t)atomic_fetch_add_explicit(&nextStageGeneration, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Allocates an empty stage context.
+ *
+ * @return New context, or NULL on allocation failure. Release with `free_stage_context()`.
+ */
+stage_context_t *create_stage_context(void)
+{
+	stage_context_t *context = calloc(1, sizeof(stage_context_t));
+	if (!context)
+	{
+		ERROR_MESSAGE("Failed to allocate stage context\n");
+		return NULL;
+	}
+	context->generation = new_stage_generation();
+	return context;
+}
+
+/**
+ * @brief Releases every state object in `context` so the next run starts from first-run initialisation.
+ *
+ * Objects are released in reverse order of creation. Call between runs, on the thread that owns the context.
+ *
+ * @param context  Context to reset, or NULL for the calling thread's current context.
+ */
+void reset_stage_context(stage_context_t *context)
+{
+	if (!context)
+	{
+		context = current_stage_context();
+	}
+	for (int i = context->n_entries - 1; i >= 0; i--)
+	{
+		if (context->entries[i].release)
+		{
+			context->entries[i].release(context->entries[i].state);
+		}
+		free(context->entries[i].state);
+	}
+	context->n_entries = 0;
+	context->generation = new_stage_generation();
+}
+
+/**
+ * @brief Resets `context` and frees it. The default context is reset but not freed.
+ */
+void free_stage_context(stage_context_t *context)
+{
+	if (!context)
+	{
+		return;
+	}
+	reset_stage_context(context);
+	free(context->entries);
+	context->entries = NULL;
+	context->capacity = 0;
+	if (currentStageContext == context)
+	{
+		currentStageContext = NULL;
+	}
+	if (context != &defaultStageContext)
+	{
+		free(context);
+	}
+}
+
+/**
+ * @brief Makes `context` the calling thread's current context.
+ *
+ * Each thread that runs a simulation concurrently with others needs its own context.
+ *
+ * @param context  Context to install, or NULL to fall back to the process default.
+ * @return         The previously installed context (NULL if none was installed).
+ */
+stage_context_t *set_current_stage_context(stage_context_t *context)
+{
+	stage_context_t *previous = currentStageContext;
+	currentStageContext = context;
+	return previous;
+}
+
+/**
+ * @brief Returns the calling thread's current context, or the process default.
+ */
+stage_context_t *current_stage_context(void)
+{
+	return currentStageContext ? currentStageContext : &defaultStageContext;
+}
+
+/**
+ * @brief Looks up, or creates on first use, the state object identified by `key`.
+ *
+ * A stage holds only a handful of objects per run, so a linear scan over the context's
+ * entries is cheaper than hashing. Per-call lookups go through `get_stage_state_cached()`.
+ *
+ * @param key        Identity of the owner, unique per stage implementation (its `__func__`).
+ * @param size       Size of the state object; new objects are zero-initialised.
+ * @param release    Optional hook run on reset before the object is freed.
+ * @param first_run  Set to true when the object was created by this call.
+ * @return           The state object, or NULL (with `shutdownFlag` set) on allocation failure.
+ */
+void *get_stage_state(const void *key, const size_t size, const stage_state_release_fn release, bool *first_run)
+{
+	stage_context_t *context = current_stage_context();
+	for (int i = 0; i < context->n_entries; i++)
+	{
+		if (context->entries[i].key == key)
+		{
+			*first_run = false;
+			return context->entries[i].state;
+		}
+	}
+
+	if (context->n_entries == context->capacity)
+	{
+		const int capacity = context->capacity ? context->capacity * 2 : STAGE_CONTEXT_INITIAL_CAPACITY;
+		stage_state_entry_t *entries = realloc(context->entries, (size_t)capacity * sizeof(stage_state_entry_t));
+		if (!entries)
+		{
+			ERROR_MESSAGE("Failed to grow stage context to %d entries\n", capacity);
+			shutdownFlag = 1;
+			*first_run = false;
+			return NULL;
+		}
+		context->entries = entries;
+		context->capacity = capacity;
+	}
+
+	void *state = calloc(1, size);
+	if (!state)
+	{
+		ERROR_MESSAGE("Failed to allocate %zu bytes of stage state\n", size);
+		shutdownFlag = 1;
+		*first_run = false;
+		return NULL;
+	}
+	context->entries[context->n_entries].key = key;
+	context->entries[context->n_entries].state = state;
+	context->entries[context->n_entries].release = release;
+	context->n_entries++;
+	*first_run = true;
+	return state;
+}
+
+/**
+ * @brief `get_stage_state()` behind a call site's slot; normally reached through `STAGE_STATE()`.
+ *
+ * While the slot was filled under the current context's generation, the object is returned
+ * without touching the context. Otherwise the context is searched and the slot refilled.
+ *
+ * @param slot       The call site's thread-local slot.
+ * @param key        Identity of the owner, unique per stage implementation (its `__func__`).
+ * @param size       Size of the state object; new objects are zero-initialised.
+ * @param release    Optional hook run on reset before the object is freed.
+ * @param first_run  Set to true when the object was created by this call.
+ * @return           The state object, or NULL (with `shutdownFlag` set) on allocation failure.
+ */
+void *get_stage_state_cached(stage_state_slot_t *slot, const void *key, const size_t size, const stage_state_release_fn release, bool *first_run)
+{
+	const stage_context_t *context = current_stage_context();
+	if (slot->generation == context->generation)
+	{
+		*first_run = false;
+		return slot->state;
+	}
+
+	void *state = get_stage_state(key, size, release, first_run);
+	if (state)
+	{
+		slot->generation = context->generation;
+		slot->state = state;
+	}
+	return state;
+}
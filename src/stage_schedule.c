@@ -0,0 +1,174 @@
+/**
+ * @file    stage_schedule.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Integer-tick multi-rate schedule deciding which loop stages run on each base step
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stage_schedule.h"
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "xfe_control_sim_common.h" // for get_param_int_or_default, get_param_double_or_default
+#include "xflow_core.h"             // for shutdownFlag
+#include <math.h>                   // for llround, fabs
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stdint.h>                 // for int64_t
+#include <string.h>                 // for memset
+
+#define STAGE_SCHEDULE_RATE_TOLERANCE 1e-6 // relative mismatch of control_dt_sec against a whole number of ticks
+
+static const char *const scheduleKeys[SCHEDULED_STAGE_COUNT] = {
+	[SCHEDULED_FLOW_GEN] = "flow_gen_every_n_ticks",
+	[SCHEDULED_HISTORY_UPDATES] = "history_every_n_ticks",
+	[SCHEDULED_TURBINE_CONTROL] = "turbine_control_every_n_ticks",
+	[SCHEDULED_CONTINUOUS_LOGGING] = "continuous_logging_every_n_ticks",
+	[SCHEDULED_DATA_PROCESSING] = "data_processing_every_n_ticks",
+};
+
+static const char *const scheduleStageNames[SCHEDULED_STAGE_COUNT] = {
+	[SCHEDULED_FLOW_GEN] = "flow_gen",
+	[SCHEDULED_HISTORY_UPDATES] = "history updates",
+	[SCHEDULED_TURBINE_CONTROL] = "turbine_control",
+	[SCHEDULED_CONTINUOUS_LOGGING] = "continuous logging",
+	[SCHEDULED_DATA_PROCESSING] = "data_processing",
+};
+
+/**
+ * @brief Converts `control_dt_sec` into a whole number of base ticks.
+ *
+ * Intervals shorter than one tick run every tick, as the accumulator did. Intervals that are
+ * not a whole multiple of the base step are rounded to the nearest one and reported.
+ */
+static int64_t control_ticks_from_dt(const double control_dt_sec, const double base_dt_sec)
+{
+	const double ratio = control_dt_sec / base_dt_sec;
+	if (ratio <= 1.0)
+	{
+		return 1;
+	}
+	const int64_t ticks = (int64_t)llround(ratio);
+	if (fabs(ratio - (double)ticks) > STAGE_SCHEDULE_RATE_TOLERANCE * ratio)
+	{
+		log_message("control_dt_sec %g is not a multiple of dt_sec %g, running turbine_control every %lld ticks (%g s)\n",
+		            control_dt_sec, base_dt_sec, (long long)ticks, (double)ticks * base_dt_sec);
+	}
+	return ticks;
+}
+
+/**
+ * @brief Reads the stage periods from `fixed_data` and resets the tick counter.
+ *
+ * Every `<stage>_every_n_ticks` entry is optional and defaults to 1 (every base step), except
+ * `turbine_control_every_n_ticks`, where the default of 0 means `control_dt_sec / base_dt_sec`.
+ *
+ * @param schedule        Schedule to initialise.
+ * @param fixed_data      Fixed parameters with the optional periods.
+ * @param base_dt_sec     Length of one base tick (the integrator step).
+ * @param start_time_sec  Simulation time at tick 0.
+ * @return                0 on success, -1 (with `shutdownFlag` set) on a non-positive step or period.
+ */
+int init_stage_schedule(stage_schedule_t *schedule, const param_array_t *fixed_data, const double base_dt_sec, const double start_time_sec)
+{
+	memset(schedule, 0, sizeof(*schedule));
+	if (base_dt_sec <= 0.0)
+	{
+		ERROR_MESSAGE("Stage schedule needs a positive base step, got dt_sec %f\n", base_dt_sec);
+		shutdownFlag = 1;
+		return -1;
+	}
+	schedule->base_dt_sec = base_dt_sec;
+	schedule->start_time_sec = start_time_sec;
+
+	const int64_t control_ticks = control_ticks_from_dt(get_param_double_or_default(fixed_data, "control_dt_sec", base_dt_sec), base_dt_sec);
+	for (int stage = 0; stage < SCHEDULED_STAGE_COUNT; stage++)
+	{
+		int every_n_ticks = get_param_int_or_default(fixed_data, scheduleKeys[stage], stage == SCHEDULED_TURBINE_CONTROL ? 0 : 1);
+		if (stage == SCHEDULED_TURBINE_CONTROL && every_n_ticks == 0)
+		{
+			every_n_ticks = (int)control_ticks;
+		}
+		if (every_n_ticks <= 0)
+		{
+			ERROR_MESSAGE("%s must be a positive number of ticks, got %d\n", scheduleKeys[stage], every_n_ticks);
+			shutdownFlag = 1;
+			return -1;
+		}
+		schedule->every_n_ticks[stage] = every_n_ticks;
+	}
+	return 0;
+}
+
+/**
+ * @brief Moves an initialised schedule to a restored position (see `checkpoint.h`).
+ *
+ * Stage phases follow the restored tick, so a resumed run calls every stage on the same
+ * ticks as the run that wrote the checkpoint. The run statistics start again from zero.
+ *
+ * @param schedule        Schedule set up by `init_stage_schedule()`.
+ * @param start_time_sec  Simulation time at tick 0 of the original run.
+ * @param tick            Base steps completed when the checkpoint was written.
+ */
+void resume_stage_schedule(stage_schedule_t *schedule, const double start_time_sec, const int64_t tick)
+{
+	schedule->start_time_sec = start_time_sec;
+	schedule->tick = tick;
+}
+
+/**
+ * @brief Completes one base step.
+ *
+ * @return  Simulation time after the step, `start_time_sec + tick * base_dt_sec`, computed
+ *          from the tick count so it does not accumulate rounding error.
+ */
+double advance_stage_schedule(stage_schedule_t *schedule)
+{
+	schedule->tick++;
+	return schedule->start_time_sec + ((double)schedule->tick * schedule->base_dt_sec);
+}
+
+/**
+ * @brief True when `stage` runs on the current tick; counts the run for the statistics.
+ */
+bool stage_is_due(stage_schedule_t *schedule, const scheduled_stage_t stage)
+{
+	if (schedule->tick % schedule->every_n_ticks[stage] != 0)
+	{
+		return false;
+	}
+	schedule->n_runs[stage]++;
+	return true;
+}
+
+/**
+ * @brief Logs each stage's period and how often it ran out of the completed ticks.
+ */
+void log_stage_schedule_statistics(const stage_schedule_t *schedule)
+{
+	log_message("Stage schedule: %lld ticks of %g s\n", (long long)schedule->tick, schedule->base_dt_sec);
+	for (int stage = 0; stage < SCHEDULED_STAGE_COUNT; stage++)
+	{
+		if (schedule->n_runs[stage] == 0 && schedule->every_n_ticks[stage] == 1)
+		{
+			continue; // stage not driven by this loop
+		}
+		log_message("  %-18s every %lld ticks, %lld runs\n", scheduleStageNames[stage], (long long)schedule->every_n_ticks[stage], (long long)schedule->n_runs[stage]);
+	}
+}
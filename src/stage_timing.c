@@ -0,0 +1,172 @@
+/**
+ * @file    stage_timing.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Opt-in per-stage call timing recorded by the MAKE_STAGE_DEFINE dispatchers
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stage_timing.h"
+#include "logger.h"                 // for log_message
+#include "xfe_control_sim_common.h" // for get_param_int_or_default, update_cpu_usage
+#include "xflow_core.h"             // for get_monotonic_timestamp
+#include <stdatomic.h>              // for atomic_fetch_add_explicit, atomic_compare_exchange_weak_explicit
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stddef.h>                 // for NULL
+#include <stdint.h>                 // for int64_t, INT64_MAX
+#include <time.h>                   // for timespec
+
+#define NSEC_PER_SEC 1000000000LL
+#define NSEC_PER_USEC 1000LL
+
+bool stageTimingEnabled = false;
+
+static stage_timing_t *stageTimings = NULL;
+
+/**
+ * @brief Names a dispatcher's statistics and adds them to the shutdown table.
+ *
+ * Called from the load-time constructor generated by `MAKE_STAGE_DEFINE`, before `main()` or
+ * while the controller library is loaded, so the list needs no locking.
+ */
+void register_stage_timing(stage_timing_t *timing, const char *name)
+{
+	timing->name = name;
+	atomic_store_explicit(&timing->min_ns, INT64_MAX, memory_order_relaxed);
+	timing->next = stageTimings;
+	stageTimings = timing;
+}
+
+/**
+ * @brief Monotonic clock in nanoseconds, the time base of all stage timings.
+ */
+int64_t stage_timing_now_ns(void)
+{
+	const struct timespec ts = get_monotonic_timestamp();
+	return ((int64_t)ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+static int64_t load_relaxed(const atomic_int_least64_t *counter)
+{
+	return (int64_t)atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+/**
+ * @brief Adds one call of `elapsed_ns` to a stage's statistics.
+ *
+ * Relaxed atomics keep every counter exact when one stage runs on several threads at once;
+ * the table is only read at shutdown, so no ordering between the counters is needed.
+ */
+void record_stage_timing(stage_timing_t *timing, const int64_t elapsed_ns)
+{
+	atomic_fetch_add_explicit(&timing->n_calls, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&timing->total_ns, elapsed_ns, memory_order_relaxed);
+	int_least64_t min_ns = atomic_load_explicit(&timing->min_ns, memory_order_relaxed);
+	while (elapsed_ns < min_ns && !atomic_compare_exchange_weak_explicit(&timing->min_ns, &min_ns, elapsed_ns, memory_order_relaxed, memory_order_relaxed))
+	{
+	}
+	int_least64_t max_ns = atomic_load_explicit(&timing->max_ns, memory_order_relaxed);
+	while (elapsed_ns > max_ns && !atomic_compare_exchange_weak_explicit(&timing->max_ns, &max_ns, elapsed_ns, memory_order_relaxed, memory_order_relaxed))
+	{
+	}
+
+	int64_t elapsed_us = elapsed_ns / NSEC_PER_USEC;
+	int bin = 0;
+	while (elapsed_us > 0 && bin < STAGE_TIMING_HISTOGRAM_BINS - 1)
+	{
+		elapsed_us >>= 1;
+		bin++;
+	}
+	atomic_fetch_add_explicit(&timing->histogram[bin], 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Turns stage timing on when the optional fixed parameter `stage_timing_enable` is non-zero.
+ *
+ * Also takes the first CPU usage sample, so the shutdown table can report the
+ * system CPU load over the run.
+ */
+void configure_stage_timing(const param_array_t *fixed_data)
+{
+	stageTimingEnabled = get_param_int_or_default(fixed_data, "stage_timing_enable", 0) != 0;
+	if (stageTimingEnabled)
+	{
+		update_cpu_usage();
+		log_message("Stage timing enabled\n");
+	}
+}
+
+/**
+ * @brief Logs one row per stage that was called: calls, total, mean, min, max and latency histogram.
+ *
+ * Times are inclusive, so a stage that calls other stages (`numerical_integrator` calling
+ * `eom`) also counts their time. Does nothing unless stage timing is enabled.
+ */
+void log_stage_timing_table(void)
+{
+	if (!stageTimingEnabled)
+	{
+		return;
+	}
+
+	log_message("Stage timing (inclusive), system CPU usage %.1f%% over the run:\n", update_cpu_usage());
+	log_message("  %-24s %10s %12s %10s %10s %10s\n", "stage", "calls", "total [ms]", "mean [us]", "min [us]", "max [us]");
+	for (const stage_timing_t *timing = stageTimings; timing != NULL; timing = timing->next)
+	{
+		const int64_t n_calls = load_relaxed(&timing->n_calls);
+		if (n_calls == 0)
+		{
+			continue;
+		}
+		const int64_t total_ns = load_relaxed(&timing->total_ns);
+		log_message("  %-24s %10lld %12.3f %10.2f %10.2f %10.2f\n", timing->name, (long long)n_calls, (double)total_ns / 1e6,
+		            (double)total_ns / (double)n_calls / 1e3, (double)load_relaxed(&timing->min_ns) / 1e3, (double)load_relaxed(&timing->max_ns) / 1e3);
+	}
+
+	log_message("  latency histogram [us]:\n");
+	for (const stage_timing_t *timing = stageTimings; timing != NULL; timing = timing->next)
+	{
+		if (load_relaxed(&timing->n_calls) == 0)
+		{
+			continue;
+		}
+		char line[512];
+		int used = safe_snprintf(line, sizeof(line), "  %-24s", timing->name);
+		for (int bin = 0; bin < STAGE_TIMING_HISTOGRAM_BINS && used > 0 && (size_t)used < sizeof(line); bin++)
+		{
+			const int64_t count = load_relaxed(&timing->histogram[bin]);
+			if (count == 0)
+			{
+				continue;
+			}
+			const long long upper_us = 1LL << bin;
+			if (bin == STAGE_TIMING_HISTOGRAM_BINS - 1)
+			{
+				used += safe_snprintf(line + used, sizeof(line) - (size_t)used, " >=%lld:%lld", upper_us >> 1, (long long)count);
+			}
+			else
+			{
+				used += safe_snprintf(line + used, sizeof(line) - (size_t)used, " <%lld:%lld", upper_us, (long long)count);
+			}
+		}
+		log_message("%s\n", line);
+	}
+}
@@ -0,0 +1,335 @@
+/**
+ * @file    swap_binding.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Table of avr_swap records bound to dynamic parameters, copied in and out on each DISCON call
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "swap_binding.h"
+#include "bladed_interface.h"       // for REC_CURRENT_TIME, REC_DEMANDED_GENERATOR_TORQUE, ...
+#include "logger.h"                 // for ERROR_MESSAGE
+#include "param_index.h"            // for get_param_handle, param_from_handle
+#include "xfe_control_sim_common.h" // for parse_delimited_list, free_delimited_list
+#include <stddef.h>                 // for NULL
+#include <stdlib.h>                 // for calloc, free, strtol
+#include <string.h>                 // for strchr, strcmp
+
+#define SWAP_RECORD(name) {#name, name}
+
+typedef struct
+{
+	const char *name;
+	int index;
+} swap_record_name_t;
+
+// every record of bladed_interface.h, so bindings can name records the way the code does
+static const swap_record_name_t swapRecordNames[] = {
+	SWAP_RECORD(REC_CURRENT_TIME),
+	SWAP_RECORD(REC_COMMUNICATION_INTERVAL),
+	SWAP_RECORD(REC_BLADE1_PITCH_ANGLE),
+	SWAP_RECORD(REC_BELOW_RATED_PITCH_ANGLE_SETPOINT),
+	SWAP_RECORD(REC_MIN_PITCH_ANGLE),
+	SWAP_RECORD(REC_MAX_PITCH_ANGLE),
+	SWAP_RECORD(REC_MIN_PITCH_RATE),
+	SWAP_RECORD(REC_MAX_PITCH_RATE),
+	SWAP_RECORD(REC_PITCH_ACTUATOR_TYPE),
+	SWAP_RECORD(REC_CURRENT_DEMANDED_PITCH_ANGLE),
+	SWAP_RECORD(REC_CURRENT_DEMANDED_PITCH_RATE),
+	SWAP_RECORD(REC_DEMANDED_POWER),
+	SWAP_RECORD(REC_MEASURED_SHAFT_POWER),
+	SWAP_RECORD(REC_MEASURED_ELECTRICAL_POWER),
+	SWAP_RECORD(REC_OPTIMAL_MODE_GAIN),
+	SWAP_RECORD(REC_MIN_GENERATOR_SPEED),
+	SWAP_RECORD(REC_OPTIMAL_MODE_MAX_SPEED),
+	SWAP_RECORD(REC_DEMANDED_GEN_SPEED_ABOVE_RATED),
+	SWAP_RECORD(REC_MEASURED_GENERATOR_SPEED),
+	SWAP_RECORD(REC_MEASURED_ROTOR_SPEED),
+	SWAP_RECORD(REC_DEMANDED_GEN_TORQUE_ABOVE_RATED),
+	SWAP_RECORD(REC_MEASURED_GENERATOR_TORQUE),
+	SWAP_RECORD(REC_MEASURED_YAW_ERROR),
+	SWAP_RECORD(REC_TORQUE_SPEED_TABLE_START),
+	SWAP_RECORD(REC_TORQUE_SPEED_TABLE_POINTS),
+	SWAP_RECORD(REC_HUB_WIND_SPEED),
+	SWAP_RECORD(REC_PITCH_CONTROL_TYPE),
+	SWAP_RECORD(REC_YAW_CONTROL_TYPE),
+	SWAP_RECORD(REC_BLADE2_PITCH_ANGLE),
+	SWAP_RECORD(REC_BLADE1_ROOT_OP_BENDING_MOMENT),
+	SWAP_RECORD(REC_BLADE2_ROOT_OP_BENDING_MOMENT),
+	SWAP_RECORD(REC_BLADE3_ROOT_OP_BENDING_MOMENT),
+	SWAP_RECORD(REC_BLADE3_PITCH_ANGLE),
+	SWAP_RECORD(REC_GENERATOR_CONTACTOR),
+	SWAP_RECORD(REC_SHAFT_BRAKE_STATUS),
+	SWAP_RECORD(REC_NACELLE_ANGLE_FROM_NORTH),
+	SWAP_RECORD(REC_PITCH_OVERRIDE),
+	SWAP_RECORD(REC_TOWER_TOP_FA_ACCELERATION),
+	SWAP_RECORD(REC_ROTOR_AZIMUTH_ANGLE),
+	SWAP_RECORD(REC_NUMBER_OF_BLADES),
+	SWAP_RECORD(REC_MAX_LOGGING_VALUES),
+	SWAP_RECORD(REC_LOGGING_START_RECORD),
+	SWAP_RECORD(REC_MAX_OUTNAME_CHARS),
+	SWAP_RECORD(REC_NUMBER_OF_LOGGING_VARIABLES),
+	SWAP_RECORD(REC_BLADE1_ROOT_IP_BENDING_MOMENT),
+	SWAP_RECORD(REC_BLADE2_ROOT_IP_BENDING_MOMENT),
+	SWAP_RECORD(REC_BLADE3_ROOT_IP_BENDING_MOMENT),
+	SWAP_RECORD(REC_GENERATOR_STARTUP_RESISTANCE),
+	SWAP_RECORD(REC_ROTATING_HUB_MY),
+	SWAP_RECORD(REC_ROTATING_HUB_MZ),
+	SWAP_RECORD(REC_FIXED_HUB_MY),
+	SWAP_RECORD(REC_FIXED_HUB_MZ),
+	SWAP_RECORD(REC_YAW_BEARING_MY),
+	SWAP_RECORD(REC_YAW_BEARING_MZ),
+	SWAP_RECORD(REC_REQUEST_FOR_LOADS),
+	SWAP_RECORD(REC_VARIABLE_SLIP_CURRENT_FLAG),
+	SWAP_RECORD(REC_VARIABLE_SLIP_CURRENT),
+	SWAP_RECORD(REC_NACELLE_ROLL_ACCELERATION),
+	SWAP_RECORD(REC_NACELLE_NOD_ACCELERATION),
+	SWAP_RECORD(REC_NACELLE_YAW_ACCELERATION),
+	SWAP_RECORD(REC_REAL_TIME_SIMULATION_TIME_STEP),
+	SWAP_RECORD(REC_REAL_TIME_STEP_MULTIPLIER),
+	SWAP_RECORD(REC_MEAN_WIND_SPEED_INCREMENT),
+	SWAP_RECORD(REC_TURBULENCE_INTENSITY_INCREMENT),
+	SWAP_RECORD(REC_WIND_DIRECTION_INCREMENT),
+	SWAP_RECORD(REC_SAFETY_SYSTEM_ACTIVATED),
+	SWAP_RECORD(REC_SAFETY_SYSTEM_TO_ACTIVATE),
+	SWAP_RECORD(REC_YAW_CONTROL_FLAG),
+	SWAP_RECORD(REC_YAW_STIFFNESS),
+	SWAP_RECORD(REC_YAW_DAMPING),
+	SWAP_RECORD(REC_BRAKE_TORQUE_DEMAND),
+	SWAP_RECORD(REC_YAW_BRAKE_TORQUE_DEMAND),
+	SWAP_RECORD(REC_SHAFT_TORQUE),
+	SWAP_RECORD(REC_HUB_FIXED_FX),
+	SWAP_RECORD(REC_HUB_FIXED_FY),
+	SWAP_RECORD(REC_HUB_FIXED_FZ),
+	SWAP_RECORD(REC_NETWORK_VOLTAGE_DISTURBANCE),
+	SWAP_RECORD(REC_NETWORK_FREQUENCY_DISTURBANCE),
+	SWAP_RECORD(REC_CONTROLLER_STATE),
+	SWAP_RECORD(REC_SETTLING_TIME),
+	SWAP_RECORD(REC_TEETER_ANGLE),
+	SWAP_RECORD(REC_TEETER_VELOCITY),
+	SWAP_RECORD(REC_CONTROLLER_FAILURE_FLAG),
+	SWAP_RECORD(REC_YAW_BEARING_POSITION),
+	SWAP_RECORD(REC_YAW_BEARING_VELOCITY),
+	SWAP_RECORD(REC_YAW_BEARING_ACCELERATION),
+	SWAP_RECORD(REC_INFILE_CHAR_COUNT),
+	SWAP_RECORD(REC_OUTNAME_CHAR_COUNT),
+	SWAP_RECORD(REC_DEMANDED_YAW_TORQUE),
+	SWAP_RECORD(REC_DEMANDED_BLADE1_PITCH),
+	SWAP_RECORD(REC_DEMANDED_BLADE2_PITCH),
+	SWAP_RECORD(REC_DEMANDED_BLADE3_PITCH),
+	SWAP_RECORD(REC_DEMANDED_COLLECTIVE_PITCH),
+	SWAP_RECORD(REC_DEMANDED_COLLECTIVE_PITCH_RATE),
+	SWAP_RECORD(REC_DEMANDED_GENERATOR_TORQUE),
+	SWAP_RECORD(REC_DEMANDED_NACELLE_YAW_RATE),
+	SWAP_RECORD(REC_MESSAGE_LENGTH),
+	SWAP_RECORD(REC_TORQUE_OVERRIDE),
+	SWAP_RECORD(REC_USER_VARIABLE_1),
+	SWAP_RECORD(REC_USER_VARIABLE_2),
+	SWAP_RECORD(REC_USER_VARIABLE_3),
+	SWAP_RECORD(REC_USER_VARIABLE_4),
+	SWAP_RECORD(REC_USER_VARIABLE_5),
+	SWAP_RECORD(REC_USER_VARIABLE_6),
+	SWAP_RECORD(REC_USER_VARIABLE_7),
+	SWAP_RECORD(REC_USER_VARIABLE_8),
+	SWAP_RECORD(REC_USER_VARIABLE_9),
+	SWAP_RECORD(REC_USER_VARIABLE_10),
+};
+
+/**
+ * @brief Resolves a record name from `bladed_interface.h` (`REC_MEASURED_ROTOR_SPEED`) or a plain index (`19`).
+ *
+ * @return The zero-based avr_swap index, or -1 if @p name is neither a known record nor an
+ *         index in `[0, SWAP_BINDING_MAX_INDEX]`.
+ */
+int swap_record_index(const char *name)
+{
+	for (size_t i = 0; i < sizeof(swapRecordNames) / sizeof(swapRecordNames[0]); i++)
+	{
+		if (strcmp(swapRecordNames[i].name, name) == 0)
+		{
+			return swapRecordNames[i].index;
+		}
+	}
+
+	char *end = NULL;
+	const long index = strtol(name, &end, 10);
+	if (end == name || *end != '\0' || index < 0 || index > SWAP_BINDING_MAX_INDEX)
+	{
+		return -1;
+	}
+	return (int)index;
+}
+
+/**
+ * @brief Parses one `direction:record:parameter` item and appends it to the matching list.
+ *
+ * @return 0 on success, -1 (error logged) on a malformed item or unknown parameter.
+ */
+static int compile_swap_binding(swap_binding_table_t *table, const param_array_t *dynamic_data, char *item)
+{
+	char *record = strchr(item, ':');
+	char *param_name = record ? strchr(record + 1, ':') : NULL;
+	if (!param_name)
+	{
+		ERROR_MESSAGE("Swap binding '%s' is not direction:record:parameter\n", item);
+		return -1;
+	}
+	*record++ = '\0';
+	*param_name++ = '\0';
+
+	swap_binding_t *list = NULL;
+	int *n_list = NULL;
+	if (strcmp(item, "in") == 0)
+	{
+		list = table->in;
+		n_list = &table->n_in;
+	}
+	else if (strcmp(item, "out") == 0)
+	{
+		list = table->out;
+		n_list = &table->n_out;
+	}
+	else
+	{
+		ERROR_MESSAGE("Swap binding direction '%s' must be in or out\n", item);
+		return -1;
+	}
+
+	const int swap_index = swap_record_index(record);
+	if (swap_index < 0)
+	{
+		ERROR_MESSAGE("Unknown avr_swap record '%s' in swap binding of %s\n", record, param_name);
+		return -1;
+	}
+
+	input_param_t *param = param_from_handle(dynamic_data, get_param_handle(dynamic_data, param_name));
+	if (!param || (param->type != INPUT_PARAM_DOUBLE && param->type != INPUT_PARAM_INT))
+	{
+		ERROR_MESSAGE("Swap binding parameter '%s' is not an int or double dynamic parameter\n", param_name);
+		return -1;
+	}
+
+	swap_binding_t *binding = &list[(*n_list)++];
+	binding->swap_index = swap_index;
+	binding->type = param->type;
+	binding->value = param->type == INPUT_PARAM_DOUBLE ? (void *)&param->value.d : (void *)&param->value.i;
+	return 0;
+}
+
+/**
+ * @brief Compiles a binding specification into flat copy-in and copy-out tables.
+ *
+ * @p spec lists items `in:<record>:<parameter>` or `out:<record>:<parameter>`, separated by
+ * ';', ',' or whitespace, for example
+ * `in:REC_MEASURED_ROTOR_SPEED:omega; out:REC_DEMANDED_GENERATOR_TORQUE:tau_flow_extract`.
+ * Records are `bladed_interface.h` names or zero-based indices. The parameters must be int or
+ * double entries of @p dynamic_data, which must not be resized afterwards.
+ *
+ * @param[out] table         Receives the tables. Release with `free_swap_bindings()`.
+ * @param      dynamic_data  Dynamic parameter array the bindings point into.
+ * @param      spec          Binding specification.
+ * @return 0 on success, -1 (with `table` empty) otherwise. The caller decides whether that stops
+ *         the run or, in a DISCON library serving several turbines, only the calling turbine.
+ */
+int compile_swap_bindings(swap_binding_table_t *table, const param_array_t *dynamic_data, const char *spec)
+{
+	*table = (swap_binding_table_t){0};
+
+	char **items = NULL;
+	const int n_items = parse_delimited_list(spec, &items);
+	if (n_items < 0)
+	{
+		ERROR_MESSAGE("Failed to parse swap bindings\n");
+		return -1;
+	}
+	if (n_items > 0)
+	{
+		table->in = calloc((size_t)n_items, sizeof(swap_binding_t));
+		table->out = calloc((size_t)n_items, sizeof(swap_binding_t));
+		if (!table->in || !table->out)
+		{
+			ERROR_MESSAGE("Failed to allocate %d swap bindings\n", n_items);
+			free_delimited_list(items, n_items);
+			free_swap_bindings(table);
+			return -1;
+		}
+	}
+
+	for (int i = 0; i < n_items; i++)
+	{
+		if (compile_swap_binding(table, dynamic_data, items[i]) != 0)
+		{
+			free_delimited_list(items, n_items);
+			free_swap_bindings(table);
+			return -1;
+		}
+	}
+	free_delimited_list(items, n_items);
+	return 0;
+}
+
+/**
+ * @brief Copies every `in` record from avr_swap into its parameter.
+ */
+void swap_bindings_copy_in(const swap_binding_table_t *table, const float *avr_swap)
+{
+	for (int i = 0; i < table->n_in; i++)
+	{
+		const swap_binding_t *binding = &table->in[i];
+		if (binding->type == INPUT_PARAM_DOUBLE)
+		{
+			*(double *)binding->value = (double)avr_swap[binding->swap_index];
+		}
+		else
+		{
+			*(int *)binding->value = (int)avr_swap[binding->swap_index];
+		}
+	}
+}
+
+/**
+ * @brief Copies every `out` parameter into its avr_swap record.
+ */
+void swap_bindings_copy_out(const swap_binding_table_t *table, float *avr_swap)
+{
+	for (int i = 0; i < table->n_out; i++)
+	{
+		const swap_binding_t *binding = &table->out[i];
+		if (binding->type == INPUT_PARAM_DOUBLE)
+		{
+			avr_swap[binding->swap_index] = (float)*(const double *)binding->value;
+		}
+		else
+		{
+			avr_swap[binding->swap_index] = (float)*(const int *)binding->value;
+		}
+	}
+}
+
+/**
+ * @brief Frees the tables and leaves @p table empty.
+ */
+void free_swap_bindings(swap_binding_table_t *table)
+{
+	free(table->in);
+	free(table->out);
+	*table = (swap_binding_table_t){0};
+}
@@ -0,0 +1,1029 @@
+/**
+ * @file    sweep_distributed.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Coordinator and worker nodes splitting one sweep into shards pulled over TCP
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sweep_distributed.h"
+#include "logger.h"                 // for log_message, ERROR_MESSAGE, safe_fprintf
+#include "sweep_scheduler.h"        // for sweep_run_t, run_sweep_range, report_sweep_run
+#include "xfe_control_sim_common.h" // for get_param_*_or_default
+#include "xflow_aero_sim.h"         // for param_array_t
+#include "xflow_core.h"             // for shutdownFlag, get_monotonic_timestamp, usleep_now, create_dynamic_file_path, xflow_fopen_safe, safe_strerror
+#include <stdarg.h>                 // for va_list, va_start, va_end
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stddef.h>                 // for NULL, size_t
+#include <stdint.h>                 // for uint64_t, uint8_t
+#include <stdio.h>                  // for FILE, fgets, fflush, fclose, snprintf
+#include <stdlib.h>                 // for calloc, free, strtod, strtol
+#include <string.h>                 // for memchr, memmove, strcmp, strncmp, strrchr
+#include <time.h>                   // for timespec
+
+#ifndef _WIN32
+#include <errno.h>       // for errno, EINTR
+#include <limits.h>      // for PATH_MAX
+#include <netdb.h>       // for getaddrinfo, freeaddrinfo, getnameinfo
+#include <poll.h>        // for poll, pollfd, POLLIN
+#include <sys/socket.h>  // for socket, bind, listen, accept, connect, send, recv
+#include <sys/types.h>   // for ssize_t
+#include <unistd.h>      // for close, access
+#endif
+
+#define FNV64_OFFSET 14695981039346656037ULL
+#define FNV64_PRIME 1099511628211ULL
+
+#define SWEEP_NET_POLL_MS 200 // wake-up for lease timeouts and shutdownFlag
+#define SWEEP_NET_BACKLOG 16
+#define SWEEP_NET_CONNECT_RETRY_US 500000U // worker back-off while the coordinator is not up yet
+#define SWEEP_NET_LINE_BASE 256            // bytes of a RESULT line besides the channel values
+#define SWEEP_NET_VALUE_CHARS 32           // upper bound of one "%.17g" value and its separator
+#define SWEEP_NET_SHORT_LINE 256
+#define SWEEP_NET_HOST_MAX 256
+#define SWEEP_NET_PORT_MAX 32
+
+#ifdef MSG_NOSIGNAL
+#define SWEEP_SEND_FLAGS MSG_NOSIGNAL // a vanished peer must not raise SIGPIPE
+#else
+#define SWEEP_SEND_FLAGS 0
+#endif
+
+static uint64_t fnv1a64(uint64_t h, const void *data, const size_t n)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	for (size_t i = 0; i < n; i++)
+	{
+		h ^= p[i];
+		h *= FNV64_PRIME;
+	}
+	return h;
+}
+
+/**
+ * @brief Cases per shard: `sweep_shard_cases`, or enough to split the sweep into
+ * `SWEEP_DEFAULT_SHARD_COUNT` shards when it is 0.
+ *
+ * Shard `k` always holds cases `k * shard_cases` up to the next shard's first case, so every
+ * node derives the same partition from the same case list.
+ */
+int sweep_shard_cases(const param_array_t *fixed_data, const int n_cases)
+{
+	int shard_cases = get_param_int_or_default(fixed_data, "sweep_shard_cases", 0);
+	if (shard_cases <= 0)
+	{
+		shard_cases = (n_cases + SWEEP_DEFAULT_SHARD_COUNT - 1) / SWEEP_DEFAULT_SHARD_COUNT;
+	}
+	return shard_cases < 1 ? 1 : shard_cases;
+}
+
+/**
+ * @brief FNV-1a 64 over the axis names, the case values and the reported channels.
+ *
+ * Worker nodes send it with their HELLO, so a node started with a different config or samples
+ * file is refused instead of filling the results with another sweep's cases.
+ */
+uint64_t sweep_fingerprint(const sweep_run_t *run)
+{
+	uint64_t h = fnv1a64(FNV64_OFFSET, &run->cases.n_axes, sizeof(run->cases.n_axes));
+	h = fnv1a64(h, &run->cases.n_cases, sizeof(run->cases.n_cases));
+	for (int a = 0; a < run->cases.n_axes; a++)
+	{
+		h = fnv1a64(h, run->cases.axis_names[a], strlen(run->cases.axis_names[a]) + 1);
+	}
+	h = fnv1a64(h, run->cases.values, (size_t)run->cases.n_cases * (size_t)run->cases.n_axes * sizeof(double));
+	for (int c = 0; c < run->n_channels; c++)
+	{
+		h = fnv1a64(h, run->channels[c], strlen(run->channels[c]) + 1);
+	}
+	return h;
+}
+
+#ifndef _WIN32
+/**
+ * @brief Buffered reader splitting a socket stream into `\n`-terminated lines.
+ */
+typedef struct
+{
+	int fd;
+	char *buffer;
+	size_t length;
+	size_t capacity;
+} sweep_line_reader_t;
+
+typedef enum
+{
+	SWEEP_SHARD_PENDING = 0,
+	SWEEP_SHARD_LEASED,
+	SWEEP_SHARD_DONE
+} sweep_shard_state_t;
+
+typedef struct
+{
+	sweep_shard_state_t state;
+	int peer_id; // peer holding the newest lease
+	struct timespec leased_at;
+} sweep_shard_t;
+
+/**
+ * @brief One worker node connected to the coordinator.
+ */
+typedef struct
+{
+	sweep_line_reader_t reader;
+	int id;      // connection number, for leases and logs
+	bool ready;  // HELLO accepted
+	bool idle;   // sent NEXT and waits for a shard
+	int shard;   // shard being run, -1 for none
+	int workers; // local worker slots the node reported
+	char name[SWEEP_NET_HOST_MAX + SWEEP_NET_PORT_MAX];
+} sweep_peer_t;
+
+/**
+ * @brief Longest line of the protocol for this sweep: a RESULT line with every channel value.
+ */
+static size_t sweep_line_max(const sweep_run_t *run)
+{
+	return SWEEP_NET_LINE_BASE + ((size_t)run->n_channels * SWEEP_NET_VALUE_CHARS);
+}
+
+static int init_line_reader(sweep_line_reader_t *reader, const int fd, const size_t line_max)
+{
+	reader->fd = fd;
+	reader->length = 0;
+	reader->capacity = 2 * line_max;
+	reader->buffer = malloc(reader->capacity);
+	return reader->buffer ? 0 : -1;
+}
+
+static void close_line_reader(sweep_line_reader_t *reader)
+{
+	if (reader->fd >= 0)
+	{
+		close(reader->fd);
+	}
+	free(reader->buffer);
+	reader->fd = -1;
+	reader->buffer = NULL;
+}
+
+/**
+ * @brief Reads what the socket has into the buffer.
+ *
+ * An interrupted `recv` is retried unless `shutdownFlag` was set by the signal.
+ *
+ * @return Bytes read, 0 when the peer closed the connection, -1 on an error, a shutdown or a line longer than the buffer.
+ */
+static ssize_t fill_line_reader(sweep_line_reader_t *reader)
+{
+	if (reader->length == reader->capacity)
+	{
+		return -1;
+	}
+	ssize_t n;
+	do
+	{
+		n = recv(reader->fd, reader->buffer + reader->length, reader->capacity - reader->length, 0);
+	} while (n < 0 && errno == EINTR && !shutdownFlag);
+	if (n > 0)
+	{
+		reader->length += (size_t)n;
+	}
+	return n;
+}
+
+/**
+ * @brief Moves the next complete line, without its line ending, into `line`.
+ *
+ * @return true when a line was available.
+ */
+static bool next_line(sweep_line_reader_t *reader, char *line, const size_t line_size)
+{
+	const char *newline = memchr(reader->buffer, '\n', reader->length);
+	if (!newline)
+	{
+		return false;
+	}
+	const size_t consumed = (size_t)(newline - reader->buffer) + 1;
+	size_t len = consumed - 1;
+	if (len > 0 && reader->buffer[len - 1] == '\r')
+	{
+		len--;
+	}
+	len = len < line_size - 1 ? len : line_size - 1;
+	memcpy(line, reader->buffer, len);
+	line[len] = '\0';
+	memmove(reader->buffer, reader->buffer + consumed, reader->length - consumed);
+	reader->length -= consumed;
+	return true;
+}
+
+/**
+ * @brief Blocks until the next line arrives or `shutdownFlag` is set.
+ *
+ * Waits in `poll` with a `SWEEP_NET_POLL_MS` timeout, so SIGINT/SIGTERM stop a worker that
+ * is waiting for a shard even when the signal handler restarts interrupted calls.
+ *
+ * @return 0 on success, -1 on a shutdown or when the connection closed or failed first.
+ */
+static int read_line_blocking(sweep_line_reader_t *reader, char *line, const size_t line_size)
+{
+	while (!next_line(reader, line, line_size))
+	{
+		struct pollfd pfd = {.fd = reader->fd, .events = POLLIN};
+		const int ready = poll(&pfd, 1, SWEEP_NET_POLL_MS);
+		if (shutdownFlag || (ready < 0 && errno != EINTR))
+		{
+			return -1;
+		}
+		if (ready > 0 && fill_line_reader(reader) <= 0)
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int send_all(const int fd, const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		const ssize_t n = send(fd, data, size, SWEEP_SEND_FLAGS);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			return -1;
+		}
+		data += n;
+		size -= (size_t)n;
+	}
+	return 0;
+}
+
+static int send_line(const int fd, const char *format, ...)
+{
+	char line[SWEEP_NET_SHORT_LINE];
+	va_list args;
+	va_start(args, format);
+	const int len = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	return (len < 0 || (size_t)len >= sizeof(line)) ? -1 : send_all(fd, line, (size_t)len);
+}
+
+/**
+ * @brief Formats case `case_index` as `RESULT <case> <finished> <exit> <stopped_early> <end_time> <wall_time> <values...>\n`.
+ *
+ * Values are printed with `%.17g` so they survive the round trip bit for bit. The same line is
+ * sent by workers and written to the coordinator's journal.
+ *
+ * @return Line length, or -1 if it does not fit in `line_size`.
+ */
+static int format_result_line(const sweep_run_t *run, const int case_index, char *line, const size_t line_size)
+{
+	const sweep_case_result_t *result = &run->results[case_index];
+	int len = snprintf(line, line_size, "RESULT %d %d %d %d %.17g %.17g", case_index, result->finished, result->exit_code, result->stopped_early, result->end_time, result->wall_time);
+	for (int c = 0; c < run->n_channels && len >= 0 && (size_t)len < line_size; c++)
+	{
+		len += snprintf(line + len, line_size - (size_t)len, " %.17g", run->values[((size_t)case_index * run->n_channels) + c]);
+	}
+	if (len < 0 || (size_t)len + 1 >= line_size)
+	{
+		return -1;
+	}
+	line[len++] = '\n';
+	line[len] = '\0';
+	return len;
+}
+
+/**
+ * @brief Stores a RESULT line (see `format_result_line()`) whose case lies in `[first_case, end_case)`.
+ *
+ * @return The case index, or -1 for a malformed line or a case outside the range.
+ */
+static int parse_result_line(sweep_run_t *run, const char *line, const int first_case, const int end_case)
+{
+	if (strncmp(line, "RESULT ", 7) != 0)
+	{
+		return -1;
+	}
+	char *cursor = NULL;
+	const long case_index = strtol(line + 7, &cursor, 10);
+	if (cursor == line + 7 || case_index < first_case || case_index >= end_case)
+	{
+		return -1;
+	}
+	sweep_case_result_t result = {0};
+	const char *field = cursor;
+	result.finished = (int)strtol(field, &cursor, 10);
+	result.exit_code = (int)strtol(cursor, &cursor, 10);
+	result.stopped_early = (int)strtol(cursor, &cursor, 10);
+	result.end_time = strtod(cursor, &cursor);
+	result.wall_time = strtod(cursor, &cursor);
+	if (cursor == field)
+	{
+		return -1;
+	}
+	double *values = &run->values[(size_t)case_index * run->n_channels];
+	for (int c = 0; c < run->n_channels; c++)
+	{
+		const char *start = cursor;
+		const double value = strtod(start, &cursor);
+		if (cursor == start)
+		{
+			return -1;
+		}
+		values[c] = value;
+	}
+	run->results[case_index] = result;
+	return (int)case_index;
+}
+
+/**
+ * @brief Splits `host:port` (or `[v6-address]:port`) at the last colon.
+ */
+static int split_address(const char *address, char *host, const size_t host_size, char *port, const size_t port_size)
+{
+	const char *colon = strrchr(address, ':');
+	if (!colon || colon[1] == '\0')
+	{
+		return -1;
+	}
+	const char *host_start = address;
+	size_t host_len = (size_t)(colon - address);
+	if (host_len >= 2 && host_start[0] == '[' && host_start[host_len - 1] == ']')
+	{
+		host_start++;
+		host_len -= 2;
+	}
+	if (host_len >= host_size || strlen(colon + 1) >= port_size)
+	{
+		return -1;
+	}
+	memcpy(host, host_start, host_len);
+	host[host_len] = '\0';
+	snprintf(port, port_size, "%s", colon + 1);
+	return 0;
+}
+
+static int open_listen_socket(const char *port)
+{
+	struct addrinfo hints = {0};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	struct addrinfo *addresses = NULL;
+	if (getaddrinfo(NULL, port, &hints, &addresses) != 0)
+	{
+		return -1;
+	}
+	int fd = -1;
+	for (const struct addrinfo *ai = addresses; ai && fd < 0; ai = ai->ai_next)
+	{
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+		{
+			continue;
+		}
+		const int yes = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, SWEEP_NET_BACKLOG) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	return fd;
+}
+
+static void configure_peer_socket(const int fd)
+{
+	const int yes = 1;
+	// lets a node that vanished without closing its connection be noticed and its shard requeued
+	setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &yes, sizeof(yes));
+#ifdef SO_NOSIGPIPE
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+}
+
+/**
+ * @brief Connects to the coordinator, retrying until `timeout_sec` so workers may start first.
+ *
+ * @return The connected socket, or -1.
+ */
+static int connect_to_coordinator(const char *host, const char *port, const double timeout_sec)
+{
+	const struct timespec start = get_monotonic_timestamp();
+	bool announced = false;
+	while (!shutdownFlag)
+	{
+		struct addrinfo hints = {0};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		struct addrinfo *addresses = NULL;
+		int fd = -1;
+		if (getaddrinfo(host, port, &hints, &addresses) == 0)
+		{
+			for (const struct addrinfo *ai = addresses; ai && fd < 0; ai = ai->ai_next)
+			{
+				fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+				if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+				{
+					close(fd);
+					fd = -1;
+				}
+			}
+			freeaddrinfo(addresses);
+		}
+		if (fd >= 0)
+		{
+			configure_peer_socket(fd);
+			return fd;
+		}
+		if (timespec_diff_to_double(start, get_monotonic_timestamp()) >= timeout_sec)
+		{
+			break;
+		}
+		if (!announced)
+		{
+			log_message("Sweep worker: waiting for the coordinator at %s:%s\n", host, port);
+			announced = true;
+		}
+		usleep_now(SWEEP_NET_CONNECT_RETRY_US);
+	}
+	return -1;
+}
+
+/**
+ * @brief Opens the coordinator's journal and restores the shards it records as done.
+ *
+ * The journal starts with a line identifying the sweep (protocol version, fingerprint, case,
+ * channel and shard counts), followed by the RESULT lines of every completed shard and an
+ * `END <shard>` line. A restarted coordinator with the same sweep reloads those shards and
+ * only hands out the rest; a journal of another sweep is started over.
+ *
+ * @return The journal opened for appending, or NULL when `sweep_journal_file` is `none` or it cannot be written.
+ */
+static FILE *open_sweep_journal(sweep_run_t *run, const param_array_t *fixed_data, sweep_shard_t *shards, const int shard_cases, const int n_shards, const uint64_t fingerprint, int *n_resumed)
+{
+	*n_resumed = 0;
+	const char *name = get_param_string_or_default(fixed_data, "sweep_journal_file", "sweep_journal.txt");
+	if (name[0] == '\0' || strcmp(name, "none") == 0)
+	{
+		return NULL;
+	}
+
+	char path[PATH_MAX];
+	create_dynamic_file_path(path, PATH_MAX, "%s/%s", OUTPUT_LOG_FILE_PATH, name);
+	char header[SWEEP_NET_SHORT_LINE];
+	snprintf(header, sizeof(header), "SWEEP %d %016llx %d %d %d", SWEEP_PROTOCOL_VERSION, (unsigned long long)fingerprint, run->cases.n_cases, run->n_channels, shard_cases);
+
+	bool resume = false;
+	FILE *existing = access(path, F_OK) == 0 ? xflow_fopen_safe(path, XFLOW_FILE_READ_ONLY) : NULL;
+	const size_t line_max = sweep_line_max(run);
+	char *line = malloc(line_max);
+	if (existing && line)
+	{
+		if (fgets(line, (int)line_max, existing) && strncmp(line, header, strlen(header)) == 0 && (line[strlen(header)] == '\n' || line[strlen(header)] == '\0'))
+		{
+			resume = true;
+			while (fgets(line, (int)line_max, existing))
+			{
+				if (strncmp(line, "RESULT ", 7) == 0)
+				{
+					parse_result_line(run, line, 0, run->cases.n_cases);
+				}
+				else if (strncmp(line, "END ", 4) == 0)
+				{
+					const long shard = strtol(line + 4, NULL, 10);
+					if (shard >= 0 && shard < n_shards && shards[shard].state != SWEEP_SHARD_DONE)
+					{
+						shards[shard].state = SWEEP_SHARD_DONE;
+						(*n_resumed)++;
+					}
+				}
+			}
+		}
+		else
+		{
+			log_message("Sweep coordinator: journal %s belongs to another sweep, starting over\n", path);
+		}
+	}
+	if (existing)
+	{
+		fclose(existing);
+	}
+	free(line);
+
+	FILE *journal = xflow_fopen_safe(path, resume ? XFLOW_FILE_APPEND : XFLOW_FILE_WRITE_ONLY);
+	if (!journal)
+	{
+		ERROR_MESSAGE("Sweep coordinator: cannot open journal %s (%s), completed shards will not survive a restart\n", path, safe_strerror(errno));
+		return NULL;
+	}
+	// On resume the newline ends a line cut short by a crash; blank lines are skipped on resume.
+	const int written = resume ? safe_fprintf(journal, "\n") : safe_fprintf(journal, "%s\n", header);
+	if (written < 0 || fflush(journal) != 0)
+	{
+		ERROR_MESSAGE("Sweep coordinator: cannot write journal %s (%s), completed shards will not survive a restart\n", path, safe_strerror(errno));
+		fclose(journal);
+		return NULL;
+	}
+	return journal;
+}
+
+/**
+ * @brief Appends a completed shard's RESULT lines and its END line to the journal.
+ *
+ * The END line is only flushed after every RESULT line, so a crash mid-shard leaves the shard
+ * to be run again rather than resumed with missing cases.
+ *
+ * @return 0 on success (or without a journal), -1 when the journal cannot be written.
+ */
+static int journal_shard(FILE *journal, const sweep_run_t *run, const int shard, const int first_case, const int end_case, char *line, const size_t line_size)
+{
+	if (!journal)
+	{
+		return 0;
+	}
+	for (int i = first_case; i < end_case; i++)
+	{
+		if (format_result_line(run, i, line, line_size) > 0 && safe_fprintf(journal, "%s", line) < 0)
+		{
+			return -1;
+		}
+	}
+	if (safe_fprintf(journal, "END %d\n", shard) < 0 || fflush(journal) != 0)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Closes a peer's connection and requeues the shard it was holding.
+ */
+static void drop_peer(sweep_peer_t *peer, sweep_shard_t *shards, const char *reason)
+{
+	if (peer->shard >= 0 && shards[peer->shard].state == SWEEP_SHARD_LEASED && shards[peer->shard].peer_id == peer->id)
+	{
+		shards[peer->shard].state = SWEEP_SHARD_PENDING;
+		log_message("Sweep coordinator: %s %s, shard %d requeued\n", peer->name, reason, peer->shard);
+	}
+	else
+	{
+		log_message("Sweep coordinator: %s %s\n", peer->name, reason);
+	}
+	close_line_reader(&peer->reader);
+}
+
+/**
+ * @brief Runs the coordinator side of a distributed sweep: serves shards to worker nodes
+ * until every shard is done, then writes the merged results.
+ *
+ * The coordinator listens on the port of `sweep_coordinator_address` on all interfaces and
+ * does not run cases itself. Each worker node sends `HELLO <version> <fingerprint> <n_cases>
+ * <n_channels> <workers>` and is answered with `OK <n_shards> <shard_cases>` or `ERR <reason>`.
+ * It then asks for work with `NEXT` and receives `SHARD <id> <first_case> <n_cases>`, runs
+ * the shard on its local pool, and returns one `RESULT` line per case followed by `END <id>`.
+ * Once all shards are done every node is sent `DONE`.
+ *
+ * Shards go out lowest id first. A shard is handed out again when its node disconnects, or
+ * when it has been out for longer than `sweep_shard_timeout_sec` (0 = no limit); the first
+ * `END` for a shard wins and later copies are ignored. Completed shards are recorded in the
+ * journal (`sweep_journal_file`), so a restarted coordinator only hands out the rest.
+ *
+ * @return Number of cases that completed, or -1 if the coordinator could not start.
+ */
+int run_sweep_coordinator(sweep_run_t *run, const param_array_t *fixed_data)
+{
+	const int n_cases = run->cases.n_cases;
+	const int shard_cases = sweep_shard_cases(fixed_data, n_cases);
+	const int n_shards = (n_cases + shard_cases - 1) / shard_cases;
+	const double shard_timeout_sec = get_param_double_or_default(fixed_data, "sweep_shard_timeout_sec", 0.0);
+	const uint64_t fingerprint = sweep_fingerprint(run);
+	const char *address = get_param_string_or_default(fixed_data, "sweep_coordinator_address", SWEEP_DEFAULT_COORDINATOR_ADDRESS);
+
+	char host[SWEEP_NET_HOST_MAX];
+	char port[SWEEP_NET_PORT_MAX];
+	if (split_address(address, host, sizeof(host), port, sizeof(port)) != 0)
+	{
+		ERROR_MESSAGE("Sweep coordinator: sweep_coordinator_address '%s' is not host:port\n", address);
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	const size_t line_max = sweep_line_max(run);
+	sweep_shard_t *shards = calloc((size_t)n_shards, sizeof(sweep_shard_t));
+	char *line = malloc(line_max);
+	const int listen_fd = open_listen_socket(port);
+	if (!shards || !line || listen_fd < 0)
+	{
+		ERROR_MESSAGE("Sweep coordinator: failed to listen on port %s\n", port);
+		if (listen_fd >= 0)
+		{
+			close(listen_fd);
+		}
+		free(shards);
+		free(line);
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	int n_done_shards = 0;
+	FILE *journal = open_sweep_journal(run, fixed_data, shards, shard_cases, n_shards, fingerprint, &n_done_shards);
+	const int n_resumed = n_done_shards;
+	log_message("Sweep coordinator: %d cases in %d shards of up to %d cases, listening on port %s\n", n_cases, n_shards, shard_cases, port);
+	if (n_resumed > 0)
+	{
+		log_message("Sweep coordinator: %d shards restored from the journal\n", n_resumed);
+	}
+
+	sweep_peer_t *peers = NULL;
+	struct pollfd *fds = NULL;
+	int n_peers = 0;
+	int peer_capacity = 0;
+	int next_peer_id = 0;
+	int peak_workers = 0;
+	const struct timespec sweep_start = get_monotonic_timestamp();
+	while (n_done_shards < n_shards && !shutdownFlag)
+	{
+		if (n_peers + 1 > peer_capacity)
+		{
+			const int capacity = peer_capacity == 0 ? 8 : peer_capacity * 2;
+			sweep_peer_t *grown_peers = realloc(peers, (size_t)capacity * sizeof(sweep_peer_t));
+			peers = grown_peers ? grown_peers : peers;
+			struct pollfd *grown_fds = realloc(fds, (size_t)(capacity + 1) * sizeof(struct pollfd));
+			fds = grown_fds ? grown_fds : fds;
+			if (!grown_peers || !grown_fds)
+			{
+				ERROR_MESSAGE("Sweep coordinator: failed to allocate %d peers\n", capacity);
+				shutdownFlag = 1;
+				break;
+			}
+			peer_capacity = capacity;
+		}
+		fds[0] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+		for (int p = 0; p < n_peers; p++)
+		{
+			fds[p + 1] = (struct pollfd){.fd = peers[p].reader.fd, .events = POLLIN};
+		}
+		const int n_polled = n_peers;
+		if (poll(fds, (nfds_t)n_polled + 1, SWEEP_NET_POLL_MS) < 0 && errno != EINTR)
+		{
+			ERROR_MESSAGE("Sweep coordinator: poll failed: %s\n", safe_strerror(errno));
+			shutdownFlag = 1;
+			break;
+		}
+
+		// Serve the connected nodes, then accept new ones, so the peers array only grows below.
+		for (int p = 0; p < n_polled; p++)
+		{
+			sweep_peer_t *peer = &peers[p];
+			if (!(fds[p + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+			{
+				continue;
+			}
+			if (fill_line_reader(&peer->reader) <= 0)
+			{
+				drop_peer(peer, shards, "disconnected");
+				continue;
+			}
+			const char *reason = NULL;
+			while (!reason && next_line(&peer->reader, line, line_max))
+			{
+				if (strncmp(line, "HELLO ", 6) == 0)
+				{
+					int version = 0;
+					unsigned long long peer_fingerprint = 0;
+					int peer_cases = 0;
+					int peer_channels = 0;
+					int workers = 0;
+					if (sscanf(line + 6, "%d %llx %d %d %d", &version, &peer_fingerprint, &peer_cases, &peer_channels, &workers) != 5 || version != SWEEP_PROTOCOL_VERSION)
+					{
+						send_line(peer->reader.fd, "ERR protocol version %d expected\n", SWEEP_PROTOCOL_VERSION);
+						reason = "speaks another protocol version";
+					}
+					else if (peer_fingerprint != fingerprint || peer_cases != n_cases || peer_channels != run->n_channels)
+					{
+						send_line(peer->reader.fd, "ERR sweep mismatch, coordinator has %d cases and %d channels\n", n_cases, run->n_channels);
+						reason = "runs a different sweep";
+					}
+					else if (send_line(peer->reader.fd, "OK %d %d\n", n_shards, shard_cases) != 0)
+					{
+						reason = "disconnected";
+					}
+					else
+					{
+						peer->ready = true;
+						peer->workers = workers;
+						int connected_workers = 0;
+						for (int q = 0; q < n_peers; q++)
+						{
+							connected_workers += peers[q].ready && peers[q].reader.fd >= 0 ? peers[q].workers : 0;
+						}
+						peak_workers = connected_workers > peak_workers ? connected_workers : peak_workers;
+						log_message("Sweep coordinator: %s joined with %d workers\n", peer->name, workers);
+					}
+				}
+				else if (!peer->ready)
+				{
+					reason = "skipped HELLO";
+				}
+				else if (strcmp(line, "NEXT") == 0)
+				{
+					if (peer->shard >= 0 && shards[peer->shard].state == SWEEP_SHARD_LEASED && shards[peer->shard].peer_id == peer->id)
+					{
+						shards[peer->shard].state = SWEEP_SHARD_PENDING;
+					}
+					peer->shard = -1;
+					peer->idle = true;
+				}
+				else if (strncmp(line, "RESULT ", 7) == 0)
+				{
+					// results of a shard that another node already finished are ignored
+					if (peer->shard >= 0 && shards[peer->shard].state != SWEEP_SHARD_DONE)
+					{
+						const int first_case = peer->shard * shard_cases;
+						const int end_case = first_case + shard_cases < n_cases ? first_case + shard_cases : n_cases;
+						if (parse_result_line(run, line, first_case, end_case) < 0)
+						{
+							reason = "sent a malformed RESULT";
+						}
+					}
+				}
+				else if (strncmp(line, "END ", 4) == 0)
+				{
+					const long shard = strtol(line + 4, NULL, 10);
+					if (peer->shard < 0 || shard < 0 || shard >= n_shards || shard != peer->shard)
+					{
+						reason = "finished a shard it was not given";
+					}
+					else if (shards[shard].state != SWEEP_SHARD_DONE)
+					{
+						const int first_case = (int)shard * shard_cases;
+						const int end_case = first_case + shard_cases < n_cases ? first_case + shard_cases : n_cases;
+						shards[shard].state = SWEEP_SHARD_DONE;
+						n_done_shards++;
+						if (journal_shard(journal, run, (int)shard, first_case, end_case, line, line_max) < 0)
+						{
+							ERROR_MESSAGE("Sweep coordinator: cannot write journal (%s), shards completed from now on will not survive a restart\n", safe_strerror(errno));
+							fclose(journal);
+							journal = NULL;
+						}
+						log_message("Sweep coordinator: shard %ld done by %s (%d/%d shards)\n", shard, peer->name, n_done_shards, n_shards);
+					}
+					peer->shard = -1;
+				}
+				else
+				{
+					reason = "sent an unknown command";
+				}
+			}
+			if (reason)
+			{
+				drop_peer(peer, shards, reason);
+			}
+		}
+
+		if (fds[0].revents & POLLIN)
+		{
+			struct sockaddr_storage peer_address;
+			socklen_t address_len = sizeof(peer_address);
+			const int fd = accept(listen_fd, (struct sockaddr *)&peer_address, &address_len);
+			if (fd >= 0)
+			{
+				sweep_peer_t *peer = &peers[n_peers];
+				*peer = (sweep_peer_t){.id = next_peer_id++, .shard = -1};
+				char peer_host[SWEEP_NET_HOST_MAX] = "?";
+				char peer_port[SWEEP_NET_PORT_MAX] = "?";
+				getnameinfo((struct sockaddr *)&peer_address, address_len, peer_host, sizeof(peer_host), peer_port, sizeof(peer_port), NI_NUMERICHOST | NI_NUMERICSERV);
+				snprintf(peer->name, sizeof(peer->name), "%s:%s", peer_host, peer_port);
+				configure_peer_socket(fd);
+				if (init_line_reader(&peer->reader, fd, line_max) != 0)
+				{
+					close_line_reader(&peer->reader);
+				}
+				else
+				{
+					n_peers++;
+				}
+			}
+		}
+
+		// Requeue expired leases, then hand pending shards to idle nodes, lowest id first.
+		const struct timespec now = get_monotonic_timestamp();
+		int next_pending = 0;
+		for (int s = 0; s < n_shards; s++)
+		{
+			if (shard_timeout_sec > 0.0 && shards[s].state == SWEEP_SHARD_LEASED && timespec_diff_to_double(shards[s].leased_at, now) > shard_timeout_sec)
+			{
+				shards[s].state = SWEEP_SHARD_PENDING;
+				log_message("Sweep coordinator: shard %d out for more than %.0f s, requeued\n", s, shard_timeout_sec);
+			}
+		}
+		for (int p = 0; p < n_peers; p++)
+		{
+			sweep_peer_t *peer = &peers[p];
+			if (peer->reader.fd < 0 || !peer->idle)
+			{
+				continue;
+			}
+			while (next_pending < n_shards && shards[next_pending].state != SWEEP_SHARD_PENDING)
+			{
+				next_pending++;
+			}
+			if (next_pending == n_shards)
+			{
+				break;
+			}
+			const int first_case = next_pending * shard_cases;
+			const int count = first_case + shard_cases < n_cases ? shard_cases : n_cases - first_case;
+			if (send_line(peer->reader.fd, "SHARD %d %d %d\n", next_pending, first_case, count) != 0)
+			{
+				drop_peer(peer, shards, "disconnected");
+				continue;
+			}
+			shards[next_pending] = (sweep_shard_t){.state = SWEEP_SHARD_LEASED, .peer_id = peer->id, .leased_at = now};
+			peer->shard = next_pending;
+			peer->idle = false;
+		}
+
+		// Compact the closed connections away.
+		int kept = 0;
+		for (int p = 0; p < n_peers; p++)
+		{
+			if (peers[p].reader.fd >= 0)
+			{
+				peers[kept++] = peers[p];
+			}
+		}
+		n_peers = kept;
+	}
+	const double total_wall = timespec_diff_to_double(sweep_start, get_monotonic_timestamp());
+
+	for (int p = 0; p < n_peers; p++)
+	{
+		// on shutdown the nodes just see the connection close and stop
+		if (n_done_shards == n_shards)
+		{
+			send_all(peers[p].reader.fd, "DONE\n", 5);
+		}
+		close_line_reader(&peers[p].reader);
+	}
+	close(listen_fd);
+	if (journal)
+	{
+		fclose(journal);
+	}
+	if (n_done_shards < n_shards)
+	{
+		log_message("Sweep coordinator: stopped with %d of %d shards done\n", n_done_shards, n_shards);
+	}
+
+	int n_done = 0;
+	for (int s = 0; s < n_shards; s++)
+	{
+		if (shards[s].state == SWEEP_SHARD_DONE)
+		{
+			const int first_case = s * shard_cases;
+			n_done += first_case + shard_cases < n_cases ? shard_cases : n_cases - first_case;
+		}
+	}
+	const int n_completed = report_sweep_run(run, fixed_data, n_done, peak_workers, total_wall);
+
+	free(peers);
+	free(fds);
+	free(shards);
+	free(line);
+	return n_completed;
+}
+
+/**
+ * @brief Runs the worker-node side of a distributed sweep: pulls shards from the coordinator
+ * and runs each on the local pool of `sweep_workers` processes until the coordinator sends `DONE`.
+ *
+ * The node loads its own configuration and flow series (and so uses its own flow cache); only
+ * case indices and results cross the network. After a shutdown request the current shard is
+ * not reported, and the coordinator hands it to another node.
+ *
+ * @return Number of cases this node completed, or -1 if it could not join the sweep.
+ */
+int run_sweep_worker(sweep_run_t *run, const param_array_t *dynamic_data, const param_array_t *fixed_data, const sweep_case_fn run_case, void *user_data)
+{
+	const char *address = get_param_string_or_default(fixed_data, "sweep_coordinator_address", SWEEP_DEFAULT_COORDINATOR_ADDRESS);
+	const double connect_timeout_sec = get_param_double_or_default(fixed_data, "sweep_connect_timeout_sec", 30.0);
+	char host[SWEEP_NET_HOST_MAX];
+	char port[SWEEP_NET_PORT_MAX];
+	if (split_address(address, host, sizeof(host), port, sizeof(port)) != 0 || host[0] == '\0')
+	{
+		ERROR_MESSAGE("Sweep worker: sweep_coordinator_address '%s' is not host:port\n", address);
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	const int fd = connect_to_coordinator(host, port, connect_timeout_sec);
+	if (fd < 0)
+	{
+		if (!shutdownFlag)
+		{
+			ERROR_MESSAGE("Sweep worker: no coordinator at %s after %.0f s\n", address, connect_timeout_sec);
+			shutdownFlag = 1;
+		}
+		return -1;
+	}
+	const size_t line_max = sweep_line_max(run);
+	sweep_line_reader_t reader;
+	char *line = malloc(line_max);
+	if (init_line_reader(&reader, fd, line_max) != 0 || !line)
+	{
+		ERROR_MESSAGE("Sweep worker: failed to allocate line buffers\n");
+		close_line_reader(&reader);
+		free(line);
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	snprintf(line, line_max, "HELLO %d %016llx %d %d %d\n", SWEEP_PROTOCOL_VERSION, (unsigned long long)sweep_fingerprint(run), run->cases.n_cases, run->n_channels, run->workers);
+	if (send_all(fd, line, strlen(line)) != 0 || read_line_blocking(&reader, line, line_max) != 0 || strncmp(line, "OK ", 3) != 0)
+	{
+		ERROR_MESSAGE("Sweep worker: coordinator at %s refused this node: %s\n", address, strncmp(line, "ERR ", 4) == 0 ? line + 4 : "connection closed");
+		close_line_reader(&reader);
+		free(line);
+		shutdownFlag = 1;
+		return -1;
+	}
+	log_message("Sweep worker: joined the coordinator at %s with %d workers\n", address, run->workers);
+
+	const struct timespec sweep_start = get_monotonic_timestamp();
+	int n_shards_run = 0;
+	int n_cases_run = 0;
+	int n_completed = 0;
+	bool done = false;
+	while (!shutdownFlag)
+	{
+		if (send_all(fd, "NEXT\n", 5) != 0 || read_line_blocking(&reader, line, line_max) != 0)
+		{
+			break;
+		}
+		if (strcmp(line, "DONE") == 0)
+		{
+			done = true;
+			break;
+		}
+		int shard = 0;
+		int first_case = 0;
+		int count = 0;
+		if (sscanf(line, "SHARD %d %d %d", &shard, &first_case, &count) != 3 || first_case < 0 || count <= 0 || first_case + count > run->cases.n_cases)
+		{
+			ERROR_MESSAGE("Sweep worker: unexpected reply from the coordinator: %s\n", line);
+			break;
+		}
+
+		if (run_sweep_range(run, dynamic_data, fixed_data, run_case, user_data, first_case, count) < count)
+		{
+			break; // interrupted, the coordinator requeues the shard
+		}
+		bool sent = true;
+		for (int i = first_case; sent && i < first_case + count; i++)
+		{
+			const int len = format_result_line(run, i, line, line_max);
+			sent = len > 0 && send_all(fd, line, (size_t)len) == 0;
+			n_completed += run->results[i].finished && run->results[i].exit_code == 0;
+		}
+		if (!sent || send_line(fd, "END %d\n", shard) != 0)
+		{
+			break;
+		}
+		n_shards_run++;
+		n_cases_run += count;
+	}
+	close_line_reader(&reader);
+	free(line);
+
+	const double total_wall = timespec_diff_to_double(sweep_start, get_monotonic_timestamp());
+	log_message("Sweep worker: %d cases in %d shards in %.3f s (%.2f cases/s)%s\n", n_cases_run, n_shards_run, total_wall, total_wall > 0.0 ? n_cases_run / total_wall : 0.0, done || shutdownFlag ? "" : ", lost the coordinator");
+	return n_completed;
+}
+#endif
@@ -0,0 +1,809 @@
+/**
+ * @file    sweep_scheduler.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Built-in parameter sweep scheduler running cases on a pool of worker processes
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sweep_scheduler.h"
+#include "logger.h"                 // for log_message, ERROR_MESSAGE, safe_fprintf
+#include "param_index.h"            // for get_param_handle, param_from_handle
+#include "sweep_distributed.h"      // for run_sweep_coordinator, run_sweep_worker
+#include "xfe_control_sim_common.h" // for get_param_*_or_default, parse_delimited_list, get_num_cores
+#include "xflow_aero_sim.h"         // for param_array_t, input_param_t
+#include "xflow_core.h"             // for shutdownFlag, get_monotonic_timestamp, usleep_now
+#include <limits.h>                 // for INT_MAX, PATH_MAX
+#include <math.h>                   // for NAN
+#include <stdbool.h>                // IWYU pragma: keep
+#include <stddef.h>                 // for NULL, size_t
+#include <stdio.h>                  // for FILE, fgets, fflush
+#include <stdlib.h>                 // for calloc, free, strtod, strtol
+#include <string.h>                 // for strchr, strcmp, strlen, memcpy
+#include <time.h>                   // for timespec
+
+#ifdef _WIN32
+#include <windows.h> // for MAX_PATH
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif
+#else
+#include <sys/mman.h>  // for mmap, munmap, MAP_SHARED, MAP_ANONYMOUS
+#include <sys/types.h> // for pid_t
+#include <unistd.h>    // for fork, _exit
+#endif
+
+#define SWEEP_POLL_SLEEP_US 1000U // scheduler back-off when no worker finished
+#define SWEEP_LINE_MAX 4096
+#define SWEEP_EXIT_OVERRIDE_FAILED 2
+
+// Read by flow_gen when the parent loads the flow series, before the cases are forked.
+static const char *const sweepLoadTimeParams[] = {
+	"dt_sec",
+	"dur_sec",
+	"flow_gen_file_location_and_or_name",
+	"flow_time_step_dt",
+	"flow_stream_chunk_steps",
+	"flow_stream_window_samples",
+	"flow_stream_y_position",
+	"flow_stream_z_position",
+	"bts_rotor_radius_m",
+	"bts_rotor_area_weighted",
+};
+
+/**
+ * @brief Returns true when `sweep_grid` or `sweep_samples_file` names a sweep.
+ */
+bool sweep_is_configured(const param_array_t *fixed_data)
+{
+	const char *grid = get_param_string_or_default(fixed_data, "sweep_grid", "none");
+	const char *samples = get_param_string_or_default(fixed_data, "sweep_samples_file", "none");
+	return (grid[0] != '\0' && strcmp(grid, "none") != 0) || (samples[0] != '\0' && strcmp(samples, "none") != 0);
+}
+
+static char *duplicate_string(const char *text, const size_t len)
+{
+	char *copy = malloc(len + 1);
+	if (copy)
+	{
+		memcpy(copy, text, len);
+		copy[len] = '\0';
+	}
+	return copy;
+}
+
+/**
+ * @brief Expands one axis spec, either `min:max:n` (n evenly spaced values) or `v1|v2|v3`.
+ */
+static int parse_sweep_axis(const char *spec, double **out_values)
+{
+	*out_values = NULL;
+	if (strchr(spec, ':'))
+	{
+		char *end = NULL;
+		const double lo = strtod(spec, &end);
+		if (*end != ':')
+		{
+			return -1;
+		}
+		const double hi = strtod(end + 1, &end);
+		if (*end != ':')
+		{
+			return -1;
+		}
+		const long n = strtol(end + 1, &end, 10);
+		if (*end != '\0' || n < 1)
+		{
+			return -1;
+		}
+		double *values = calloc((size_t)n, sizeof(double));
+		if (!values)
+		{
+			return -1;
+		}
+		for (long i = 0; i < n; i++)
+		{
+			values[i] = n > 1 ? lo + ((hi - lo) * (double)i / (double)(n - 1)) : lo;
+		}
+		*out_values = values;
+		return (int)n;
+	}
+
+	int n = 1;
+	for (const char *p = spec; *p; p++)
+	{
+		n += *p == '|';
+	}
+	double *values = calloc((size_t)n, sizeof(double));
+	if (!values)
+	{
+		return -1;
+	}
+	const char *cursor = spec;
+	for (int i = 0; i < n; i++)
+	{
+		char *end = NULL;
+		values[i] = strtod(cursor, &end);
+		if (end == cursor || (*end != '|' && *end != '\0'))
+		{
+			free(values);
+			return -1;
+		}
+		cursor = end + 1;
+	}
+	*out_values = values;
+	return n;
+}
+
+/**
+ * @brief Builds the full factorial product of the axes in `sweep_grid`, last axis varying fastest.
+ */
+static int build_grid_cases(const char *grid, sweep_cases_t *cases)
+{
+	char **axes = NULL;
+	const int n_axes = parse_delimited_list(grid, &axes);
+	if (n_axes <= 0)
+	{
+		ERROR_MESSAGE("Sweep: sweep_grid '%s' has no axes\n", grid);
+		return -1;
+	}
+
+	double **axis_values = (double **)calloc((size_t)n_axes, sizeof(double *));
+	int *axis_count = calloc((size_t)n_axes, sizeof(int));
+	cases->axis_names = (char **)calloc((size_t)n_axes, sizeof(char *));
+	int rc = (axis_values && axis_count && cases->axis_names) ? 0 : -1;
+	long n_cases = 1;
+	for (int a = 0; rc == 0 && a < n_axes; a++)
+	{
+		const char *eq = strchr(axes[a], '=');
+		if (!eq || eq == axes[a])
+		{
+			ERROR_MESSAGE("Sweep: axis '%s' must look like name=min:max:n or name=v1|v2\n", axes[a]);
+			rc = -1;
+			break;
+		}
+		cases->axis_names[a] = duplicate_string(axes[a], (size_t)(eq - axes[a]));
+		axis_count[a] = parse_sweep_axis(eq + 1, &axis_values[a]);
+		if (!cases->axis_names[a] || axis_count[a] <= 0)
+		{
+			ERROR_MESSAGE("Sweep: cannot parse axis '%s'\n", axes[a]);
+			rc = -1;
+			break;
+		}
+		if (n_cases > INT_MAX / axis_count[a])
+		{
+			ERROR_MESSAGE("Sweep: sweep_grid '%s' has more than %d cases\n", grid, INT_MAX);
+			rc = -1;
+			break;
+		}
+		n_cases *= axis_count[a];
+	}
+	cases->n_axes = n_axes;
+
+	if (rc == 0)
+	{
+		cases->values = calloc((size_t)n_cases * (size_t)n_axes, sizeof(double));
+		rc = cases->values ? 0 : -1;
+	}
+	if (rc == 0)
+	{
+		cases->n_cases = (int)n_cases;
+		for (long c = 0; c < n_cases; c++)
+		{
+			long rest = c;
+			for (int a = n_axes - 1; a >= 0; a--)
+			{
+				cases->values[(c * n_axes) + a] = axis_values[a][rest % axis_count[a]];
+				rest /= axis_count[a];
+			}
+		}
+	}
+
+	for (int a = 0; axis_values && a < n_axes; a++)
+	{
+		free(axis_values[a]);
+	}
+	free((void *)axis_values);
+	free(axis_count);
+	free_delimited_list(axes, n_axes);
+	return rc;
+}
+
+/**
+ * @brief Reads a sample list: a header row of parameter names, then one case per row.
+ */
+static int build_sample_cases(const char *path, sweep_cases_t *cases)
+{
+	FILE *file = xflow_fopen_safe(path, XFLOW_FILE_READ_ONLY);
+	if (!file)
+	{
+		ERROR_MESSAGE("Sweep: cannot open sweep_samples_file '%s'\n", path);
+		return -1;
+	}
+
+	char line[SWEEP_LINE_MAX];
+	int rc = -1;
+	int capacity = 0;
+	int line_number = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		line_number++;
+		// a longer row would come back in pieces and be read as several cases
+		if (!strchr(line, '\n') && !feof(file))
+		{
+			ERROR_MESSAGE("Sweep: line %d of '%s' is longer than %d characters\n", line_number, path, SWEEP_LINE_MAX - 2);
+			rc = -1;
+			break;
+		}
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0')
+		{
+			continue;
+		}
+		if (cases->n_axes == 0)
+		{
+			cases->n_axes = parse_delimited_list(line, &cases->axis_names);
+			if (cases->n_axes <= 0)
+			{
+				break;
+			}
+			rc = 0;
+			continue;
+		}
+
+		if (cases->n_cases == capacity)
+		{
+			capacity = capacity == 0 ? 64 : capacity * 2;
+			double *grown = realloc(cases->values, (size_t)capacity * (size_t)cases->n_axes * sizeof(double));
+			if (!grown)
+			{
+				rc = -1;
+				break;
+			}
+			cases->values = grown;
+		}
+		const char *cursor = line;
+		for (int a = 0; a < cases->n_axes; a++)
+		{
+			char *end = NULL;
+			cases->values[((size_t)cases->n_cases * cases->n_axes) + a] = strtod(cursor, &end);
+			if (end == cursor)
+			{
+				ERROR_MESSAGE("Sweep: row %d of '%s' has fewer than %d numeric columns\n", cases->n_cases + 1, path, cases->n_axes);
+				rc = -1;
+				break;
+			}
+			cursor = end;
+			while (*cursor == ',' || *cursor == ' ' || *cursor == '\t' || *cursor == ';')
+			{
+				cursor++;
+			}
+		}
+		if (rc != 0)
+		{
+			break;
+		}
+		cases->n_cases++;
+	}
+	fclose(file);
+
+	if (rc == 0 && cases->n_cases == 0)
+	{
+		ERROR_MESSAGE("Sweep: '%s' contains no cases\n", path);
+		rc = -1;
+	}
+	return rc;
+}
+
+/**
+ * @brief Rejects axes on parameters the parent has already consumed when it loaded the flow series.
+ */
+static int check_sweep_axes(const sweep_cases_t *cases)
+{
+	for (int a = 0; a < cases->n_axes; a++)
+	{
+		for (size_t k = 0; k < sizeof(sweepLoadTimeParams) / sizeof(sweepLoadTimeParams[0]); k++)
+		{
+			if (strcmp(cases->axis_names[a], sweepLoadTimeParams[k]) == 0)
+			{
+				ERROR_MESSAGE("Sweep: '%s' is read when the flow series is loaded, before the cases start, and cannot be swept\n", cases->axis_names[a]);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Builds the case list from `sweep_samples_file` if set, otherwise from `sweep_grid`.
+ *
+ * `sweep_grid` is a list of axes such as `k=0.5:2.0:4;b=0.1|0.2`; `min:max:n` gives n evenly
+ * spaced values and `|` lists values explicitly. The cases are the full factorial product.
+ * `sweep_samples_file` is a CSV with parameter names in the first row and one case per row.
+ *
+ * Any numeric dynamic or fixed parameter read after the cases are forked can be an axis. The
+ * step, the duration and the flow-generation settings (`sweepLoadTimeParams`) are used by the
+ * parent to load the flow series once for all cases, so axes on them are rejected.
+ *
+ * @param fixed_data  Fixed parameters.
+ * @param cases       Receives the case list; release with `free_sweep_cases()`.
+ * @return            0 on success, -1 on a malformed definition or allocation failure.
+ */
+int build_sweep_cases(const param_array_t *fixed_data, sweep_cases_t *cases)
+{
+	cases->n_axes = 0;
+	cases->n_cases = 0;
+	cases->axis_names = NULL;
+	cases->values = NULL;
+
+	const char *samples = get_param_string_or_default(fixed_data, "sweep_samples_file", "none");
+	int rc = (samples[0] != '\0' && strcmp(samples, "none") != 0) ? build_sample_cases(samples, cases) : build_grid_cases(get_param_string_or_default(fixed_data, "sweep_grid", ""), cases);
+	if (rc == 0)
+	{
+		rc = check_sweep_axes(cases);
+	}
+	if (rc != 0)
+	{
+		free_sweep_cases(cases);
+	}
+	return rc;
+}
+
+/**
+ * @brief Releases a case list built by `build_sweep_cases()`.
+ */
+void free_sweep_cases(sweep_cases_t *cases)
+{
+	free_delimited_list(cases->axis_names, cases->n_axes > 0 ? cases->n_axes : 0);
+	free(cases->values);
+	cases->axis_names = NULL;
+	cases->values = NULL;
+	cases->n_axes = 0;
+	cases->n_cases = 0;
+}
+
+/**
+ * @brief Writes the values of case `case_index` into the matching dynamic or fixed parameters.
+ *
+ * Each axis name is looked up in `dynamic_data` first, then in `fixed_data`; double and int
+ * parameters are supported.
+ *
+ * @return 0 on success, -1 if an axis does not name a numeric parameter.
+ */
+int apply_sweep_case(const param_array_t *dynamic_data, const param_array_t *fixed_data, const sweep_cases_t *cases, const int case_index)
+{
+	for (int a = 0; a < cases->n_axes; a++)
+	{
+		const char *name = cases->axis_names[a];
+		input_param_t *param = param_from_handle(dynamic_data, get_param_handle(dynamic_data, name));
+		if (!param)
+		{
+			param = param_from_handle(fixed_data, get_param_handle(fixed_data, name));
+		}
+		const double value = cases->values[((size_t)case_index * cases->n_axes) + a];
+		if (param && param->type == INPUT_PARAM_DOUBLE)
+		{
+			param->value.d = value;
+		}
+		else if (param && param->type == INPUT_PARAM_INT)
+		{
+			param->value.i = (int)value;
+		}
+		else
+		{
+			ERROR_MESSAGE("Sweep: '%s' is not a numeric dynamic or fixed parameter\n", name);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void save_sweep_results(const char *filename, const sweep_cases_t *cases, const sweep_case_result_t *results, const double *values, char **channels, const int n_channels)
+{
+	FILE *file = xflow_fopen_safe(filename, XFLOW_FILE_WRITE_ONLY);
+	if (file == NULL)
+	{
+		ERROR_MESSAGE("Sweep: could not open results file '%s'.\n", filename);
+		return;
+	}
+
+	safe_fprintf(file, "case");
+	for (int a = 0; a < cases->n_axes; a++)
+	{
+		safe_fprintf(file, ",%s", cases->axis_names[a]);
+	}
+	safe_fprintf(file, ",exit_code,stopped_early,end_time_sec,wall_time_sec");
+	for (int c = 0; c < n_channels; c++)
+	{
+		safe_fprintf(file, ",final_%s", channels[c]);
+	}
+	safe_fprintf(file, "\n");
+
+	for (int i = 0; i < cases->n_cases; i++)
+	{
+		safe_fprintf(file, "%d", i);
+		for (int a = 0; a < cases->n_axes; a++)
+		{
+			safe_fprintf(file, ",%.10g", cases->values[((size_t)i * cases->n_axes) + a]);
+		}
+		safe_fprintf(file, ",%d,%d,%.10g,%.6f", results[i].exit_code, results[i].stopped_early, results[i].end_time, results[i].wall_time);
+		for (int c = 0; c < n_channels; c++)
+		{
+			safe_fprintf(file, ",%.10g", values[((size_t)i * n_channels) + c]);
+		}
+		safe_fprintf(file, "\n");
+	}
+
+	fclose(file);
+	log_message("Sweep results for %d cases saved to %s\n", cases->n_cases, filename);
+}
+
+static void log_sweep_summary(const sweep_cases_t *cases, const sweep_case_result_t *results, const int n_done, const int workers, const double total_wall)
+{
+	double min_wall = 0.0;
+	double max_wall = 0.0;
+	double sum_wall = 0.0;
+	int n_timed = 0;
+	int n_early = 0;
+	int n_failed = 0;
+	for (int i = 0; i < cases->n_cases; i++)
+	{
+		if (!results[i].finished)
+		{
+			n_failed += results[i].exit_code != 0;
+			continue;
+		}
+		const double w = results[i].wall_time;
+		min_wall = (n_timed == 0 || w < min_wall) ? w : min_wall;
+		max_wall = (n_timed == 0 || w > max_wall) ? w : max_wall;
+		sum_wall += w;
+		n_timed++;
+		n_early += results[i].stopped_early;
+	}
+	log_message("Sweep: %d/%d cases on %d workers in %.3f s (%.2f cases/s)\n", n_done, cases->n_cases, workers, total_wall, total_wall > 0.0 ? n_done / total_wall : 0.0);
+	if (n_timed > 0)
+	{
+		log_message("Sweep: per-case wall time min %.3f s, mean %.3f s, max %.3f s; %d stopped early, %d failed\n", min_wall, sum_wall / n_timed, max_wall, n_early, n_failed);
+	}
+}
+
+#ifndef _WIN32
+/**
+ * @brief Builds the case list, resolves the reported channels and maps the shared result storage.
+ *
+ * Reads `sweep_grid` / `sweep_samples_file`, `sweep_workers` and `sweep_output_channels`
+ * as described for `run_sweep()`.
+ *
+ * @param[out] run  Receives the sweep state; release with `release_sweep_run()`.
+ * @return          0 on success, -1 (after logging) on a malformed sweep or allocation failure.
+ */
+int prepare_sweep_run(const param_array_t *dynamic_data, const param_array_t *fixed_data, const char **default_channels, const int n_default_channels, sweep_run_t *run)
+{
+	memset(run, 0, sizeof(*run));
+	if (build_sweep_cases(fixed_data, &run->cases) != 0)
+	{
+		return -1;
+	}
+
+	run->n_channels = parse_delimited_list(get_param_string_or_default(fixed_data, "sweep_output_channels", NULL), &run->channels);
+	if (run->n_channels <= 0)
+	{
+		run->n_channels = 0;
+		run->channels = (char **)calloc(n_default_channels > 0 ? (size_t)n_default_channels : 1, sizeof(char *));
+		for (int c = 0; run->channels && c < n_default_channels; c++)
+		{
+			run->channels[c] = duplicate_string(default_channels[c], strlen(default_channels[c]));
+			run->n_channels += run->channels[c] != NULL;
+		}
+	}
+	run->channel_handles = calloc(run->n_channels > 0 ? (size_t)run->n_channels : 1, sizeof(param_handle_t));
+	for (int c = 0; run->channel_handles && c < run->n_channels; c++)
+	{
+		run->channel_handles[c] = get_param_handle(dynamic_data, run->channels[c]);
+		if (run->channel_handles[c] == PARAM_HANDLE_INVALID)
+		{
+			log_message("Sweep: output channel '%s' is not a dynamic parameter, reporting NaN\n", run->channels[c]);
+		}
+	}
+	run->time_handle = get_param_handle(dynamic_data, "time_sec");
+	run->dur_sec = get_param_double_or_default(fixed_data, "dur_sec", 0.0);
+
+	int workers = get_param_int_or_default(fixed_data, "sweep_workers", 0);
+	if (workers <= 0)
+	{
+		workers = get_num_cores();
+	}
+	run->workers = workers < 1 ? 1 : (workers > run->cases.n_cases ? run->cases.n_cases : workers);
+
+	// Results live in an anonymous shared mapping so workers can fill them in before exiting.
+	const size_t results_bytes = (size_t)run->cases.n_cases * sizeof(sweep_case_result_t);
+	const size_t values_bytes = (size_t)run->cases.n_cases * (size_t)(run->n_channels > 0 ? run->n_channels : 1) * sizeof(double);
+	void *shared = mmap(NULL, results_bytes + values_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED || !run->channel_handles)
+	{
+		ERROR_MESSAGE("Sweep: failed to allocate state for %d cases\n", run->cases.n_cases);
+		if (shared != MAP_FAILED)
+		{
+			munmap(shared, results_bytes + values_bytes);
+		}
+		release_sweep_run(run);
+		return -1;
+	}
+	run->shared_bytes = results_bytes + values_bytes;
+	run->results = (sweep_case_result_t *)shared;
+	run->values = (double *)((unsigned char *)shared + results_bytes);
+	return 0;
+}
+
+/**
+ * @brief Runs cases `first_case` to `first_case + n_cases - 1` on the local pool of forked workers.
+ *
+ * Up to `run->workers` cases run at a time, and an idle worker slot immediately takes the
+ * next case, so cases that stop early (`shutdownFlag`) free their slot for the remaining
+ * ones. Each worker writes its result and final channel values into the shared storage.
+ *
+ * @return Number of cases that finished or failed; the rest were not started because of `shutdownFlag`.
+ */
+int run_sweep_range(sweep_run_t *run, const param_array_t *dynamic_data, const param_array_t *fixed_data, const sweep_case_fn run_case, void *user_data, const int first_case, const int n_cases)
+{
+	const int end_case = first_case + n_cases;
+	const int workers = run->workers < n_cases ? run->workers : n_cases;
+	pid_t *slot_pid = calloc(workers > 0 ? (size_t)workers : 1, sizeof(pid_t));
+	int *slot_case = calloc(workers > 0 ? (size_t)workers : 1, sizeof(int));
+	if (!slot_pid || !slot_case)
+	{
+		ERROR_MESSAGE("Sweep: failed to allocate %d worker slots\n", workers);
+		free(slot_pid);
+		free(slot_case);
+		return 0;
+	}
+
+	sweep_case_result_t *results = run->results;
+	int next_case = first_case;
+	int n_running = 0;
+	int n_done = 0;
+	while (next_case < end_case || n_running > 0)
+	{
+		// Hand the next case to every idle slot.
+		for (int w = 0; w < workers && next_case < end_case && !shutdownFlag; w++)
+		{
+			if (slot_pid[w] > 0)
+			{
+				continue;
+			}
+			const int case_index = next_case++;
+			memset(&results[case_index], 0, sizeof(results[case_index]));
+			fflush(NULL); // keep buffered parent output from being written twice
+			const pid_t pid = fork();
+			if (pid == 0)
+			{
+				if (apply_sweep_case(dynamic_data, fixed_data, &run->cases, case_index) != 0)
+				{
+					_exit(SWEEP_EXIT_OVERRIDE_FAILED);
+				}
+				const struct timespec case_start = get_monotonic_timestamp();
+				run_case(dynamic_data, fixed_data, user_data);
+				sweep_case_result_t *result = &results[case_index];
+				result->wall_time = timespec_diff_to_double(case_start, get_monotonic_timestamp());
+				const input_param_t *time_param = param_from_handle(dynamic_data, run->time_handle);
+				result->end_time = time_param ? time_param->value.d : 0.0;
+				result->stopped_early = result->end_time < run->dur_sec;
+				for (int c = 0; c < run->n_channels; c++)
+				{
+					const input_param_t *param = param_from_handle(dynamic_data, run->channel_handles[c]);
+					double value = NAN;
+					if (param && param->type == INPUT_PARAM_DOUBLE)
+					{
+						value = param->value.d;
+					}
+					else if (param && param->type == INPUT_PARAM_INT)
+					{
+						value = param->value.i;
+					}
+					run->values[((size_t)case_index * run->n_channels) + c] = value;
+				}
+				result->finished = 1;
+				fflush(NULL);
+				_exit(0);
+			}
+			if (pid < 0)
+			{
+				ERROR_MESSAGE("Sweep: fork failed for case %d\n", case_index);
+				results[case_index].exit_code = -1;
+				n_done++;
+				continue;
+			}
+			slot_pid[w] = pid;
+			slot_case[w] = case_index;
+			n_running++;
+		}
+		if (shutdownFlag && next_case < end_case)
+		{
+			log_message("Sweep: shutdown requested, %d cases not started\n", end_case - next_case);
+			next_case = end_case;
+		}
+
+		// Reap finished workers.
+		bool reaped = false;
+		for (int w = 0; w < workers; w++)
+		{
+			if (slot_pid[w] <= 0)
+			{
+				continue;
+			}
+			const int status = check_duplicate_status_of_child(slot_pid[w]);
+			if (status == CHILD_STILL_RUNNING)
+			{
+				continue;
+			}
+			const int case_index = slot_case[w];
+			results[case_index].exit_code = status;
+			if (status != 0 || !results[case_index].finished)
+			{
+				ERROR_MESSAGE("Sweep: case %d failed (status %d)\n", case_index, status);
+			}
+			else
+			{
+				log_message("Sweep: case %d done in %.3f s%s\n", case_index, results[case_index].wall_time, results[case_index].stopped_early ? " (stopped early)" : "");
+			}
+			slot_pid[w] = 0;
+			n_running--;
+			n_done++;
+			reaped = true;
+		}
+		if (!reaped && n_running > 0)
+		{
+			usleep_now(SWEEP_POLL_SLEEP_US);
+		}
+	}
+
+	free(slot_pid);
+	free(slot_case);
+	return n_done;
+}
+
+/**
+ * @brief Logs throughput and per-case wall times, then writes `sweep_results_file` (default
+ * `sweep_results.csv`) to `OUTPUT_LOG_FILE_PATH`.
+ *
+ * @param workers  Concurrent workers the cases ran on, for the summary line.
+ * @return         Number of cases that completed.
+ */
+int report_sweep_run(const sweep_run_t *run, const param_array_t *fixed_data, const int n_done, const int workers, const double total_wall)
+{
+	log_sweep_summary(&run->cases, run->results, n_done, workers, total_wall);
+
+	const char *results_name = get_param_string_or_default(fixed_data, "sweep_results_file", "sweep_results.csv");
+	char results_filename[PATH_MAX];
+	create_dynamic_file_path(results_filename, PATH_MAX, "%s/%s", OUTPUT_LOG_FILE_PATH, results_name);
+	save_sweep_results(results_filename, &run->cases, run->results, run->values, run->channels, run->n_channels);
+
+	int n_completed = 0;
+	for (int i = 0; i < run->cases.n_cases; i++)
+	{
+		n_completed += run->results[i].finished && run->results[i].exit_code == 0;
+	}
+	return n_completed;
+}
+
+/**
+ * @brief Releases everything `prepare_sweep_run()` set up.
+ */
+void release_sweep_run(sweep_run_t *run)
+{
+	if (run->results)
+	{
+		munmap(run->results, run->shared_bytes);
+	}
+	free(run->channel_handles);
+	free_delimited_list(run->channels, run->n_channels);
+	free_sweep_cases(&run->cases);
+	memset(run, 0, sizeof(*run));
+}
+#endif
+
+/**
+ * @brief Runs every case of the configured sweep on a pool of worker processes, or across nodes.
+ *
+ * The flow series and configuration are loaded once by the caller; each case is then run in
+ * a worker forked from that state, so no case re-execs the binary or re-reads the config.
+ * Up to `sweep_workers` (default `get_num_cores()`) cases run at a time, and an idle worker
+ * slot immediately takes the next case from the shared queue. Cases that stop early
+ * (`shutdownFlag`) therefore free their slot for the remaining cases instead of leaving a
+ * statically assigned share idle.
+ *
+ * With `sweep_role` set to `coordinator` or `worker`, the case list is split into shards that
+ * worker nodes pull from a coordinator over TCP instead (see `run_sweep_coordinator()`); each
+ * worker node runs its shards on its own local pool.
+ *
+ * Optional fixed parameters:
+ * - `sweep_grid` / `sweep_samples_file`: case definition, see `build_sweep_cases()`.
+ * - `sweep_workers`: concurrent cases (0 = number of cores).
+ * - `sweep_output_channels`: dynamic channels whose final values are reported (default: the
+ *   `default_channels` given by the caller).
+ * - `sweep_results_file`: results CSV in `OUTPUT_LOG_FILE_PATH` (default `sweep_results.csv`).
+ * - `sweep_role`: `local` (default), `coordinator` or `worker`.
+ *
+ * Throughput (cases/s) and the min/mean/max per-case wall time are logged at the end.
+ *
+ * @param dynamic_data        Dynamic parameters; cases start from their current values.
+ * @param fixed_data          Fixed parameters.
+ * @param run_case            Runs one case in a worker.
+ * @param user_data           Passed through to `run_case`.
+ * @param default_channels    Channels reported when `sweep_output_channels` is not set.
+ * @param n_default_channels  Number of entries in `default_channels`.
+ * @return                    Number of cases that completed, or -1 if the sweep could not start.
+ */
+int run_sweep(const param_array_t *dynamic_data, const param_array_t *fixed_data, const sweep_case_fn run_case, void *user_data, const char **default_channels, const int n_default_channels)
+{
+#ifdef _WIN32
+	(void)dynamic_data;
+	(void)run_case;
+	(void)user_data;
+	(void)default_channels;
+	(void)n_default_channels;
+	ERROR_MESSAGE("Sweep: the built-in sweep scheduler needs fork() and is not available on Windows\n");
+	shutdownFlag = 1;
+	return -1;
+#else
+	if (strcmp(get_param_string_or_default(fixed_data, "flow_function_call", ""), "stream_interp_flow_gen") == 0)
+	{
+		ERROR_MESSAGE("Sweep: stream_interp_flow_gen keeps a prefetch thread that forked workers do not inherit; use a fixed interp flow_gen\n");
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	const char *role = get_param_string_or_default(fixed_data, "sweep_role", "local");
+	if (strcmp(role, "local") != 0 && strcmp(role, "coordinator") != 0 && strcmp(role, "worker") != 0)
+	{
+		ERROR_MESSAGE("Sweep: unknown sweep_role '%s', expected local, coordinator or worker\n", role);
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	sweep_run_t run;
+	if (prepare_sweep_run(dynamic_data, fixed_data, default_channels, n_default_channels, &run) != 0)
+	{
+		shutdownFlag = 1;
+		return -1;
+	}
+
+	int n_completed = 0;
+	if (strcmp(role, "coordinator") == 0)
+	{
+		n_completed = run_sweep_coordinator(&run, fixed_data);
+	}
+	else if (strcmp(role, "worker") == 0)
+	{
+		n_completed = run_sweep_worker(&run, dynamic_data, fixed_data, run_case, user_data);
+	}
+	else
+	{
+		log_message("Sweep: %d cases over %d parameters on %d workers\n", run.cases.n_cases, run.cases.n_axes, run.workers);
+		const struct timespec sweep_start = get_monotonic_timestamp();
+		const int n_done = run_sweep_range(&run, dynamic_data, fixed_data, run_case, user_data, 0, run.cases.n_cases);
+		n_completed = report_sweep_run(&run, fixed_data, n_done, run.workers, timespec_diff_to_double(sweep_start, get_monotonic_timestamp()));
+	}
+
+	release_sweep_run(&run);
+	return n_completed;
+#endif
+}
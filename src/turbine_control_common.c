@@ -26,28 +26,82 @@
  */
 
 #include "turbine_controls.h" // for TURBINE_CONTROL_PARAM_LIST, kw2_turbin...
+#include "ensemble.h"         // for ensemble_channel
+#include "logger.h"           // for ERROR_MESSAGE
+#include "stage_context.h"    // for STAGE_STATE
 #include "xflow_aero_sim.h"   // for get_param
+#include "xflow_core.h"       // for shutdownFlag
 #include <stdbool.h>          // IWYU pragma: keep
 #include <stddef.h>           // for NULL
+#include <stdint.h>           // for uint64_t
 
-void kw2_turbine_control(TURBINE_CONTROL_PARAM_LIST)
+typedef struct
 {
-	static double *omega = NULL;
-	static double *tau_Flow_Extract = NULL;
-	static double *k = NULL;
+	double *omega;
+	double *tau_flow_extract;
+	double *k;
+} kw2_turbine_control_state_t;
 
-	static bool first_Run = false;
-	if (!first_Run)
+void kw2_turbine_control(TURBINE_CONTROL_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(kw2_turbine_control_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (first_run)
 	{
 		// initialize variables since this is the first time the function is running.
-		get_param(dynamic_data, "omega", &omega);
-		get_param(dynamic_data, "tau_flow_extract", &tau_Flow_Extract);
-		get_param(dynamic_data, "k", &k);
+		get_param(dynamic_data, "omega", &state->omega);
+		get_param(dynamic_data, "tau_flow_extract", &state->tau_flow_extract);
+		get_param(dynamic_data, "k", &state->k);
+
+		// log_message("omega before: %f\n", *state->omega);
+	}
+
+	*state->tau_flow_extract = (*state->k) * (*state->omega) * (*state->omega);
+}
 
-		// log_message("omega before: %f\n", *omega);
+typedef struct
+{
+	uint64_t ensemble_id; // ensemble the channels below were resolved in
+	const double *omega;
+	const double *k;
+	double *tau_flow_extract;
+} kw2_turbine_control_batch_state_t;
 
-		first_Run = true;
+/**
+ * @brief Batched `kw2_turbine_control` for the ensemble engine: τ_extract = k·ω² for every member.
+ */
+void kw2_turbine_control_batch(TURBINE_CONTROL_BATCH_PARAM_LIST)
+{
+	bool first_run = false;
+	STAGE_STATE(kw2_turbine_control_batch_state_t, state, first_run);
+	if (!state)
+	{
+		return;
+	}
+	if (state->ensemble_id != ensemble->id)
+	{
+		state->omega = ensemble_channel(ensemble, "omega");
+		state->k = ensemble_channel(ensemble, "k");
+		state->tau_flow_extract = ensemble_channel(ensemble, "tau_flow_extract");
+		if (!state->omega || !state->k || !state->tau_flow_extract)
+		{
+			ERROR_MESSAGE("kw2_turbine_control_batch(): omega, k or tau_flow_extract not found\n");
+			shutdownFlag = 1;
+			return;
+		}
+		state->ensemble_id = ensemble->id;
 	}
 
-	*tau_Flow_Extract = (*k) * (*omega) * (*omega);
+	const double *restrict omega = state->omega;
+	const double *restrict k = state->k;
+	double *restrict tau_flow_extract = state->tau_flow_extract;
+	const int n = ensemble->n_members;
+	for (int m = 0; m < n; ++m)
+	{
+		tau_flow_extract[m] = k[m] * omega[m] * omega[m];
+	}
 }
@@ -0,0 +1,436 @@
+/**
+ * @file    xfe_control_sim_bench.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Micro-benchmarks of the integrators, the CSV logger and flow start-up, written as JSON, plus a stiff-turbine check of SDIRK2
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "drivetrains.h"            // for drivetrainMap, register_drivetrain
+#include "equation_of_motion.h"     // for eomMap, register_eom
+#include "flow_gen.h"               // for flowMap
+#include "flow_sim_model.h"         // for flowSimModelMap, register_flow_sim_model
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "make_stage.h"             // for DEFINE_STAGE_DISPATCHER, DISPATCH_STAGE_OR_ERROR
+#include "numerical_integrator.h"   // for numericalIntegratorMap, create_numerical_integrator_workspace
+#include "param_index.h"            // for build_param_index, get_param_handle, param_from_handle
+#include "stage_context.h"          // for reset_stage_context
+#include "turbine_controls.h"       // for turbineControlMap, register_turbine_control
+#include "xfe_control_sim_common.h" // for dynamic_data_csv_logger, get_num_cores
+#include "xfe_control_sim_version.h"
+#include "xflow_aero_sim.h" // for create_input_data, read_csv_and_store, get_param
+#include "xflow_core.h"     // for get_monotonic_timestamp, timespec_diff_to_double, shutdownFlag
+#include <math.h>           // for fabs, isfinite
+#include <stdbool.h>        // IWYU pragma: keep
+#include <stdio.h>          // for FILE, fclose, remove
+#include <stdlib.h>         // for free, strtol
+#include <string.h>         // for strcmp, strlen
+#include <sys/stat.h>       // for stat
+#include <time.h>           // for time, timespec
+
+#ifdef _WIN32
+#include <windows.h> // for MAX_PATH
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif
+#else
+#include <limits.h> // for PATH_MAX
+#endif
+
+#define BENCH_DEFAULT_STEPS 200000
+#define BENCH_WARMUP_STEPS 1000
+#define BENCH_DEFAULT_LOG_ROWS 100000
+#define BENCH_SCHEMA "xfe_control_sim_bench/1"
+
+// stiff turbine: a light rotor held by a constant extraction torque at the speed where it equals
+// the aero torque; the aero damping then gives an eigenvalue near -285 1/s, so lambda * dt ~ -14
+#define BENCH_STIFF_INERTIA 0.1
+#define BENCH_STIFF_FLOW_SPEED 10.0
+#define BENCH_STIFF_OMEGA_EQ 15.0
+#define BENCH_STIFF_OMEGA_START 10.0
+#define BENCH_STIFF_STEPS 2000
+#define BENCH_STIFF_TOLERANCE 0.01
+
+// bundled configurations; together they select every entry of eomMap
+static const char *const benchConfigFiles[] = {
+	"simple_ball_config.csv",
+	"simple_turbine_config.csv",
+};
+
+/**
+ * @brief A flow generator and the bundled flow file it is started on.
+ */
+typedef struct
+{
+	const char *generator;
+	const char *flow_file;
+} bench_flow_case_t;
+
+static const bench_flow_case_t benchFlowCases[] = {
+	{"csv_fixed_interp_flow_gen", "turb_train_data_10_Hz_01.csv"},
+	{"bts_fixed_interp_flow_gen", "demo_wind_file.bts"          },
+};
+
+DEFINE_STAGE_DISPATCHER(eom, eomMap)
+DEFINE_STAGE_DISPATCHER(drivetrain, drivetrainMap)
+DEFINE_STAGE_DISPATCHER(flow_sim_model, flowSimModelMap)
+DEFINE_STAGE_DISPATCHER(turbine_control, turbineControlMap)
+
+/**
+ * @brief Reads one bundled configuration into fresh parameter arrays and wires its stages.
+ *
+ * @return 0 on success, -1 (with `shutdownFlag` set) when the file could not be loaded.
+ */
+static int load_bench_config(const char *config_file, param_array_t **dynamic_data, param_array_t **fixed_data)
+{
+	char config_path[PATH_MAX];
+	create_dynamic_file_path(config_path, PATH_MAX, "%s/%s", BENCH_CONFIG_DIR, config_file);
+
+	*dynamic_data = create_input_data(1);
+	*fixed_data = create_input_data(1);
+	set_int_param(*dynamic_data, 0, "initialize", 1);
+	set_int_param(*fixed_data, 0, "initialize", 1);
+	read_csv_and_store(config_path, *dynamic_data, *fixed_data);
+	build_param_index(*dynamic_data);
+	build_param_index(*fixed_data);
+	if (shutdownFlag)
+	{
+		ERROR_MESSAGE("Bench: failed to load %s\n", config_path);
+		return -1;
+	}
+
+	const char *eom_Function_Call = NULL;
+	const char *drivetrain_Function_Call = NULL;
+	const char *flow_Sim_Model_Function_Call = NULL;
+	const char *turbine_Control_Function_Call = NULL;
+	get_param(*fixed_data, "eom_function_call", &eom_Function_Call);
+	get_param(*fixed_data, "drivetrain_function_call", &drivetrain_Function_Call);
+	get_param(*fixed_data, "flow_sim_model_function_call", &flow_Sim_Model_Function_Call);
+	get_param(*fixed_data, "turbine_control_function_call", &turbine_Control_Function_Call);
+	DISPATCH_STAGE_OR_ERROR(eom, eomMap, eom_Function_Call);
+	DISPATCH_STAGE_OR_ERROR(drivetrain, drivetrainMap, drivetrain_Function_Call);
+	DISPATCH_STAGE_OR_ERROR(flow_sim_model, flowSimModelMap, flow_Sim_Model_Function_Call);
+	DISPATCH_STAGE_OR_ERROR(turbine_control, turbineControlMap, turbine_Control_Function_Call);
+	return shutdownFlag ? -1 : 0;
+}
+
+/**
+ * @brief Releases the stage state bound to a configuration and frees its arrays.
+ */
+static void free_bench_config(param_array_t *dynamic_data, param_array_t *fixed_data)
+{
+	reset_stage_context(NULL);
+	invalidate_param_index(dynamic_data);
+	invalidate_param_index(fixed_data);
+	free_input_data(dynamic_data);
+	free_input_data(fixed_data);
+}
+
+/**
+ * @brief Integrates `n_steps` fixed steps with every integrator on every bundled configuration.
+ */
+static void bench_integrators(FILE *json, const long n_steps)
+{
+	safe_fprintf(json, "  \"integrators\": [");
+	bool first_entry = true;
+	const size_t n_configs = sizeof(benchConfigFiles) / sizeof(benchConfigFiles[0]);
+	const size_t n_integrators = sizeof(numericalIntegratorMap) / sizeof(numericalIntegratorMap[0]);
+	for (size_t c = 0; c < n_configs && !shutdownFlag; c++)
+	{
+		for (size_t i = 0; i < n_integrators && !shutdownFlag; i++)
+		{
+			// fresh arrays per integrator, so every run starts from the configured initial state.
+			param_array_t *dynamic_data = NULL;
+			param_array_t *fixed_data = NULL;
+			if (load_bench_config(benchConfigFiles[c], &dynamic_data, &fixed_data) != 0)
+			{
+				break; // shutdownFlag ends the outer loop too, the array is still closed below
+			}
+			double **state_vars = NULL;
+			const char **state_names = NULL;
+			const int n_state_var = init_state_bindings(dynamic_data, &state_vars, &state_names);
+			numerical_integrator_workspace_t *workspace = create_numerical_integrator_workspace(n_state_var);
+			const double dt = get_param_double_or_default(fixed_data, "dt_sec", 0.05);
+			const numerical_integrator_fn integrate = numericalIntegratorMap[i].fn;
+
+			for (long step = 0; step < BENCH_WARMUP_STEPS && !shutdownFlag; step++)
+			{
+				integrate(state_vars, state_names, n_state_var, dt, dynamic_data, fixed_data, workspace);
+			}
+			const struct timespec start = get_monotonic_timestamp();
+			for (long step = 0; step < n_steps && !shutdownFlag; step++)
+			{
+				integrate(state_vars, state_names, n_state_var, dt, dynamic_data, fixed_data, workspace);
+			}
+			const double seconds = timespec_diff_to_double(start, get_monotonic_timestamp());
+
+			const char *eom_id = get_param_string_or_default(fixed_data, "eom_function_call", "unknown");
+			log_message("Bench: %s + %s: %.0f steps/s\n", eom_id, numericalIntegratorMap[i].id, seconds > 0.0 ? (double)n_steps / seconds : 0.0);
+			safe_fprintf(json, "%s\n    {\"eom\": \"%s\", \"integrator\": \"%s\", \"state_vars\": %d, \"dt_sec\": %g, \"steps\": %ld, \"seconds\": %.6f, \"steps_per_sec\": %.1f}",
+			             first_entry ? "" : ",", eom_id, numericalIntegratorMap[i].id, n_state_var, dt, n_steps, seconds, seconds > 0.0 ? (double)n_steps / seconds : 0.0);
+			first_entry = false;
+
+			free_numerical_integrator_workspace(workspace);
+			free((void *)state_vars);
+			free((void *)state_names);
+			free_bench_config(dynamic_data, fixed_data);
+		}
+	}
+	safe_fprintf(json, "\n  ],\n");
+}
+
+/**
+ * @brief Writes `n_rows` rows of the turbine configuration's dynamic data through `dynamic_data_csv_logger()`.
+ */
+static void bench_csv_logger(FILE *json, const long n_rows)
+{
+	param_array_t *dynamic_data = NULL;
+	param_array_t *fixed_data = NULL;
+	if (load_bench_config("simple_turbine_config.csv", &dynamic_data, &fixed_data) != 0)
+	{
+		return;
+	}
+
+	char log_path[PATH_MAX];
+	create_dynamic_file_path(log_path, PATH_MAX, "%s/bench_dynamic_data.csv", OUTPUT_LOG_FILE_PATH);
+	FILE *log_file = NULL;
+	dynamic_data_csv_logger(&log_file, CSV_LOGGER_INIT, log_path, dynamic_data);
+	const struct timespec start = get_monotonic_timestamp();
+	for (long row = 0; row < n_rows && log_file; row++)
+	{
+		dynamic_data_csv_logger(&log_file, CSV_LOGGER_LOG, log_path, dynamic_data);
+	}
+	dynamic_data_csv_logger(&log_file, CSV_LOGGER_CLOSE, log_path, dynamic_data);
+	const double seconds = timespec_diff_to_double(start, get_monotonic_timestamp());
+
+	struct stat file_stat;
+	const long long bytes = stat(log_path, &file_stat) == 0 ? (long long)file_stat.st_size : 0;
+	remove(log_path);
+
+	const double rows_per_sec = seconds > 0.0 ? (double)n_rows / seconds : 0.0;
+	const double mb_per_sec = seconds > 0.0 ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0;
+	log_message("Bench: dynamic_data_csv_logger: %.0f rows/s, %.1f MB/s\n", rows_per_sec, mb_per_sec);
+	safe_fprintf(json, "  \"csv_logger\": {\"columns\": %d, \"rows\": %ld, \"bytes\": %lld, \"seconds\": %.6f, \"rows_per_sec\": %.1f, \"mb_per_sec\": %.3f},\n",
+	             dynamic_data->n_param, n_rows, bytes, seconds, rows_per_sec, mb_per_sec);
+
+	free_bench_config(dynamic_data, fixed_data);
+}
+
+/**
+ * @brief Steps the stiff turbine with `integrate` and returns the final rotor speed.
+ *
+ * @return The rotor speed after `BENCH_STIFF_STEPS` steps, NAN when the configuration could not be loaded.
+ */
+static double run_stiff_turbine(const numerical_integrator_fn integrate, double *dt)
+{
+	param_array_t *dynamic_data = NULL;
+	param_array_t *fixed_data = NULL;
+	if (load_bench_config("simple_turbine_config.csv", &dynamic_data, &fixed_data) != 0)
+	{
+		return NAN;
+	}
+
+	double *omega = NULL;
+	double *flow_speed = NULL;
+	double *moment_of_inertia = NULL;
+	double *tau_flow = NULL;
+	double *tau_flow_extract = NULL;
+	get_param(dynamic_data, "omega", &omega);
+	get_param(dynamic_data, "flow_speed", &flow_speed);
+	get_param(dynamic_data, "moment_of_inertia", &moment_of_inertia);
+	get_param(dynamic_data, "tau_flow", &tau_flow);
+	get_param(dynamic_data, "tau_flow_extract", &tau_flow_extract);
+	*flow_speed = BENCH_STIFF_FLOW_SPEED;
+	*moment_of_inertia = BENCH_STIFF_INERTIA;
+
+	// hold the rotor at BENCH_STIFF_OMEGA_EQ by extracting exactly the aero torque there.
+	*omega = BENCH_STIFF_OMEGA_EQ;
+	flow_sim_model(dynamic_data, fixed_data);
+	*tau_flow_extract = *tau_flow;
+	*omega = BENCH_STIFF_OMEGA_START;
+
+	double **state_vars = NULL;
+	const char **state_names = NULL;
+	const int n_state_var = init_state_bindings(dynamic_data, &state_vars, &state_names);
+	numerical_integrator_workspace_t *workspace = create_numerical_integrator_workspace(n_state_var);
+	*dt = get_param_double_or_default(fixed_data, "dt_sec", 0.05);
+	for (long step = 0; step < BENCH_STIFF_STEPS && !shutdownFlag && isfinite(*omega); step++)
+	{
+		integrate(state_vars, state_names, n_state_var, *dt, dynamic_data, fixed_data, workspace);
+	}
+	const double final_omega = *omega;
+
+	free_numerical_integrator_workspace(workspace);
+	free((void *)state_vars);
+	free((void *)state_names);
+	free_bench_config(dynamic_data, fixed_data);
+	return final_omega;
+}
+
+/**
+ * @brief Runs RK4 and SDIRK2 on the stiff turbine at the configured `dt_sec`.
+ *
+ * RK4 is expected to diverge there, which is only reported. SDIRK2 has to settle on the
+ * equilibrium speed; if it does not, the bench fails through `shutdownFlag`.
+ */
+static void bench_stiff_turbine(FILE *json)
+{
+	static const char *const integrators[] = {"rk4_numerical_integrator", "sdirk2_numerical_integrator"};
+	const numerical_integrator_fn fns[] = {rk4_numerical_integrator, sdirk2_numerical_integrator};
+
+	safe_fprintf(json, "  \"stiff_turbine\": [");
+	for (size_t i = 0; i < sizeof(fns) / sizeof(fns[0]) && !shutdownFlag; i++)
+	{
+		double dt = 0.0;
+		const double final_omega = run_stiff_turbine(fns[i], &dt);
+		const bool stable = isfinite(final_omega) && fabs(final_omega - BENCH_STIFF_OMEGA_EQ) < BENCH_STIFF_TOLERANCE * BENCH_STIFF_OMEGA_EQ;
+		log_message("Bench: stiff turbine + %s at dt %g: omega %g, %s\n", integrators[i], dt, final_omega, stable ? "stable" : "diverged");
+		safe_fprintf(json, "%s\n    {\"integrator\": \"%s\", \"moment_of_inertia\": %g, \"dt_sec\": %g, \"steps\": %d, \"final_omega\": %g, \"stable\": %s}",
+		             i == 0 ? "" : ",", integrators[i], BENCH_STIFF_INERTIA, dt, BENCH_STIFF_STEPS, isfinite(final_omega) ? final_omega : 0.0, stable ? "true" : "false");
+		if (fns[i] == sdirk2_numerical_integrator && !stable)
+		{
+			ERROR_MESSAGE("Bench: SDIRK2 did not stay on the stiff turbine equilibrium (omega %g)\n", final_omega);
+			shutdownFlag = 1;
+		}
+	}
+	safe_fprintf(json, "\n  ],\n");
+}
+
+/**
+ * @brief Time of one first call of `generator`, i.e. loading and interpolating its flow file.
+ */
+static double time_flow_gen_startup(const flow_gen_fn generator, const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	reset_stage_context(NULL); // drop the series loaded by the previous call
+	const struct timespec start = get_monotonic_timestamp();
+	generator(dynamic_data, fixed_data);
+	return timespec_diff_to_double(start, get_monotonic_timestamp());
+}
+
+/**
+ * @brief Start-up time of the fixed-interpolation flow generators, parsing and from the flow cache.
+ */
+static void bench_flow_gen_startup(FILE *json)
+{
+	safe_fprintf(json, "  \"flow_gen_startup\": [");
+	const size_t n_cases = sizeof(benchFlowCases) / sizeof(benchFlowCases[0]);
+	const size_t n_flows = sizeof(flowMap) / sizeof(flowMap[0]);
+	for (size_t f = 0; f < n_cases && !shutdownFlag; f++)
+	{
+		flow_gen_fn generator = NULL;
+		for (size_t m = 0; m < n_flows; m++)
+		{
+			if (strcmp(flowMap[m].id, benchFlowCases[f].generator) == 0)
+			{
+				generator = flowMap[m].fn;
+			}
+		}
+		param_array_t *dynamic_data = NULL;
+		param_array_t *fixed_data = NULL;
+		if (generator == NULL || load_bench_config("simple_turbine_config.csv", &dynamic_data, &fixed_data) != 0)
+		{
+			ERROR_MESSAGE("Bench: cannot run %s\n", benchFlowCases[f].generator);
+			shutdownFlag = 1;
+			break;
+		}
+
+		// the generators only load their file in a first or single run.
+		int *single_run_only = NULL;
+		int *flow_cache_enable = NULL;
+		get_param(fixed_data, "data_processing_single_run_only", &single_run_only);
+		get_param(fixed_data, "flow_cache_enable", &flow_cache_enable);
+		*single_run_only = 1;
+
+		input_param_t *flow_file = param_from_handle(fixed_data, get_param_handle(fixed_data, "flow_gen_file_location_and_or_name"));
+		char *configured_flow_file = flow_file->value.s;
+		flow_file->value.s = (char *)benchFlowCases[f].flow_file;
+
+		*flow_cache_enable = 0;
+		const double parse_sec = time_flow_gen_startup(generator, dynamic_data, fixed_data);
+		*flow_cache_enable = 1;
+		time_flow_gen_startup(generator, dynamic_data, fixed_data); // make sure the cache entry exists
+		const double cache_hit_sec = time_flow_gen_startup(generator, dynamic_data, fixed_data);
+
+		log_message("Bench: %s on %s: %.2f ms parsing, %.2f ms from cache\n", benchFlowCases[f].generator, benchFlowCases[f].flow_file, parse_sec * 1e3, cache_hit_sec * 1e3);
+		safe_fprintf(json, "%s\n    {\"generator\": \"%s\", \"flow_file\": \"%s\", \"parse_ms\": %.3f, \"cache_hit_ms\": %.3f}",
+		             f == 0 ? "" : ",", benchFlowCases[f].generator, benchFlowCases[f].flow_file, parse_sec * 1e3, cache_hit_sec * 1e3);
+
+		reset_stage_context(NULL);
+		flow_file->value.s = configured_flow_file;
+		free_bench_config(dynamic_data, fixed_data);
+	}
+	safe_fprintf(json, "\n  ]\n");
+}
+
+/**
+ * @brief Runs all benchmarks and writes the results as one JSON object.
+ *
+ * Usage: `xfe_control_sim_bench [--output results.json] [--steps N] [--log-rows N]`.
+ * The JSON goes to stdout when `--output` is not given.
+ */
+int main(const int argc, const char *argv[])
+{
+	const char *output_path = NULL;
+	long n_steps = BENCH_DEFAULT_STEPS;
+	long n_log_rows = BENCH_DEFAULT_LOG_ROWS;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			output_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+		{
+			n_steps = strtol(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--log-rows") == 0 && i + 1 < argc)
+		{
+			n_log_rows = strtol(argv[++i], NULL, 10);
+		}
+		else
+		{
+			ERROR_MESSAGE("Usage: %s [--output results.json] [--steps N] [--log-rows N]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	FILE *json = output_path ? xflow_fopen_safe(output_path, XFLOW_FILE_WRITE_ONLY) : stdout;
+	if (!json)
+	{
+		ERROR_MESSAGE("Bench: cannot open %s\n", output_path);
+		return EXIT_FAILURE;
+	}
+
+	safe_fprintf(json, "{\n  \"schema\": \"%s\",\n  \"git_commit\": \"%s\",\n  \"unix_time\": %lld,\n  \"cores\": %d,\n", BENCH_SCHEMA, gitCommitInfoXfeControlSim, (long long)time(NULL), get_num_cores());
+	bench_integrators(json, n_steps);
+	bench_csv_logger(json, n_log_rows);
+	bench_stiff_turbine(json);
+	bench_flow_gen_startup(json);
+	safe_fprintf(json, "}\n");
+
+	if (json != stdout)
+	{
+		fclose(json);
+		log_message("Bench results written to %s\n", output_path);
+	}
+	free_param_indices();
+	return shutdownFlag ? EXIT_FAILURE : EXIT_SUCCESS;
+}
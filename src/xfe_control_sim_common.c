@@ -32,8 +32,15 @@
 
 // NOLINTBEGIN(llvm-include-order)
 #include "xflow_file_socket.h"
+#include "async_logger.h"  // for async_logger_push, async_logger_start, async_logger_stop
+#include "binary_logger.h" // for dynamic_data_binary_logger, binary_log_path_from_csv
+#include "config_snapshot.h" // for load_config, set_config_override
+#include "flow_shmem.h"    // for flow_shmem_publish, flow_shmem_attach, flow_shmem_find_series
+#include "log_pyramid.h"  // for log_pyramid_open, log_pyramid_add_row, log_pyramid_close
 #include "logger.h"       // for safe_fprintf, log_message, safe_snprintf
 #include "maybe_unused.h" // for MAYBE_UNUSED
+#include "param_index.h"  // for get_param_handle, param_from_handle, build_param_index
+#include "result_shmem.h" // for result_shmem_create, result_shmem_write, result_shmem_save
 #include "xfe_control_sim_common.h"
 #include "xflow_aero_sim.h"  // for param_array_t, (anonymous struct)::(an...
 #include "xflow_core.h"      // for get_monotonic_timestamp, shutdownFlag
@@ -71,16 +78,27 @@
 
 // IWYU pragma: no_include <__stdarg_va_arg.h>
 
-#ifdef _WIN32
-static HANDLE gHMapFile = NULL; // Global handle to keep mapping alive
-#endif
-
 #ifndef DELETE_LOG_FILE_NEW_RUN
 #define DELETE_LOG_FILE_NEW_RUN 0
 #endif
 
 static FILE *dynamicDataCsvLoggerFile = NULL;
 
+#if defined(LOGGING_DYNAMIC_DATA_CONTINUOUS) && defined(DYNAMIC_DATA_FULL_PATH)
+typedef void (*dynamic_data_logger_fn)(FILE **file, const csv_logger_action_t action, const char *filename, const param_array_t *data);
+static dynamic_data_logger_fn dynamicDataLogger = dynamic_data_csv_logger; // backend picked by dynamic_data_logger_format
+static async_logger_row_writer_fn dynamicDataRowWriter = write_dynamic_data_csv_row;
+static char dynamicDataLoggerPath[PATH_MAX] = DYNAMIC_DATA_FULL_PATH;
+
+// Compact log plan: only the selected channels are copied into the view handed to the backend.
+static param_array_t dynamicDataLogView = {0, NULL};
+static int *dynamicDataLogIndex = NULL; // dynamic_data index of each view entry, NULL when logging every parameter
+static int dynamicDataLogDecimation = 1;
+static long dynamicDataLogStep = 0;
+
+static log_pyramid_t dynamicDataLogPyramid; // min/max companion of the log, file NULL when disabled
+#endif
+
 /**
  * @brief Exports time series of velocity components and magnitude at a given grid point to CSV files.
  *
@@ -549,14 +567,92 @@ static int write_csv_string_field(char *dest, size_t dest_size, const char *str)
 	return len;
 }
 
-void dynamic_data_csv_logger(FILE **file, const csv_logger_action_t action, const char *filename, const param_array_t *data)
+/**
+ * @brief Formats one dynamic data row as CSV text and appends it to `file`.
+ *
+ * Used by `dynamic_data_csv_logger` for synchronous logging and by the asynchronous logger
+ * thread, which passes the timestamp taken when the snapshot was captured.
+ *
+ * @param file  Open CSV file.
+ * @param ts    Timestamp written in the `epoch_time` column.
+ * @param data  Parameter values to write, in header order.
+ * @return      0 on success, -1 on a formatting or write error.
+ */
+int write_dynamic_data_csv_row(FILE *file, const struct timespec ts, const param_array_t *data)
 {
-	static char buf[1U << 22U];
 	static char line[4096];
-	static struct timespec total_Logger_Time = {0, 0};
-	struct timespec ts;
 	int len = 0;
 	size_t written = 0;
+
+	len = safe_snprintf(line, sizeof(line), TIME_FORMAT ".%.5ld", ts.tv_sec, ts.tv_nsec);
+	if (len < 0 || len >= (int)sizeof(line))
+	{
+		ERROR_MESSAGE("Timestamp formatting overflow\n");
+		return -1;
+	}
+	for (int i = 0; i < data->n_param; i++)
+	{
+		const input_param_t *param = &data->params[i];
+		switch (param->type)
+		{
+		case INPUT_PARAM_INT:
+			len += safe_snprintf(line + len, sizeof(line) - len, ",%d", param->value.i);
+			break;
+		case INPUT_PARAM_DOUBLE:
+			len += safe_snprintf(line + len, sizeof(line) - len, ",%.10f", param->value.d);
+			break;
+		case INPUT_PARAM_STRING: {
+			if (!param->value.s || !*param->value.s)
+			{
+				// Empty string - write empty quoted field
+				len += safe_snprintf(line + len, sizeof(line) - len, ",\"\"");
+			}
+			else
+			{
+				int added = write_csv_string_field(line + len, sizeof(line) - len, param->value.s);
+				if (added < 0)
+				{
+					ERROR_MESSAGE("Failed to write string field for %s\n", param->name);
+					// Make sure len reflects a full buffer to trigger the overflow check
+					len = sizeof(line);
+				}
+				else
+				{
+					len += added;
+				}
+			}
+		}
+		break;
+		default:
+			ERROR_MESSAGE("Unknown parameter type for %s\n", param->name);
+			break;
+		}
+		if (len < 0 || len >= (int)sizeof(line))
+		{
+			ERROR_MESSAGE("CSV line formatting overflow for param %s\n", param->name);
+			return -1; // FIX #2: Change 'break' to 'return' to prevent out-of-bounds write.
+		}
+	}
+	// This check ensures there's space for the newline character
+	if (len >= (int)sizeof(line) - 1)
+	{
+		ERROR_MESSAGE("CSV line buffer full, cannot add newline\n");
+		return -1;
+	}
+	line[len++] = '\n';
+	written = fwrite(line, 1, len, file);
+	if (written != (size_t)len)
+	{
+		ERROR_MESSAGE("Write error: %zu of %d\n", written, len);
+		return -1;
+	}
+	return 0;
+}
+
+void dynamic_data_csv_logger(FILE **file, const csv_logger_action_t action, const char *filename, const param_array_t *data)
+{
+	static char buf[1U << 22U];
+	static struct timespec total_Logger_Time = {0, 0};
 	struct timespec start_ts = get_monotonic_timestamp();
 	if (action == CSV_LOGGER_INIT)
 	{
@@ -599,68 +695,10 @@ void dynamic_data_csv_logger(FILE **file, const csv_logger_action_t action, cons
 			ERROR_MESSAGE("CSV logger not initialized\n");
 			return;
 		}
-		ts = get_monotonic_timestamp();
-		len = safe_snprintf(line, sizeof(line), TIME_FORMAT ".%.5ld", ts.tv_sec, ts.tv_nsec);
-		if (len < 0 || len >= (int)sizeof(line))
-		{
-			ERROR_MESSAGE("Timestamp formatting overflow\n");
-			return;
-		}
-		for (int i = 0; i < data->n_param; i++)
-		{
-			const input_param_t *param = &data->params[i];
-			switch (param->type)
-			{
-			case INPUT_PARAM_INT:
-				len += safe_snprintf(line + len, sizeof(line) - len, ",%d", param->value.i);
-				break;
-			case INPUT_PARAM_DOUBLE:
-				len += safe_snprintf(line + len, sizeof(line) - len, ",%.10f", param->value.d);
-				break;
-			case INPUT_PARAM_STRING: {
-				if (!param->value.s || !*param->value.s)
-				{
-					// Empty string - write empty quoted field
-					len += safe_snprintf(line + len, sizeof(line) - len, ",\"\"");
-				}
-				else
-				{
-					int added = write_csv_string_field(line + len, sizeof(line) - len, param->value.s);
-					if (added < 0)
-					{
-						ERROR_MESSAGE("Failed to write string field for %s\n", param->name);
-						// Make sure len reflects a full buffer to trigger the overflow check
-						len = sizeof(line);
-					}
-					else
-					{
-						len += added;
-					}
-				}
-			}
-			break;
-			default:
-				ERROR_MESSAGE("Unknown parameter type for %s\n", param->name);
-				break;
-			}
-			if (len < 0 || len >= (int)sizeof(line))
-			{
-				ERROR_MESSAGE("CSV line formatting overflow for param %s\n", param->name);
-				return; // FIX #2: Change 'break' to 'return' to prevent out-of-bounds write.
-			}
-		}
-		// This check ensures there's space for the newline character
-		if (len >= (int)sizeof(line) - 1)
+		if (write_dynamic_data_csv_row(*file, start_ts, data) != 0)
 		{
-			ERROR_MESSAGE("CSV line buffer full, cannot add newline\n");
 			return;
 		}
-		line[len++] = '\n';
-		written = fwrite(line, 1, len, *file);
-		if (written != (size_t)len)
-		{
-			ERROR_MESSAGE("Write error: %zu of %d\n", written, len);
-		}
 		struct timespec end_ts = get_monotonic_timestamp();
 		struct timespec delta = timespec_diff(start_ts, end_ts);
 		total_Logger_Time = timespec_add(total_Logger_Time, delta);
@@ -750,32 +788,178 @@ BOOL WINAPI DllMain(MAYBE_UNUSED HINSTANCE hinstDLL, DWORD fdwReason, MAYBE_UNUS
  */
 int get_param_value(const param_array_t *data, const char *name, input_param_type_t *type, void *value)
 {
-	for (int i = 0; i < data->n_param; i++)
+	const input_param_t *param = param_from_handle(data, get_param_handle(data, name));
+	if (param == NULL)
+	{
+		return -1; // Parameter not found
+	}
+
+	*type = param->type;
+	if (value != NULL) // Only retrieve the value if value is not NULL
 	{
-		if (strcmp(data->params[i].name, name) == 0)
+		switch (param->type)
 		{
-			*type = data->params[i].type;
-			if (value != NULL) // Only retrieve the value if value is not NULL
+		case INPUT_PARAM_INT:
+			*(int *)value = param->value.i;
+			break;
+		case INPUT_PARAM_DOUBLE:
+			*(double *)value = param->value.d;
+			break;
+		case INPUT_PARAM_STRING:
+			*(char **)value = param->value.s;
+			break;
+		default:
+			return -1; // Unknown parameter type
+		}
+	}
+	return 0; // Success
+}
+
+/**
+ * @brief Reads an optional numeric parameter, falling back to a default.
+ *
+ * Intended for configuration keys that older config CSVs may not contain. Integer
+ * parameters are promoted to double so either data type can be used in the CSV.
+ *
+ * @param data           Parameter array to search.
+ * @param name           Parameter name.
+ * @param default_value  Value returned if the parameter is missing or not numeric.
+ * @return The parameter value, or @p default_value.
+ */
+double get_param_double_or_default(const param_array_t *data, const char *name, const double default_value)
+{
+	const input_param_t *param = param_from_handle(data, get_param_handle(data, name));
+	if (param == NULL)
+	{
+		return default_value;
+	}
+
+	if (param->type == INPUT_PARAM_DOUBLE)
+	{
+		return param->value.d;
+	}
+	if (param->type == INPUT_PARAM_INT)
+	{
+		return (double)param->value.i;
+	}
+	return default_value;
+}
+
+/**
+ * @brief Reads an optional integer parameter, falling back to a default.
+ *
+ * @param data           Parameter array to search.
+ * @param name           Parameter name.
+ * @param default_value  Value returned if the parameter is missing or not an integer.
+ * @return The parameter value, or @p default_value.
+ */
+int get_param_int_or_default(const param_array_t *data, const char *name, const int default_value)
+{
+	const input_param_t *param = param_from_handle(data, get_param_handle(data, name));
+	if (param == NULL || param->type != INPUT_PARAM_INT)
+	{
+		return default_value;
+	}
+	return param->value.i;
+}
+
+/**
+ * @brief Reads an optional string parameter, falling back to a default.
+ *
+ * @param data           Parameter array to search.
+ * @param name           Parameter name.
+ * @param default_value  Value returned if the parameter is missing or not a string.
+ * @return Pointer to the stored string (owned by @p data), or @p default_value.
+ */
+const char *get_param_string_or_default(const param_array_t *data, const char *name, const char *default_value)
+{
+	const input_param_t *param = param_from_handle(data, get_param_handle(data, name));
+	if (param == NULL || param->type != INPUT_PARAM_STRING || param->value.s == NULL)
+	{
+		return default_value;
+	}
+	return param->value.s;
+}
+
+/**
+ * @brief Splits a config string such as "omega; tau_flow, k" into separate items.
+ *
+ * Items are separated by ';', ',' or whitespace; empty items are skipped. Each item
+ * is returned as its own heap-allocated string.
+ *
+ * @param text           String to split (NULL or empty yields zero items).
+ * @param[out] out_items Receives a heap-allocated array of heap-allocated strings, or NULL
+ *                       when there are no items. Release with `free_delimited_list()`.
+ * @return Number of items, or -1 on allocation failure.
+ */
+int parse_delimited_list(const char *text, char ***out_items)
+{
+	*out_items = NULL;
+	if (text == NULL)
+	{
+		return 0;
+	}
+
+	static const char delimiters[] = ";, \t\r\n";
+	int n_items = 0;
+	int capacity = 0;
+	char **items = NULL;
+
+	const char *cursor = text;
+	while (*cursor != '\0')
+	{
+		cursor += strspn(cursor, delimiters);
+		const size_t len = strcspn(cursor, delimiters);
+		if (len == 0)
+		{
+			break;
+		}
+
+		if (n_items == capacity)
+		{
+			capacity = capacity == 0 ? 8 : capacity * 2;
+			char **grown = (char **)realloc((void *)items, capacity * sizeof(char *));
+			if (grown == NULL)
 			{
-				switch (data->params[i].type)
-				{
-				case INPUT_PARAM_INT:
-					*(int *)value = data->params[i].value.i;
-					break;
-				case INPUT_PARAM_DOUBLE:
-					*(double *)value = data->params[i].value.d;
-					break;
-				case INPUT_PARAM_STRING:
-					*(char **)value = data->params[i].value.s;
-					break;
-				default:
-					return -1; // Unknown parameter type
-				}
+				free_delimited_list(items, n_items);
+				return -1;
 			}
-			return 0; // Success
+			items = grown;
+		}
+
+		items[n_items] = malloc(len + 1);
+		if (items[n_items] == NULL)
+		{
+			free_delimited_list(items, n_items);
+			return -1;
 		}
+		memcpy(items[n_items], cursor, len);
+		items[n_items][len] = '\0';
+		n_items++;
+		cursor += len;
+	}
+
+	*out_items = items;
+	return n_items;
+}
+
+/**
+ * @brief Frees a list returned by `parse_delimited_list()`.
+ *
+ * @param items    Array of strings (NULL is ignored).
+ * @param n_items  Number of strings in @p items.
+ */
+void free_delimited_list(char **items, const int n_items)
+{
+	if (items == NULL)
+	{
+		return;
+	}
+	for (int i = 0; i < n_items; i++)
+	{
+		free(items[i]);
 	}
-	return -1; // Parameter not found
+	free((void *)items);
 }
 
 /**
@@ -807,6 +991,252 @@ static bool is_dynamic_logging_enabled(const param_array_t *fixed_data)
 	return false;
 }
 
+#if defined(LOGGING_DYNAMIC_DATA_CONTINUOUS) && defined(DYNAMIC_DATA_FULL_PATH)
+/**
+ * @brief Chooses the continuous dynamic data logger backend from the configuration.
+ *
+ * Reads the optional fixed parameter `dynamic_data_logger_format`:
+ * - `csv` (default): text rows written by `dynamic_data_csv_logger` to `DYNAMIC_DATA_FULL_PATH`.
+ * - `binary`: fixed-width rows written by `dynamic_data_binary_logger` to the same path with
+ *   the `.xfelog` extension.
+ *
+ * @param fixed_data Pointer to the fixed data parameter array.
+ */
+static void select_dynamic_data_logger(const param_array_t *fixed_data)
+{
+	const char *format = get_param_string_or_default(fixed_data, "dynamic_data_logger_format", "csv");
+
+	if (strcmp(format, "binary") == 0)
+	{
+		dynamicDataLogger = dynamic_data_binary_logger;
+		dynamicDataRowWriter = write_dynamic_data_binary_row;
+		binary_log_path_from_csv(dynamicDataLoggerPath, sizeof(dynamicDataLoggerPath), DYNAMIC_DATA_FULL_PATH);
+		set_binary_logger_dt(get_param_double_or_default(fixed_data, "dt_sec", 0.0));
+		return;
+	}
+
+	if (strcmp(format, "csv") != 0)
+	{
+		ERROR_MESSAGE("Unknown dynamic_data_logger_format '%s', using csv\n", format);
+	}
+	dynamicDataLogger = dynamic_data_csv_logger;
+	dynamicDataRowWriter = write_dynamic_data_csv_row;
+	if (safe_snprintf(dynamicDataLoggerPath, sizeof(dynamicDataLoggerPath), "%s", DYNAMIC_DATA_FULL_PATH) < 0)
+	{
+		ERROR_MESSAGE("Dynamic data log path too long\n");
+	}
+}
+
+/**
+ * @brief Precomputes which dynamic parameters are logged and how often.
+ *
+ * Optional fixed parameters:
+ * - `dynamic_data_log_channels` (char, default `all`): `;`- or `,`-separated parameter names
+ *   to log. Unknown names are reported and skipped; `all` logs every dynamic parameter.
+ * - `dynamic_data_log_decimation` (int, default 1): write one row every N calls of
+ *   `continuous_logging_function`.
+ *
+ * The selected entries are copied once into `dynamicDataLogView`; on each logged step only
+ * their values are refreshed, so the backend formats and writes the selected columns only.
+ *
+ * @param dynamic_data Dynamic parameter array that will be logged.
+ * @param fixed_data   Pointer to the fixed data parameter array.
+ */
+static void build_dynamic_data_log_plan(const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	free(dynamicDataLogIndex);
+	free(dynamicDataLogView.params);
+	dynamicDataLogIndex = NULL;
+	dynamicDataLogView.params = NULL;
+	dynamicDataLogView.n_param = 0;
+	dynamicDataLogStep = 0;
+
+	dynamicDataLogDecimation = get_param_int_or_default(fixed_data, "dynamic_data_log_decimation", 1);
+	if (dynamicDataLogDecimation < 1)
+	{
+		ERROR_MESSAGE("dynamic_data_log_decimation must be >= 1, got %d; using 1\n", dynamicDataLogDecimation);
+		dynamicDataLogDecimation = 1;
+	}
+
+	const char *channels = get_param_string_or_default(fixed_data, "dynamic_data_log_channels", "all");
+	char **names = NULL;
+	const int n_names = parse_delimited_list(channels, &names);
+	if (n_names <= 0 || (n_names == 1 && strcmp(names[0], "all") == 0))
+	{
+		free_delimited_list(names, n_names);
+		return;
+	}
+
+	dynamicDataLogIndex = malloc((size_t)n_names * sizeof(int));
+	dynamicDataLogView.params = malloc((size_t)n_names * sizeof(input_param_t));
+	if (!dynamicDataLogIndex || !dynamicDataLogView.params)
+	{
+		ERROR_MESSAGE("Failed to allocate dynamic data log plan, logging all parameters\n");
+		free(dynamicDataLogIndex);
+		free(dynamicDataLogView.params);
+		dynamicDataLogIndex = NULL;
+		dynamicDataLogView.params = NULL;
+		free_delimited_list(names, n_names);
+		return;
+	}
+
+	for (int k = 0; k < n_names; k++)
+	{
+		const param_handle_t found = get_param_handle(dynamic_data, names[k]);
+		if (found == PARAM_HANDLE_INVALID)
+		{
+			ERROR_MESSAGE("dynamic_data_log_channels: '%s' is not a dynamic parameter, skipping\n", names[k]);
+			continue;
+		}
+		dynamicDataLogIndex[dynamicDataLogView.n_param] = found;
+		dynamicDataLogView.params[dynamicDataLogView.n_param] = dynamic_data->params[found];
+		dynamicDataLogView.n_param++;
+	}
+	free_delimited_list(names, n_names);
+
+	if (dynamicDataLogView.n_param == 0)
+	{
+		ERROR_MESSAGE("dynamic_data_log_channels selected no parameters, logging all parameters\n");
+		free(dynamicDataLogIndex);
+		free(dynamicDataLogView.params);
+		dynamicDataLogIndex = NULL;
+		dynamicDataLogView.params = NULL;
+		return;
+	}
+
+	log_message("Logging %d of %d dynamic parameters every %d step(s)\n", dynamicDataLogView.n_param, dynamic_data->n_param, dynamicDataLogDecimation);
+}
+
+/**
+ * @brief Returns the array the logger backend should write for this step.
+ *
+ * Without a channel selection this is `dynamic_data` itself; otherwise the compact view with
+ * the selected values refreshed from `dynamic_data`.
+ */
+static const param_array_t *dynamic_data_log_view(const param_array_t *dynamic_data)
+{
+	if (!dynamicDataLogIndex)
+	{
+		return dynamic_data;
+	}
+	for (int k = 0; k < dynamicDataLogView.n_param; k++)
+	{
+		dynamicDataLogView.params[k].value = dynamic_data->params[dynamicDataLogIndex[k]].value;
+	}
+	return &dynamicDataLogView;
+}
+
+/**
+ * @brief Opens the min/max pyramid companion of the dynamic data log when requested.
+ *
+ * Optional fixed parameters:
+ * - `dynamic_data_log_pyramid` (int, default 1): > 0 writes `<log stem>.xfepyr` next to the log.
+ * - `dynamic_data_log_pyramid_factor` (int, default 10): rows per level-0 record and ratio
+ *   between consecutive levels.
+ * - `dynamic_data_log_pyramid_levels` (int, default 3): number of levels.
+ *
+ * A pyramid that cannot be opened is reported and logging continues without it.
+ *
+ * @param log_view   Logged parameters, as handed to the backend.
+ * @param fixed_data Pointer to the fixed data parameter array.
+ */
+static void open_dynamic_data_log_pyramid(const param_array_t *log_view, const param_array_t *fixed_data)
+{
+	if (get_param_int_or_default(fixed_data, "dynamic_data_log_pyramid", 1) <= 0 || !dynamicDataCsvLoggerFile)
+	{
+		return;
+	}
+	const int factor = get_param_int_or_default(fixed_data, "dynamic_data_log_pyramid_factor", LOG_PYRAMID_DEFAULT_FACTOR);
+	const int n_levels = get_param_int_or_default(fixed_data, "dynamic_data_log_pyramid_levels", LOG_PYRAMID_DEFAULT_LEVELS);
+	if (log_pyramid_open(&dynamicDataLogPyramid, dynamicDataLoggerPath, log_view, dynamicDataCsvLoggerFile, factor, n_levels) != 0)
+	{
+		ERROR_MESSAGE("Continuing without the dynamic data log pyramid\n");
+	}
+}
+
+/**
+ * @brief Row writer of the background logger: folds the row into the pyramid, then writes it.
+ */
+static int write_dynamic_data_row_with_pyramid(FILE *file, const struct timespec ts, const param_array_t *data)
+{
+	log_pyramid_add_row(&dynamicDataLogPyramid, file, data);
+	return dynamicDataRowWriter(file, ts, data);
+}
+
+/**
+ * @brief Starts the background writer on the opened dynamic data log.
+ *
+ * The overflow policy (`block` or `drop`) is read from the fixed parameter @p overflow_key,
+ * falling back to @p default_overflow, the capacity from `dynamic_data_logger_ring_rows`.
+ * Logs and keeps logging synchronously if the writer cannot be started.
+ */
+static void launch_async_dynamic_data_logger(const param_array_t *dynamic_data, const param_array_t *fixed_data, const char *overflow_key, const char *default_overflow)
+{
+	const char *overflow_name = get_param_string_or_default(fixed_data, overflow_key, default_overflow);
+	async_logger_overflow_t overflow = ASYNC_LOGGER_OVERFLOW_BLOCK;
+	if (strcmp(overflow_name, "drop") == 0)
+	{
+		overflow = ASYNC_LOGGER_OVERFLOW_DROP;
+	}
+	else if (strcmp(overflow_name, "block") != 0)
+	{
+		ERROR_MESSAGE("Unknown %s '%s', using block\n", overflow_key, overflow_name);
+	}
+
+	const int ring_rows = get_param_int_or_default(fixed_data, "dynamic_data_logger_ring_rows", ASYNC_LOGGER_DEFAULT_RING_ROWS);
+	if (async_logger_start(dynamicDataCsvLoggerFile, write_dynamic_data_row_with_pyramid, dynamic_data, ring_rows, overflow) != 0)
+	{
+		ERROR_MESSAGE("Falling back to synchronous dynamic data logging\n");
+	}
+}
+
+/**
+ * @brief Hands the opened dynamic data log over to the background writer when requested.
+ *
+ * Optional fixed parameters:
+ * - `dynamic_data_logger_async` (int, default 0): > 0 moves formatting and writing to a
+ *   background thread fed by a lock-free ring of snapshots.
+ * - `dynamic_data_logger_ring_rows` (int, default 4096): ring capacity in rows.
+ * - `dynamic_data_logger_overflow` (`block` or `drop`, default `block`): whether a full ring
+ *   stalls the simulation step or discards the row and counts it.
+ *
+ * Falls back to synchronous logging if the writer cannot be started.
+ *
+ * @param dynamic_data Dynamic parameter array whose layout the snapshots copy.
+ * @param fixed_data   Pointer to the fixed data parameter array.
+ */
+static void start_async_dynamic_data_logger(const param_array_t *dynamic_data, const param_array_t *fixed_data)
+{
+	if (get_param_int_or_default(fixed_data, "dynamic_data_logger_async", 0) <= 0 || !dynamicDataCsvLoggerFile)
+	{
+		return;
+	}
+	launch_async_dynamic_data_logger(dynamic_data, fixed_data, "dynamic_data_logger_overflow", "block");
+}
+#endif
+
+/**
+ * @brief Moves continuous dynamic data logging off the caller's thread, for hosts that own the time step.
+ *
+ * Used by the DISCON path, where each CSV row would otherwise be formatted inside QBlade's
+ * step. Starts the background writer unless it is already running or continuous logging is
+ * off. A full ring drops rows unless the fixed parameter `deferred_logging_overflow` is
+ * `block`, so a slow disk never stalls the host.
+ *
+ * @param dynamic_data Dynamic parameter array passed to `initialize_control_system`.
+ * @param fixed_data   Pointer to the fixed data parameter array.
+ */
+void defer_dynamic_data_logging(MAYBE_UNUSED const param_array_t *dynamic_data, MAYBE_UNUSED const param_array_t *fixed_data)
+{
+#if defined(LOGGING_DYNAMIC_DATA_CONTINUOUS) && defined(DYNAMIC_DATA_FULL_PATH)
+	if (async_logger_running() || !dynamicDataCsvLoggerFile || !is_dynamic_logging_enabled(fixed_data))
+	{
+		return;
+	}
+	launch_async_dynamic_data_logger(dynamic_data_log_view(dynamic_data), fixed_data, "deferred_logging_overflow", "drop");
+#endif
+}
+
 /**
  * @brief Saves dynamic and fixed parameter data to CSV at shutdown based on logging configuration.
  *
@@ -835,7 +1265,14 @@ void save_dynamic_fixed_data_at_shutdown(MAYBE_UNUSED const param_array_t *dynam
 	{
 #if defined(LOGGING_DYNAMIC_DATA_CONTINUOUS) && defined(DYNAMIC_DATA_FULL_PATH)
 		// save_param_array_data_to_csv(DYNAMIC_DATA_FULL_PATH, dynamic_data, 0);
-		dynamic_data_csv_logger(&dynamicDataCsvLoggerFile, CSV_LOGGER_CLOSE, DYNAMIC_DATA_FULL_PATH, dynamic_data);
+		async_logger_stop(); // drain queued rows before the backend flushes and closes the file
+		log_pyramid_close(&dynamicDataLogPyramid);
+		dynamicDataLogger(&dynamicDataCsvLoggerFile, CSV_LOGGER_CLOSE, dynamicDataLoggerPath, dynamic_data_log_view(dynamic_data));
+		free(dynamicDataLogIndex);
+		free(dynamicDataLogView.params);
+		dynamicDataLogIndex = NULL;
+		dynamicDataLogView.params = NULL;
+		dynamicDataLogView.n_param = 0;
 #endif
 #if defined(LOGGING_DYNAMIC_DATA_CONTINUOUS) && defined(FIXED_DATA_FULL_PATH)
 		save_param_array_data_to_csv(FIXED_DATA_FULL_PATH, fixed_data, 1);
@@ -846,8 +1283,9 @@ void save_dynamic_fixed_data_at_shutdown(MAYBE_UNUSED const param_array_t *dynam
 /**
  * @brief Sets up all control system data structures, including parameter arrays, an optimized history update list, and optional logging.
  *
- * Allocates and initializes the dynamic and fixed parameter arrays, then reads the
- * main configuration CSV file to populate them. After populating the arrays, it
+ * Allocates and initializes the dynamic and fixed parameter arrays, then populates them
+ * with `load_config()`: from the parent's shared config snapshot when one was inherited,
+ * otherwise by reading the main configuration CSV file once. After populating the arrays, it
  * inspects the dynamic data to create and return an optimized list of tasks for
  * updating parameter histories during the simulation.
  *
@@ -878,7 +1316,10 @@ void initialize_control_system(param_array_t **dynamic_data, param_array_t **fix
 	set_int_param(*dynamic_data, 0, "initialize", 1); //
 	set_int_param(*fixed_data, 0, "initialize", 1);   //
 
-	read_csv_and_store(SYSTEM_CONFIG_FULL_PATH, *dynamic_data, *fixed_data); //
+	// parsed once by the first process, children copy the parent's snapshot instead of re-reading the CSV
+	load_config(SYSTEM_CONFIG_FULL_PATH, *dynamic_data, *fixed_data);
+	build_param_index(*dynamic_data);
+	build_param_index(*fixed_data);
 
 	// --- Part 3: Create the history task list ---
 	// The create function is called, and the result is assigned to the output parameter.
@@ -918,8 +1359,12 @@ void initialize_control_system(param_array_t **dynamic_data, param_array_t **fix
 		// Use the helper function with the now-populated fixed_data.
 		if (is_dynamic_logging_enabled(*fixed_data) && LOGGING_DYNAMIC_DATA_CONTINUOUS)
 		{
+			select_dynamic_data_logger(*fixed_data);
+			build_dynamic_data_log_plan(*dynamic_data, *fixed_data);
 			dynamicDataCsvLoggerFile = NULL;
-			dynamic_data_csv_logger(&dynamicDataCsvLoggerFile, CSV_LOGGER_INIT, DYNAMIC_DATA_FULL_PATH, *dynamic_data);
+			dynamicDataLogger(&dynamicDataCsvLoggerFile, CSV_LOGGER_INIT, dynamicDataLoggerPath, dynamic_data_log_view(*dynamic_data));
+			open_dynamic_data_log_pyramid(dynamic_data_log_view(*dynamic_data), *fixed_data);
+			start_async_dynamic_data_logger(dynamic_data_log_view(*dynamic_data), *fixed_data);
 		}
 #endif
 
@@ -957,7 +1402,18 @@ void continuous_logging_function(const param_array_t *dynamic_data, const param_
 #if defined(LOGGING_DYNAMIC_DATA_CONTINUOUS) && defined(DYNAMIC_DATA_FULL_PATH)
 	if (LOGGING_DYNAMIC_DATA_CONTINUOUS)
 	{
-		dynamic_data_csv_logger(&dynamicDataCsvLoggerFile, CSV_LOGGER_LOG, DYNAMIC_DATA_FULL_PATH, dynamic_data);
+		if ((dynamicDataLogStep++ % dynamicDataLogDecimation) != 0)
+		{
+			return;
+		}
+		const param_array_t *log_view = dynamic_data_log_view(dynamic_data);
+		if (async_logger_running())
+		{
+			async_logger_push(log_view);
+			return;
+		}
+		log_pyramid_add_row(&dynamicDataLogPyramid, dynamicDataCsvLoggerFile, log_view);
+		dynamicDataLogger(&dynamicDataCsvLoggerFile, CSV_LOGGER_LOG, dynamicDataLoggerPath, log_view);
 		// save_param_array_data_to_csv(DYNAMIC_DATA_FULL_PATH, dynamic_data, 0);
 	}
 #endif
@@ -981,246 +1437,201 @@ void load_double_struct_param(const param_array_t *data, const char *param_name,
 	*param = *temp_ptr;
 }
 
-void cleanup_stale_shared_memory(void)
-{
-#ifdef _WIN32
-	HANDLE h = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, shmemName);
-	if (h != NULL)
-	{
-		log_message("Found stale shared memory '%s', cleaning up...\n", shmemName);
-		CloseHandle(h);
-		// Give Windows a moment to clean up
-		Sleep(10);
-	}
-#else
-	shm_unlink(shmemName);
-#endif
-}
+// Segment published by this process (parent) or attached to (child) through the wrappers below.
+static char sharedInterpName[FLOW_SHMEM_SEGMENT_NAME_MAX] = "";
+static flow_shmem_view_t sharedInterpView;
 
 /**
- * @brief Creates or resets a shared memory region and populates it with precomputed interpolation data.
- *
- * Allocates a shared memory segment sized for `num_sim_steps` doubles, maps it into the process’s
- * address space, and copies the array `precomputed_wind_interp` into that region. On Windows, uses
- * `CreateFileMapping()` and `MapViewOfFile()`, retaining the mapping handle in `gHMapFile`. On POSIX,
- * unlinks any existing object, then uses `shm_open()`, `ftruncate()`, and `mmap()` before unmapping.
+ * @brief Publishes the precomputed interpolation array in a run-unique shared memory segment.
+ *
+ * The segment name is `<flow_shmem_prefix>_<pid>` (fixed parameter `flow_shmem_prefix`,
+ * default `FLOW_SHMEM_DEFAULT_PREFIX`), so concurrent runs on one machine never share a
+ * segment. The name is exported through the `FLOW_SHMEM_ENV_NAME` environment variable,
+ * which child processes inherit, and returned by `shared_interp_name()` so the caller can
+ * also record it in the config. The segment header carries dt, count and a checksum, which
+ * `get_shared_interp()` validates instead of recomputing the size.
  * Logs an error and terminates the program on failure.
  *
+ * @param fixed_data               Fixed parameters (`flow_shmem_prefix`).
+ * @param series_name              Name children look the series up by, e.g. the flow file name.
  * @param precomputed_wind_interp  Pointer to an array of `num_sim_steps` doubles containing
  *                                 the precomputed interpolation values to share.
  * @param num_sim_steps            Number of steps (elements) in the `precomputed_wind_interp` array.
+ * @param dt_sec                   Spacing of the samples in seconds.
+ * @param total_time               Length of the source flow series in seconds.
  */
-
-#ifdef _WIN32
-static LPVOID gSharedView = NULL; // Add this global alongside gHMapFile
-#endif
-void create_shared_interp(const double *precomputed_wind_interp, int num_sim_steps)
+void create_shared_interp(const param_array_t *fixed_data, const char *series_name, const double *precomputed_wind_interp, const int num_sim_steps, const double dt_sec, const double total_time)
 {
-	cleanup_stale_shared_memory();
-	size_t shm_size = num_sim_steps * sizeof(double);
-
-#ifdef _WIN32
-	SECURITY_ATTRIBUTES sa;
-	sa.nLength = sizeof(sa);
-	sa.lpSecurityDescriptor = NULL;
-	sa.bInheritHandle = TRUE;
-
-	// Try to open existing first to detect if it exists
-	HANDLE h_existing = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, shmemName);
-	if (h_existing != NULL)
+	const char *prefix = get_param_string_or_default(fixed_data, "flow_shmem_prefix", FLOW_SHMEM_DEFAULT_PREFIX);
+	if (flow_shmem_make_name(sharedInterpName, sizeof(sharedInterpName), prefix) != 0)
 	{
-		DWORD size_high = 0;
-		DWORD size_low = GetFileSize(h_existing, &size_high);
-		log_message("WARNING: Shared memory already exists! Existing size: %lu bytes\n", size_low);
-		CloseHandle(h_existing);
-	}
-
-	gHMapFile = CreateFileMapping(
-		INVALID_HANDLE_VALUE,
-		&sa,
-		PAGE_READWRITE,
-		0,
-		(DWORD)shm_size,
-		shmemName
-	);
-
-	if (gHMapFile == NULL)
-	{
-		ERROR_MESSAGE("CreateFileMapping failed: %ld\n", GetLastError());
 		exit(EXIT_FAILURE);
 	}
 
-	DWORD last_error = GetLastError();
-	if (last_error == ERROR_ALREADY_EXISTS)
+	const flow_shmem_series_desc_t series = {.name = series_name, .values = precomputed_wind_interp, .count = num_sim_steps, .dt = dt_sec, .total_time = total_time};
+	if (flow_shmem_publish(sharedInterpName, &series, 1) != 0)
 	{
-		log_message("Warning: Opened existing shared memory object. Data may be stale.\n");
+		ERROR_MESSAGE("Failed to publish shared interpolation data in %s\n", sharedInterpName);
+		exit(EXIT_FAILURE);
 	}
 
-	gSharedView = MapViewOfFile(
-		gHMapFile,
-		FILE_MAP_ALL_ACCESS,
-		0,
-		0,
-		shm_size
-	);
-
-	if (gSharedView == NULL)
+#ifdef _WIN32
+	if (_putenv_s(FLOW_SHMEM_ENV_NAME, sharedInterpName) != 0)
+#else
+	if (setenv(FLOW_SHMEM_ENV_NAME, sharedInterpName, 1) != 0)
+#endif
 	{
-		ERROR_MESSAGE("MapViewOfFile failed: %ld\n", GetLastError());
-		CloseHandle(gHMapFile);
-		gHMapFile = NULL;
-		exit(EXIT_FAILURE);
+		ERROR_MESSAGE("Failed to export %s=%s\n", FLOW_SHMEM_ENV_NAME, sharedInterpName);
 	}
+}
 
-	// Copy the precomputed data into shared memory
-	safe_memcpy(gSharedView, shm_size, precomputed_wind_interp, shm_size);
-	log_message("Just created %s\n", shmemName);
+/**
+ * @brief Name of the segment created by `create_shared_interp()`, or "" if none.
+ */
+const char *shared_interp_name(void)
+{
+	return sharedInterpName;
+}
 
-#else
-	// POSIX: Remove any existing shared memory object.
-	shm_unlink(shmemName);
+/**
+ * @brief Releases the shared interpolation segment.
+ *
+ * In the publishing process the segment is removed (children that already mapped it keep
+ * their view); in a child the mapping from `get_shared_interp()` is unmapped.
+ */
+void destroy_shared_interp(void)
+{
+	flow_shmem_detach(&sharedInterpView);
+	flow_shmem_unpublish();
+}
 
-	// Create (or open) a shared memory object.
-	int shm_fd = shm_open(shmemName, O_CREAT | O_RDWR, 0666);
-	if (shm_fd == -1)
+/**
+ * @brief Maps a published interpolation series read-only and validates it against the segment header.
+ *
+ * The segment name is taken from the `FLOW_SHMEM_ENV_NAME` environment variable when the
+ * process inherited it from its parent, otherwise from `segment_name` (e.g. the
+ * `flow_shmem_name` config value the parent wrote). The sample count comes from the
+ * header rather than from `flow_total_time / dt_sec`, and the series dt must match `dt_sec`.
+ *
+ * @param segment_name        Fallback segment name when the environment variable is not set.
+ * @param series_name         Series to look up, or NULL for the first series in the segment.
+ * @param dt_sec              Simulation step the caller indexes the series with.
+ * @param[out] num_sim_steps  Number of samples in the series.
+ * @param[out] total_time     Length of the source flow series in seconds (may be NULL).
+ * @return                    Zero-copy pointer into the segment; released by `destroy_shared_interp()`.
+ *                            Logs an error and terminates the program on failure.
+ */
+const double *get_shared_interp(const char *segment_name, const char *series_name, const double dt_sec, int *num_sim_steps, double *total_time)
+{
+	const char *inherited = getenv(FLOW_SHMEM_ENV_NAME);
+	const char *name = (inherited && inherited[0] != '\0') ? inherited : segment_name;
+	if (!name || name[0] == '\0')
 	{
-		ERROR_MESSAGE("shm_open failed: %s\n", safe_strerror(errno));
+		ERROR_MESSAGE("No shared flow segment name: %s is not set and no fallback was given\n", FLOW_SHMEM_ENV_NAME);
 		exit(EXIT_FAILURE);
 	}
 
-	// Set the size of the shared memory object.
-	if (ftruncate(shm_fd, (off_t)shm_size) == -1)
+	if (flow_shmem_attach(name, &sharedInterpView) != 0)
 	{
-		ERROR_MESSAGE("ftruncate failed: %s\n", safe_strerror(errno));
-		close(shm_fd);
 		exit(EXIT_FAILURE);
 	}
-
-	// Map the shared memory into the parent's address space.
-	double *shm_ptr = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-	if (shm_ptr == MAP_FAILED)
+	const flow_shmem_series_t *entry = flow_shmem_find_series(&sharedInterpView, series_name);
+	if (!entry)
 	{
-		ERROR_MESSAGE("mmap failed: %s\n", safe_strerror(errno));
-		close(shm_fd);
+		ERROR_MESSAGE("Shared flow segment %s has no series '%s'\n", name, series_name ? series_name : "");
+		flow_shmem_detach(&sharedInterpView);
 		exit(EXIT_FAILURE);
 	}
-
-	// Copy the precomputed data into shared memory.
-	if (safe_memcpy(shm_ptr, shm_size, precomputed_wind_interp, shm_size) != 0)
+	if (fabs(entry->dt - dt_sec) > 1e-12 * fmax(1.0, fabs(dt_sec)))
 	{
-		ERROR_MESSAGE("shared memory copy failed");
+		ERROR_MESSAGE("Shared flow series '%s' was sampled at dt %g, this run uses dt_sec %g\n", entry->name, entry->dt, dt_sec);
+		flow_shmem_detach(&sharedInterpView);
 		exit(EXIT_FAILURE);
 	}
-	log_message("Just created %s\n", shmemName);
 
-	// Unmap the shared memory since it's populated.
-	if (munmap(shm_ptr, shm_size) == -1)
+	*num_sim_steps = (int)entry->count;
+	if (total_time)
 	{
-		ERROR_MESSAGE("munmap failed: %s\n", safe_strerror(errno));
-		close(shm_fd);
-		exit(EXIT_FAILURE);
+		*total_time = entry->total_time;
 	}
-	close(shm_fd);
-#endif
+	return flow_shmem_series_values(&sharedInterpView, entry);
 }
 
 /**
- * @brief Destroys the shared interpolation memory segment.
- *
- * On Windows, the shared memory is automatically released when all handles are closed.
- * On POSIX systems, unlinks the shared memory object named `shmemName`, removing it from the system.
- * Logs an error and exits on failure.
+ * @brief Sets up the shared-memory result area for a data-processing run.
+ *
+ * Enabled by the fixed parameter `result_shmem_slots` (> 0). The data-processing parent
+ * (`data_processing_first_run`) creates an area of that many rows, each with up to
+ * `result_shmem_max_columns` values. It exports the name through `RESULT_SHMEM_ENV_NAME`
+ * and records it as `result_shmem_name` in the config. Workers attach to it. From then on,
+ * `save_double_array_data_to_csv()` publishes rows into the area without locks or file I/O,
+ * and the parent writes them out in `flush_result_collection()`. Single runs and failures
+ * keep the per-row appends.
+ *
+ * @param dynamic_data  Dynamic parameters (`result_shmem_name`).
+ * @param fixed_data    Fixed parameters.
  */
-void destroy_shared_interp(void)
+void start_result_collection(const param_array_t *dynamic_data, const param_array_t *fixed_data)
 {
-#ifdef _WIN32
-	if (gSharedView != NULL)
+	const int n_slots = get_param_int_or_default(fixed_data, "result_shmem_slots", 0);
+	if (n_slots <= 0 || get_param_int_or_default(fixed_data, "data_processing_single_run_only", 0))
 	{
-		UnmapViewOfFile(gSharedView);
-		gSharedView = NULL;
+		return;
 	}
-	if (gHMapFile != NULL)
+
+	if (get_param_int_or_default(fixed_data, "data_processing_first_run", 0))
 	{
-		CloseHandle(gHMapFile);
-		gHMapFile = NULL;
-		log_message("Closed shared memory handle.\n");
-	}
+		char name[FLOW_SHMEM_SEGMENT_NAME_MAX];
+		const int max_columns = get_param_int_or_default(fixed_data, "result_shmem_max_columns", RESULT_SHMEM_DEFAULT_MAX_COLUMNS);
+		if (flow_shmem_make_name(name, sizeof(name), RESULT_SHMEM_DEFAULT_PREFIX) != 0 || result_shmem_create(name, n_slots, max_columns) != 0)
+		{
+			ERROR_MESSAGE("Result area not available, results are appended row by row\n");
+			return;
+		}
+#ifdef _WIN32
+		if (_putenv_s(RESULT_SHMEM_ENV_NAME, name) != 0)
 #else
-	if (shm_unlink(shmemName) == -1)
+		if (setenv(RESULT_SHMEM_ENV_NAME, name, 1) != 0)
+#endif
+		{
+			ERROR_MESSAGE("Failed to export %s=%s\n", RESULT_SHMEM_ENV_NAME, name);
+		}
+		set_config_override("result_shmem_name", INPUT_PARAM_STRING, name);
+		return;
+	}
+
+	const char *inherited = getenv(RESULT_SHMEM_ENV_NAME);
+	const char *name = (inherited && inherited[0] != '\0') ? inherited : get_param_string_or_default(dynamic_data, "result_shmem_name", "none");
+	if (name[0] != '\0' && strcmp(name, "none") != 0 && result_shmem_attach(name) != 0)
 	{
-		ERROR_MESSAGE("shm_unlink failed: %s\n", safe_strerror(errno));
-		exit(EXIT_FAILURE);
+		log_message("Result area %s not available, results are appended row by row\n", name);
 	}
-#endif
 }
 
 /**
- * @brief Opens and maps a shared memory segment containing precomputed interpolation data.
- *
- * On Windows, uses `OpenFileMapping()` and `MapViewOfFile()` to open and map the shared memory
- * object named `name` for read access, then closes the mapping handle.
- * On POSIX systems, calls `shm_open()` with read-only flags and uses `mmap()` to map the object.
- * In both cases, the returned pointer references a memory region of size `num_sim_steps * sizeof(double)`,
- * containing the shared interpolation data.
- *
- * @param name            Null-terminated name of the shared memory object to open.
- * @param num_sim_steps   Number of `double` elements in the shared memory region.
- * @return                Pointer to the mapped `double` array on success;
- *                        the process must not unmap or unlink it here.
+ * @brief Writes the collected rows to the results file. Only the parent that created the area writes.
  *
- * @note
- * - On Windows, the returned pointer remains valid until the view is unmapped (caller’s responsibility).
- * - On POSIX, the caller should call `munmap()` when finished.
- * - On any failure, logs an error via `ERROR_MESSAGE()` and calls `exit(EXIT_FAILURE)`.
+ * Call once, after every worker has finished and before the `ENDING` data-processing stage
+ * reads the results. The fixed parameter `result_shmem_format` selects `csv` (default,
+ * appended to the file named in `save_csv_header()`) or `binary` (`<file>.xferes`, rewritten
+ * as one block). Later calls write nothing.
  */
-double *get_shared_interp(const char *name, int num_sim_steps)
+void flush_result_collection(const param_array_t *fixed_data)
 {
-	size_t shm_size = num_sim_steps * sizeof(double);
-#ifdef _WIN32
-	HANDLE h_map_file = OpenFileMapping(
-		FILE_MAP_READ,
-		FALSE,
-		name
-	);
-	if (h_map_file == NULL)
-	{
-		ERROR_MESSAGE("OpenFileMapping failed: %ld\n", GetLastError());
-		exit(EXIT_FAILURE);
-	}
-
-	LPVOID p_buf = MapViewOfFile(
-		h_map_file,
-		FILE_MAP_READ,
-		0,
-		0,
-		shm_size
-	);
-	if (p_buf == NULL)
-	{
-		ERROR_MESSAGE("MapViewOfFile failed: %ld\n", GetLastError());
-		CloseHandle(h_map_file);
-		exit(EXIT_FAILURE);
-	}
-	CloseHandle(h_map_file);
-	return (double *)p_buf;
-#else
-	int shm_fd = shm_open(name, O_RDONLY, 0666);
-	if (shm_fd == -1)
+	if (!result_shmem_is_creator())
 	{
-		ERROR_MESSAGE("shm_open (child) failed: %s\n", safe_strerror(errno));
-		exit(EXIT_FAILURE);
+		return;
 	}
+	const bool binary = strcmp(get_param_string_or_default(fixed_data, "result_shmem_format", "csv"), "binary") == 0;
+	result_shmem_save(NULL, binary);
+}
 
-	double *interp_data = mmap(NULL, shm_size, PROT_READ, MAP_SHARED, shm_fd, 0);
-	if (interp_data == MAP_FAILED)
-	{
-		ERROR_MESSAGE("mmap (child) failed: %s\n", safe_strerror(errno));
-		close(shm_fd);
-		exit(EXIT_FAILURE);
-	}
-	close(shm_fd);
-	return interp_data;
-#endif
+/**
+ * @brief Unmaps the result area; the rows were written by `flush_result_collection()`.
+ */
+void stop_result_collection(MAYBE_UNUSED const param_array_t *fixed_data)
+{
+	result_shmem_close();
 }
 
 /**
@@ -1756,9 +2167,14 @@ double update_cpu_usage(void)
  * @param filename   Path to the CSV file where the header will be written.
  * @param sem_info   Pointer to a `semaphore_info_t` used to synchronize file access.
  * @param headers    Null-terminated array of column name strings to include after `epoch_time`.
+ *
+ * With a result area mapped, `filename` is also recorded there as the file the parent
+ * appends the collected rows to.
  */
 void save_csv_header(const char *filename, semaphore_info_t *sem_info, const char **headers)
 {
+	result_shmem_set_results_path(filename);
+
 	// Acquire the semaphore before writing to the file.
 	if (shmem_wait_check(sem_info, "dp"))
 	{
@@ -1817,9 +2233,17 @@ void save_csv_header(const char *filename, semaphore_info_t *sem_info, const cha
  * - Uses `get_monotonic_timestamp()` to obtain the current time since boot.
  * - Formats the timestamp with `TIME_FORMAT` for seconds and `.%.5ld` for fractional seconds.
  * - Ensures mutual exclusion via `shmem_wait_check()` and `shmem_post_check()`.
+ * - When `start_result_collection()` mapped a result area, the row goes into its next free
+ *   slot instead (no semaphore, no file I/O); rows only fall back to the file when it is full.
  */
 void save_double_array_data_to_csv(const char *filename, semaphore_info_t *sem_info, const double *data, int n_data)
 {
+	// With a result area mapped the row is published lock-free and written out by the parent.
+	if (result_shmem_write(data, n_data) == 0)
+	{
+		return;
+	}
+
 	// Acquire the semaphore before writing to the file
 	if (shmem_wait_check(sem_info, "dp"))
 	{
@@ -28,21 +28,36 @@
 #include <winsock2.h>
 #include <windows.h>
 // NOLINTEND(llvm-include-order)
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif
 #else
+#include <limits.h>   // for PATH_MAX
 #include <signal.h>   // For kill, SIGTERM, SIGKILL
 #include <sys/wait.h> // For waitpid, WIFEXITED, WEXITSTATUS, etc.
 #endif
 
+#include "checkpoint.h"             // for load_checkpoint, save_checkpoint
+#include "config_snapshot.h"        // for set_config_override, unpublish_config_snapshot
 #include "control_switch.h"         // for control_switch
 #include "data_processing.h"        // for data_processing, BEGINNING
+#include "ensemble.h"               // for run_ensemble_simulation
 #include "flow_gen.h"               // for flow_gen
+#include "history_ring.h"           // for update_history_rings
 #include "logger.h"                 // for log_message, ERROR_MESSAGE
 #include "maybe_unused.h"           // for MAYBE_UNUSED
 #include "numerical_integrator.h"   // for numerical_integrator
+#include "param_index.h"            // for invalidate_param_index
+#include "realtime_loop.h"          // for realtime_loop_start, realtime_loop_wait
+#include "stage_context.h"          // for reset_stage_context
+#include "stage_schedule.h"         // for init_stage_schedule, stage_is_due
+#include "stage_timing.h"           // for log_stage_timing_table
+#include "sweep_scheduler.h"        // for sweep_is_configured, run_sweep
 #include "turbine_controls.h"       // for turbine_control
 #include "xfe_control_sim_common.h" // for continuous_logging_function
 #include "xfe_control_sim_version.h"
-#include "xflow_aero_sim.h"             // for get_param, update_csv_value
+#include "xfe_log.h"                    // for xfe_log_start, xfe_log_stop
+#include "xflow_aero_sim.h"             // for get_param
 #include "xflow_core.h"                 // for get_monotonic_timestamp, clo...
 #include "xflow_modbus_server_client.h" // for childPID
 #include <errno.h>                      // for errno
@@ -167,6 +182,81 @@ void end_modbus_server(void)
 void cleanup_program(MAYBE_UNUSED int signum)
 {
 	end_modbus_server();
+	unpublish_config_snapshot();
+	xfe_log_stop(); // queued diagnostics reach the log file before it is closed
+}
+
+/**
+ * @brief State shared by every case of a sweep, set up once in `main()` before the workers start.
+ */
+typedef struct
+{
+	double **state_vars;
+	const char **state_names;
+	int num_state_vars;
+	numerical_integrator_workspace_t *integrator_workspace;
+	history_task_list_t *history_tasks;
+	const checkpoint_position_t *resume; // restored checkpoint every case continues from, NULL to start at 0
+} sweep_case_context_t;
+
+/**
+ * @brief Runs one sweep case from `time_sec` 0, or from the restored checkpoint, to `dur_sec` inside a sweep worker.
+ *
+ * Same step sequence as the normal run; continuous logging and data processing are left to
+ * the sweep scheduler, which reports the final channel values of every case.
+ */
+static void run_sweep_case(const param_array_t *dynamic_data, const param_array_t *fixed_data, void *user_data)
+{
+	const sweep_case_context_t *context = user_data;
+	static double *dt_Sec = NULL;
+	static double *dur_Sec = NULL;
+	static double *time_Sec = NULL;
+	static int *enable_Brake_Signal = NULL;
+	static double *omega = NULL;
+	static int *total_Loop_Count = NULL;
+
+	get_param(fixed_data, "dt_sec", &dt_Sec);
+	get_param(fixed_data, "dur_sec", &dur_Sec);
+	get_param(dynamic_data, "time_sec", &time_Sec);
+	get_param(dynamic_data, "enable_brake_signal", &enable_Brake_Signal);
+	get_param(dynamic_data, "omega", &omega);
+	get_param(dynamic_data, "total_loop_count", &total_Loop_Count);
+
+	stage_schedule_t schedule;
+	if (init_stage_schedule(&schedule, fixed_data, *dt_Sec, *time_Sec) != 0)
+	{
+		return;
+	}
+	if (context->resume)
+	{
+		resume_stage_schedule(&schedule, context->resume->start_time_sec, context->resume->tick);
+	}
+	while (*time_Sec < *dur_Sec && !shutdownFlag)
+	{
+		if (stage_is_due(&schedule, SCHEDULED_FLOW_GEN))
+		{
+			flow_gen(dynamic_data, fixed_data);
+		}
+
+		numerical_integrator(context->state_vars, context->state_names, context->num_state_vars, *dt_Sec, dynamic_data, fixed_data, context->integrator_workspace);
+		if (*enable_Brake_Signal != 0 && *omega < 0.5)
+		{
+			*omega = 0;
+		}
+		*time_Sec = advance_stage_schedule(&schedule);
+		update_history_rings(schedule.tick);
+
+		if (stage_is_due(&schedule, SCHEDULED_HISTORY_UPDATES))
+		{
+			perform_history_updates(*time_Sec, context->history_tasks);
+		}
+
+		if (stage_is_due(&schedule, SCHEDULED_TURBINE_CONTROL))
+		{
+			turbine_control(dynamic_data, fixed_data);
+		}
+		(*total_Loop_Count)++;
+	}
 }
 
 int main(const int argc, const char *argv[])
@@ -188,6 +278,15 @@ int main(const int argc, const char *argv[])
 		{
 			parent_pid_initial = safe_atoi(argv[++i]);
 		}
+		else if (strcmp(argv[i], "--sweep-role") == 0)
+		{
+			// lets every node share one config: `--sweep-role coordinator` on one, `worker` on the others.
+			set_config_override("sweep_role", INPUT_PARAM_STRING, argv[++i]);
+		}
+		else if (strcmp(argv[i], "--sweep-coordinator") == 0)
+		{
+			set_config_override("sweep_coordinator_address", INPUT_PARAM_STRING, argv[++i]);
+		}
 	}
 	// Initialize the signal handler to catch signals which will stop the program.
 	initialize_signal_handler();
@@ -198,19 +297,20 @@ int main(const int argc, const char *argv[])
 	if (RUN_SINGLE_MODEL_ONLY)
 	{
 		int run_single_one = 1;
-		update_csv_value(SYSTEM_CONFIG_FULL_PATH, "data_processing_single_run_only", INPUT_PARAM_INT, &run_single_one);
+		set_config_override("data_processing_single_run_only", INPUT_PARAM_INT, &run_single_one);
 		run_single_mode_only = 1;
 	}
 	else
 	{
 		int run_single_zero = 0;
-		update_csv_value(SYSTEM_CONFIG_FULL_PATH, "data_processing_single_run_only", INPUT_PARAM_INT, &run_single_zero);
+		set_config_override("data_processing_single_run_only", INPUT_PARAM_INT, &run_single_zero);
 		run_single_mode_only = 0;
 	}
 #endif
 
 	// Pass the address of the pointers (i.e., pointers to pointers)
 	initialize_control_system(&dynamic_Data, &fixed_Data, &history_Tasks, logging_status != 0);
+	xfe_log_start(fixed_Data); // log_level, and the background writer of the XFE_LOG_* messages
 	log_message("xfe-control-sim git commit info: %s\n", gitCommitInfoXfeControlSim);
 
 	static double **state_Vars = NULL; // Array of pointers to .value.d fields
@@ -219,12 +319,15 @@ int main(const int argc, const char *argv[])
 	// Get what variables are state variables for the numerical integrator
 	const int num_state_vars = init_state_bindings(dynamic_Data, &state_Vars, &state_Names);
 
+	// Scratch buffers and multistep history for the integrator, sized once for the whole run.
+	static numerical_integrator_workspace_t *integrator_Workspace = NULL;
+	integrator_Workspace = create_numerical_integrator_workspace(num_state_vars);
+
 	// log_message("parent_pid: %ld\n", parent_pid_initial);
 
 	static double *dt_Sec = NULL;
 	static double *dur_Sec = NULL;
 	static double *time_Sec = NULL;
-	static double *control_Dt_Sec = NULL;
 	static int *enable_Brake_Signal = NULL;
 	static double *omega = NULL;
 	static int *total_Loop_Count = NULL;
@@ -239,7 +342,6 @@ int main(const int argc, const char *argv[])
 	get_param(fixed_Data, "dt_sec", &dt_Sec);
 	get_param(fixed_Data, "dur_sec", &dur_Sec);
 	get_param(dynamic_Data, "time_sec", &time_Sec);
-	get_param(fixed_Data, "control_dt_sec", &control_Dt_Sec);
 	get_param(dynamic_Data, "enable_brake_signal", &enable_Brake_Signal);
 	get_param(dynamic_Data, "omega", &omega);
 	get_param(dynamic_Data, "total_loop_count", &total_Loop_Count);
@@ -253,96 +355,163 @@ int main(const int argc, const char *argv[])
 
 	// log_message("argv[0]: %s\n", argv[0]);
 
-	update_csv_value(SYSTEM_CONFIG_FULL_PATH, "program_name", INPUT_PARAM_STRING, (void *)argv[0]);
-	update_csv_value(SYSTEM_CONFIG_FULL_PATH, "program_argc", INPUT_PARAM_INT, (void *)&argc);
+	set_config_override("program_name", INPUT_PARAM_STRING, argv[0]);
+	set_config_override("program_argc", INPUT_PARAM_INT, &argc);
 
 	control_switch(dynamic_Data, fixed_Data);
 
 #ifdef BUILD_XFE_SCADA_INTERFACE
 	log_message("running BUILD_XFE_SCADA_INTERFACE\n");
-	const struct timespec programStartTime = get_monotonic_timestamp();
-	while (*time_Sec < *dur_Sec && !shutdownFlag)
+	// each iteration is released on an absolute deadline, so the period does not drift with the loop's own run time.
+	realtime_loop_t scada_loop;
+	if (realtime_loop_start(&scada_loop, *dt_Sec, fixed_Data) == 0)
 	{
-		const struct timespec while_loop_start_time = get_monotonic_timestamp();
-		flow_gen(dynamic_Data, fixed_Data);
-		numerical_integrator(state_Vars, state_Names, num_state_vars, *dt_Sec, dynamic_Data, fixed_Data);
-		*time_Sec = timespec_diff_to_double(programStartTime, get_monotonic_timestamp());
-		turbine_control(dynamic_Data, fixed_Data);
+		while (*time_Sec < *dur_Sec && !shutdownFlag)
+		{
+			flow_gen(dynamic_Data, fixed_Data);
+			numerical_integrator(state_Vars, state_Names, num_state_vars, *dt_Sec, dynamic_Data, fixed_Data, integrator_Workspace);
+			*time_Sec = realtime_loop_elapsed_sec(&scada_loop);
+			turbine_control(dynamic_Data, fixed_Data);
 
-		continuous_logging_function(dynamic_Data, fixed_Data);
+			continuous_logging_function(dynamic_Data, fixed_Data);
 
-		const double while_loop_duration_time = timespec_diff_to_double(while_loop_start_time, get_monotonic_timestamp());
-		log_message("while_loop_duration_time %f, *time_Sec: %f\n", while_loop_duration_time, *time_Sec);
-		const double sleep_time = *dt_Sec - while_loop_duration_time;
-		if (sleep_time <= 0)
-		{
-			log_message("sleep_time less than 0: %f\n", sleep_time);
-			continue;
-		}
-		else
-		{
-			const uint32_t sleep_time_command = (1e6 * sleep_time);
-			// log_message("sleep_time_command: %d\n", sleep_time_command);
-			usleep_now(sleep_time_command);
+			realtime_loop_wait(&scada_loop);
 		}
+		realtime_loop_log_statistics(&scada_loop);
+		realtime_loop_stop(&scada_loop);
 	}
 #else
 
-	// Populate the program_args struct.
-	data_processing_program_args_t dp_options = {
-		.argc = argc,
-		.argv = argv
-	};
-
-	// have new function here that checks here where we see if its the first run or not.
-	// if it is then we need to open csv file where the new data will be stored
-	// and the semephore for opening up the csv file.
-	*data_Processing_Status = BEGINNING;
-	flow_gen(dynamic_Data, fixed_Data); // call in the beginning to load in the flow time series.
-	data_processing(dynamic_Data, fixed_Data, &dp_options);
-	*data_Processing_Status = LOOPING;
-
-	static double accumulated_Time = 0.0;
-	// log_message("running normal simulation, *time_Sec: %f, *dur_Sec: %f\n", *time_Sec, *dur_Sec);
-	while (*time_Sec < *dur_Sec && !shutdownFlag && (!*data_Processing_First_Run || run_single_mode_only))
+	// checkpoint_restart continues from a checkpoint instead of t = 0; sweep cases and ensemble members all start from it.
+	checkpoint_position_t checkpoint_position = {0};
+	const bool checkpoint_restart = get_param_int_or_default(fixed_Data, "checkpoint_restart", 0) != 0;
+	const double checkpoint_save_time = get_param_double_or_default(fixed_Data, "checkpoint_save_time_sec", -1.0);
+	char checkpoint_path[PATH_MAX];
+	if ((checkpoint_restart || checkpoint_save_time >= 0.0) && checkpoint_file_path(fixed_Data, checkpoint_path, sizeof(checkpoint_path)) != 0)
 	{
-		flow_gen(dynamic_Data, fixed_Data);
+		ERROR_MESSAGE("checkpoint_file does not fit in %d characters\n", PATH_MAX);
+		shutdownFlag = 1;
+	}
+	else if (checkpoint_restart)
+	{
+		load_checkpoint(checkpoint_path, dynamic_Data, integrator_Workspace, *dt_Sec, &checkpoint_position);
+	}
 
-		numerical_integrator(state_Vars, state_Names, num_state_vars, *dt_Sec, dynamic_Data, fixed_Data);
-		if (*enable_Brake_Signal != 0 && *omega < 0.5)
+	const int ensemble_size = get_param_int_or_default(fixed_Data, "ensemble_size", 0);
+	if (ensemble_size > 0)
+	{
+		// step ensemble_size turbines side by side in structure-of-arrays layout.
+		run_ensemble_simulation(dynamic_Data, fixed_Data, ensemble_size);
+	}
+	else if (sweep_is_configured(fixed_Data))
+	{
+		// load the flow series once so every forked case starts from it.
+		flow_gen(dynamic_Data, fixed_Data);
+		sweep_case_context_t sweep_context = {
+			.state_vars = state_Vars,
+			.state_names = state_Names,
+			.num_state_vars = num_state_vars,
+			.integrator_workspace = integrator_Workspace,
+			.history_tasks = history_Tasks,
+			.resume = checkpoint_restart ? &checkpoint_position : NULL
+		};
+		run_sweep(dynamic_Data, fixed_Data, run_sweep_case, &sweep_context, state_Names, num_state_vars);
+	}
+	else
+	{
+		// Populate the program_args struct.
+		data_processing_program_args_t dp_options = {
+			.argc = argc,
+			.argv = argv
+		};
+
+		// have new function here that checks here where we see if its the first run or not.
+		// if it is then we need to open csv file where the new data will be stored
+		// and the semephore for opening up the csv file.
+		start_result_collection(dynamic_Data, fixed_Data); // optional lock-free result area shared with the workers
+		*data_Processing_Status = BEGINNING;
+		flow_gen(dynamic_Data, fixed_Data); // call in the beginning to load in the flow time series.
+		data_processing(dynamic_Data, fixed_Data, &dp_options);
+		*data_Processing_Status = LOOPING;
+
+		// stages run on whole multiples of the dt_sec base tick; see stage_schedule.h.
+		stage_schedule_t schedule;
+		const bool schedule_ready = init_stage_schedule(&schedule, fixed_Data, *dt_Sec, *time_Sec) == 0;
+		if (schedule_ready && checkpoint_restart)
 		{
-			*omega = 0;
+			resume_stage_schedule(&schedule, checkpoint_position.start_time_sec, checkpoint_position.tick);
 		}
-		*time_Sec += *dt_Sec;
-		// Add the elapsed time since the last update
-		accumulated_Time += *dt_Sec;
+		bool checkpoint_pending = checkpoint_save_time >= 0.0 && checkpoint_save_time > *time_Sec; // a restart does not overwrite its own checkpoint
+		// log_message("running normal simulation, *time_Sec: %f, *dur_Sec: %f\n", *time_Sec, *dur_Sec);
+		while (schedule_ready && *time_Sec < *dur_Sec && !shutdownFlag && (!*data_Processing_First_Run || run_single_mode_only))
+		{
+			if (stage_is_due(&schedule, SCHEDULED_FLOW_GEN))
+			{
+				flow_gen(dynamic_Data, fixed_Data);
+			}
 
-		// Update the history buffers, if needed
-		perform_history_updates(*time_Sec, history_Tasks);
+			numerical_integrator(state_Vars, state_Names, num_state_vars, *dt_Sec, dynamic_Data, fixed_Data, integrator_Workspace);
+			if (*enable_Brake_Signal != 0 && *omega < 0.5)
+			{
+				*omega = 0;
+			}
+			*time_Sec = advance_stage_schedule(&schedule);
+			update_history_rings(schedule.tick); // in-tree rings keep their own period (history_ring.h)
+
+			// Update the history buffers, if needed
+			if (stage_is_due(&schedule, SCHEDULED_HISTORY_UPDATES))
+			{
+				perform_history_updates(*time_Sec, history_Tasks);
+			}
+
+			if (stage_is_due(&schedule, SCHEDULED_TURBINE_CONTROL))
+			{
+				// call the turbine control every turbine_control_every_n_ticks (control_dt_sec by default).
+				turbine_control(dynamic_Data, fixed_Data); // update the vfd torque command
+			}
+
+			if (stage_is_due(&schedule, SCHEDULED_CONTINUOUS_LOGGING))
+			{
+				continuous_logging_function(dynamic_Data, fixed_Data);
+			}
 
-		// Check if the accumulated time has reached or exceeded control_dt_sec
-		if (accumulated_Time >= *control_Dt_Sec)
+			if (stage_is_due(&schedule, SCHEDULED_DATA_PROCESSING))
+			{
+				data_processing(dynamic_Data, fixed_Data, &dp_options); // If applicable track the requested data for processing at end of run.
+			}
+			(*total_Loop_Count)++;
+			// safe_snprintf(all_Combined, MAX_LINE_LENGTH, "char, omega: %f, count: %d", *omega, *total_Loop_Count);
+
+			if (checkpoint_pending && *time_Sec >= checkpoint_save_time - (0.5 * *dt_Sec))
+			{
+				save_checkpoint(checkpoint_path, dynamic_Data, integrator_Workspace, &schedule);
+				checkpoint_pending = false;
+			}
+		}
+		if (schedule_ready)
 		{
-			// call the turbine control every control_dt_sec timestep.
-			turbine_control(dynamic_Data, fixed_Data); // update the vfd torque command
-			accumulated_Time -= *control_Dt_Sec;       // Reset accumulated_Time, preserve any leftover time
+			log_stage_schedule_statistics(&schedule);
 		}
 
-		continuous_logging_function(dynamic_Data, fixed_Data);
-
-		data_processing(dynamic_Data, fixed_Data, &dp_options); // If applicable track the requested data for processing at end of run.
-		(*total_Loop_Count)++;
-		// safe_snprintf(all_Combined, MAX_LINE_LENGTH, "char, omega: %f, count: %d", *omega, *total_Loop_Count);
+		*data_Processing_Status = ENDING;
+		flush_result_collection(fixed_Data);                    // the workers are done: every row is in the results file before ENDING reads it
+		data_processing(dynamic_Data, fixed_Data, &dp_options); // while loop has ended so its time to complete last steps of the data processing.
+		stop_result_collection(fixed_Data);
 	}
-
-	*data_Processing_Status = ENDING;
-	data_processing(dynamic_Data, fixed_Data, &dp_options); // while loop has ended so its time to complete last steps of the data processing.
 #endif
 
 	const struct timespec program_duration = timespec_diff(time_beg, get_monotonic_timestamp());
 	log_message("Program Duration: %ld.%.5ld\n", program_duration.tv_sec, program_duration.tv_nsec / 10000);
 
 	save_dynamic_fixed_data_at_shutdown(dynamic_Data, fixed_Data, logging_status != 0);
+	log_stage_timing_table();
+
+	// release per-run stage state (flow series, mappings) held by the stage implementations.
+	reset_stage_context(NULL);
+
+	log_numerical_integrator_statistics(integrator_Workspace);
+	free_numerical_integrator_workspace(integrator_Workspace);
+	integrator_Workspace = NULL;
 
 	// Graceful shutdown code
 	if (shutdownFlag)
@@ -358,6 +527,8 @@ int main(const int argc, const char *argv[])
 			free(history_Tasks->tasks);
 			free(history_Tasks);
 		}
+		invalidate_param_index(dynamic_Data);
+		invalidate_param_index(fixed_Data);
 		free_input_data(dynamic_Data);
 		free_input_data(fixed_Data);
 	}
@@ -0,0 +1,348 @@
+/**
+ * @file    xfe_log.c
+ * @author  XFlow Energy
+ * @date    2025
+ * @brief   Leveled, rate-limited diagnostic messages formatted into a ring and written by a background thread
+ */
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * XFE-CONTROL-SIM
+ * Copyright (C) 2024-2025 XFlow Energy (https://www.xflowenergy.com/)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY and FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "xfe_log.h"
+#include "logger.h"                 // for log_message, ERROR_MESSAGE
+#include "maybe_unused.h"           // for MAYBE_UNUSED
+#include "xfe_control_sim_common.h" // for get_param_int_or_default, get_param_string_or_default
+#include "xflow_core.h"             // for get_monotonic_timestamp, usleep_now
+#include <pthread.h>                // for pthread_create, pthread_join, pthread_atfork
+#include <stdarg.h>                 // for va_list, va_start, va_end
+#include <stdatomic.h>              // for atomic_size_t, atomic_load_explicit, ...
+#include <stdint.h>                 // for int64_t
+#include <stdio.h>                  // for vsnprintf
+#include <stdlib.h>                 // for calloc, free
+#include <string.h>                 // for strcmp, strlen
+#include <time.h>                   // for timespec
+
+#define XFE_LOG_IDLE_SLEEP_US 1000U // writer back-off when the ring is empty
+#define XFE_LOG_NSEC_PER_SEC 1000000000LL
+
+/**
+ * @brief One queued message; `sequence` hands the slot between the producers and the writer.
+ */
+typedef struct
+{
+	atomic_size_t sequence; // == position: free, == position + 1: filled, read by the writer
+	int level;
+	long suppressed;
+	int64_t stamp_ns;
+	char text[XFE_LOG_RECORD_TEXT];
+} xfe_log_record_t;
+
+/*
+ * Bounded multi-producer/single-consumer ring (per-slot sequence numbers). Any thread may
+ * log: producers claim a position with a CAS on `head`, format into the slot and publish it
+ * through its sequence. The writer thread is the only reader and owns `tail`. A full ring
+ * drops the message and counts it; logging never blocks the caller.
+ */
+typedef struct
+{
+	xfe_log_record_t *records;
+	size_t capacity; // power of two
+	size_t mask;
+	atomic_size_t head;
+	size_t tail; // writer-only
+	atomic_bool running;
+	atomic_bool stop;
+	atomic_long dropped;
+	size_t written; // writer-only
+	pthread_t thread;
+} xfe_log_queue_t;
+
+static xfe_log_queue_t xfeLog;
+static atomic_int runtimeLogLevel = XFE_LOG_LEVEL_INFO;
+static int64_t logStartNs;
+static bool atforkRegistered = false;
+
+static const char *const levelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+static int64_t log_now_ns(void)
+{
+	const struct timespec ts = get_monotonic_timestamp();
+	return ((int64_t)ts.tv_sec * XFE_LOG_NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+/**
+ * @brief Writes one message through `log_message`, with its level, time and suppressed count.
+ */
+static void emit_record(const int level, const long suppressed, const int64_t stamp_ns, const char *text)
+{
+	size_t len = strlen(text);
+	if (len > 0 && text[len - 1] == '\n')
+	{
+		len--;
+	}
+	const double elapsed_sec = (double)(stamp_ns - logStartNs) / (double)XFE_LOG_NSEC_PER_SEC;
+	if (suppressed > 0)
+	{
+		log_message("[%s +%.3f s] %.*s (%ld similar messages suppressed)\n", levelNames[level], elapsed_sec, (int)len, text, suppressed);
+	}
+	else
+	{
+		log_message("[%s +%.3f s] %.*s\n", levelNames[level], elapsed_sec, (int)len, text);
+	}
+}
+
+static void *xfe_log_thread(MAYBE_UNUSED void *arg)
+{
+	for (;;)
+	{
+		xfe_log_record_t *record = &xfeLog.records[xfeLog.tail & xfeLog.mask];
+		if (atomic_load_explicit(&record->sequence, memory_order_acquire) != xfeLog.tail + 1)
+		{
+			if (atomic_load_explicit(&xfeLog.stop, memory_order_acquire))
+			{
+				// `running` went false before `stop`: drain what was claimed, including slots still being filled.
+				if (atomic_load_explicit(&xfeLog.head, memory_order_acquire) == xfeLog.tail)
+				{
+					break;
+				}
+				continue;
+			}
+			usleep_now(XFE_LOG_IDLE_SLEEP_US);
+			continue;
+		}
+
+		emit_record(record->level, record->suppressed, record->stamp_ns, record->text);
+		atomic_store_explicit(&record->sequence, xfeLog.tail + xfeLog.capacity, memory_order_release);
+		xfeLog.tail++;
+		xfeLog.written++;
+	}
+	return NULL;
+}
+
+/**
+ * @brief A forked child has no writer thread; its messages go straight to `log_message`.
+ */
+static void xfe_log_atfork_child(void)
+{
+	atomic_store_explicit(&xfeLog.running, false, memory_order_relaxed);
+}
+
+/**
+ * @brief Parses a `log_level` name, case-sensitive.
+ *
+ * @return The level, or -1 for an unknown name.
+ */
+static int parse_log_level(const char *name)
+{
+	static const char *const LevelKeys[] = {"debug", "info", "warn", "error", "off"};
+	for (int level = XFE_LOG_LEVEL_DEBUG; level <= XFE_LOG_LEVEL_OFF; level++)
+	{
+		if (strcmp(name, LevelKeys[level]) == 0)
+		{
+			return level;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Applies the runtime level and, unless disabled, starts the background writer.
+ *
+ * Fixed parameters (all optional):
+ * - `log_level`: `debug`, `info` (default), `warn`, `error` or `off`; messages below it are
+ *   dropped at the call site. Levels below the compile-time `XFE_LOG_MIN_LEVEL` never reach it.
+ * - `log_async`: 1 (default) formats into a ring of `log_ring_records` (default
+ *   `XFE_LOG_DEFAULT_RING_RECORDS`) messages that a background thread writes; 0 writes in the caller.
+ *
+ * Call after the log file is open; `xfe_log_stop()` must run before it is closed.
+ *
+ * @param fixed_data  Fixed parameters.
+ * @return 0 on success, -1 (reported) if the writer could not start; logging then stays synchronous.
+ */
+int xfe_log_start(const param_array_t *fixed_data)
+{
+	logStartNs = log_now_ns();
+
+	const char *level_name = get_param_string_or_default(fixed_data, "log_level", "info");
+	const int level = parse_log_level(level_name);
+	if (level < 0)
+	{
+		ERROR_MESSAGE("Unknown log_level '%s', expected debug, info, warn, error or off; using info\n", level_name);
+	}
+	atomic_store(&runtimeLogLevel, level < 0 ? XFE_LOG_LEVEL_INFO : level);
+
+	if (atomic_load(&xfeLog.running) || get_param_int_or_default(fixed_data, "log_async", 1) <= 0)
+	{
+		return 0;
+	}
+
+	const int ring_records = get_param_int_or_default(fixed_data, "log_ring_records", XFE_LOG_DEFAULT_RING_RECORDS);
+	size_t capacity = 1;
+	while (capacity < (size_t)(ring_records > 1 ? ring_records : 2))
+	{
+		capacity <<= 1U;
+	}
+
+	xfeLog.records = calloc(capacity, sizeof(xfe_log_record_t));
+	if (!xfeLog.records)
+	{
+		ERROR_MESSAGE("Failed to allocate a log ring of %zu records\n", capacity);
+		return -1;
+	}
+	for (size_t i = 0; i < capacity; i++)
+	{
+		atomic_init(&xfeLog.records[i].sequence, i);
+	}
+	xfeLog.capacity = capacity;
+	xfeLog.mask = capacity - 1;
+	xfeLog.tail = 0;
+	xfeLog.written = 0;
+	atomic_store(&xfeLog.head, 0);
+	atomic_store(&xfeLog.dropped, 0);
+	atomic_store(&xfeLog.stop, false);
+
+	if (!atforkRegistered)
+	{
+		atforkRegistered = pthread_atfork(NULL, NULL, xfe_log_atfork_child) == 0;
+	}
+	if (!atforkRegistered || pthread_create(&xfeLog.thread, NULL, xfe_log_thread, NULL) != 0)
+	{
+		ERROR_MESSAGE("Failed to start the log writer thread, logging synchronously\n");
+		free(xfeLog.records);
+		xfeLog.records = NULL;
+		return -1;
+	}
+	atomic_store_explicit(&xfeLog.running, true, memory_order_release);
+	return 0;
+}
+
+/**
+ * @brief Drains the queued messages, joins the writer and frees the ring. Safe to call when not started.
+ *
+ * Later messages are written synchronously. Call once the threads that log have finished.
+ */
+void xfe_log_stop(void)
+{
+	if (!atomic_load(&xfeLog.running))
+	{
+		return;
+	}
+	atomic_store_explicit(&xfeLog.running, false, memory_order_release);
+	atomic_store_explicit(&xfeLog.stop, true, memory_order_release);
+	if (pthread_join(xfeLog.thread, NULL) != 0)
+	{
+		ERROR_MESSAGE("Failed to join the log writer thread\n");
+	}
+
+	const long dropped = atomic_load(&xfeLog.dropped);
+	if (dropped > 0)
+	{
+		log_message("Log writer: %zu messages written, %ld dropped on a full ring\n", xfeLog.written, dropped);
+	}
+	free(xfeLog.records);
+	xfeLog.records = NULL;
+}
+
+/**
+ * @brief True when messages of @p level pass the runtime `log_level`.
+ */
+bool xfe_log_level_enabled(const int level)
+{
+	return level >= atomic_load_explicit(&runtimeLogLevel, memory_order_relaxed);
+}
+
+/**
+ * @brief Rate limit of one call site: lets one call per @p period_sec through.
+ *
+ * @return -1 when the call is suppressed, otherwise the number of calls suppressed since the
+ *         site last logged.
+ */
+long xfe_log_site_pass(xfe_log_site_t *site, const double period_sec)
+{
+	const int64_t now_ns = log_now_ns();
+	int64_t next_ns = atomic_load_explicit(&site->next_ns, memory_order_relaxed);
+	if (now_ns < next_ns || !atomic_compare_exchange_strong_explicit(&site->next_ns, &next_ns, now_ns + (int64_t)(period_sec * (double)XFE_LOG_NSEC_PER_SEC), memory_order_relaxed, memory_order_relaxed))
+	{
+		atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+		return -1;
+	}
+	return atomic_exchange_explicit(&site->suppressed, 0, memory_order_relaxed);
+}
+
+/**
+ * @brief Formats one message and queues it for the writer thread, or writes it when none is running.
+ *
+ * Use through the `XFE_LOG_*` macros so sub-threshold levels compile out. Text longer than
+ * `XFE_LOG_RECORD_TEXT` bytes is truncated. With the ring full the message is dropped and counted.
+ *
+ * @param level       `XFE_LOG_LEVEL_DEBUG` to `XFE_LOG_LEVEL_ERROR`.
+ * @param suppressed  Calls the rate limit dropped before this one, appended to the message.
+ * @param format      printf format.
+ */
+void xfe_log_write(const int level, const long suppressed, const char *format, ...)
+{
+	if (level < XFE_LOG_LEVEL_DEBUG || level > XFE_LOG_LEVEL_ERROR || !xfe_log_level_enabled(level))
+	{
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	if (!atomic_load_explicit(&xfeLog.running, memory_order_acquire))
+	{
+		char text[XFE_LOG_RECORD_TEXT];
+		(void)vsnprintf(text, sizeof(text), format, args);
+		va_end(args);
+		emit_record(level, suppressed, log_now_ns(), text);
+		return;
+	}
+
+	// claim a free slot: its sequence equals the position while the writer has released it.
+	size_t position = atomic_load_explicit(&xfeLog.head, memory_order_relaxed);
+	xfe_log_record_t *record = NULL;
+	for (;;)
+	{
+		record = &xfeLog.records[position & xfeLog.mask];
+		const size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+		if (sequence == position)
+		{
+			if (atomic_compare_exchange_weak_explicit(&xfeLog.head, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (sequence < position)
+		{
+			va_end(args);
+			atomic_fetch_add_explicit(&xfeLog.dropped, 1, memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			position = atomic_load_explicit(&xfeLog.head, memory_order_relaxed);
+		}
+	}
+
+	(void)vsnprintf(record->text, sizeof(record->text), format, args);
+	va_end(args);
+	record->level = level;
+	record->suppressed = suppressed;
+	record->stamp_ns = log_now_ns();
+	atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+}